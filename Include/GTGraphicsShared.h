@@ -78,11 +78,15 @@
 
 // SceneGraph
 #include <Graphics/GteMeshFactory.h>
+#include <Graphics/GteMeshOptimizer.h>
 
 // SceneGraph/Controllers
+#include <Graphics/GteAnimationClip.h>
 #include <Graphics/GteBlendTransformController.h>
+#include <Graphics/GteClipController.h>
 #include <Graphics/GteControlledObject.h>
 #include <Graphics/GteController.h>
+#include <Graphics/GteControllerScheduler.h>
 #include <Graphics/GteIKController.h>
 #include <Graphics/GteKeyframeController.h>
 #include <Graphics/GteMorphController.h>
@@ -103,6 +107,7 @@
 #include <Graphics/GteParticles.h>
 #include <Graphics/GtePVWUpdater.h>
 #include <Graphics/GteSpatial.h>
+#include <Graphics/GteSpatialHierarchy.h>
 #include <Graphics/GteTrackball.h>
 #include <Graphics/GteTrackcylinder.h>
 #include <Graphics/GteTransform.h>
@@ -123,6 +128,7 @@
 // SceneGraph/Visibility
 #include <Graphics/GteCuller.h>
 #include <Graphics/GteCullingPlane.h>
+#include <Graphics/GteOcclusionCuller.h>
 
 // Shaders
 #include <Graphics/GteComputeProgram.h>
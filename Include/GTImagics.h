@@ -19,6 +19,7 @@
 #include <Imagics/GteSurfaceExtractorTetrahedra.h>
 
 // Images
+#include <Imagics/GteBinaryImage.h>
 #include <Imagics/GteImage.h>
 #include <Imagics/GteImage2.h>
 #include <Imagics/GteImage3.h>
@@ -47,3 +48,5 @@
 #include <Imagics/GteAdaptiveSkeletonClimbing3.h>
 #include <Imagics/GteFastMarch2.h>
 #include <Imagics/GteFastMarch3.h>
+#include <Imagics/GteFastSweep2.h>
+#include <Imagics/GteFastSweep3.h>
@@ -13,13 +13,16 @@
 #include <LowLevel/GteArray4.h>
 #include <LowLevel/GteAtomicMinMax.h>
 #include <LowLevel/GteComputeModel.h>
+#include <LowLevel/GteIndexedMinHeap.h>
 #include <LowLevel/GteLexicoArray2.h>
 #include <LowLevel/GteMinHeap.h>
+#include <LowLevel/GteParallelFor.h>
 #include <LowLevel/GteRangeIteration.h>
 #include <LowLevel/GteSharedPtrCompare.h>
 #include <LowLevel/GteStringUtility.h>
 #include <LowLevel/GteThreadSafeMap.h>
 #include <LowLevel/GteThreadSafeQueue.h>
+#include <LowLevel/GteUntidyPriorityQueue.h>
 #include <LowLevel/GteWeakPtrCompare.h>
 
 // Logger
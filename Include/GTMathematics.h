@@ -72,6 +72,8 @@
 #include <Mathematics/GteApprTorus3.h>
 
 // ComputationalGeometry
+#include <Mathematics/GteAABBTree3.h>
+#include <Mathematics/GteAABBTreeOfTriangles.h>
 #include <Mathematics/GteBSPPolygon2.h>
 #include <Mathematics/GteCLODPolyline.h>
 #include <Mathematics/GteConformalMapGenus0.h>
@@ -274,6 +276,7 @@
 #include <Mathematics/GteIntpSphere2.h>
 #include <Mathematics/GteIntpThinPlateSpline2.h>
 #include <Mathematics/GteIntpThinPlateSpline3.h>
+#include <Mathematics/GteIntpThinPlateSplineScalable.h>
 #include <Mathematics/GteIntpTricubic3.h>
 #include <Mathematics/GteIntpTrilinear3.h>
 #include <Mathematics/GteIntpVectorField2.h>
@@ -389,6 +392,8 @@
 #include <Mathematics/GteLinearSystem.h>
 #include <Mathematics/GteMinimize1.h>
 #include <Mathematics/GteMinimizeN.h>
+#include <Mathematics/GteMultiStartMinimizer.h>
+#include <Mathematics/GteOdeEnsemble.h>
 #include <Mathematics/GteOdeEuler.h>
 #include <Mathematics/GteOdeImplicitEuler.h>
 #include <Mathematics/GteOdeMidpoint.h>
@@ -399,6 +404,7 @@
 #include <Mathematics/GteRootsBrentsMethod.h>
 #include <Mathematics/GteRootsPolynomial.h>
 #include <Mathematics/GteSingularValueDecomposition.h>
+#include <Mathematics/GteSparseNormalEquations.h>
 #include <Mathematics/GteSymmetricEigensolver.h>
 #include <Mathematics/GteSymmetricEigensolver2x2.h>
 #include <Mathematics/GteSymmetricEigensolver3x3.h>
@@ -0,0 +1,148 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Mathematics/GteQuaternion.h>
+#include <Mathematics/GteVector4.h>
+#include <cstdint>
+#include <vector>
+
+namespace gte
+{
+
+class KeyframeController;
+
+// A compact keyframe animation of the local transforms of a set of objects,
+// typically the bones of a skeleton.  Each object has a track.  The keys of
+// all tracks are at the same uniformly spaced times, so the keys for a time
+// are found by a division rather than by a search, and the cost of a seek is
+// independent of the previous time and of the number of keys.  A key stores
+// the translation and scale as floats and the rotation quaternion with 16
+// bits per component, 24 bytes in total compared to 36 bytes plus 12 bytes
+// of times for a key of KeyframeController.  The keys of a time are
+// contiguous for all tracks, so a skeleton is sampled from consecutive
+// memory.  A clip is immutable once built and can be shared by many
+// ClipController objects, for example by the characters of a crowd.
+//
+// The translations and scales are interpolated linearly.  The rotations are
+// interpolated linearly and normalized (nlerp) in the hemisphere of the
+// first key, which is a close approximation to slerp for the small angles
+// between consecutive keys of a sampled animation.
+
+class GTE_IMPEXP AnimationClip
+{
+public:
+    // Construction and destruction.  The keys are at the times
+    // minTime + k*(maxTime-minTime)/(numKeys-1) for 0 <= k < numKeys.  The
+    // inputs must satisfy numTracks > 0, numKeys >= 2 and minTime < maxTime.
+    // The keys are initialized to the identity transform and the tracks
+    // have no channels.
+    virtual ~AnimationClip();
+    AnimationClip(int numTracks, int numKeys, float minTime, float maxTime);
+
+    // The channels of a track that are applied by ClipController.  The
+    // other channels of the local transform are not modified.
+    enum
+    {
+        CHANNEL_TRANSLATION = 1,
+        CHANNEL_ROTATION = 2,
+        CHANNEL_SCALE = 4,
+        CHANNEL_ALL = 7
+    };
+
+    // Member access.
+    inline int GetNumTracks() const;
+    inline int GetNumKeys() const;
+    inline float GetMinTime() const;
+    inline float GetMaxTime() const;
+    inline int GetChannels(int track) const;
+    void SetChannels(int track, int channels);
+
+    // The number of bytes of the keys.
+    inline size_t GetNumBytes() const;
+
+    // Set a key.  The rotation must be unit length.  The w-component of the
+    // translation is ignored.
+    void SetKey(int track, int key, Vector4<float> const& translation,
+        Quaternion<float> const& rotation, float scale);
+
+    // Resample a KeyframeController at the key times.  The times of the
+    // clip are in the units of the keyframe times.  The channels of the
+    // track are the channels of the controller.  The channels that the
+    // controller does not have are taken from its transform (see
+    // TransformController::GetTransform).  The function is not const for
+    // the controller because its member accessors are not const.
+    void SetTrack(int track, KeyframeController& controller);
+
+    // Sample track 'track' at 'time'.  The time is clamped to
+    // [minTime,maxTime].  The w-component of the translation is 0.
+    void Sample(int track, float time, Vector4<float>& translation,
+        Quaternion<float>& rotation, float& scale) const;
+
+    // Sample track tracks[i] at time times[i] for 0 <= i < numSamples.  The
+    // samples are processed in blocks; the key lookups of a block are
+    // computed by a branch-free loop and then the keys are interpolated.
+    void Sample(int numSamples, int const* tracks, float const* times,
+        Vector4<float>* translations, Quaternion<float>* rotations,
+        float* scales) const;
+
+private:
+    struct Key
+    {
+        float translation[3];
+        float scale;
+        int16_t rotation[4];
+    };
+
+    inline Key& GetKey(int track, int key);
+
+    int mNumTracks, mNumKeys;
+    float mMinTime, mMaxTime, mInvDelta;
+    std::vector<int> mChannels;
+
+    // The keys are indexed by track+numTracks*key.
+    std::vector<Key> mKeys;
+};
+
+
+inline int AnimationClip::GetNumTracks() const
+{
+    return mNumTracks;
+}
+
+inline int AnimationClip::GetNumKeys() const
+{
+    return mNumKeys;
+}
+
+inline float AnimationClip::GetMinTime() const
+{
+    return mMinTime;
+}
+
+inline float AnimationClip::GetMaxTime() const
+{
+    return mMaxTime;
+}
+
+inline int AnimationClip::GetChannels(int track) const
+{
+    return mChannels[track];
+}
+
+inline size_t AnimationClip::GetNumBytes() const
+{
+    return mKeys.size() * sizeof(Key);
+}
+
+inline AnimationClip::Key& AnimationClip::GetKey(int track, int key)
+{
+    return mKeys[track + static_cast<size_t>(mNumTracks) * key];
+}
+
+}
@@ -0,0 +1,71 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Graphics/GteAnimationClip.h>
+#include <Graphics/GteTransformController.h>
+#include <memory>
+#include <vector>
+
+namespace gte
+{
+
+// A transform controller that samples a track of an AnimationClip.  It is
+// the counterpart of KeyframeController for the compact clip format.  The
+// controller's minTime and maxTime are initialized to the times of the clip,
+// so the repeat type, phase and frequency apply as for other controllers;
+// set phase to a random value to desynchronize the characters of a crowd
+// that share a clip.
+
+class GTE_IMPEXP ClipController : public TransformController
+{
+public:
+    // Construction and destruction.  The channels of the track that are not
+    // in the clip are copied from localTransform.
+    virtual ~ClipController();
+    ClipController(std::shared_ptr<AnimationClip> const& clip, int track,
+        Transform const& localTransform);
+
+    // Member access.
+    inline std::shared_ptr<AnimationClip> const& GetClip() const;
+    inline int GetTrack() const;
+
+    // The animation update.  The application time is in milliseconds.
+    virtual bool Update(double applicationTime) override;
+
+    // Update many controllers at the same application time.  The control
+    // times are computed for all active controllers, and each maximal
+    // sequence of consecutive controllers that share a clip is sampled by
+    // one call to AnimationClip::Sample.  Sort the controllers by clip to
+    // benefit.  The result is the same as calling Update for each
+    // controller.
+    static void UpdateBatch(std::vector<ClipController*> const& controllers,
+        double applicationTime);
+
+protected:
+    // Copy the sampled channels to the local transform of the controller
+    // and of the controlled object.
+    void Apply(Vector4<float> const& translation,
+        Quaternion<float> const& rotation, float scale);
+
+    std::shared_ptr<AnimationClip> mClip;
+    int mTrack;
+};
+
+
+inline std::shared_ptr<AnimationClip> const& ClipController::GetClip() const
+{
+    return mClip;
+}
+
+inline int ClipController::GetTrack() const
+{
+    return mTrack;
+}
+
+}
@@ -0,0 +1,197 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Graphics/GteSpatialHierarchy.h>
+#include <Graphics/GteVertexBuffer.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace gte
+{
+
+// Parallel update of the controllers of a SpatialHierarchy.  Spatial::Update
+// and SpatialHierarchy::Update call the controllers one at a time as the
+// scene graph is traversed.  For scenes with many animated objects, such as
+// crowds of skinned characters, most of the controllers are independent.
+// ControllerScheduler collects the controllers of the hierarchy, sorts them
+// into phases by their data dependencies and updates the controllers of a
+// phase on a pool of threads.  The phases of Update are
+//
+//   1. Controllers of unknown types, serially in breadth-first order.  A
+//      class derived from Controller can read or write any object, so no
+//      assumptions are made about it.
+//   2. Local controllers, in parallel:  TransformController (which includes
+//      KeyframeController and BlendTransformController), MorphController,
+//      PointController and ParticleController.  These modify only their own
+//      object's localTransform, model data or vertex buffer.
+//   3. The world transforms and world bounds of the hierarchy.
+//   4. IKController objects, in waves.  Each IK controller modifies the
+//      transforms of its joints, and hence the world transforms of their
+//      descendants, and reads the world transforms of its object, targets,
+//      effectors and joint parents.  A controller is in a later wave than
+//      every preceding controller (in breadth-first order) that modifies an
+//      object it reads or modifies, or that reads an object it modifies.
+//      Controllers that share only targets are in the same wave.  The world
+//      data of the joints and of their descendants is recomputed after each
+//      wave, so a controller whose chain hangs below the joints of another
+//      controller reads the world transforms produced by the earlier wave.
+//      (Spatial::Update calls such a controller before it recomputes the
+//      world transform of the controller's object, so the results can
+//      differ.)  The joints are marked dirty after their wave, so the joint
+//      objects must be in the hierarchy; Build reports an error for a joint
+//      object that is not.
+//   5. SkinController objects, in parallel.  These read the world transforms
+//      of their bones, which are current after phases 3 and 4.
+//   6. The world data of the objects modified in phase 5.
+//   7. The post-update functions of the controllers updated in phases 2 and
+//      5, on the calling thread in breadth-first order of their objects and
+//      in the order the controllers were attached to an object.
+//
+// The controllers of an object that are in the same phase are updated by
+// the same thread in the order they were attached, so several controllers
+// may modify the same object.  The post-update functions typically copy
+// vertex buffers to graphics memory with GraphicsEngine::Update, which must
+// be called on the thread that owns the graphics context.  The scheduler
+// therefore replaces the post-update functions of the controllers while they
+// are scheduled and calls the original functions in phase 7.  The originals
+// are restored by Clear, by Build and by the destructor.
+//
+// Derived classes of the local controllers and of SkinController must not
+// modify objects other than their own.  The controllers in the subtrees of
+// objects of classes derived from Node (see SpatialHierarchy) are updated by
+// the Update functions of those objects in phase 3, as usual.  Call Build
+// after SpatialHierarchy::Build and after attaching controllers to or
+// detaching controllers from objects of the hierarchy.
+
+class GTE_IMPEXP ControllerScheduler
+{
+public:
+    // Construction and destruction.
+    ~ControllerScheduler();
+    ControllerScheduler();
+
+    // The scheduler stores a pointer to the hierarchy, which must exist
+    // until Clear is called or the scheduler is destroyed.
+    void Build(SpatialHierarchy& hierarchy);
+    void Clear();
+
+    // Update the controllers and the world data of the hierarchy.  The
+    // application time is in milliseconds.  For numThreads > 1, the objects
+    // of each phase are distributed dynamically among the threads; the
+    // phases with fewer than minTasksPerThread objects per thread are
+    // processed by the calling thread.
+    void Update(double applicationTime, unsigned int numThreads = 1);
+
+    // Member access.  The counts are of objects with controllers in the
+    // phase, except for GetNumIKControllers.
+    inline SpatialHierarchy* GetHierarchy() const;
+    inline int GetNumSerialControllers() const;
+    inline int GetNumLocalObjects() const;
+    inline int GetNumIKControllers() const;
+    inline int GetNumIKWaves() const;
+    inline int GetNumSkinObjects() const;
+
+    // Objects per thread below which a phase is processed by the calling
+    // thread.  The default is 4.
+    unsigned int minTasksPerThread;
+
+private:
+    // The scheduler captures 'this' in the replacement post-update
+    // functions.
+    ControllerScheduler(ControllerScheduler const&) = delete;
+    ControllerScheduler& operator=(ControllerScheduler const&) = delete;
+
+    typedef std::function<void(std::shared_ptr<VertexBuffer> const&)> Updater;
+
+    // The controllers of a task are mControllers[first] through
+    // mControllers[last-1].  The object is a hierarchy index.
+    struct Task
+    {
+        int object, first, last;
+    };
+
+    struct Deferred
+    {
+        Controller* controller;
+        Updater postUpdate;
+        std::shared_ptr<VertexBuffer> vbuffer;
+    };
+
+    // Append a task for the controllers of 'object' in 'controllers'.
+    void AddTask(int object,
+        std::vector<std::shared_ptr<Controller>> const& controllers,
+        std::vector<Task>& tasks);
+
+    // Schedule the IK controllers into waves.
+    void BuildIKWaves(std::vector<Task> const& tasks);
+
+    // Append 'object' and its descendants to 'objects'.
+    static void AppendSubtree(Spatial* object,
+        std::vector<Spatial const*>& objects);
+
+    // Execute the tasks on the threads.
+    void Execute(std::vector<Task> const& tasks, double applicationTime,
+        unsigned int numThreads);
+
+    // Exchange the post-update function of a MorphController,
+    // PointController, ParticleController or SkinController.  The return
+    // value is 'false' for the other classes.
+    static bool ExchangePostUpdate(Controller* controller, Updater& postUpdate);
+
+    SpatialHierarchy* mHierarchy;
+    std::vector<std::shared_ptr<Controller>> mControllers;
+    std::vector<Controller*> mSerial;
+    std::vector<Task> mLocalTasks, mSkinTasks;
+    std::vector<std::vector<Task>> mIKWaves;
+
+    // The hierarchy indices of the objects modified by the waves.
+    std::vector<std::vector<int>> mIKObjects;
+
+    // The deferred post-update functions, in the order they are called.
+    std::vector<Deferred> mDeferred;
+};
+
+
+inline SpatialHierarchy* ControllerScheduler::GetHierarchy() const
+{
+    return mHierarchy;
+}
+
+inline int ControllerScheduler::GetNumSerialControllers() const
+{
+    return static_cast<int>(mSerial.size());
+}
+
+inline int ControllerScheduler::GetNumLocalObjects() const
+{
+    return static_cast<int>(mLocalTasks.size());
+}
+
+inline int ControllerScheduler::GetNumIKControllers() const
+{
+    int numControllers = 0;
+    for (auto const& wave : mIKWaves)
+    {
+        numControllers += static_cast<int>(wave.size());
+    }
+    return numControllers;
+}
+
+inline int ControllerScheduler::GetNumIKWaves() const
+{
+    return static_cast<int>(mIKWaves.size());
+}
+
+inline int ControllerScheduler::GetNumSkinObjects() const
+{
+    return static_cast<int>(mSkinTasks.size());
+}
+
+}
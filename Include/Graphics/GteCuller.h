@@ -9,6 +9,7 @@
 
 #include <Graphics/GteBoundingSphere.h>
 #include <Graphics/GteCamera.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -24,6 +25,7 @@ namespace gte
     // portals should not be inserted into the set twice).
 
     class Spatial;
+    class SpatialHierarchy;
     class Visual;
 
     enum GTE_IMPEXP CullingMode
@@ -69,6 +71,27 @@ namespace gte
         void ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
             std::shared_ptr<Spatial> const& scene);
 
+        // Culling of a flattened scene graph (see GteSpatialHierarchy.h),
+        // which must have been updated by hierarchy.Update().  The bounds
+        // are read from the packed array hierarchy.GetWorldBounds() and are
+        // compared to the culling planes LANES objects at a time; the inner
+        // loops have no branches, so the compiler can vectorize them.  The
+        // plane-state masks are inherited from parents as in the recursive
+        // traversal, so a plane that a Node's bound is inside is not tested
+        // for its descendants, and the culling modes of the objects are
+        // honored.  For numThreads > 1, the objects of each level are
+        // partitioned among the threads and the per-thread results are
+        // merged in order.  The visible leaves of the flattened hierarchy
+        // are then passed to their GetVisibleSet functions by the calling
+        // thread, so Insert is called as in the recursive traversal and the
+        // subtrees of Node-derived classes are culled recursively.  The
+        // visible set contains the same objects as for ComputeVisibleSet
+        // with the root of the hierarchy, but in breadth-first order rather
+        // than depth-first order.
+        enum { LANES = 8 };
+        void ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
+            SpatialHierarchy const& hierarchy, unsigned int numThreads = 1);
+
         // Access to the camera and potentially visible set.
         inline VisibleSet& GetVisibleSet()
         {
@@ -84,9 +107,21 @@ namespace gte
         friend class Visual;
 
         // Compare the object's world bounding sphere against the culling planes.
-        // Only Spatial calls this function.
+        // Only Spatial calls this function.  A sphere that is not culled by
+        // the planes is passed to IsOccluded.
         bool IsVisible(BoundingSphere<float> const& sphere);
 
+        // Derived classes that implement occlusion culling override these
+        // functions.  OnComputeVisibleSet is called by ComputeVisibleSet after
+        // the view frustum planes are computed and before the scene is
+        // traversed.  IsOccluded is called for each object whose bound is not
+        // culled by the planes; when it returns 'true', the object is culled.
+        // For a flattened hierarchy, IsOccluded is called concurrently from
+        // the culling threads, so it must not modify the culler.  The base
+        // class functions do nothing and return 'false'.
+        virtual void OnComputeVisibleSet(std::shared_ptr<Camera> const& camera);
+        virtual bool IsOccluded(BoundingSphere<float> const& sphere) const;
+
         // The base class behavior is to append the visible object to the end of
         // the visible set (stored as an array).  Derived classes may override
         // this behavior; for example, the array might be maintained as a sorted
@@ -110,6 +145,19 @@ namespace gte
 
         void PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera);
 
+        // Support for culling a flattened scene graph.  CullRange processes
+        // the objects with indices in [begin,end) of a single level and
+        // appends the indices of the visible leaves to 'visible'.
+        enum : uint8_t
+        {
+            STATE_CULLED,
+            STATE_DYNAMIC,
+            STATE_NEVER_CULLED
+        };
+
+        void CullRange(SpatialHierarchy const& hierarchy, int begin, int end,
+            std::vector<int>& visible);
+
         // The world culling planes corresponding to the view frustum plus any
         // additional user-defined culling planes.  The member mPlaneState
         // represents bit flags to store whether or not a plane is active in the
@@ -126,5 +174,12 @@ namespace gte
 
         // The potentially visible set generated by ComputeVisibleSet(scene).
         VisibleSet mVisibleSet;
+
+        // The culling planes packed by component, in the order of testing,
+        // and the per-object culling state of a flattened scene graph.
+        std::vector<float> mPackedPlanes[4];
+        std::vector<unsigned int> mPackedPlaneMasks;
+        std::vector<unsigned int> mObjectPlaneStates;
+        std::vector<uint8_t> mObjectStates;
     };
 }
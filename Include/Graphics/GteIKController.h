@@ -44,6 +44,22 @@ namespace gte
         float GetJointMinRotation(size_t j, int axis) const;
         float GetJointMaxRotation(size_t j, int axis) const;
 
+        // Member access to the objects that are read or modified by the
+        // update.  A null pointer is returned for an invalid index.
+        inline size_t GetNumJoints() const
+        {
+            return mJoints.size();
+        }
+
+        inline size_t GetNumGoals() const
+        {
+            return mGoals.size();
+        }
+
+        Spatial* GetJointObject(size_t j) const;
+        Spatial* GetGoalTarget(size_t g) const;
+        Spatial* GetGoalEffector(size_t g) const;
+
         // The animation update.  The application time is in milliseconds.
         virtual bool Update(double applicationTime) override;
 
@@ -0,0 +1,139 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Graphics/GteVisual.h>
+#include <Mathematics/GteVector3.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace gte
+{
+// Preprocessing of triangle meshes for faster rendering, for example of the
+// meshes generated by MeshFactory or loaded by an application.  The stages
+// are
+//
+//   1. ReorderForVertexCache.  The triangles are reordered by the greedy
+//      algorithm of Tom Forsyth, "Linear-Speed Vertex Cache Optimisation".
+//      Each vertex has a score that depends on its position in a simulated
+//      LRU cache and on the number of triangles that are not yet emitted,
+//      and the triangle with the largest sum of vertex scores among those
+//      that share a vertex with the cache is emitted next.
+//   2. ReorderForOverdraw.  The triangle sequence is split into clusters
+//      where the simulated vertex cache is refilled, and the clusters are
+//      subdivided further as long as the cache efficiency of a cluster is
+//      within the factor overdrawThreshold of that of its parent cluster.
+//      The clusters are sorted so that those facing away from the center of
+//      the mesh are drawn first, which approximates a front-to-back order
+//      from most view directions (Sander, Nehab and Barczak, "Fast Triangle
+//      Reordering for Vertex Locality and Reduced Overdraw").
+//   3. ReorderForVertexFetch.  The vertices are renumbered in the order of
+//      their first use by the triangles, so the vertex buffer is read
+//      sequentially.  Vertices that are not used are moved to the end.
+//
+// The quality of the order is measured by the average cache miss ratio
+// (ACMR), the number of vertex cache misses per triangle, and the average
+// transformed vertex ratio (ATVR), the number of misses per vertex used.
+// The ACMR is at least 0.5 for large closed meshes, and the ATVR is at
+// least 1.  The metrics simulate a FIFO cache, the model of most GPUs.
+//
+// The functions operate on triangle lists (IP_TRIMESH).  The triangle
+// winding is preserved.  Optimize modifies the index buffer and the vertex
+// buffer of a Visual, which must have their data in system memory; other
+// Visual objects that share the vertex buffer must be remapped by the
+// caller (see ReorderForVertexFetch).
+
+class GTE_IMPEXP MeshOptimizer
+{
+public:
+    // Construction and destruction.
+    ~MeshOptimizer();
+    MeshOptimizer();
+
+    // The size of the simulated vertex cache, 4 <= cacheSize <= 64.  The
+    // default is 16.
+    inline void SetCacheSize(unsigned int cacheSize);
+    inline unsigned int GetCacheSize() const;
+
+    // The factor by which a cluster may have a larger ACMR than its parent
+    // cluster, at least 1.  Larger values produce smaller clusters, so the
+    // overdraw is reduced more at the expense of the vertex cache
+    // efficiency.  The default is 1.05.
+    inline void SetOverdrawThreshold(float overdrawThreshold);
+    inline float GetOverdrawThreshold() const;
+
+    struct Statistics
+    {
+        float acmr, atvr;
+    };
+
+    // Apply the three stages to the visual.  Only the active triangles of
+    // the index buffer, those with indices in [GetFirstPrimitive(),
+    // GetFirstPrimitive() + GetNumActivePrimitives()), are reordered.  The
+    // other triangles keep their positions and are renumbered for the new
+    // vertex order.  The statistics of the active triangles before and
+    // after the optimization are returned when the pointers are not null.
+    // The function fails when the index buffer is not IP_TRIMESH or when
+    // the vertex buffer does not have 3-tuple or 4-tuple float positions.
+    bool Optimize(Visual& visual, Statistics* before = nullptr,
+        Statistics* after = nullptr) const;
+
+    // The individual stages.  The index array has 3 indices per triangle,
+    // each less than numVertices.  ReorderForVertexFetch returns the
+    // permutation of the vertices, remap[oldIndex] = newIndex, and the
+    // caller must move the vertex data accordingly (see RemapVertices).
+    void ReorderForVertexCache(uint32_t numVertices,
+        std::vector<uint32_t>& indices) const;
+
+    void ReorderForOverdraw(std::vector<Vector3<float>> const& positions,
+        std::vector<uint32_t>& indices) const;
+
+    static void ReorderForVertexFetch(uint32_t numVertices,
+        std::vector<uint32_t>& indices, std::vector<uint32_t>& remap);
+
+    // Move the vertices of a vertex buffer according to a permutation
+    // computed by ReorderForVertexFetch.
+    static bool RemapVertices(std::vector<uint32_t> const& remap, VertexBuffer& vbuffer);
+
+    // The ACMR and ATVR of an index array for a FIFO cache of the specified
+    // size.
+    static Statistics ComputeStatistics(uint32_t numVertices,
+        std::vector<uint32_t> const& indices, unsigned int cacheSize);
+
+private:
+    // Copy the indices of an index buffer to an array and back.
+    static bool GetIndices(IndexBuffer const& ibuffer, std::vector<uint32_t>& indices);
+    static void SetIndices(std::vector<uint32_t> const& indices, IndexBuffer& ibuffer);
+
+    unsigned int mCacheSize;
+    float mOverdrawThreshold;
+};
+
+
+inline void MeshOptimizer::SetCacheSize(unsigned int cacheSize)
+{
+    mCacheSize = std::min(std::max(cacheSize, 4u), 64u);
+}
+
+inline unsigned int MeshOptimizer::GetCacheSize() const
+{
+    return mCacheSize;
+}
+
+inline void MeshOptimizer::SetOverdrawThreshold(float overdrawThreshold)
+{
+    mOverdrawThreshold = std::max(overdrawThreshold, 1.0f);
+}
+
+inline float MeshOptimizer::GetOverdrawThreshold() const
+{
+    return mOverdrawThreshold;
+}
+
+}
@@ -95,7 +95,51 @@ namespace gte
         void GetTimes(std::vector<float>& times);
         void GetWeights(size_t key, std::vector<float>& weights);
 
+        // Sparse morph targets.  Blend shapes such as those of facial rigs
+        // typically modify a small part of the mesh.  Compress stores for
+        // each target n > 0 only the vertices m where X[n][m] differs from
+        // X[0][m] by more than epsilon in some component, together with the
+        // differences D[n][m] = X[n][m] - X[0][m].  The combination is then
+        // computed as (sum_n w[n]) * X[0][m] + sum_{n>0} w[n] * D[n][m],
+        // which equals sum_n w[n] * X[n][m] for epsilon = 0 up to rounding
+        // errors, so its cost is proportional to the number of stored
+        // vertices rather than to N*M.  The dense targets are retained for
+        // the member accessors, and SetVertices recompresses the targets.
+        // In both representations the targets with zero weight at the
+        // current time are skipped.
+        void Compress(float epsilon = 0.0f);
+        void Decompress();
+
+        inline bool IsCompressed() const
+        {
+            return mSparseOffsets.size() > 0;
+        }
+
+        // The number of vertices stored by the sparse targets.
+        inline size_t GetNumSparseVertices() const
+        {
+            return mSparseIndices.size();
+        }
+
+        // Member access to the post-update function.  ControllerScheduler
+        // replaces it temporarily to defer the calls until all controllers
+        // are updated.
+        inline Updater const& GetPostUpdate() const
+        {
+            return mPostUpdate;
+        }
+
+        inline void SetPostUpdate(Updater const& postUpdate)
+        {
+            mPostUpdate = postUpdate;
+        }
+
         // The animation update.  The application time is in milliseconds.
+        // The combination is accumulated in an array of contiguous floats
+        // by loops that the compiler vectorizes and is then copied to the
+        // vertex buffer.  Update modifies only the object of the controller,
+        // so the controllers of many morphed objects can be updated in
+        // parallel by ControllerScheduler.
         virtual bool Update(double applicationTime);
 
     protected:
@@ -118,6 +162,18 @@ namespace gte
         // that is increasing during execution.
         size_t mLastIndex;
 
+        // Sparse targets.  The vertices of target n > 0 are
+        // mSparseIndices[k] and mSparseDeltas[k] for mSparseOffsets[n] <=
+        // k < mSparseOffsets[n+1].  The array is empty when the targets are
+        // not compressed.
+        float mEpsilon;
+        std::vector<size_t> mSparseOffsets;
+        std::vector<unsigned int> mSparseIndices;
+        std::vector<Vector3<float>> mSparseDeltas;
+
+        // The combination, 3*M floats.
+        std::vector<float> mCombination;
+
         // The caller specifies an update function that is used to copy the
         // vertex buffer of mObject from the CPU to GPU.
         Updater mPostUpdate;
@@ -0,0 +1,107 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Graphics/GteCuller.h>
+#include <Graphics/GteVisual.h>
+#include <memory>
+#include <vector>
+
+namespace gte
+{
+    // A culler that adds occlusion culling to the view frustum culling.
+    // The application designates occluders, typically large and simple
+    // meshes such as building shells or terrain.  Before each traversal of
+    // the scene, the occluder triangles are rasterized on the CPU into a
+    // low-resolution depth buffer, and the maximum depth of each tile of
+    // TILE_SIZE-by-TILE_SIZE pixels is stored in a second, coarser level.
+    // An object whose bounding sphere is not culled by the planes is culled
+    // when its screen-space bounding rectangle is behind the depth buffer.
+    // The test is applied to Node bounds as well as Visual bounds, so a
+    // subtree hidden behind occluders is rejected by a single test.
+    //
+    // The rasterization is conservative, so no visible object is culled.  A
+    // pixel is written only when it is entirely covered by a triangle, and
+    // the depth written is the maximum depth of the triangle over the pixel.
+    // A triangle that is not entirely in front of the near plane is not
+    // rasterized.  A bounding sphere is tested with its screen rectangle
+    // (the projection of its axis-aligned bounding box) and its minimum
+    // depth, and a sphere that intersects the near plane is never occluded.
+    // The occluders must be updated (Spatial::Update) before culling.  They
+    // are not culled by their own depths, but they can be culled by other
+    // occluders.
+    //
+    // The depths are z/w of the projection-view matrix of the camera, which
+    // increases with distance from the camera for both depth ranges.  The
+    // inner loops of the rasterizer and of the test have no branches, so
+    // the compiler can vectorize them.
+
+    class GTE_IMPEXP OcclusionCuller : public Culler
+    {
+    public:
+        // Construction and destruction.  The depth buffer has width-by-height
+        // pixels.  It should have the aspect ratio of the viewport; its
+        // resolution trades culling power for rasterization time.
+        virtual ~OcclusionCuller();
+        OcclusionCuller(int width = 256, int height = 128);
+
+        enum { TILE_SIZE = 8 };
+
+        // Designate the occluders.  An occluder must have a vertex buffer
+        // with 3-component or 4-component float positions and an index
+        // buffer with triangle primitives; other occluders are ignored.
+        void AttachOccluder(std::shared_ptr<Visual> const& occluder);
+        void DetachOccluder(std::shared_ptr<Visual> const& occluder);
+        void DetachAllOccluders();
+
+        inline std::vector<std::shared_ptr<Visual>> const& GetOccluders() const
+        {
+            return mOccluders;
+        }
+
+        // Member access.  The depth buffer is stored in row-major order with
+        // row 0 at the top of the view.  A depth of std::numeric_limits<float>
+        // ::max() indicates that no occluder covers the pixel.  These are
+        // valid after a ComputeVisibleSet call.
+        inline int GetWidth() const
+        {
+            return mWidth;
+        }
+
+        inline int GetHeight() const
+        {
+            return mHeight;
+        }
+
+        inline std::vector<float> const& GetDepthBuffer() const
+        {
+            return mDepth;
+        }
+
+        // Test a world bounding sphere against the depth buffer.  The return
+        // value is 'true' when the sphere is hidden by the occluders.
+        virtual bool IsOccluded(BoundingSphere<float> const& sphere) const override;
+
+    protected:
+        // Rasterize the occluders.
+        virtual void OnComputeVisibleSet(std::shared_ptr<Camera> const& camera) override;
+
+        void RasterizeOccluder(Visual* occluder);
+        void RasterizeTriangle(Vector4<float> const* clip);
+        void ComputeTileDepths();
+
+        int mWidth, mHeight, mNumXTiles, mNumYTiles;
+        std::vector<std::shared_ptr<Visual>> mOccluders;
+        std::vector<float> mDepth, mTileDepth;
+
+        // The camera state for the current ComputeVisibleSet call.
+        Matrix4x4<float> mPVMatrix;
+        Vector4<float> mEye, mDirection;
+        float mDMin;
+    };
+}
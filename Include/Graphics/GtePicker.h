@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <Mathematics/GteAABBTree3.h>
 #include <Mathematics/GteLine.h>
 #include <Graphics/GteNode.h>
 #include <Graphics/GtePickRecord.h>
 #include <Graphics/GteVisual.h>
+#include <map>
 
 namespace gte
 {
@@ -43,6 +45,36 @@ public:
         Vector4<float> const& origin, Vector4<float> const& direction,
         float tmin, float tmax);
 
+    // Accelerated picking.  BuildIndex collects the Visual objects of the
+    // scene and builds a bounding volume hierarchy of their world bounding
+    // spheres.  For each Visual with triangle primitives, it also builds a
+    // hierarchy of the model-space triangles.  The triangle hierarchies are
+    // cached; a later BuildIndex call reuses them for Visual objects whose
+    // vertex and index buffers have not been replaced.  Rebuild the index
+    // after attaching or detaching objects.  Call RefitIndex after the world
+    // bounds or transforms change (Spatial::Update), and call RefitVisual
+    // after modifying the vertex positions of a Visual.  The indexed picks
+    // produce the same records as the scene-graph picks, although not in the
+    // same order.
+    void BuildIndex(std::shared_ptr<Spatial> const& scene);
+    void RefitIndex();
+    void RefitVisual(std::shared_ptr<Visual> const& visual);
+    void ClearIndex();
+
+    // Pick the indexed scene.  The parameters and the 'records' output are
+    // those of the scene-graph operator().
+    void operator()(Vector4<float> const& origin, Vector4<float> const& direction,
+        float tmin, float tmax);
+
+    // Pick the indexed scene with many linear components, all with the same
+    // interval [tmin,tmax].  The records for origins[i] and directions[i]
+    // are stored in output[i].  The linear components are partitioned among
+    // the threads specified in the constructor.  The 'records' member is not
+    // modified.
+    void operator()(std::vector<Vector4<float>> const& origins,
+        std::vector<Vector4<float>> const& directions, float tmin, float tmax,
+        std::vector<std::vector<PickRecord>>& output) const;
+
     // The following three functions return the record satisfying the
     // constraints.  They should be called only when records.size() > 0.
 
@@ -62,18 +94,66 @@ private:
     // The picking occurs recursively by traversing the input scene.
     void ExecuteRecursive(std::shared_ptr<Spatial> const& object);
 
-    void PickTriangles(std::shared_ptr<Visual> const& visual, char const* positions,
-        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line);
+    // The picking of the primitives of a single Visual.  The linear
+    // component is passed explicitly so that the indexed picks can run
+    // concurrently, as is the inverse world matrix of the Visual.  When
+    // 'useIndex' is 'true' and the Visual has a cached triangle hierarchy,
+    // the hierarchy is used.
+    void PickVisual(std::shared_ptr<Visual> const& visual,
+        Matrix4x4<float> const& invWorldMatrix, Vector4<float> const& origin, Vector4<float> const& direction,
+        float tmin, float tmax, bool useIndex, std::vector<PickRecord>& output) const;
 
     void PickTriangles(std::shared_ptr<Visual> const& visual, char const* positions,
         unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
-        unsigned int i0, unsigned int i1, std::vector<PickRecord>& output) const;
+        Vector4<float> const& origin, float tmin, float tmax,
+        std::vector<PickRecord>& output) const;
+
+    void PickTriangle(std::shared_ptr<Visual> const& visual, char const* positions,
+        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+        unsigned int i, Vector4<float> const& origin, float tmin, float tmax,
+        std::vector<PickRecord>& output) const;
 
     void PickSegments(std::shared_ptr<Visual> const& visual, char const* positions,
-        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line);
+        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+        Vector4<float> const& origin, float tmin, float tmax,
+        std::vector<PickRecord>& output) const;
 
     void PickPoints(std::shared_ptr<Visual> const& visual, char const* positions,
-        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line);
+        unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+        Vector4<float> const& origin, float tmin, float tmax,
+        std::vector<PickRecord>& output) const;
+
+    // Support for the indexed picks.
+    // The buffers are referenced weakly.  A buffer that was released
+    // compares unequal to any live buffer, even one allocated at the same
+    // address.  The primitives of the tree are the active triangles
+    // firstTriangle + k of the index buffer, so the index is also out of
+    // date when the range of active triangles changes.
+    struct TriangleIndex
+    {
+        bool IsIndexOf(Visual const* visual) const
+        {
+            auto const& visualIBuffer = visual->GetIndexBuffer();
+            return vbuffer.lock() == visual->GetVertexBuffer()
+                && ibuffer.lock() == visualIBuffer
+                && firstTriangle == visualIBuffer->GetFirstPrimitive()
+                && numTriangles == visualIBuffer->GetNumActivePrimitives();
+        }
+
+        std::weak_ptr<VertexBuffer> vbuffer;
+        std::weak_ptr<IndexBuffer> ibuffer;
+        unsigned int firstTriangle, numTriangles;
+        AABBTree3<float> tree;
+    };
+
+    void CollectVisuals(std::shared_ptr<Spatial> const& object);
+    void ComputeSceneBoxes(std::vector<AlignedBox3<float>>& boxes) const;
+    void ComputeInverseWorldMatrices();
+    static char const* GetPositions(Visual* visual);
+    static void GetTriangle(IndexBuffer* ibuffer, unsigned int i,
+        unsigned int& v0, unsigned int& v1, unsigned int& v2);
+    static bool ComputeTriangleBoxes(Visual* visual,
+        std::vector<AlignedBox3<float>>& boxes);
 
     // The maximum number of threads that may be used to perform picking
     // requests for triangle primitives.
@@ -88,6 +168,16 @@ private:
     Vector4<float> mDirection;
     float mTMin, mTMax;
 
+    // The indexed scene.  The primitives of mSceneTree are the indices into
+    // mIndexedVisuals.  The inverse world matrices of the Visual objects are
+    // copied when the index is built or refit.  Transform::GetHInverse
+    // computes the inverse lazily, so it must not be called by the threads
+    // of the batched picks.
+    std::vector<std::shared_ptr<Visual>> mIndexedVisuals;
+    std::vector<Matrix4x4<float>> mInverseWorldMatrices;
+    AABBTree3<float> mSceneTree;
+    std::map<Visual const*, TriangleIndex> mTriangleIndices;
+
     // The value returned if the Get* functions are called when 'records' has
     // no elements.
     static PickRecord const msInvalid;
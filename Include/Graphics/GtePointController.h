@@ -64,6 +64,19 @@ namespace gte
             return mPointAngularAxis;
         }
 
+        // Member access to the post-update function.  ControllerScheduler
+        // replaces it temporarily to defer the calls until all controllers
+        // are updated.
+        inline Updater const& GetPostUpdate() const
+        {
+            return mPostUpdate;
+        }
+
+        inline void SetPostUpdate(Updater const& postUpdate)
+        {
+            mPostUpdate = postUpdate;
+        }
+
         // The animation update.  The application time is in milliseconds.
         virtual bool Update(double applicationTime);
 
@@ -9,6 +9,7 @@
 
 #include <Graphics/GteController.h>
 #include <Graphics/GteVertexBuffer.h>
+#include <Mathematics/GteMatrix4x4.h>
 #include <Mathematics/GteVector4.h>
 #include <functional>
 #include <memory>
@@ -40,6 +41,46 @@ public:
     inline std::vector<float>& GetWeights();
     inline std::vector<Vector4<float>>& GetOffsets();
 
+    // Member access to the post-update function.  ControllerScheduler
+    // replaces it temporarily to defer the calls until all controllers are
+    // updated.
+    inline Updater const& GetPostUpdate() const;
+    inline void SetPostUpdate(Updater const& postUpdate);
+
+    // Compressed skinning.  The dense arrays store a weight and an offset
+    // for every pair of vertex and bone, and Update visits all of them.
+    // Compress keeps, for each vertex, the maxInfluences bones of largest
+    // weights (1 <= maxInfluences <= MAX_INFLUENCES) and rescales the kept
+    // weights so that their sum is the sum of all the weights of the vertex.
+    // The bone indices, weights and offsets are stored as structure-of-
+    // arrays ordered by influence, so the vertex kernel processes blocks of
+    // vertices without branches and the compiler can vectorize it.  The
+    // dense arrays are not modified, so call Compress again after changing
+    // them.  The return value is 'false' when maxInfluences is invalid.
+    // Decompress returns to the dense update.  Both functions disable
+    // dual-quaternion skinning.
+    enum { MAX_INFLUENCES = 8 };
+    bool Compress(int maxInfluences);
+    void Decompress();
+    inline int GetMaxInfluences() const;  // 0 when not compressed
+
+    // Dual-quaternion skinning, which avoids the volume loss of linear
+    // blending at twisted joints, is available for compressed controllers.
+    // The bind pose is taken from the current world transforms of the
+    // bones, so call this function when the bones are in the bind pose
+    // (the pose for which the offsets were computed) and their world
+    // transforms are current.  The bone transforms relative to the bind pose
+    // must be rigid (rotation and translation).  The return value is 'false'
+    // when the controller is not compressed or a bone is expired.
+    bool SetDualQuaternionSkinning(bool enable);
+    inline bool GetDualQuaternionSkinning() const;
+
+    // The vertices of a compressed controller are partitioned among
+    // numThreads threads when there are at least MIN_VERTICES_PER_THREAD
+    // vertices per thread.  The default is 1.
+    enum { MIN_VERTICES_PER_THREAD = 2048 };
+    unsigned int numThreads;
+
     // The animation update.  The application time is in milliseconds.
     virtual bool Update(double applicationTime);
 
@@ -59,6 +100,42 @@ protected:
     char* mPosition;
     unsigned int mStride;
     bool mFirstUpdate, mCanUpdate;
+
+private:
+    // Support for compressed skinning.  The skinning kernels process the
+    // vertices in [vbegin,vend).
+    void ComputeBoneData();
+    void SkinVertices();
+    void SkinLinearBlend(int vbegin, int vend);
+    void SkinDualQuaternion(int vbegin, int vend);
+
+    // The affine matrices are 3x4 in matrix-vector order, so the product
+    // with a point P is A[4*r+0]*P[0]+A[4*r+1]*P[1]+A[4*r+2]*P[2]+A[4*r+3]
+    // for row r, regardless of GTE_USE_MAT_VEC.
+    static void PackAffine(Matrix4x4<float> const& M, float* affine);
+    static void ComposeAffine(float const* A, float const* B, float* AB);
+
+    // Convert the affine matrix of a rigid transformation to a dual
+    // quaternion (real x,y,z,w, dual x,y,z,w).
+    static void ToDualQuaternion(float const* affine, float* dq);
+
+    // The influences are indexed by v+nv*k for 0 <= k < mMaxInfluences and
+    // the offsets by v+nv*(3*k+c) for components c = 0,1,2.
+    int mMaxInfluences;
+    std::vector<int> mInfluenceBones;
+    std::vector<float> mInfluenceWeights;
+    std::vector<float> mInfluenceOffsets;
+
+    // The bone data for the current frame, either the affine matrices (12
+    // floats per bone) or the dual quaternions (8 floats per bone).
+    std::vector<float> mBoneData;
+
+    // Dual-quaternion skinning uses the inverses of the bind-pose world
+    // matrices of the bones (affine matrices) and the bind-pose
+    // positions of the vertices (indexed by v+nv*c).
+    bool mDualQuaternion;
+    std::vector<float> mInverseBind;
+    std::vector<float> mBindPositions;
 };
 
 
@@ -87,4 +164,24 @@ inline std::vector<Vector4<float>>& SkinController::GetOffsets()
     return mOffsets;
 }
 
+inline int SkinController::GetMaxInfluences() const
+{
+    return mMaxInfluences;
+}
+
+inline bool SkinController::GetDualQuaternionSkinning() const
+{
+    return mDualQuaternion;
+}
+
+inline SkinController::Updater const& SkinController::GetPostUpdate() const
+{
+    return mPostUpdate;
+}
+
+inline void SkinController::SetPostUpdate(Updater const& postUpdate)
+{
+    mPostUpdate = postUpdate;
+}
+
 }
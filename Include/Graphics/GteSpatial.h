@@ -86,6 +86,10 @@ namespace gte
         void PropagateBoundToRoot();
 
     private:
+        // SpatialHierarchy calls UpdateWorldBound() for its flattened
+        // updates.
+        friend class SpatialHierarchy;
+
         // Support for a hierarchical scene graph.  Spatial provides the
         // parent pointer.  Node provides the child pointers.  The parent
         // pointer is not shared to avoid reference-count cycles between
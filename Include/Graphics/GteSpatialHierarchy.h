@@ -0,0 +1,252 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Graphics/GteNode.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace gte
+{
+
+// A flattened view of a scene graph for fast geometric updates of large
+// hierarchies.  Spatial::Update is a depth-first recursion that chases
+// pointers and touches each object twice.  SpatialHierarchy stores the
+// objects in breadth-first order, so the objects at the same depth are
+// contiguous, each object's parent precedes it and the children of a Node
+// are contiguous.  The world transforms are computed one level at a time
+// from the root down and the world bounds are computed one level at a time
+// from the deepest level up.  The objects of a level are independent, so
+// each level is partitioned among threads.
+//
+// The local and world transforms are stored in arrays in breadth-first
+// order.  Update copies the localTransform of each object into its slot,
+// composes the world transform with the world transform of the parent slot
+// mParents[i] and writes the result back to the object, in one linear pass
+// over each level.  The parent's Spatial object is never visited, so the
+// pass streams over the arrays.  The Spatial and Node objects remain the
+// authoritative storage for the local transforms, and their worldTransform
+// and worldBound are the same as those computed by Spatial::Update, so the
+// renderer, the culler and the picker continue to use the scene graph.  The
+// world matrices are also stored contiguously for consumers that want to
+// stream over them.
+//
+// The hierarchy must be rebuilt (call Build) after the topology of the scene
+// graph changes, that is, after attaching or detaching children anywhere in
+// the subtree.
+//
+// Only objects whose type is exactly Node are expanded.  Classes derived
+// from Node (BillboardNode, BspNode, ViewVolumeNode, Terrain, ...) may
+// override UpdateWorldData, so each such object is stored as a leaf of the
+// flattened hierarchy and its subtree is updated by calling its Update
+// function.
+//
+// Controllers are updated serially, one level at a time and in breadth-first
+// order within a level, before the world transforms of that level are
+// computed.  A controller therefore sees the current world transforms of the
+// ancestors of its object, as it does in Spatial::Update.  A controller that
+// reads the world data of other objects, for example a SkinController that
+// reads the world transforms of its bone nodes, sees the current data only
+// for objects at smaller depths than its own object.  For such scenes,
+// either attach the skinned Visual deeper than its bones, call
+// Spatial::Update or update the controllers with a ControllerScheduler.
+//
+// The dirty flags avoid recomputation of subtrees that have not changed.
+// An object's world data is recomputed when the object is marked dirty, when
+// its parent's world transform was recomputed, or when the object has
+// controllers.  A world bound is recomputed when the world transform was
+// recomputed or when the bound of a child was recomputed.  Whenever you
+// modify localTransform of an object without a controller, or modify the
+// model bound of a Visual, call MarkDirty for that object.  Build marks all
+// objects dirty and Update clears the flags.
+
+class GTE_IMPEXP SpatialHierarchy
+{
+public:
+    // Construction and destruction.
+    virtual ~SpatialHierarchy();
+    SpatialHierarchy();
+
+    // Flatten the subtree rooted at 'root'.  The root may have a parent, in
+    // which case the parent's world transform is used for the root and the
+    // parent's world bound is not updated.
+    void Build(std::shared_ptr<Spatial> const& root);
+
+    // Update the world transforms and world bounds of the subtree.  The
+    // application time is passed to the controllers and is in milliseconds.
+    // For numThreads > 1, the objects of each level are partitioned among
+    // the threads; the levels with fewer than minObjectsPerThread objects
+    // per thread are processed by the calling thread.  When
+    // updateControllers is 'false', the controllers of the expanded objects
+    // and of the leaves are not updated, but those objects are still treated
+    // as dirty; ControllerScheduler uses this after it has updated the
+    // controllers itself.  The objects derived from Node are updated by
+    // their Update function in either case.
+    void Update(double applicationTime = 0.0, unsigned int numThreads = 1,
+        bool updateControllers = true);
+
+    // Update the world data only for the objects marked dirty since the
+    // last update, and for their descendants and ancestors.  No controllers
+    // are updated except those in the subtrees of dirty objects derived
+    // from Node.
+    void UpdateDirty(double applicationTime = 0.0, unsigned int numThreads = 1);
+
+    // Member access.  The index of an object is its position in the
+    // breadth-first order, so index 0 is the root.  The indices of the
+    // objects at depth d are in [GetLevelBegin(d),GetLevelBegin(d+1)).
+    inline std::shared_ptr<Spatial> const& GetRoot() const;
+    inline int GetNumObjects() const;
+    inline int GetNumLevels() const;
+    inline int GetLevelBegin(int level) const;
+    inline Spatial* GetSpatial(int i) const;
+    inline int GetParent(int i) const;
+    inline bool IsExpanded(int i) const;  // 'true' iff children are stored
+    int GetIndex(Spatial const* object) const;  // -1 if not in hierarchy
+
+    // The world transforms, their matrices GetHMatrix() and the world
+    // bounds, packed as (center[0],center[1],center[2],radius), in
+    // breadth-first order.  These are valid after the first Update call.
+    // They are copied only for the objects whose world data is recomputed,
+    // so call MarkDirty for an object whose worldTransform or worldBound you
+    // set directly.
+    inline std::vector<Transform> const& GetWorldTransforms() const;
+    inline std::vector<Matrix4x4<float>> const& GetWorldMatrices() const;
+    inline std::vector<Vector4<float>> const& GetWorldBounds() const;
+
+    // Dirty flags.  MarkDirty returns 'false' when the object is not in the
+    // hierarchy.  Controllers are found by Build, so call Build again after
+    // attaching controllers to or detaching controllers from objects.
+    void MarkDirty(int i);
+    bool MarkDirty(Spatial const* object);
+    void MarkAllDirty();
+    inline bool IsDirty(int i) const;
+
+    // Objects per thread below which a level is processed by the calling
+    // thread.  The default is 256.
+    unsigned int minObjectsPerThread;
+
+private:
+    enum UpdateMode
+    {
+        UPDATE_ALL,
+        UPDATE_NO_CONTROLLERS,
+        UPDATE_DIRTY
+    };
+
+    void Update(double applicationTime, unsigned int numThreads,
+        UpdateMode mode);
+
+    // Apply 'function(i)' to each index i in [begin,end), partitioned among
+    // the threads.
+    template <typename Function>
+    void ForEach(int begin, int end, unsigned int numThreads,
+        Function const& function);
+
+    void ComputeWorldTransform(int i);
+    void ComputeWorldBound(int i);
+
+    enum Kind : uint8_t
+    {
+        KIND_LEAF,      // not a Node
+        KIND_NODE,      // a Node whose children are expanded
+        KIND_SUBTREE    // derived from Node, updated by Spatial::Update
+    };
+
+    std::shared_ptr<Spatial> mRoot;
+
+    // The objects in breadth-first order and their parent indices (-1 for
+    // the root).
+    std::vector<Spatial*> mObjects;
+    std::vector<int> mParents;
+
+    // The children of an object of kind KIND_NODE have indices in
+    // [mChildBegin[i],mChildBegin[i+1]).  The range is empty for the other
+    // kinds.
+    std::vector<Kind> mKinds;
+    std::vector<int> mChildBegin;
+
+    // The objects of level d have indices in
+    // [mLevelBegin[d],mLevelBegin[d+1]).
+    std::vector<int> mLevelBegin;
+
+    // The indices of the objects of kind KIND_LEAF or KIND_NODE that have
+    // controllers and of the objects of kind KIND_SUBTREE, which are updated
+    // serially.
+    std::vector<int> mSerial;
+
+    // The transforms, world matrices and world bounds in breadth-first
+    // order.
+    std::vector<Transform> mLocalTransforms, mWorldTransforms;
+    std::vector<Matrix4x4<float>> mWorldMatrices;
+    std::vector<Vector4<float>> mWorldBounds;
+    std::vector<uint8_t> mDirty, mBoundDirty;
+    std::unordered_map<Spatial const*, int> mIndices;
+};
+
+
+inline std::shared_ptr<Spatial> const& SpatialHierarchy::GetRoot() const
+{
+    return mRoot;
+}
+
+inline int SpatialHierarchy::GetNumObjects() const
+{
+    return static_cast<int>(mObjects.size());
+}
+
+inline int SpatialHierarchy::GetNumLevels() const
+{
+    return static_cast<int>(mLevelBegin.size()) - 1;
+}
+
+inline int SpatialHierarchy::GetLevelBegin(int level) const
+{
+    return mLevelBegin[level];
+}
+
+inline Spatial* SpatialHierarchy::GetSpatial(int i) const
+{
+    return mObjects[i];
+}
+
+inline int SpatialHierarchy::GetParent(int i) const
+{
+    return mParents[i];
+}
+
+inline bool SpatialHierarchy::IsExpanded(int i) const
+{
+    return mKinds[i] == KIND_NODE;
+}
+
+inline std::vector<Transform> const&
+SpatialHierarchy::GetWorldTransforms() const
+{
+    return mWorldTransforms;
+}
+
+inline std::vector<Matrix4x4<float>> const&
+SpatialHierarchy::GetWorldMatrices() const
+{
+    return mWorldMatrices;
+}
+
+inline std::vector<Vector4<float>> const&
+SpatialHierarchy::GetWorldBounds() const
+{
+    return mWorldBounds;
+}
+
+inline bool SpatialHierarchy::IsDirty(int i) const
+{
+    return mDirty[i] != 0;
+}
+
+}
@@ -11,6 +11,13 @@
 #include <Graphics/GteMeshFactory.h>
 #include <Graphics/GteNode.h>
 #include <Mathematics/GteVector2.h>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace gte
 {
@@ -87,10 +94,134 @@ namespace gte
         // The value s is the spacing parameter.
         Vector3<float> GetNormal(float x, float y) const;
 
-        // Update the active set of terrain pages.
+        // Update the active set of terrain pages.  When paging is enabled,
+        // the tiles loaded since the last call are applied to the pages.
+        // When level of detail is enabled, the chunks of the pages are
+        // selected and the vertices are morphed for the current camera.
+        // Call this function whenever the camera moves.
         void OnCameraMotion();
 
+        // Chunked level of detail.  Each page is partitioned by a quadtree.
+        // A node at level l covers chunkSize-by-chunkSize cells whose
+        // spacing is 2^l times the spacing of the page, so the leaves
+        // (level 0) are at the full resolution and the root covers the page.
+        // The chunkSize must be a power of two with 2 <= chunkSize < Size.
+        // The geometric error of a node is the maximum vertical distance
+        // between the heights and the triangle mesh of the node, and it is
+        // precomputed when the heights of a page are set.  A node is drawn
+        // rather than its children when its distance to the camera is large
+        // enough that the maximum error of its level projects to at most
+        // pixelTolerance pixels of a viewport with viewportHeight pixels.
+        // The selection ranges grow with the level so that adjacent chunks
+        // differ by at most one level.
+        //
+        // The vertices of a level that are not vertices of the next coarser
+        // level are morphed on the CPU between their heights and the heights
+        // of the coarser mesh, depending on their distance to the camera.  A
+        // vertex is fully morphed at the distance where its chunk is
+        // replaced by the parent chunk, so the transitions are continuous
+        // and there are no cracks between chunks of different levels.  The
+        // vertex and index buffers of the pages are modified, so their usage
+        // is set to Resource::DYNAMIC_UPDATE; call EnableLOD before the
+        // buffers are bound to a graphics engine.  The morphed mesh uses
+        // another triangulation than the full-resolution mesh, so GetHeight
+        // and GetNormal are approximations to the drawn surface.
+        void EnableLOD(size_t chunkSize, float pixelTolerance, float viewportHeight);
+        void DisableLOD();
+
+        inline bool IsLODEnabled() const
+        {
+            return mChunkSize > 0;
+        }
+
+        inline size_t GetChunkSize() const
+        {
+            return mChunkSize;
+        }
+
+        inline float GetPixelTolerance() const
+        {
+            return mPixelTolerance;
+        }
+
+        inline float GetViewportHeight() const
+        {
+            return mViewportHeight;
+        }
+
+        // The number of chunks drawn for the last OnCameraMotion call.
+        size_t GetNumActiveChunks() const;
+
+        // The updater is called by OnCameraMotion for the vertex and index
+        // buffers that were modified, typically to copy them to graphics
+        // memory with GraphicsEngine::Update.  It is called on the thread
+        // that calls OnCameraMotion.  For a vertex buffer modified by
+        // morphing, it is called for each range of modified rows with the
+        // offset and number of active elements of the buffer set to the
+        // range, and these are restored afterwards.
+        typedef std::function<void(std::shared_ptr<Buffer> const&)> Updater;
+
+        inline void SetUpdater(Updater const& updater)
+        {
+            mUpdater = updater;
+        }
+
+        inline Updater const& GetUpdater() const
+        {
+            return mUpdater;
+        }
+
+        // Background paging of height tiles from a terrain that is larger
+        // than the NumRows-by-NumCols pages.  The terrain consists of
+        // numTileRows-by-numTileCols tiles, each a Size-by-Size array of
+        // heights, with wrap-around at its boundaries.  The page at the
+        // world origin (c*Length,r*Length) shows the tile (r mod numTileRows,
+        // c mod numTileCols).  The loader reads a tile into the array, which
+        // has Size*Size elements, and returns 'true' when successful; it is
+        // called on a worker thread, so it must not access graphics
+        // resources or the scene.  The tiles of the pages and of the ring of
+        // pages around them are requested in order of distance from the
+        // camera and are cached, so the tiles of the pages that become
+        // visible when the camera crosses a page boundary are usually
+        // available already.  A page whose tile has not been loaded is not
+        // drawn (its culling mode is CULL_ALWAYS) until the tile arrives.
+        // The chunk errors of a tile are computed on the worker thread.
+        // Tiles that fail to load are logged and have minimum elevation.
+        typedef std::function<bool(size_t, size_t, std::vector<unsigned short>&)> Loader;
+
+        void EnablePaging(size_t numTileRows, size_t numTileCols, Loader const& loader);
+        void DisablePaging();
+
+        inline bool IsPagingEnabled() const
+        {
+            return mNumTileRows > 0;
+        }
+
+        // A loader for tiles stored in files named
+        //   prefix + tileRow + "." + tileCol + suffix
+        // that contain the Size*Size heights in binary format, the format
+        // of the Terrain sample.
+        Loader CreateFileLoader(std::string const& prefix, std::string const& suffix) const;
+
+        // Block until the tiles of all the pages are loaded and applied,
+        // for example when the application starts.  Call this function
+        // after OnCameraMotion, which requests the tiles.
+        void WaitForPages();
+
+        // The number of pages whose tiles have not been loaded.
+        size_t GetNumWaitingPages() const;
+
     protected:
+        // The bounds and geometric error of a quadtree node of a page.
+        struct Chunk
+        {
+            float minHeight, maxHeight, error;
+        };
+
+        // The nodes of a page quadtree, chunks[level][col + n * row] with
+        // n = (Size - 1) / (chunkSize * 2^level) nodes per side.
+        typedef std::vector<std::vector<Chunk>> ChunkTree;
+
         class Page : public Visual
         {
         public:
@@ -109,7 +240,66 @@ namespace gte
 
             // If the vertex buffer has been copied from CPU to GPU, the caller
             // must re-copy the buffer after a call to setting the heights.
+            // When level of detail is enabled, the chunk errors are computed
+            // unless 'chunks' is the tree of the heights for the chunk size
+            // of the page, in which case it is copied.
             void SetHeights(std::vector<unsigned short> const& heights);
+            void SetHeights(std::vector<unsigned short> const& heights, ChunkTree const& chunks);
+
+            // Level of detail.  The page stores the chunk tree and an index
+            // buffer for the selected chunks, which replaces the index buffer
+            // of the full-resolution mesh while level of detail is enabled.
+            void EnableLOD(size_t chunkSize);
+            void DisableLOD();
+
+            inline size_t GetNumLevels() const
+            {
+                return mChunks.size();
+            }
+
+            inline float GetLevelError(size_t level) const
+            {
+                return mLevelError[level];
+            }
+
+            inline float GetLevelHeight(size_t level) const
+            {
+                return mLevelHeight[level];
+            }
+
+            inline size_t GetNumActiveChunks() const
+            {
+                return mSelection.size();
+            }
+
+            // Select the chunks for the eye point in model space of the page
+            // and morph the vertices.  A node of level l > 0 is subdivided
+            // when its distance to the eye is smaller than split[l].  The
+            // output flags specify which buffers were modified.  The model
+            // bound and the normals, if the vertex format has them, are
+            // updated for the morphed heights.
+            void UpdateLOD(Vector3<float> const& eye, std::vector<float> const& split,
+                bool& vbufferChanged, bool& ibufferChanged);
+
+            // The ranges of vertices modified by the last call to UpdateLOD,
+            // each stored as (offset, number of vertices).  The ranges are
+            // sets of consecutive rows of the page.
+            inline std::vector<std::array<unsigned int, 2>> const& GetDirtyRanges() const
+            {
+                return mDirtyRanges;
+            }
+
+            // Compute the chunk tree of a height array.  The function is
+            // called by the paging thread.
+            static void ComputeChunks(size_t size, size_t chunkSize,
+                float minElevation, float maxElevation,
+                std::vector<unsigned short> const& heights, ChunkTree& chunks);
+
+            // Paging information.  The key of the tile shown by the page,
+            // or std::numeric_limits<size_t>::max() when no tile has been
+            // assigned, and whether the page waits for its tile.
+            size_t tileKey;
+            bool waiting;
 
             inline std::vector<unsigned short> const& GetHeights() const
             {
@@ -123,16 +313,59 @@ namespace gte
         private:
             float GetHeight(size_t i) const;
             float GetHeight(size_t row, size_t col) const;
+            void SetChunks(ChunkTree const& chunks);
+
+            // Recompute the normals of the vertices in rows rmin through
+            // rmax from the triangles of the full-resolution mesh.  The
+            // function does nothing when the vertices have no normals.
+            void UpdateNormals(size_t rmin, size_t rmax);
 
             // Height field parameters.
             size_t mSize;
             float mMinElevation, mMaxElevation, mSpacing;
             Vector2<float> mOrigin;
             std::vector<unsigned short> mHeights;
+
+            // Level of detail.  The selection stores level + 256 * node
+            // for the chunks drawn.
+            size_t mChunkSize;
+            ChunkTree mChunks;
+            std::vector<float> mLevelError, mLevelHeight;
+            std::shared_ptr<IndexBuffer> mFullIBuffer, mLODIBuffer;
+            std::vector<unsigned int> mSelection, mNextSelection, mStack;
+
+            // The rows of vertices whose heights were changed by morphing
+            // and the vertex ranges to be copied to graphics memory.
+            std::vector<bool> mDirtyRows;
+            std::vector<std::array<unsigned int, 2>> mDirtyRanges;
+        };
+
+        // A tile requested from or delivered by the paging thread.
+        struct Tile
+        {
+            size_t row, col, chunkSize;
+            bool loaded;
+            std::vector<unsigned short> heights;
+            ChunkTree chunks;
         };
 
         std::shared_ptr<Page> GetPage(float x, float y) const;
 
+        // Support for level of detail and paging.
+        void UpdateLOD(Vector4<float> const& modelEye);
+        void RequestTiles(int rminO, int cminO);
+        bool ApplyTiles();
+        void LoadTiles();
+
+        inline size_t GetTileKey(int rO, int cO) const
+        {
+            int numTileRows = static_cast<int>(mNumTileRows);
+            int numTileCols = static_cast<int>(mNumTileCols);
+            size_t row = static_cast<size_t>((rO % numTileRows + numTileRows) % numTileRows);
+            size_t col = static_cast<size_t>((cO % numTileCols + numTileCols) % numTileCols);
+            return col + mNumTileCols * row;
+        }
+
         // Terrain information.
         size_t mNumRows, mNumCols, mSize;
 
@@ -142,5 +375,24 @@ namespace gte
         // Current page containing the camera.
         size_t mCameraRow, mCameraCol;
         std::shared_ptr<Camera> mCamera;
+
+        // Level of detail.
+        size_t mChunkSize;
+        float mPixelTolerance, mViewportHeight;
+        std::vector<float> mSplit;
+        Updater mUpdater;
+
+        // Paging.  The cache and the pending set are accessed only by the
+        // calling thread; the requests and completed tiles are shared with
+        // the paging thread and are protected by the mutex.
+        size_t mNumTileRows, mNumTileCols;
+        Loader mLoader;
+        std::map<size_t, std::shared_ptr<Tile>> mCache, mPending;
+        std::deque<std::shared_ptr<Tile>> mRequests;
+        std::vector<std::shared_ptr<Tile>> mCompleted;
+        std::mutex mMutex;
+        std::condition_variable mRequested, mLoaded;
+        std::thread mLoaderThread;
+        bool mStopLoader;
     };
 }
@@ -0,0 +1,222 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Imagics/GteImage2.h>
+#include <Imagics/GteImage3.h>
+#include <cstdint>
+
+// A binary image whose pixels are packed into 64-bit words, 64 pixels per
+// word in the x-direction.  Each row of pixels starts on a word boundary, so
+// the row (y,z) occupies the words with indices
+// numWordsPerRow*(y+dim1*z)+{0..numWordsPerRow-1}.  The pixel (x,y,z) is bit
+// x%64 of word x/64 of its row.  The unused bits of the last word of a row
+// are always zero.  A 2-dimensional image is represented as a 3-dimensional
+// image with one slice (dim2 = 1).  The memory usage is 1/32 of that for an
+// Image3<int>, and the morphological operations ImageUtility3::DilateBox and
+// ImageUtility3::ErodeBox for binary images process 64 pixels per word
+// operation.
+
+namespace gte
+{
+    class BinaryImage
+    {
+    public:
+        // Construction.  The last constructor must have positive
+        // dimensions; otherwise, the image is empty.
+        BinaryImage()
+            :
+            mNumWordsPerRow(0)
+        {
+            mDimensions.fill(0);
+        }
+
+        BinaryImage(int dimension0, int dimension1, int dimension2 = 1)
+        {
+            Reconstruct(dimension0, dimension1, dimension2);
+        }
+
+        // Support for changing the image dimensions.  All pixels are set to
+        // zero by this operation.
+        void Reconstruct(int dimension0, int dimension1, int dimension2 = 1)
+        {
+            if (dimension0 > 0 && dimension1 > 0 && dimension2 > 0)
+            {
+                mDimensions = { dimension0, dimension1, dimension2 };
+                mNumWordsPerRow = (dimension0 + 63) / 64;
+                mWords.assign(static_cast<size_t>(mNumWordsPerRow) *
+                    static_cast<size_t>(dimension1) *
+                    static_cast<size_t>(dimension2), 0);
+            }
+            else
+            {
+                mDimensions.fill(0);
+                mNumWordsPerRow = 0;
+                mWords.clear();
+            }
+        }
+
+        // Conversion from images.  A pixel is set to 1 when the image value
+        // is not zero.
+        template <typename PixelType>
+        void Set(Image2<PixelType> const& image)
+        {
+            Reconstruct(image.GetDimension(0), image.GetDimension(1), 1);
+            for (int y = 0; y < mDimensions[1]; ++y)
+            {
+                for (int x = 0; x < mDimensions[0]; ++x)
+                {
+                    if (image(x, y) != (PixelType)0)
+                    {
+                        Set(x, y, 0, true);
+                    }
+                }
+            }
+        }
+
+        template <typename PixelType>
+        void Set(Image3<PixelType> const& image)
+        {
+            Reconstruct(image.GetDimension(0), image.GetDimension(1),
+                image.GetDimension(2));
+            for (int z = 0; z < mDimensions[2]; ++z)
+            {
+                for (int y = 0; y < mDimensions[1]; ++y)
+                {
+                    for (int x = 0; x < mDimensions[0]; ++x)
+                    {
+                        if (image(x, y, z) != (PixelType)0)
+                        {
+                            Set(x, y, z, true);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Conversion to images with values 0 and 1.  The Image2 conversion
+        // uses slice z = 0.
+        template <typename PixelType>
+        void Get(Image2<PixelType>& image) const
+        {
+            image.Reconstruct(mDimensions[0], mDimensions[1]);
+            for (int y = 0; y < mDimensions[1]; ++y)
+            {
+                for (int x = 0; x < mDimensions[0]; ++x)
+                {
+                    image(x, y) = (Get(x, y, 0) ? (PixelType)1 : (PixelType)0);
+                }
+            }
+        }
+
+        template <typename PixelType>
+        void Get(Image3<PixelType>& image) const
+        {
+            image.Reconstruct(mDimensions[0], mDimensions[1], mDimensions[2]);
+            for (int z = 0; z < mDimensions[2]; ++z)
+            {
+                for (int y = 0; y < mDimensions[1]; ++y)
+                {
+                    for (int x = 0; x < mDimensions[0]; ++x)
+                    {
+                        image(x, y, z) =
+                            (Get(x, y, z) ? (PixelType)1 : (PixelType)0);
+                    }
+                }
+            }
+        }
+
+        // Member access.
+        inline int GetDimension(int d) const
+        {
+            return mDimensions[d];
+        }
+
+        inline int GetNumWordsPerRow() const
+        {
+            return mNumWordsPerRow;
+        }
+
+        inline std::vector<uint64_t> const& GetWords() const
+        {
+            return mWords;
+        }
+
+        inline std::vector<uint64_t>& GetWords()
+        {
+            return mWords;
+        }
+
+        // The first word of row (y,z).
+        inline uint64_t const* GetRow(int y, int z) const
+        {
+            return &mWords[GetRowIndex(y, z)];
+        }
+
+        inline uint64_t* GetRow(int y, int z)
+        {
+            return &mWords[GetRowIndex(y, z)];
+        }
+
+        // Pixel access.
+        inline bool Get(int x, int y, int z = 0) const
+        {
+            uint64_t word = mWords[GetRowIndex(y, z) + (x >> 6)];
+            return ((word >> (x & 63)) & 1) != 0;
+        }
+
+        inline void Set(int x, int y, int z, bool value)
+        {
+            uint64_t& word = mWords[GetRowIndex(y, z) + (x >> 6)];
+            uint64_t mask = (uint64_t)1 << (x & 63);
+            if (value)
+            {
+                word |= mask;
+            }
+            else
+            {
+                word &= ~mask;
+            }
+        }
+
+        // The number of 1-valued pixels.
+        size_t GetNumSetBits() const
+        {
+            size_t count = 0;
+            for (auto word : mWords)
+            {
+                // Parallel bit count (SWAR).
+                word = word - ((word >> 1) & 0x5555555555555555ull);
+                word = (word & 0x3333333333333333ull) +
+                    ((word >> 2) & 0x3333333333333333ull);
+                word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+                count += static_cast<size_t>((word * 0x0101010101010101ull) >> 56);
+            }
+            return count;
+        }
+
+        // The mask for the valid bits of the last word of a row.
+        inline uint64_t GetLastWordMask() const
+        {
+            int numBits = mDimensions[0] - 64 * (mNumWordsPerRow - 1);
+            return (numBits == 64 ? ~(uint64_t)0 :
+                (((uint64_t)1 << numBits) - 1));
+        }
+
+    private:
+        inline size_t GetRowIndex(int y, int z) const
+        {
+            return static_cast<size_t>(mNumWordsPerRow) * (static_cast<size_t>(y) +
+                static_cast<size_t>(mDimensions[1]) * static_cast<size_t>(z));
+        }
+
+        std::array<int, 3> mDimensions;
+        int mNumWordsPerRow;
+        std::vector<uint64_t> mWords;
+    };
+}
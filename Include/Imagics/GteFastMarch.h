@@ -7,8 +7,12 @@
 
 #pragma once
 
-#include <LowLevel/GteMinHeap.h>
+#include <LowLevel/GteIndexedMinHeap.h>
+#include <LowLevel/GteUntidyPriorityQueue.h>
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <thread>
 #include <vector>
 
 // The topic of fast marching methods are discussed in the book
@@ -40,9 +44,11 @@ namespace gte
         // visited; the minus sign distinguishes these from pixels not yet
         // reached during iteration.
         //
-        // Trial pixels are identified by having min-heap records
-        // associated with them.  Known or far pixels have no associated
-        // record.
+        // Trial pixels are identified by being in the priority queue of
+        // the trial pixels, which is keyed by pixel index.  Known or far
+        // pixels are not in the queue.  The queue is an indexed min-heap
+        // by default.  UseUntidyQueue() switches to an untidy priority
+        // queue with O(1) amortized operations.
         //
         // The speeds must be nonnegative and are inverted because the
         // reciprocals are all that are needed in the numerical method.
@@ -52,8 +58,9 @@ namespace gte
             mQuantity(quantity),
             mTimes(quantity, std::numeric_limits<Real>::max()),
             mInvSpeeds(quantity),
-            mHeap(static_cast<int>(quantity)),
-            mTrials(quantity, nullptr)
+            mHeap(quantity),
+            mUseUntidyQueue(false),
+            mLayerSize(quantity)
         {
             for (auto seed : seeds)
             {
@@ -79,8 +86,9 @@ namespace gte
             mQuantity(quantity),
             mTimes(quantity, std::numeric_limits<Real>::max()),
             mInvSpeeds(quantity, (Real)1 / speed),
-            mHeap(static_cast<int>(quantity)),
-            mTrials(quantity, nullptr)
+            mHeap(quantity),
+            mUseUntidyQueue(false),
+            mLayerSize(quantity)
         {
             for (auto seed : seeds)
             {
@@ -148,7 +156,7 @@ namespace gte
 
         inline bool IsTrial(size_t i) const
         {
-            return mTrials[i] != nullptr;
+            return (mUseUntidyQueue ? mUntidyQueue.Contains(i) : mHeap.Contains(i));
         }
 
         inline bool IsFar(size_t i) const
@@ -181,14 +189,270 @@ namespace gte
         virtual void GetBoundary(std::vector<size_t>& boundary) const = 0;
         virtual bool IsBoundary(size_t i) const = 0;
 
-        // Run one step of the fast marching algorithm.
+        // Run one step of the fast marching algorithm.  The function does
+        // nothing when there are no trial pixels.
         virtual void Iterate() = 0;
 
+        // The number of trial pixels.  The algorithm is finished when this
+        // number is zero.
+        inline int GetNumTrials() const
+        {
+            return (mUseUntidyQueue ? mUntidyQueue.GetNumElements() : mHeap.GetNumElements());
+        }
+
+        // Replace the min-heap of trial pixels by an untidy priority queue
+        // (see GteUntidyPriorityQueue.h for a description).  The trial
+        // pixels are removed in increasing order of time only up to the
+        // bucket width, so the computed times differ from those of the
+        // min-heap by an amount proportional to the bucket width.  If the
+        // input bucket width is not positive, it is chosen to be one half
+        // of the minimum inverse speed.  The function may be called at any
+        // time; the current trial pixels are moved to the new queue.
+        void UseUntidyQueue(Real bucketWidth = (Real)0)
+        {
+            Real const maxReal = std::numeric_limits<Real>::max();
+            Real minInvSpeed = maxReal, maxInvSpeed = (Real)0;
+            for (size_t i = 0; i < mQuantity; ++i)
+            {
+                if (mInvSpeeds[i] < maxReal)
+                {
+                    minInvSpeed = std::min(minInvSpeed, mInvSpeeds[i]);
+                    maxInvSpeed = std::max(maxInvSpeed, mInvSpeeds[i]);
+                }
+            }
+            if (minInvSpeed == maxReal)
+            {
+                // All pixels have zero speed.
+                minInvSpeed = (Real)1;
+                maxInvSpeed = (Real)1;
+            }
+
+            if (bucketWidth <= (Real)0)
+            {
+                bucketWidth = (Real)0.5 * minInvSpeed;
+            }
+
+            // The time of a trial pixel exceeds the minimum time of the
+            // trial pixels by at most the maximum inverse speed, so the
+            // circular array of buckets must span that amount.  The number
+            // of buckets is bounded to limit memory usage for images with
+            // a large range of speeds.
+            Real const maxNumBuckets = (Real)65536;
+            Real numBuckets = std::min(std::ceil(maxInvSpeed / bucketWidth) + (Real)2,
+                maxNumBuckets);
+
+            UntidyPriorityQueue<Real> queue(mQuantity, bucketWidth,
+                static_cast<int>(numBuckets));
+            size_t i;
+            while (RemoveTrial(i))
+            {
+                queue.Insert(i, mTimes[i]);
+            }
+            mUntidyQueue = std::move(queue);
+            mUseUntidyQueue = true;
+        }
+
+        // Run the fast marching algorithm until there are no trial pixels.
+        // For numThreads <= 1, this is a loop that calls Iterate().  For
+        // numThreads > 1, the image is partitioned into 2*numThreads slabs
+        // of rows (2D) or slices (3D).  The slabs are colored red and black
+        // alternately and the colors are processed in turn, the slabs of
+        // one color concurrently.  Each slab runs a label-correcting
+        // variant of fast marching with its own min-heap, reading the
+        // times of the neighboring slabs as boundary values.  The phases
+        // are repeated until no time changes.  The times are the same as
+        // those of the serial algorithm except for floating-point rounding
+        // errors and for the rare pixels where the serial algorithm
+        // accepts a time before a neighbor time has decreased.
+        void Execute(unsigned int numThreads = 1)
+        {
+            size_t const numLayers = mQuantity / mLayerSize;
+            size_t const numSlabs = std::min(2 * static_cast<size_t>(numThreads), numLayers);
+            if (numThreads <= 1 || numSlabs < 2)
+            {
+                while (GetNumTrials() > 0)
+                {
+                    Iterate();
+                }
+                return;
+            }
+
+            std::vector<size_t> slabBegin(numSlabs + 1);
+            for (size_t s = 0; s <= numSlabs; ++s)
+            {
+                slabBegin[s] = mLayerSize * ((s * numLayers) / numSlabs);
+            }
+
+            // Move the trial pixels to the min-heaps of their slabs.  The
+            // heap keys are relative to the first pixel of the slab.
+            std::vector<IndexedMinHeap<Real>> heaps(numSlabs);
+            for (size_t s = 0; s < numSlabs; ++s)
+            {
+                heaps[s].Reset(slabBegin[s + 1] - slabBegin[s]);
+            }
+            size_t i;
+            while (RemoveTrial(i))
+            {
+                size_t s = std::upper_bound(slabBegin.begin(), slabBegin.end(), i)
+                    - slabBegin.begin() - 1;
+                heaps[s].Insert(i - slabBegin[s], mTimes[i]);
+            }
+
+            // Alternate between the red (even) and black (odd) slabs until
+            // two consecutive phases do not change any time.
+            std::vector<char> changed(numSlabs);
+            for (size_t parity = 0, numQuiet = 0; numQuiet < 2; parity = 1 - parity)
+            {
+                std::vector<std::thread> process;
+                for (size_t s = parity; s < numSlabs; s += 2)
+                {
+                    process.push_back(std::thread([this, s, numSlabs, &slabBegin, &heaps, &changed]()
+                    {
+                        changed[s] = (MarchSlab(slabBegin[s], slabBegin[s + 1],
+                            s > 0, s + 1 < numSlabs, heaps[s]) ? 1 : 0);
+                    }));
+                }
+
+                bool anyChanged = false;
+                for (size_t t = 0; t < process.size(); ++t)
+                {
+                    process[t].join();
+                    anyChanged = anyChanged || (changed[parity + 2 * t] != 0);
+                }
+                numQuiet = (anyChanged ? 0 : numQuiet + 1);
+            }
+        }
+
     protected:
+        // Support for the derived classes to manage the trial pixels.  The
+        // queue value is the current time of the pixel.
+        inline void InsertTrial(size_t i)
+        {
+            if (mUseUntidyQueue)
+            {
+                mUntidyQueue.Insert(i, mTimes[i]);
+            }
+            else
+            {
+                mHeap.Insert(i, mTimes[i]);
+            }
+        }
+
+        inline void UpdateTrial(size_t i)
+        {
+            if (mUseUntidyQueue)
+            {
+                mUntidyQueue.Update(i, mTimes[i]);
+            }
+            else
+            {
+                mHeap.Update(i, mTimes[i]);
+            }
+        }
+
+        inline bool RemoveTrial(size_t& i)
+        {
+            Real value;
+            return (mUseUntidyQueue ? mUntidyQueue.Remove(i, value) : mHeap.Remove(i, value));
+        }
+
+        // Compute the time of pixel i from the valid times of its
+        // neighbors.  The time is not modified when there are no such
+        // neighbors.
+        virtual void ComputeTime(size_t i) = 0;
+
+        // Run label-correcting fast marching on the pixels [begin,end).  The
+        // neighbor offsets are mNeighborOffsets.  If 'lower' is true, the
+        // pixels of the first layer are relaxed against the layer preceding
+        // the slab.  If 'upper' is true, the pixels of the last layer are
+        // relaxed against the layer following the slab.  The return value
+        // is 'true' when at least one time has changed.
+        bool MarchSlab(size_t begin, size_t end, bool lower, bool upper,
+            IndexedMinHeap<Real>& heap)
+        {
+            size_t const numPixels = end - begin;
+            bool changed = false;
+
+            auto Relax = [this, begin, &heap, &changed](size_t j)
+            {
+                Real oldTime = mTimes[j];
+                ComputeTime(j);
+                if (mTimes[j] < oldTime)
+                {
+                    if (heap.Contains(j - begin))
+                    {
+                        heap.Update(j - begin, mTimes[j]);
+                    }
+                    else
+                    {
+                        heap.Insert(j - begin, mTimes[j]);
+                    }
+                    changed = true;
+                }
+                else
+                {
+                    mTimes[j] = oldTime;
+                }
+            };
+
+            if (lower)
+            {
+                for (size_t j = begin; j < begin + mLayerSize; ++j)
+                {
+                    if (!IsZeroSpeed(j) && IsValid(j - mLayerSize))
+                    {
+                        Relax(j);
+                    }
+                }
+            }
+            if (upper)
+            {
+                for (size_t j = end - mLayerSize; j < end; ++j)
+                {
+                    if (!IsZeroSpeed(j) && IsValid(j + mLayerSize))
+                    {
+                        Relax(j);
+                    }
+                }
+            }
+
+            size_t key;
+            Real value;
+            while (heap.Remove(key, value))
+            {
+                size_t i = begin + key;
+                for (auto offset : mNeighborOffsets)
+                {
+                    // The unsigned subtraction maps out-of-slab indices to
+                    // numbers larger than numPixels.
+                    size_t j = i - offset;
+                    if (j - begin < numPixels && !IsZeroSpeed(j))
+                    {
+                        Relax(j);
+                    }
+                    j = i + offset;
+                    if (j - begin < numPixels && !IsZeroSpeed(j))
+                    {
+                        Relax(j);
+                    }
+                }
+            }
+            return changed;
+        }
+
         size_t mQuantity;
         std::vector<Real> mTimes;
         std::vector<Real> mInvSpeeds;
-        MinHeap<size_t, Real> mHeap;
-        std::vector<typename MinHeap<size_t, Real>::Record*> mTrials;
+        IndexedMinHeap<Real> mHeap;
+        UntidyPriorityQueue<Real> mUntidyQueue;
+        bool mUseUntidyQueue;
+
+        // The derived classes set these in their Initialize functions.  The
+        // layer size is the number of pixels in a row (2D) or a slice (3D),
+        // which is the granularity of the slabs for Execute.  The neighbor
+        // offsets are the positive index differences of the neighbors used
+        // by ComputeTime.
+        size_t mLayerSize;
+        std::vector<size_t> mNeighborOffsets;
     };
 }
@@ -106,15 +106,13 @@ namespace gte
         // Run one step of the fast marching algorithm.
         virtual void Iterate() override
         {
-            // Remove the minimum trial value from the heap.
+            // Remove the minimum trial value from the heap.  The pixel is
+            // promoted from trial to known.
             size_t i;
-            Real value;
-            this->mHeap.Remove(i, value);
-
-            // Promote the trial value to a known value.  The value was
-            // negative but is now nonnegative (the heap stores only
-            // nonnegative numbers).
-            this->mTrials[i] = nullptr;
+            if (!this->RemoveTrial(i))
+            {
+                return;
+            }
 
             // All trial pixels must be updated.  All far neighbors must become trial
             // pixels.
@@ -122,48 +120,48 @@ namespace gte
             if (this->IsTrial(iM1))
             {
                 ComputeTime(iM1);
-                this->mHeap.Update(this->mTrials[iM1], this->mTimes[iM1]);
+                this->UpdateTrial(iM1);
             }
             else if (this->IsFar(iM1))
             {
                 ComputeTime(iM1);
-                this->mTrials[iM1] = this->mHeap.Insert(iM1, this->mTimes[iM1]);
+                this->InsertTrial(iM1);
             }
 
             size_t iP1 = i + 1;
             if (this->IsTrial(iP1))
             {
                 ComputeTime(iP1);
-                this->mHeap.Update(this->mTrials[iP1], this->mTimes[iP1]);
+                this->UpdateTrial(iP1);
             }
             else if (this->IsFar(iP1))
             {
                 ComputeTime(iP1);
-                this->mTrials[iP1] = this->mHeap.Insert(iP1, this->mTimes[iP1]);
+                this->InsertTrial(iP1);
             }
 
             size_t iMXB = i - mXBound;
             if (this->IsTrial(iMXB))
             {
                 ComputeTime(iMXB);
-                this->mHeap.Update(this->mTrials[iMXB], this->mTimes[iMXB]);
+                this->UpdateTrial(iMXB);
             }
             else if (this->IsFar(iMXB))
             {
                 ComputeTime(iMXB);
-                this->mTrials[iMXB] = this->mHeap.Insert(iMXB, this->mTimes[iMXB]);
+                this->InsertTrial(iMXB);
             }
 
             size_t iPXB = i + mXBound;
             if (this->IsTrial(iPXB))
             {
                 ComputeTime(iPXB);
-                this->mHeap.Update(this->mTrials[iPXB], this->mTimes[iPXB]);
+                this->UpdateTrial(iPXB);
             }
             else if (this->IsFar(iPXB))
             {
                 ComputeTime(iPXB);
-                this->mTrials[iPXB] = this->mHeap.Insert(iPXB, this->mTimes[iPXB]);
+                this->InsertTrial(iPXB);
             }
         }
 
@@ -179,6 +177,8 @@ namespace gte
             mYSpacing = ySpacing;
             mInvXSpacing = (Real)1 / xSpacing;
             mInvYSpacing = (Real)1 / ySpacing;
+            this->mLayerSize = mXBound;
+            this->mNeighborOffsets = { 1, mXBound };
 
             // Boundary pixels are marked as zero speed to allow us to avoid
             // having to process the boundary pixels separately during the
@@ -242,15 +242,15 @@ namespace gte
                             || (this->IsValid(i + mXBound) && !this->IsTrial(i + mXBound)))
                         {
                             ComputeTime(i);
-                            this->mTrials[i] = this->mHeap.Insert(i, this->mTimes[i]);
+                            this->InsertTrial(i);
                         }
                     }
                 }
             }
         }
 
-        // Called by Iterate().
-        void ComputeTime(size_t i)
+        // Called by Iterate() and Execute().
+        virtual void ComputeTime(size_t i) override
         {
             bool hasXTerm;
             Real xConst;
@@ -309,23 +309,21 @@ namespace gte
                     Real sum = xConst + yConst;
                     Real diff = xConst - yConst;
                     Real discr = (Real)2 * this->mInvSpeeds[i] * this->mInvSpeeds[i] - diff * diff;
-                    if (discr >= (Real)0)
+                    if (diff * diff <= this->mInvSpeeds[i] * this->mInvSpeeds[i])
                     {
-                        // The quadratic equation has a real-valued solution.
-                        // Choose the largest positive root for the crossing
-                        // time.
+                        // The neighbor times differ by at most the inverse
+                        // speed, so the largest root of the quadratic equation
+                        // is real-valued and at least the larger neighbor time.
+                        // It is the crossing time.
                         this->mTimes[i] = (Real)0.5 * (sum + std::sqrt(discr));
                     }
                     else
                     {
-                        // The quadratic equation does not have a real-valued
-                        // solution.  This can happen when the speed is so
-                        // large that the time gradient has very small length,
-                        // which means that the time has not changed
-                        // significantly from the neighbors to the current
-                        // pixel.  Just choose the maximum time of the
-                        // neighbors.  (Is there a better choice?)
-                        this->mTimes[i] = (diff >= (Real)0 ? xConst : yConst);
+                        // The front arrives from the neighbor with the smaller
+                        // time.  Use the linear equation for that neighbor.  The
+                        // quadratic root, when it exists, is smaller than the
+                        // larger neighbor time, which violates causality.
+                        this->mTimes[i] = this->mInvSpeeds[i] + (diff >= (Real)0 ? yConst : xConst);
                     }
                 }
                 else
@@ -122,15 +122,13 @@ namespace gte
         // Run one step of the fast marching algorithm.
         virtual void Iterate() override
         {
-            // Remove the minimum trial value from the heap.
+            // Remove the minimum trial value from the heap.  The pixel is
+            // promoted from trial to known.
             size_t i;
-            Real value;
-            this->mHeap.Remove(i, value);
-
-            // Promote the trial value to a known value.  The value was
-            // negative but is now nonnegative (the heap stores only
-            // nonnegative numbers).
-            this->mTrials[i] = nullptr;
+            if (!this->RemoveTrial(i))
+            {
+                return;
+            }
 
             // All trial pixels must be updated.  All far neighbors must
             // become trial pixels.
@@ -138,72 +136,72 @@ namespace gte
             if (this->IsTrial(iM1))
             {
                 ComputeTime(iM1);
-                this->mHeap.Update(this->mTrials[iM1], this->mTimes[iM1]);
+                this->UpdateTrial(iM1);
             }
             else if (this->IsFar(iM1))
             {
                 ComputeTime(iM1);
-                this->mTrials[iM1] = this->mHeap.Insert(iM1, this->mTimes[iM1]);
+                this->InsertTrial(iM1);
             }
 
             size_t iP1 = i + 1;
             if (this->IsTrial(iP1))
             {
                 ComputeTime(iP1);
-                this->mHeap.Update(this->mTrials[iP1], this->mTimes[iP1]);
+                this->UpdateTrial(iP1);
             }
             else if (this->IsFar(iP1))
             {
                 ComputeTime(iP1);
-                this->mTrials[iP1] = this->mHeap.Insert(iP1, this->mTimes[iP1]);
+                this->InsertTrial(iP1);
             }
 
             size_t iMXB = i - mXBound;
             if (this->IsTrial(iMXB))
             {
                 ComputeTime(iMXB);
-                this->mHeap.Update(this->mTrials[iMXB], this->mTimes[iMXB]);
+                this->UpdateTrial(iMXB);
             }
             else if (this->IsFar(iMXB))
             {
                 ComputeTime(iMXB);
-                this->mTrials[iMXB] = this->mHeap.Insert(iMXB, this->mTimes[iMXB]);
+                this->InsertTrial(iMXB);
             }
 
             size_t iPXB = i + mXBound;
             if (this->IsTrial(iPXB))
             {
                 ComputeTime(iPXB);
-                this->mHeap.Update(this->mTrials[iPXB], this->mTimes[iPXB]);
+                this->UpdateTrial(iPXB);
             }
             else if (this->IsFar(iPXB))
             {
                 ComputeTime(iPXB);
-                this->mTrials[iPXB] = this->mHeap.Insert(iPXB, this->mTimes[iPXB]);
+                this->InsertTrial(iPXB);
             }
 
             size_t iMXYB = i - mXYBound;
             if (this->IsTrial(iMXYB))
             {
                 ComputeTime(iMXYB);
-                this->mHeap.Update(this->mTrials[iMXYB], this->mTimes[iMXYB]);
+                this->UpdateTrial(iMXYB);
             }
             else if (this->IsFar(iMXYB))
             {
                 ComputeTime(iMXYB);
-                this->mTrials[iMXYB] = this->mHeap.Insert(iMXYB, this->mTimes[iMXYB]);
+                this->InsertTrial(iMXYB);
             }
 
             size_t iPXYB = i + mXYBound;
             if (this->IsTrial(iPXYB))
             {
                 ComputeTime(iPXYB);
-                this->mHeap.Update(this->mTrials[iPXYB], this->mTimes[iPXYB]);
+                this->UpdateTrial(iPXYB);
             }
             else if (this->IsFar(iPXYB))
             {
                 ComputeTime(iPXYB);
-                this->mTrials[iPXYB] = this->mHeap.Insert(iPXYB, this->mTimes[iPXYB]);
+                this->InsertTrial(iPXYB);
             }
         }
 
@@ -225,6 +223,8 @@ namespace gte
             mInvXSpacing = (Real)1 / xSpacing;
             mInvYSpacing = (Real)1 / ySpacing;
             mInvZSpacing = (Real)1 / zSpacing;
+            this->mLayerSize = mXYBound;
+            this->mNeighborOffsets = { 1, mXBound, mXYBound };
 
             // Boundary pixels are marked as zero speed to allow us to avoid
             // having to process the boundary pixels separately during the
@@ -337,6 +337,48 @@ namespace gte
                 this->mTimes[i] = -std::numeric_limits<Real>::max();
             }
 
+            // faces (x,y,0) and (x,y,zmax)
+            for (y = 0; y < mYBound; ++y)
+            {
+                for (x = 0; x < mXBound; ++x)
+                {
+                    i = Index(x, y, 0);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(x, y, mZBoundM1);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
+            // faces (x,0,z) and (x,ymax,z)
+            for (z = 0; z < mZBound; ++z)
+            {
+                for (x = 0; x < mXBound; ++x)
+                {
+                    i = Index(x, 0, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(x, mYBoundM1, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
+            // faces (0,y,z) and (xmax,y,z)
+            for (z = 0; z < mZBound; ++z)
+            {
+                for (y = 0; y < mYBound; ++y)
+                {
+                    i = Index(0, y, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(mXBoundM1, y, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
             // Compute the first batch of trial pixels.  These are pixels a grid
             // distance of one away from the seed pixels.
             for (z = 1; z < mZBoundM1; ++z)
@@ -356,7 +398,7 @@ namespace gte
                                 || (this->IsValid(i + mXYBound) && !this->IsTrial(i + mXYBound)))
                             {
                                 ComputeTime(i);
-                                this->mTrials[i] = this->mHeap.Insert(i, this->mTimes[i]);
+                                this->InsertTrial(i);
                             }
                         }
                     }
@@ -364,8 +406,8 @@ namespace gte
             }
         }
 
-        // Called by Iterate().
-        void ComputeTime(size_t i)
+        // Called by Iterate() and Execute().
+        virtual void ComputeTime(size_t i) override
         {
             bool hasXTerm;
             Real xConst;
@@ -459,31 +501,32 @@ namespace gte
                         discr -= diff * diff;
                         diff = yConst - zConst;
                         discr -= diff * diff;
-                        if (discr >= (Real)0)
+                        Real maxConst = std::max(std::max(xConst, yConst), zConst);
+                        Real root = (discr >= (Real)0 ? (sum + std::sqrt(discr)) / (Real)3 : (Real)0);
+                        if (discr >= (Real)0 && root >= maxConst)
                         {
-                            // The quadratic equation has a real-valued
-                            // solution.  Choose the largest positive root for
-                            // the crossing time.
-                            this->mTimes[i] = (sum + std::sqrt(discr)) / (Real)3;
+                            // The largest root of the quadratic equation is
+                            // real-valued and at least the largest neighbor
+                            // time.  It is the crossing time.
+                            this->mTimes[i] = root;
                         }
                         else
                         {
-                            // The quadratic equation does not have a
-                            // real-valued solution.  This can happen when the
-                            // speed is so large that the time gradient has
-                            // very small length, which means that the time
-                            // has not changed significantly from the
-                            // neighbors to the current pixel.  Just choose
-                            // the maximum time of the neighbors.  (Is there a
-                            // better choice?)
-                            this->mTimes[i] = xConst;
-                            if (yConst > this->mTimes[i])
+                            // The front does not arrive from all three
+                            // directions.  Solve the equation for the two
+                            // neighbors with the smallest times, which is
+                            // the equation of the xy, xz or yz case.
+                            Real minConst = std::min(std::min(xConst, yConst), zConst);
+                            Real midConst = sum - minConst - maxConst;
+                            diff = midConst - minConst;
+                            if (diff <= this->mInvSpeeds[i])
                             {
-                                this->mTimes[i] = yConst;
+                                discr = (Real)2 * this->mInvSpeeds[i] * this->mInvSpeeds[i] - diff * diff;
+                                this->mTimes[i] = (Real)0.5 * (minConst + midConst + std::sqrt(discr));
                             }
-                            if (zConst > this->mTimes[i])
+                            else
                             {
-                                this->mTimes[i] = zConst;
+                                this->mTimes[i] = this->mInvSpeeds[i] + minConst;
                             }
                         }
                     }
@@ -493,24 +536,21 @@ namespace gte
                         sum = xConst + yConst;
                         diff = xConst - yConst;
                         discr = (Real)2 * this->mInvSpeeds[i] * this->mInvSpeeds[i] - diff * diff;
-                        if (discr >= (Real)0)
+                        if (diff * diff <= this->mInvSpeeds[i] * this->mInvSpeeds[i])
                         {
-                            // The quadratic equation has a real-valued
-                            // solution.  Choose the largest positive root for
-                            // the crossing time.
+                            // The neighbor times differ by at most the inverse
+                            // speed, so the largest root of the quadratic equation
+                            // is real-valued and at least the larger neighbor time.
+                            // It is the crossing time.
                             this->mTimes[i] = (Real)0.5 * (sum + std::sqrt(discr));
                         }
                         else
                         {
-                            // The quadratic equation does not have a
-                            // real-valued solution.  This can happen when the
-                            // speed is so large that the time gradient has
-                            // very small length, which means that the time
-                            // has not changed significantly from the
-                            // neighbors to the current pixel.  Just choose
-                            // the maximum time of the neighbors.  (Is there a
-                            // better choice?)
-                            this->mTimes[i] = (diff >= (Real)0 ? xConst : yConst);
+                            // The front arrives from the neighbor with the smaller
+                            // time.  Use the linear equation for that neighbor.  The
+                            // quadratic root, when it exists, is smaller than the
+                            // larger neighbor time, which violates causality.
+                            this->mTimes[i] = this->mInvSpeeds[i] + (diff >= (Real)0 ? yConst : xConst);
                         }
                     }
                 }
@@ -522,24 +562,21 @@ namespace gte
                         sum = xConst + zConst;
                         diff = xConst - zConst;
                         discr = (Real)2 * this->mInvSpeeds[i] * this->mInvSpeeds[i] - diff * diff;
-                        if (discr >= (Real)0)
+                        if (diff * diff <= this->mInvSpeeds[i] * this->mInvSpeeds[i])
                         {
-                            // The quadratic equation has a real-valued
-                            // solution.  Choose the largest positive root for
-                            // the crossing time.
+                            // The neighbor times differ by at most the inverse
+                            // speed, so the largest root of the quadratic equation
+                            // is real-valued and at least the larger neighbor time.
+                            // It is the crossing time.
                             this->mTimes[i] = (Real)0.5 * (sum + std::sqrt(discr));
                         }
                         else
                         {
-                            // The quadratic equation does not have a
-                            // real-valued solution.  This can happen when the
-                            // speed is so large that the time gradient has
-                            // very small length, which means that the time
-                            // has not changed significantly from the
-                            // neighbors to the current pixel.  Just choose
-                            // the maximum time of the neighbors.  (Is there a
-                            // better choice?)
-                            this->mTimes[i] = (diff >= (Real)0 ? xConst : zConst);
+                            // The front arrives from the neighbor with the smaller
+                            // time.  Use the linear equation for that neighbor.  The
+                            // quadratic root, when it exists, is smaller than the
+                            // larger neighbor time, which violates causality.
+                            this->mTimes[i] = this->mInvSpeeds[i] + (diff >= (Real)0 ? zConst : xConst);
                         }
                     }
                     else
@@ -559,24 +596,21 @@ namespace gte
                         sum = yConst + zConst;
                         diff = yConst - zConst;
                         discr = (Real)2 * this->mInvSpeeds[i] * this->mInvSpeeds[i] - diff * diff;
-                        if (discr >= (Real)0)
+                        if (diff * diff <= this->mInvSpeeds[i] * this->mInvSpeeds[i])
                         {
-                            // The quadratic equation has a real-valued
-                            // solution.  Choose the largest positive root for
-                            // the crossing time.
+                            // The neighbor times differ by at most the inverse
+                            // speed, so the largest root of the quadratic equation
+                            // is real-valued and at least the larger neighbor time.
+                            // It is the crossing time.
                             this->mTimes[i] = (Real)0.5 * (sum + std::sqrt(discr));
                         }
                         else
                         {
-                            // The quadratic equation does not have a
-                            // real-valued solution.  This can happen when the
-                            // speed is so large that the time gradient has
-                            // very small length, which means that the time
-                            // has not changed significantly from the
-                            // neighbors to the current pixel.  Just choose
-                            // the maximum time of the neighbors.  (Is there a
-                            // better choice?)
-                            this->mTimes[i] = (diff >= (Real)0 ? yConst : zConst);
+                            // The front arrives from the neighbor with the smaller
+                            // time.  Use the linear equation for that neighbor.  The
+                            // quadratic root, when it exists, is smaller than the
+                            // larger neighbor time, which violates causality.
+                            this->mTimes[i] = this->mInvSpeeds[i] + (diff >= (Real)0 ? zConst : yConst);
                         }
                     }
                     else
@@ -0,0 +1,317 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// The fast sweeping method solves the eikonal equation |grad(T)| = 1/F for
+// the crossing times T of a front moving with speed F.  It is an alternative
+// to fast marching (see GteFastMarch.h) that replaces the priority queue by
+// Gauss-Seidel iterations with alternating sweep orderings, 2^n orderings
+// for an n-dimensional image.  Each sweep order follows the characteristics
+// in one quadrant (2D) or octant (3D) of directions, so for smooth speed
+// fields the iterations converge in a handful of passes over the image.
+// The method is described in
+//   A fast sweeping method for eikonal equations,
+//   Hongkai Zhao,
+//   Mathematics of Computation 74 (2005) 603-627
+//
+// The upwind update and the conventions for the times are the same as for
+// fast marching.  Define maxReal to be std::numeric_limits<Real>::max().  The
+// seed points have a time of 0.  A time of maxReal indicates that the pixel
+// has not been reached by the front.  Pixels with speed 0 have a time of
+// -maxReal and are never reached.  Unlike fast marching, the image boundary
+// pixels are not sacrificed, and the pixel spacings are used in the update.
+
+namespace gte
+{
+    template <typename Real>
+    class FastSweep
+    {
+        // Abstract base class.
+    public:
+        virtual ~FastSweep()
+        {
+        }
+
+    protected:
+        // The speeds must be nonnegative and are inverted because the
+        // reciprocals are all that are needed in the numerical method.
+        FastSweep(size_t quantity, std::vector<size_t> const& seeds, std::vector<Real> const& speeds)
+            :
+            mQuantity(quantity),
+            mTimes(quantity, std::numeric_limits<Real>::max()),
+            mInvSpeeds(quantity),
+            mLineLength(quantity),
+            mNumLines(1),
+            mNumOrderings(1)
+        {
+            for (auto seed : seeds)
+            {
+                mTimes[seed] = (Real)0;
+            }
+
+            for (size_t i = 0; i < mQuantity; ++i)
+            {
+                if (speeds[i] > (Real)0)
+                {
+                    mInvSpeeds[i] = (Real)1 / speeds[i];
+                }
+                else
+                {
+                    mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+        }
+
+        FastSweep(size_t quantity, std::vector<size_t> const& seeds, Real speed)
+            :
+            mQuantity(quantity),
+            mTimes(quantity, std::numeric_limits<Real>::max()),
+            mInvSpeeds(quantity, (Real)1 / speed),
+            mLineLength(quantity),
+            mNumLines(1),
+            mNumOrderings(1)
+        {
+            for (auto seed : seeds)
+            {
+                mTimes[seed] = (Real)0;
+            }
+        }
+
+    public:
+        // Member access.
+        inline size_t GetQuantity() const
+        {
+            return mQuantity;
+        }
+
+        inline void SetTime(size_t i, Real time)
+        {
+            mTimes[i] = time;
+        }
+
+        inline Real GetTime(size_t i) const
+        {
+            return mTimes[i];
+        }
+
+        void GetTimeExtremes(Real& minValue, Real& maxValue) const
+        {
+            // If all times are invalid, minValue = +maxReal and
+            // maxValue = -maxReal on exit.
+            minValue = std::numeric_limits<Real>::max();
+            maxValue = -std::numeric_limits<Real>::max();
+            for (size_t i = 0; i < mQuantity; ++i)
+            {
+                if (IsValid(i))
+                {
+                    minValue = std::min(minValue, mTimes[i]);
+                    maxValue = std::max(maxValue, mTimes[i]);
+                }
+            }
+        }
+
+        // Image element classification.
+        inline bool IsValid(size_t i) const
+        {
+            return (Real)0 <= mTimes[i] && mTimes[i] < std::numeric_limits<Real>::max();
+        }
+
+        inline bool IsFar(size_t i) const
+        {
+            return mTimes[i] == std::numeric_limits<Real>::max();
+        }
+
+        inline bool IsZeroSpeed(size_t i) const
+        {
+            return mTimes[i] == -std::numeric_limits<Real>::max();
+        }
+
+        // Run iterations until the maximum decrease of a time during an
+        // iteration is at most 'tolerance' or until maxIterations
+        // iterations have been run.  An iteration consists of one sweep for
+        // each ordering.  The return value is the number of iterations.
+        // With the default tolerance of zero, the iterations stop when the
+        // times do not change, which is the exact solution of the
+        // discretized equation.
+        //
+        // For numThreads > 1, each sweep is pipelined.  The lines of the
+        // image along the x-axis are split into numThreads bands of
+        // contiguous x-values, and the lines themselves are grouped into
+        // blocks.  The thread of a band processes a block after the thread
+        // of the preceding band (in the sweep direction) has processed that
+        // block.  The order of the updates of neighboring pixels is the same
+        // as that of the single-threaded sweep, so the times are exactly the
+        // same and so is the number of iterations.
+        unsigned int Execute(unsigned int numThreads = 1, unsigned int maxIterations = 64,
+            Real tolerance = (Real)0)
+        {
+            unsigned int iteration = 0;
+            while (iteration < maxIterations)
+            {
+                ++iteration;
+                Real maxChange = (Real)0;
+                for (unsigned int ordering = 0; ordering < mNumOrderings; ++ordering)
+                {
+                    maxChange = std::max(maxChange, Sweep(ordering, numThreads));
+                }
+
+                if (maxChange <= tolerance)
+                {
+                    break;
+                }
+            }
+            return iteration;
+        }
+
+    protected:
+        // Update the pixels with x in [xBegin,xEnd) of the specified line.
+        // Bit 0 of the ordering is 1 when x decreases during the sweep.  The
+        // other bits and the line number are interpreted by the derived
+        // class; the line number is in the order of the sweep, so line 0 is
+        // the first line visited by the sweep.  The return value is the
+        // maximum decrease of a time.
+        virtual Real SweepLine(unsigned int ordering, size_t line, size_t xBegin, size_t xEnd) = 0;
+
+        Real Sweep(unsigned int ordering, unsigned int numThreads)
+        {
+            size_t const numBands = std::min(static_cast<size_t>(numThreads), mLineLength);
+            if (numBands <= 1)
+            {
+                Real maxChange = (Real)0;
+                for (size_t line = 0; line < mNumLines; ++line)
+                {
+                    maxChange = std::max(maxChange, SweepLine(ordering, line, 0, mLineLength));
+                }
+                return maxChange;
+            }
+
+            // A block has enough lines to amortize the synchronization but
+            // few enough to keep the pipeline filled.
+            size_t const blockSize = std::max(mNumLines / (4 * numBands), (size_t)1);
+            size_t const numBlocks = (mNumLines + blockSize - 1) / blockSize;
+            bool const decreasing = ((ordering & 1) != 0);
+
+            // progress[b] is the number of blocks finished by band b.
+            std::vector<std::atomic<size_t>> progress(numBands);
+            for (auto& value : progress)
+            {
+                value.store(0);
+            }
+            std::vector<Real> maxChanges(numBands, (Real)0);
+
+            std::vector<std::thread> process(numBands);
+            for (size_t b = 0; b < numBands; ++b)
+            {
+                process[b] = std::thread([this, b, ordering, numBands, blockSize, numBlocks,
+                    decreasing, &progress, &maxChanges]()
+                {
+                    size_t xBegin = (b * mLineLength) / numBands;
+                    size_t xEnd = ((b + 1) * mLineLength) / numBands;
+                    bool hasPrevious = (decreasing ? b + 1 < numBands : b > 0);
+                    size_t previous = (decreasing ? b + 1 : b - 1);
+                    Real maxChange = (Real)0;
+                    for (size_t block = 0; block < numBlocks; ++block)
+                    {
+                        if (hasPrevious)
+                        {
+                            while (progress[previous].load() <= block)
+                            {
+                                std::this_thread::yield();
+                            }
+                        }
+
+                        size_t lineEnd = std::min((block + 1) * blockSize, mNumLines);
+                        for (size_t line = block * blockSize; line < lineEnd; ++line)
+                        {
+                            maxChange = std::max(maxChange, SweepLine(ordering, line, xBegin, xEnd));
+                        }
+                        progress[b].store(block + 1);
+                    }
+                    maxChanges[b] = maxChange;
+                });
+            }
+
+            Real maxChange = (Real)0;
+            for (size_t b = 0; b < numBands; ++b)
+            {
+                process[b].join();
+                maxChange = std::max(maxChange, maxChanges[b]);
+            }
+            return maxChange;
+        }
+
+        // The time of pixel j as a neighbor value.  Zero-speed pixels have
+        // negative times but behave as unreached pixels.
+        inline Real GetNeighborTime(size_t j) const
+        {
+            return (mTimes[j] >= (Real)0 ? mTimes[j] : std::numeric_limits<Real>::max());
+        }
+
+        // Solve the upwind discretization of the eikonal equation at a
+        // pixel.  The input a[d] is the minimum of the neighbor times along
+        // axis d (maxReal if neither neighbor is reached), w[d] is
+        // 1/spacing[d]^2 and invSpeed is the inverse speed at the pixel.
+        // The time T is the largest solution of
+        //   sum_{d : a[d] < T} w[d]*(T - a[d])^2 = invSpeed^2
+        // which is computed by adding the axes in increasing order of a[d].
+        // The equation is solved for T - a[0] in terms of the differences
+        // a[d] - a[0], as FastMarch does, to avoid the cancellation of the
+        // expanded quadratic when the times are large.
+        template <int N>
+        static Real Solve(std::array<Real, N> a, std::array<Real, N> w, Real invSpeed)
+        {
+            for (int d0 = 1; d0 < N; ++d0)
+            {
+                for (int d1 = d0; d1 > 0 && a[d1] < a[d1 - 1]; --d1)
+                {
+                    std::swap(a[d1], a[d1 - 1]);
+                    std::swap(w[d1], w[d1 - 1]);
+                }
+            }
+
+            Real const maxReal = std::numeric_limits<Real>::max();
+            if (a[0] == maxReal)
+            {
+                return maxReal;
+            }
+
+            Real const sqrInvSpeed = invSpeed * invSpeed;
+            Real delta = maxReal, sum0 = (Real)0, sum1 = (Real)0, sum2 = (Real)0;
+            for (int d = 0; d < N && a[d] - a[0] < delta; ++d)
+            {
+                Real diff = a[d] - a[0];
+                sum0 += w[d];
+                sum1 += w[d] * diff;
+                sum2 += w[d] * diff * diff;
+                Real discr = sum1 * sum1 - sum0 * (sum2 - sqrInvSpeed);
+                delta = (sum1 + std::sqrt(std::max(discr, (Real)0))) / sum0;
+            }
+            return a[0] + delta;
+        }
+
+        size_t mQuantity;
+        std::vector<Real> mTimes;
+        std::vector<Real> mInvSpeeds;
+
+        // The derived classes set these in their Initialize functions.  The
+        // image is a sequence of mNumLines lines of mLineLength pixels along
+        // the x-axis.
+        size_t mLineLength, mNumLines;
+        unsigned int mNumOrderings;
+    };
+}
@@ -0,0 +1,139 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Imagics/GteFastSweep.h>
+
+// See GteFastSweep.h for a description of the algorithm.  The pixel (x,y)
+// has index x + xBound * y.  The sweep orderings are the 4 combinations of
+// increasing or decreasing x and y.
+
+namespace gte
+{
+    template <typename Real>
+    class FastSweep2 : public FastSweep<Real>
+    {
+    public:
+        // Construction and destruction.
+        FastSweep2(size_t xBound, size_t yBound, Real xSpacing, Real ySpacing,
+            std::vector<size_t> const& seeds, std::vector<Real> const& speeds)
+            :
+            FastSweep<Real>(xBound * yBound, seeds, speeds)
+        {
+            Initialize(xBound, yBound, xSpacing, ySpacing);
+        }
+
+        FastSweep2(size_t xBound, size_t yBound, Real xSpacing, Real ySpacing,
+            std::vector<size_t> const& seeds, Real speed)
+            :
+            FastSweep<Real>(xBound * yBound, seeds, speed)
+        {
+            Initialize(xBound, yBound, xSpacing, ySpacing);
+        }
+
+        virtual ~FastSweep2()
+        {
+        }
+
+        // Member access.
+        inline size_t GetXBound() const
+        {
+            return mXBound;
+        }
+
+        inline size_t GetYBound() const
+        {
+            return mYBound;
+        }
+
+        inline Real GetXSpacing() const
+        {
+            return mXSpacing;
+        }
+
+        inline Real GetYSpacing() const
+        {
+            return mYSpacing;
+        }
+
+        inline size_t Index(size_t x, size_t y) const
+        {
+            return x + mXBound * y;
+        }
+
+    protected:
+        // Called by the constructors.
+        void Initialize(size_t xBound, size_t yBound, Real xSpacing, Real ySpacing)
+        {
+            mXBound = xBound;
+            mYBound = yBound;
+            mXSpacing = xSpacing;
+            mYSpacing = ySpacing;
+            mWeights = { (Real)1 / (xSpacing * xSpacing), (Real)1 / (ySpacing * ySpacing) };
+            this->mLineLength = mXBound;
+            this->mNumLines = mYBound;
+            this->mNumOrderings = 4;
+        }
+
+        // Called by Sweep().  Bit 1 of the ordering is 1 when y decreases
+        // during the sweep.
+        virtual Real SweepLine(unsigned int ordering, size_t line, size_t xBegin, size_t xEnd) override
+        {
+            size_t y = ((ordering & 2) != 0 ? mYBound - 1 - line : line);
+            Real maxChange = (Real)0;
+            if ((ordering & 1) != 0)
+            {
+                for (size_t x = xEnd; x > xBegin; --x)
+                {
+                    maxChange = std::max(maxChange, Update(x - 1, y));
+                }
+            }
+            else
+            {
+                for (size_t x = xBegin; x < xEnd; ++x)
+                {
+                    maxChange = std::max(maxChange, Update(x, y));
+                }
+            }
+            return maxChange;
+        }
+
+        // Update the time of pixel (x,y) and return the decrease in time.
+        Real Update(size_t x, size_t y)
+        {
+            size_t i = Index(x, y);
+            Real oldTime = this->mTimes[i];
+            if (oldTime <= (Real)0)
+            {
+                // The pixel is a seed or has zero speed.
+                return (Real)0;
+            }
+
+            Real const maxReal = std::numeric_limits<Real>::max();
+            std::array<Real, 2> a;
+            a[0] = std::min(
+                (x > 0 ? this->GetNeighborTime(i - 1) : maxReal),
+                (x + 1 < mXBound ? this->GetNeighborTime(i + 1) : maxReal));
+            a[1] = std::min(
+                (y > 0 ? this->GetNeighborTime(i - mXBound) : maxReal),
+                (y + 1 < mYBound ? this->GetNeighborTime(i + mXBound) : maxReal));
+
+            Real time = this->template Solve<2>(a, mWeights, this->mInvSpeeds[i]);
+            if (time < oldTime)
+            {
+                this->mTimes[i] = time;
+                return oldTime - time;
+            }
+            return (Real)0;
+        }
+
+        size_t mXBound, mYBound;
+        Real mXSpacing, mYSpacing;
+        std::array<Real, 2> mWeights;
+    };
+}
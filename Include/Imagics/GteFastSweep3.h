@@ -0,0 +1,170 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <Imagics/GteFastSweep.h>
+
+// See GteFastSweep.h for a description of the algorithm.  The voxel (x,y,z)
+// has index x + xBound * (y + yBound * z).  The sweep orderings are the 8
+// combinations of increasing or decreasing x, y and z.
+
+namespace gte
+{
+    template <typename Real>
+    class FastSweep3 : public FastSweep<Real>
+    {
+    public:
+        // Construction and destruction.
+        FastSweep3(size_t xBound, size_t yBound, size_t zBound,
+            Real xSpacing, Real ySpacing, Real zSpacing,
+            std::vector<size_t> const& seeds, std::vector<Real> const& speeds)
+            :
+            FastSweep<Real>(xBound * yBound * zBound, seeds, speeds)
+        {
+            Initialize(xBound, yBound, zBound, xSpacing, ySpacing, zSpacing);
+        }
+
+        FastSweep3(size_t xBound, size_t yBound, size_t zBound,
+            Real xSpacing, Real ySpacing, Real zSpacing,
+            std::vector<size_t> const& seeds, Real speed)
+            :
+            FastSweep<Real>(xBound * yBound * zBound, seeds, speed)
+        {
+            Initialize(xBound, yBound, zBound, xSpacing, ySpacing, zSpacing);
+        }
+
+        virtual ~FastSweep3()
+        {
+        }
+
+        // Member access.
+        inline size_t GetXBound() const
+        {
+            return mXBound;
+        }
+
+        inline size_t GetYBound() const
+        {
+            return mYBound;
+        }
+
+        inline size_t GetZBound() const
+        {
+            return mZBound;
+        }
+
+        inline Real GetXSpacing() const
+        {
+            return mXSpacing;
+        }
+
+        inline Real GetYSpacing() const
+        {
+            return mYSpacing;
+        }
+
+        inline Real GetZSpacing() const
+        {
+            return mZSpacing;
+        }
+
+        inline size_t Index(size_t x, size_t y, size_t z) const
+        {
+            return x + mXBound * (y + mYBound * z);
+        }
+
+    protected:
+        // Called by the constructors.
+        void Initialize(size_t xBound, size_t yBound, size_t zBound,
+            Real xSpacing, Real ySpacing, Real zSpacing)
+        {
+            mXBound = xBound;
+            mYBound = yBound;
+            mZBound = zBound;
+            mXYBound = xBound * yBound;
+            mXSpacing = xSpacing;
+            mYSpacing = ySpacing;
+            mZSpacing = zSpacing;
+            mWeights = { (Real)1 / (xSpacing * xSpacing), (Real)1 / (ySpacing * ySpacing),
+                (Real)1 / (zSpacing * zSpacing) };
+            this->mLineLength = mXBound;
+            this->mNumLines = mYBound * mZBound;
+            this->mNumOrderings = 8;
+        }
+
+        // Called by Sweep().  Bit 1 of the ordering is 1 when y decreases
+        // during the sweep and bit 2 is 1 when z decreases during the
+        // sweep.  The lines are visited in the order of z, then y within
+        // each slice.
+        virtual Real SweepLine(unsigned int ordering, size_t line, size_t xBegin, size_t xEnd) override
+        {
+            size_t y = line % mYBound, z = line / mYBound;
+            if ((ordering & 2) != 0)
+            {
+                y = mYBound - 1 - y;
+            }
+            if ((ordering & 4) != 0)
+            {
+                z = mZBound - 1 - z;
+            }
+
+            Real maxChange = (Real)0;
+            if ((ordering & 1) != 0)
+            {
+                for (size_t x = xEnd; x > xBegin; --x)
+                {
+                    maxChange = std::max(maxChange, Update(x - 1, y, z));
+                }
+            }
+            else
+            {
+                for (size_t x = xBegin; x < xEnd; ++x)
+                {
+                    maxChange = std::max(maxChange, Update(x, y, z));
+                }
+            }
+            return maxChange;
+        }
+
+        // Update the time of voxel (x,y,z) and return the decrease in time.
+        Real Update(size_t x, size_t y, size_t z)
+        {
+            size_t i = Index(x, y, z);
+            Real oldTime = this->mTimes[i];
+            if (oldTime <= (Real)0)
+            {
+                // The voxel is a seed or has zero speed.
+                return (Real)0;
+            }
+
+            Real const maxReal = std::numeric_limits<Real>::max();
+            std::array<Real, 3> a;
+            a[0] = std::min(
+                (x > 0 ? this->GetNeighborTime(i - 1) : maxReal),
+                (x + 1 < mXBound ? this->GetNeighborTime(i + 1) : maxReal));
+            a[1] = std::min(
+                (y > 0 ? this->GetNeighborTime(i - mXBound) : maxReal),
+                (y + 1 < mYBound ? this->GetNeighborTime(i + mXBound) : maxReal));
+            a[2] = std::min(
+                (z > 0 ? this->GetNeighborTime(i - mXYBound) : maxReal),
+                (z + 1 < mZBound ? this->GetNeighborTime(i + mXYBound) : maxReal));
+
+            Real time = this->template Solve<3>(a, mWeights, this->mInvSpeeds[i]);
+            if (time < oldTime)
+            {
+                this->mTimes[i] = time;
+                return oldTime - time;
+            }
+            return (Real)0;
+        }
+
+        size_t mXBound, mYBound, mZBound, mXYBound;
+        Real mXSpacing, mYSpacing, mZSpacing;
+        std::array<Real, 3> mWeights;
+    };
+}
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <GTEngineDEF.h>
+#include <Imagics/GteImage.h>
+#include <cstdint>
 #include <vector>
 
 namespace gte
@@ -40,6 +42,35 @@ public:
     // constructor.  Bounds checking is used.
     void InsertCheck(int value);
 
+    // Bulk insertion of samples, typically the pixels of an Image2 or
+    // Image3, with the same bounds checking as InsertCheck.  The samples
+    // are split among numThreads threads, each thread counting into its own
+    // sub-histogram, and the sub-histograms are added to the buckets at the
+    // end.  The samples are binned in blocks whose bucket indices are
+    // computed by vectorizable loops.
+    void Insert(size_t numSamples, uint8_t const* samples, unsigned int numThreads = 1);
+    void Insert(size_t numSamples, uint16_t const* samples, unsigned int numThreads = 1);
+    void Insert(size_t numSamples, int const* samples, unsigned int numThreads = 1);
+
+    // Bulk insertion of real-valued samples.  The interval [minValue,maxValue]
+    // is mapped to the buckets as in the constructors for real-valued
+    // samples.  The samples smaller than minValue (or NaN) are counted by
+    // GetExcessLess() and those larger than maxValue are counted by
+    // GetExcessGreater().  The function requires minValue < maxValue.
+    void Insert(size_t numSamples, float const* samples, float minValue, float maxValue,
+        unsigned int numThreads = 1);
+    void Insert(size_t numSamples, double const* samples, double minValue, double maxValue,
+        unsigned int numThreads = 1);
+
+    // Convenience wrappers for images of a pixel type supported by the
+    // bulk insertion functions.
+    template <typename PixelType>
+    void Insert(Image<PixelType> const& image, unsigned int numThreads = 1);
+
+    template <typename PixelType>
+    void Insert(Image<PixelType> const& image, PixelType minValue, PixelType maxValue,
+        unsigned int numThreads = 1);
+
     // Member access.
     inline std::vector<int> const& GetBuckets() const;
     inline int GetExcessLess() const;
@@ -63,7 +94,50 @@ public:
     // cdf(U)/N >= 1-tailAmount/2, and cdf(U+1) < 1-tailAmount/2.
     void GetTails(double tailAmount, int& lower, int& upper);
 
+    // Get the cumulative histogram, cdf[V] = sum_{i=0}^{V} bucket[i].
+    void GetCumulative(std::vector<int>& cdf) const;
+
+    // Compute the joint histogram of two sample sets of the same size, for
+    // example two registered images.  The sample values are mapped directly
+    // to the buckets; pairs with a value out of range are not counted.  The
+    // output has numBuckets0*numBuckets1 elements and the count for the
+    // pair (v0,v1) is joint[v0 + numBuckets0 * v1].  The multithreading is
+    // the same as for the bulk insertion functions.
+    static void GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+        uint8_t const* samples0, uint8_t const* samples1, unsigned int numThreads,
+        std::vector<int>& joint);
+
+    static void GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+        uint16_t const* samples0, uint16_t const* samples1, unsigned int numThreads,
+        std::vector<int>& joint);
+
+    static void GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+        int const* samples0, int const* samples1, unsigned int numThreads,
+        std::vector<int>& joint);
+
 private:
+    // Support for bulk insertion.  The functor maps a sample index to a
+    // counter index in {0..numCounts-1} and the counts are added to the
+    // input array of numCounts elements.  For insertion, the counter index
+    // is the bucket index plus 1, where 0 is used for samples smaller than
+    // the range and numBuckets+1 is used for samples larger than the range.
+    template <typename Binner>
+    static void Count(size_t numSamples, size_t numCounts, unsigned int numThreads,
+        Binner const& binner, int* counts);
+
+    template <typename SampleType>
+    void InsertDirect(size_t numSamples, SampleType const* samples,
+        unsigned int numThreads);
+
+    template <typename SampleType>
+    void InsertRescaled(size_t numSamples, SampleType const* samples,
+        SampleType minValue, SampleType maxValue, unsigned int numThreads);
+
+    template <typename SampleType>
+    static void ComputeJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+        SampleType const* samples0, SampleType const* samples1,
+        unsigned int numThreads, std::vector<int>& joint);
+
     std::vector<int> mBuckets;
     int mExcessLess, mExcessGreater;
 };
@@ -74,6 +148,20 @@ inline void Histogram::Insert(int value)
     ++mBuckets[value];
 }
 
+template <typename PixelType>
+void Histogram::Insert(Image<PixelType> const& image, unsigned int numThreads)
+{
+    Insert(image.GetNumPixels(), image.GetPixels().data(), numThreads);
+}
+
+template <typename PixelType>
+void Histogram::Insert(Image<PixelType> const& image, PixelType minValue,
+    PixelType maxValue, unsigned int numThreads)
+{
+    Insert(image.GetNumPixels(), image.GetPixels().data(), minValue, maxValue,
+        numThreads);
+}
+
 inline std::vector<int> const& Histogram::GetBuckets() const
 {
     return mBuckets;
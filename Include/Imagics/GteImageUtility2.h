@@ -42,6 +42,22 @@ public:
     static void GetComponents8(Image2<int>& image,
         std::vector<std::vector<size_t>>& components);
 
+    // Multithreaded versions of GetComponents4 and GetComponents8.  The
+    // labeling uses a block-parallel union-find algorithm.  The rows of the
+    // image are partitioned into numThreads strips that are labeled
+    // concurrently, the equivalences across the strip boundaries are merged
+    // and then the labels are resolved in a single linear pass.  The
+    // union-find parent links are stored in the image itself, so no
+    // additional per-pixel memory is required; the number of pixels must be
+    // smaller than std::numeric_limits<int>::max().  The output is identical
+    // to that of the single-threaded functions.  In particular, the
+    // components are numbered in the raster order of their first pixels.
+    static void GetComponents4(Image2<int>& image, unsigned int numThreads,
+        std::vector<std::vector<size_t>>& components);
+
+    static void GetComponents8(Image2<int>& image, unsigned int numThreads,
+        std::vector<std::vector<size_t>>& components);
+
     // Compute a dilation with a structuring element consisting of the
     // 4-connected neighbors of each pixel.  The input image is binary with 0
     // for background and 1 for foreground.  The output image must be an
@@ -148,6 +164,33 @@ public:
         int numNeighbors, std::array<int, 2> const* neighbors,
         Image2<int>& output);
 
+    // Morphological operations with a rectangular structuring element of
+    // (2*xRadius+1)x(2*yRadius+1) pixels centered at each pixel.  The
+    // rectangle is separable, so the operations are applied to the rows and
+    // then to the columns.  Each 1-dimensional pass uses the van Herk/Gil-
+    // Werman algorithm, which requires 3 comparisons per pixel regardless of
+    // the radius.  The rows (and then the columns) are partitioned among
+    // numThreads threads.  The semantics of the input image, zeroExterior
+    // and the output image are the same as for Dilate, Erode, Open and
+    // Close; for example, DilateRectangle(input, 1, 1, 1, output) produces
+    // the same output as Dilate8(input, output).  The functions are also
+    // valid for nonbinary images, in which case dilation is the maximum
+    // filter and erosion is the minimum filter over the rectangle.
+    static void DilateRectangle(Image2<int> const& input, int xRadius,
+        int yRadius, unsigned int numThreads, Image2<int>& output);
+
+    static void ErodeRectangle(Image2<int> const& input, bool zeroExterior,
+        int xRadius, int yRadius, unsigned int numThreads,
+        Image2<int>& output);
+
+    static void OpenRectangle(Image2<int> const& input, bool zeroExterior,
+        int xRadius, int yRadius, unsigned int numThreads,
+        Image2<int>& output);
+
+    static void CloseRectangle(Image2<int> const& input, bool zeroExterior,
+        int xRadius, int yRadius, unsigned int numThreads,
+        Image2<int>& output);
+
     // Locate a pixel and walk around the edge of a component.  The input
     // (x,y) is where the search starts for a nonzero pixel.  If (x,y) is
     // outside the component, the walk is around the outside the component.
@@ -179,6 +222,32 @@ public:
     static void GetL2Distance(Image2<int> const& image, float& maxDistance,
         int& xMax, int& yMax, Image2<float>& transform);
 
+    // Compute the exact L2-distance transform of the binary image using the
+    // separable lower-envelope algorithm of Felzenszwalb and Huttenlocher.
+    // The distance at a pixel is the distance to the nearest 0-valued pixel
+    // and there is no limit on the maximum distance.  The transform is
+    // computed by a pass along the rows followed by a pass along the
+    // columns, and the rows (columns) are partitioned among numThreads
+    // threads.  The function returns the maximum distance and a point at
+    // which the maximum distance is attained.  If the image has no 0-valued
+    // pixels, the distances are std::numeric_limits<float>::max().
+    static void GetExactL2Distance(Image2<int> const& image,
+        unsigned int numThreads, float& maxDistance, int& xMax, int& yMax,
+        Image2<float>& transform);
+
+    // The exact squared L2-distance transform and, for the second function,
+    // the index of the nearest 0-valued pixel (the feature transform).  The
+    // squared distances must be smaller than std::numeric_limits<int>::max().
+    // If the image has no 0-valued pixels, the squared distances are
+    // std::numeric_limits<int>::max() and the nearest indices are
+    // std::numeric_limits<size_t>::max().
+    static void GetExactSqrL2Distance(Image2<int> const& image,
+        unsigned int numThreads, Image2<int>& sqrDistance);
+
+    static void GetExactSqrL2Distance(Image2<int> const& image,
+        unsigned int numThreads, Image2<int>& sqrDistance,
+        Image2<size_t>& nearest);
+
     // Compute a skeleton of a binary image.  Boundary pixels are trimmed from
     // the object one layer at a time based on their adjacency to interior
     // pixels.  At each step the connectivity and cycles of the object are
@@ -229,10 +298,30 @@ private:
     static void GetComponents(int numNeighbors, int const* delta,
         Image2<int>& image, std::vector<std::vector<size_t>>& components);
 
+    // Block-parallel union-find connected component labeling.  The
+    // neighbor offsets are those for neighbors preceding the pixel in
+    // raster order.  The rowDelta offsets are relative to the same row and
+    // the prevDelta offsets are relative to the previous row.
+    static void GetComponents(int numRowNeighbors, int const* rowDelta,
+        int numPrevNeighbors, int const* prevDelta, unsigned int numThreads,
+        Image2<int>& image, std::vector<std::vector<size_t>>& components);
+
+    // Support for the rectangle morphology.  The rows and columns are
+    // filtered by the van Herk/Gil-Werman algorithm of
+    // GteImageUtilityDetail.h.
+    static void MinMaxFilter2(Image2<int> const& input, int xRadius,
+        int yRadius, bool useMax, int padValue, unsigned int numThreads,
+        Image2<int>& output);
+
     // Support for GetL2Distance.
     static void L2Check(int x, int y, int dx, int dy, Image2<int>& xNear,
         Image2<int>& yNear, Image2<int>& dist);
 
+    // Support for GetExactL2Distance and GetExactSqrL2Distance.
+    static void GetExactSqrL2Distance(Image2<int> const& image,
+        unsigned int numThreads, Image2<int>& sqrDistance,
+        Image2<size_t>* nearest);
+
     // Support for GetSkeleton.
     static bool Interior2 (Image2<int>& image, int x, int y);
     static bool Interior3 (Image2<int>& image, int x, int y);
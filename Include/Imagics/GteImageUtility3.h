@@ -7,7 +7,7 @@
 
 #pragma once
 
-#include <Imagics/GteImage3.h>
+#include <Imagics/GteBinaryImage.h>
 #include <functional>
 
 namespace gte
@@ -46,6 +46,24 @@ public:
     static void GetComponents26(Image3<int>& image,
         std::vector<std::vector<size_t>>& components);
 
+    // Multithreaded versions of GetComponents6, GetComponents18 and
+    // GetComponents26.  The labeling uses a block-parallel union-find
+    // algorithm.  The slices of the image are partitioned into numThreads
+    // slabs that are labeled concurrently, the equivalences across the slab
+    // boundaries are merged and then the labels are resolved in a single
+    // linear pass.  The union-find parent links are stored in the image
+    // itself, so no additional per-voxel memory is required; the number of
+    // voxels must be smaller than std::numeric_limits<int>::max().  The
+    // output is identical to that of the single-threaded functions.
+    static void GetComponents6(Image3<int>& image, unsigned int numThreads,
+        std::vector<std::vector<size_t>>& components);
+
+    static void GetComponents18(Image3<int>& image, unsigned int numThreads,
+        std::vector<std::vector<size_t>>& components);
+
+    static void GetComponents26(Image3<int>& image, unsigned int numThreads,
+        std::vector<std::vector<size_t>>& components);
+
     // Dilate the image using a structuring element that contains the
     // 6-connected neighbors.
     static void Dilate6(Image3<int> const& inImage, Image3<int>& outImage);
@@ -58,6 +76,83 @@ public:
     // 26-connected neighbors.
     static void Dilate26(Image3<int> const& inImage, Image3<int>& outImage);
 
+    // Morphological operations with a box structuring element of
+    // (2*xRadius+1)x(2*yRadius+1)x(2*zRadius+1) voxels centered at each
+    // voxel.  The box is separable, so the operations are applied in the
+    // x-, y- and z-directions in turn.  Each 1-dimensional pass uses the
+    // van Herk/Gil-Werman algorithm, which requires 3 comparisons per voxel
+    // regardless of the radius, and the lines of voxels are partitioned
+    // among numThreads threads.  The input image is binary with 0 for
+    // background and 1 for foreground.  The output image must be an object
+    // different from the input image.  Unlike Dilate26, all voxels including
+    // those on the image boundary are processed.  If zeroExterior is true,
+    // the image exterior is assumed to consist of 0-valued voxels;
+    // otherwise, voxels outside the image are ignored by the erosion.  For
+    // nonbinary images, dilation is the maximum filter and erosion is the
+    // minimum filter over the box.
+    static void DilateBox(Image3<int> const& inImage, int xRadius,
+        int yRadius, int zRadius, unsigned int numThreads,
+        Image3<int>& outImage);
+
+    static void ErodeBox(Image3<int> const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        Image3<int>& outImage);
+
+    static void OpenBox(Image3<int> const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        Image3<int>& outImage);
+
+    static void CloseBox(Image3<int> const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        Image3<int>& outImage);
+
+    // The box morphology for bit-packed binary images.  The x-direction
+    // pass processes the rows with word-parallel shifts, which requires
+    // O(log(xRadius)) word operations per 64 pixels.  The y- and z-direction
+    // passes use the van Herk/Gil-Werman algorithm on 64 pixels at a time.
+    // The 2-dimensional images are handled with dimension2 = 1 and
+    // zRadius = 0.
+    static void DilateBox(BinaryImage const& inImage, int xRadius,
+        int yRadius, int zRadius, unsigned int numThreads,
+        BinaryImage& outImage);
+
+    static void ErodeBox(BinaryImage const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        BinaryImage& outImage);
+
+    static void OpenBox(BinaryImage const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        BinaryImage& outImage);
+
+    static void CloseBox(BinaryImage const& inImage, bool zeroExterior,
+        int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+        BinaryImage& outImage);
+
+    // Compute the exact L2-distance transform of the binary image using the
+    // separable lower-envelope algorithm of Felzenszwalb and Huttenlocher.
+    // The distance at a voxel is the distance to the nearest 0-valued voxel.
+    // The transform is computed by passes in the x-, y- and z-directions,
+    // and the lines of each pass are partitioned among numThreads threads.
+    // The function returns the maximum distance and a point at which the
+    // maximum distance is attained.  If the image has no 0-valued voxels,
+    // the distances are std::numeric_limits<float>::max().
+    static void GetExactL2Distance(Image3<int> const& image,
+        unsigned int numThreads, float& maxDistance, int& xMax, int& yMax,
+        int& zMax, Image3<float>& transform);
+
+    // The exact squared L2-distance transform and, for the second function,
+    // the index of the nearest 0-valued voxel (the feature transform).  The
+    // squared distances must be smaller than std::numeric_limits<int>::max().
+    // If the image has no 0-valued voxels, the squared distances are
+    // std::numeric_limits<int>::max() and the nearest indices are
+    // std::numeric_limits<size_t>::max().
+    static void GetExactSqrL2Distance(Image3<int> const& image,
+        unsigned int numThreads, Image3<int>& sqrDistance);
+
+    static void GetExactSqrL2Distance(Image3<int> const& image,
+        unsigned int numThreads, Image3<int>& sqrDistance,
+        Image3<size_t>& nearest);
+
     // Compute coordinate-directional convex set.  For a given coordinate
     // direction (x, y, or z), identify the first and last 1-valued voxels
     // on a segment of voxels in that direction.  All voxels from first to
@@ -85,6 +180,55 @@ private:
     // Connected component labeling using depth-first search.
     static void GetComponents(int numNeighbors, int const* delta,
         Image3<int>& image, std::vector<std::vector<size_t>>& components);
+
+    // Block-parallel union-find connected component labeling.  The
+    // neighbor offsets are those for neighbors preceding the voxel in
+    // raster order.  The sliceDelta offsets are relative to the same slice
+    // and the prevDelta offsets are relative to the previous slice.
+    static void GetComponents(int numSliceNeighbors, int const* sliceDelta,
+        int numPrevNeighbors, int const* prevDelta, unsigned int numThreads,
+        Image3<int>& image, std::vector<std::vector<size_t>>& components);
+
+    // Support for the box morphology.  The lines along each axis are
+    // filtered by the van Herk/Gil-Werman algorithm of
+    // GteImageUtilityDetail.h.
+    static void MinMaxFilter3(Image3<int> const& inImage, int xRadius,
+        int yRadius, int zRadius, bool useMax, int padValue,
+        unsigned int numThreads, Image3<int>& outImage);
+
+    // Support for the box morphology of bit-packed binary images.  The
+    // dilation uses bitwise OR and the erosion uses bitwise AND, which are
+    // the maximum and minimum for single bits.  GetBits returns the 64 bits
+    // starting at the specified bit of a sequence of 'numBits' bits; the
+    // bits outside the sequence are those of padWord.
+    static void MinMaxFilterBits(int numElements, int radius, bool useOr,
+        uint64_t padWord, int numLanes, size_t stride, uint64_t* data,
+        std::vector<uint64_t>& g, std::vector<uint64_t>& h);
+
+    static void SelectBits(bool useOr, int numLanes, uint64_t const* v0,
+        uint64_t const* v1, uint64_t* result);
+
+    static void FilterRowBits(int numBits, int radius, bool useOr,
+        uint64_t padWord, uint64_t* row, std::vector<uint64_t>& buffer);
+
+    static uint64_t GetBits(uint64_t const* words, int numBits, int bit,
+        uint64_t padWord);
+
+    static void MinMaxFilter3(BinaryImage const& inImage, int xRadius,
+        int yRadius, int zRadius, bool useOr, bool padBit,
+        unsigned int numThreads, BinaryImage& outImage);
+
+    // Support for GetExactL2Distance and GetExactSqrL2Distance.
+    // TransformLines applies the 1-dimensional transform to the lines of
+    // 'numElements' values with the specified stride that start at the
+    // indices first[0..numLines-1].
+    static void GetExactSqrL2Distance(Image3<int> const& image,
+        unsigned int numThreads, Image3<int>& sqrDistance,
+        Image3<size_t>* nearest);
+
+    static void TransformLines(int numElements, size_t stride,
+        std::vector<size_t> const& first, unsigned int numThreads,
+        Image3<int>& sqrDistance, Image3<size_t>* nearest);
 };
 
 
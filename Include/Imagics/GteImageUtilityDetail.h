@@ -0,0 +1,218 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// Support shared by ImageUtility2 and ImageUtility3.  This header is
+// included only by their source files and is not part of the public
+// interface.
+
+namespace gte
+{
+
+namespace ImageUtilityDetail
+{
+
+// Union-find on an image of labels, where image[i] is the parent of pixel
+// i.  The root of a set is its smallest index.
+template <typename ImageType>
+inline int FindRoot(ImageType& image, int i)
+{
+    while (image[i] != i)
+    {
+        // Path halving.
+        image[i] = image[image[i]];
+        i = image[i];
+    }
+    return i;
+}
+
+template <typename ImageType>
+inline void Union(ImageType& image, int i0, int i1)
+{
+    int root0 = FindRoot(image, i0);
+    int root1 = FindRoot(image, i1);
+    if (root0 < root1)
+    {
+        image[root1] = root0;
+    }
+    else if (root1 < root0)
+    {
+        image[root0] = root1;
+    }
+}
+
+// Select the maximum (useMax is 'true') or minimum of v0[j] and v1[j] for
+// 0 <= j < numLanes.
+inline void Select(bool useMax, int numLanes, int const* v0,
+    int const* v1, int* result)
+{
+    if (useMax)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            result[j] = std::max(v0[j], v1[j]);
+        }
+    }
+    else
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            result[j] = std::min(v0[j], v1[j]);
+        }
+    }
+}
+
+// The 1-dimensional maximum (or minimum) filter is applied in-place to
+// 'numLanes' independent lines of 'numElements' values.  The value of
+// element i of lane j is data[i*stride+j], so the lanes are processed
+// together in the inner loops.  The out-of-range values are assumed to be
+// padValue.  The arrays g and h are storage for the van Herk/Gil-Werman
+// algorithm.
+inline void MinMaxFilter1(int numElements, int radius, bool useMax,
+    int padValue, int numLanes, size_t stride, int* data,
+    std::vector<int>& g, std::vector<int>& h)
+{
+    // The lines are padded with 'radius' values on each side and the padded
+    // lines are partitioned into blocks of size w = 2*radius+1.  The array g
+    // stores the maximum (minimum) of the values from the beginning of a
+    // block to the current element.  The array h stores the maximum
+    // (minimum) of the values from the current element to the end of its
+    // block.  A window of size w intersects at most two blocks, so its
+    // maximum (minimum) is the maximum (minimum) of one h-value and one
+    // g-value.
+    int const width = 2 * radius + 1;
+    int const numPadded = numElements + 2 * radius;
+    int const numTotal = width * ((numPadded + width - 1) / width);
+    size_t const lanes = static_cast<size_t>(numLanes);
+    g.resize(numTotal * lanes);
+    h.resize(numTotal * lanes);
+    std::vector<int> padLine(lanes, padValue);
+
+    auto line = [numElements, radius, stride, data, &padLine](int k)
+    {
+        int i = k - radius;
+        return (0 <= i && i < numElements ? data + i * stride : padLine.data());
+    };
+
+    for (int k = 0; k < numTotal; ++k)
+    {
+        int* gk = &g[k * lanes];
+        if (k % width == 0)
+        {
+            std::copy(line(k), line(k) + lanes, gk);
+        }
+        else
+        {
+            Select(useMax, numLanes, gk - lanes, line(k), gk);
+        }
+    }
+
+    for (int k = numTotal - 1; k >= 0; --k)
+    {
+        int* hk = &h[k * lanes];
+        if (k % width == width - 1)
+        {
+            std::copy(line(k), line(k) + lanes, hk);
+        }
+        else
+        {
+            Select(useMax, numLanes, hk + lanes, line(k), hk);
+        }
+    }
+
+    for (int i = 0; i < numElements; ++i)
+    {
+        Select(useMax, numLanes, &h[i * lanes], &g[(i + 2 * radius) * lanes],
+            data + i * stride);
+    }
+}
+
+}
+
+// The 1-dimensional squared Euclidean distance transform of Felzenszwalb
+// and Huttenlocher computes d[i] = min_j (i-j)^2 + f[j] and the minimizer
+// j = q[i].  The input values f[j] that are std::numeric_limits<int>::max()
+// are treated as infinite; when all are infinite, d[i] is infinite and q[i]
+// is -1.  The arrays v and z must have at least numElements and
+// numElements+1 elements and are storage for the lower envelope of the
+// parabolas.
+inline void DistanceTransform1(int numElements, int const* f,
+    int* d, int* q, std::vector<int>& v, std::vector<double>& z)
+{
+    // Compute the lower envelope of the parabolas y = (x-j)^2 + f[j] for
+    // the finite f[j].  The parabola v[k] is on the envelope for
+    // z[k] <= x <= z[k+1].
+    int const infinity = std::numeric_limits<int>::max();
+    int k = -1;
+    for (int j = 0; j < numElements; ++j)
+    {
+        if (f[j] == infinity)
+        {
+            continue;
+        }
+
+        if (k < 0)
+        {
+            k = 0;
+            v[0] = j;
+            z[0] = -std::numeric_limits<double>::max();
+            z[1] = std::numeric_limits<double>::max();
+            continue;
+        }
+
+        double s;
+        for (;;)
+        {
+            // Intersection of the parabolas for j and v[k].
+            double vk = static_cast<double>(v[k]);
+            s = ((static_cast<double>(f[j]) + static_cast<double>(j) * j) -
+                (static_cast<double>(f[v[k]]) + vk * vk)) /
+                (2.0 * (static_cast<double>(j) - vk));
+            if (s > z[k])
+            {
+                break;
+            }
+            --k;
+        }
+
+        ++k;
+        v[k] = j;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<double>::max();
+    }
+
+    if (k < 0)
+    {
+        // There are no sites.
+        for (int i = 0; i < numElements; ++i)
+        {
+            d[i] = infinity;
+            q[i] = -1;
+        }
+        return;
+    }
+
+    // Sample the lower envelope.
+    k = 0;
+    for (int i = 0; i < numElements; ++i)
+    {
+        while (z[k + 1] < static_cast<double>(i))
+        {
+            ++k;
+        }
+        long long diff = static_cast<long long>(i - v[k]);
+        d[i] = static_cast<int>(diff * diff + f[v[k]]);
+        q[i] = v[k];
+    }
+}
+
+}
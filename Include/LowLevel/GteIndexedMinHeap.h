@@ -0,0 +1,284 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <cstddef>
+#include <vector>
+
+// An indexed min-heap is a priority queue for keys that are indices in
+// {0..maxKeys-1}.  It supports the same operations as MinHeap, but the keys
+// themselves are used to access the heap elements for Update, so there is
+// no need for the caller to store record pointers.  The heap elements are
+// stored contiguously as (value,key) pairs in a 4-ary tree, which has half
+// the depth of a binary tree and keeps the children of a node in the same
+// cache line.  The only per-key storage is the heap position of the key,
+// which is -1 when the key is not in the heap.  This is the priority queue
+// of choice for grid algorithms such as fast marching, where the keys are
+// pixel indices and the number of keys in the heap at any time is much
+// smaller than the number of pixels.
+//
+// The ValueType represents the weight and it must support comparisons
+// "<" and "<=".
+
+namespace gte
+{
+
+template <typename ValueType>
+class IndexedMinHeap
+{
+public:
+    // Construction.  The keys must be in {0..maxKeys-1}.
+    IndexedMinHeap(size_t maxKeys = 0);
+
+    // Clear the heap so that it supports the specified number of keys.
+    void Reset(size_t maxKeys);
+
+    // Member access.
+    inline size_t GetMaxKeys() const;
+    inline int GetNumElements() const;
+
+    // Test whether the key is currently in the heap.
+    inline bool Contains(size_t key) const;
+
+    // Get the value associated with a key that is currently in the heap.
+    inline ValueType const& GetValue(size_t key) const;
+
+    // Get the root of the min-heap.  The return value is 'true' whenever the
+    // min-heap is not empty.  This function reads the root but does not
+    // remove the element from the min-heap.
+    inline bool GetMinimum(size_t& key, ValueType& value) const;
+
+    // Insert a key that is not in the heap.  The return value is 'false'
+    // when the key is out of range or already in the heap.
+    bool Insert(size_t key, ValueType const& value);
+
+    // Remove the root of the heap and return its key and value.  The root
+    // contains the minimum value of all heap elements.  The return value is
+    // 'true' whenever the min-heap was not empty before the Remove call.
+    bool Remove(size_t& key, ValueType& value);
+
+    // Modify the value of a key that is in the heap.  The return value is
+    // 'false' when the key is not in the heap.
+    bool Update(size_t key, ValueType const& value);
+
+    // Support for debugging.  The function tests whether the data structure
+    // is a valid min-heap.
+    bool IsValid() const;
+
+private:
+    struct Element
+    {
+        ValueType value;
+        size_t key;
+    };
+
+    enum { ARITY = 4 };
+
+    void MoveUp(int index, Element element);
+    void MoveDown(int index, Element element);
+
+    std::vector<Element> mElements;
+    std::vector<int> mPositions;
+};
+
+
+template <typename ValueType>
+IndexedMinHeap<ValueType>::IndexedMinHeap(size_t maxKeys)
+{
+    Reset(maxKeys);
+}
+
+template <typename ValueType>
+void IndexedMinHeap<ValueType>::Reset(size_t maxKeys)
+{
+    mElements.clear();
+    mPositions.assign(maxKeys, -1);
+}
+
+template <typename ValueType> inline
+size_t IndexedMinHeap<ValueType>::GetMaxKeys() const
+{
+    return mPositions.size();
+}
+
+template <typename ValueType> inline
+int IndexedMinHeap<ValueType>::GetNumElements() const
+{
+    return static_cast<int>(mElements.size());
+}
+
+template <typename ValueType> inline
+bool IndexedMinHeap<ValueType>::Contains(size_t key) const
+{
+    return mPositions[key] >= 0;
+}
+
+template <typename ValueType> inline
+ValueType const& IndexedMinHeap<ValueType>::GetValue(size_t key) const
+{
+    return mElements[mPositions[key]].value;
+}
+
+template <typename ValueType> inline
+bool IndexedMinHeap<ValueType>::GetMinimum(size_t& key, ValueType& value) const
+{
+    if (mElements.size() > 0)
+    {
+        key = mElements[0].key;
+        value = mElements[0].value;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+template <typename ValueType>
+bool IndexedMinHeap<ValueType>::Insert(size_t key, ValueType const& value)
+{
+    if (key >= mPositions.size() || mPositions[key] >= 0)
+    {
+        return false;
+    }
+
+    // Append the element as the last leaf of the tree and propagate it
+    // toward the root.
+    int child = static_cast<int>(mElements.size());
+    mElements.push_back(Element());
+    MoveUp(child, Element{ value, key });
+    return true;
+}
+
+template <typename ValueType>
+bool IndexedMinHeap<ValueType>::Remove(size_t& key, ValueType& value)
+{
+    if (mElements.size() == 0)
+    {
+        return false;
+    }
+
+    key = mElements[0].key;
+    value = mElements[0].value;
+    mPositions[key] = -1;
+
+    // Move the last leaf to the root and propagate it toward the leaves.
+    Element last = mElements.back();
+    mElements.pop_back();
+    if (mElements.size() > 0)
+    {
+        MoveDown(0, last);
+    }
+    return true;
+}
+
+template <typename ValueType>
+bool IndexedMinHeap<ValueType>::Update(size_t key, ValueType const& value)
+{
+    if (key >= mPositions.size() || mPositions[key] < 0)
+    {
+        return false;
+    }
+
+    int index = mPositions[key];
+    if (value < mElements[index].value)
+    {
+        MoveUp(index, Element{ value, key });
+    }
+    else
+    {
+        MoveDown(index, Element{ value, key });
+    }
+    return true;
+}
+
+template <typename ValueType>
+bool IndexedMinHeap<ValueType>::IsValid() const
+{
+    int const numElements = static_cast<int>(mElements.size());
+    for (int child = 0; child < numElements; ++child)
+    {
+        if (mPositions[mElements[child].key] != child)
+        {
+            return false;
+        }
+
+        if (child > 0)
+        {
+            int parent = (child - 1) / ARITY;
+            if (mElements[child].value < mElements[parent].value)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename ValueType>
+void IndexedMinHeap<ValueType>::MoveUp(int index, Element element)
+{
+    // The slot at 'index' is a hole.  Move parents into the hole until the
+    // element can be stored there.
+    while (index > 0)
+    {
+        int parent = (index - 1) / ARITY;
+        if (mElements[parent].value <= element.value)
+        {
+            break;
+        }
+
+        mElements[index] = mElements[parent];
+        mPositions[mElements[index].key] = index;
+        index = parent;
+    }
+
+    mElements[index] = element;
+    mPositions[element.key] = index;
+}
+
+template <typename ValueType>
+void IndexedMinHeap<ValueType>::MoveDown(int index, Element element)
+{
+    // The slot at 'index' is a hole.  Move the minimum-valued children into
+    // the hole until the element can be stored there.
+    int const numElements = static_cast<int>(mElements.size());
+    for (;;)
+    {
+        int first = ARITY * index + 1;
+        if (first >= numElements)
+        {
+            break;
+        }
+
+        int minChild = first;
+        int last = (first + ARITY < numElements ? first + ARITY : numElements);
+        for (int child = first + 1; child < last; ++child)
+        {
+            if (mElements[child].value < mElements[minChild].value)
+            {
+                minChild = child;
+            }
+        }
+
+        if (element.value <= mElements[minChild].value)
+        {
+            break;
+        }
+
+        mElements[index] = mElements[minChild];
+        mPositions[mElements[index].key] = index;
+        index = minChild;
+    }
+
+    mElements[index] = element;
+    mPositions[element.key] = index;
+}
+
+}
@@ -0,0 +1,73 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Process the items 0 <= i < numItems in blocks on multiple threads.  The
+// blocks are the ranges [begin,end) of at most blockSize items, where begin
+// is a multiple of blockSize, and each thread takes the next unprocessed
+// block until none remain.  This balances the work when the cost per item
+// varies.  The function is called as function(t, begin, end), where
+// t < numThreads is the index of the calling thread, which can be used to
+// select per-thread storage.  When blockSize is 0, the items are split into
+// numThreads contiguous blocks of nearly equal size.  The number of threads
+// is limited to the number of blocks.  When it is 1, the blocks are
+// processed in order on the calling thread.
+
+namespace gte
+{
+
+template <typename Function>
+void ParallelFor(size_t numItems, size_t blockSize, unsigned int numThreads,
+    Function const& function);
+
+
+template <typename Function>
+void ParallelFor(size_t numItems, size_t blockSize, unsigned int numThreads,
+    Function const& function)
+{
+    if (blockSize == 0)
+    {
+        size_t const numRanges = std::max(static_cast<size_t>(numThreads), static_cast<size_t>(1));
+        blockSize = (numItems + numRanges - 1) / numRanges;
+    }
+    blockSize = std::max(blockSize, static_cast<size_t>(1));
+    size_t const numBlocks = (numItems + blockSize - 1) / blockSize;
+    std::atomic<size_t> nextBlock(0);
+    auto process = [numItems, numBlocks, blockSize, &nextBlock, &function](unsigned int t)
+    {
+        for (size_t b = nextBlock++; b < numBlocks; b = nextBlock++)
+        {
+            function(t, b * blockSize, std::min(numItems, (b + 1) * blockSize));
+        }
+    };
+
+    numThreads = static_cast<unsigned int>(std::min(static_cast<size_t>(numThreads), numBlocks));
+    if (numThreads <= 1)
+    {
+        process(0);
+        return;
+    }
+
+    std::vector<std::thread> threads(numThreads);
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        threads[t] = std::thread(process, t);
+    }
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        threads[t].join();
+    }
+}
+
+}
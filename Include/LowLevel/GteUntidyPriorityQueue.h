@@ -0,0 +1,221 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// An untidy priority queue is a bucketed priority queue for keys that are
+// indices in {0..maxKeys-1}.  The values are quantized into buckets of a
+// fixed width and the buckets are stored in a circular array.  Insert and
+// Update are O(1) and Remove is O(1) amortized, but Remove returns an element
+// whose value is within one bucket width of the minimum value rather than
+// the minimum value itself.  The algorithm is described in
+//   O(N) Implementation of the Fast Marching Algorithm,
+//   Liron Yatziv, Alberto Bartesaghi and Guillermo Sapiro,
+//   Journal of Computational Physics 212 (2006) 393-399
+//
+// The values are expected to be inserted in approximately increasing order,
+// as is the case for front propagation algorithms.  A value smaller than the
+// current bucket is placed in the current bucket.  The values must be no
+// larger than the current bucket value plus numBuckets*bucketWidth; larger
+// values are placed in the last bucket, which is allowed but increases the
+// ordering error.  Update does not move an element between buckets.
+// Instead, a new entry is added to the appropriate bucket and the old entry
+// is discarded when it is encountered by Remove.
+
+namespace gte
+{
+
+template <typename ValueType>
+class UntidyPriorityQueue
+{
+public:
+    // Construction.  The keys must be in {0..maxKeys-1}.
+    UntidyPriorityQueue(size_t maxKeys = 0, ValueType bucketWidth = (ValueType)1,
+        int numBuckets = 1);
+
+    // Clear the queue and set its parameters.
+    void Reset(size_t maxKeys, ValueType bucketWidth, int numBuckets);
+
+    // Member access.
+    inline size_t GetMaxKeys() const;
+    inline ValueType GetBucketWidth() const;
+    inline int GetNumBuckets() const;
+    inline int GetNumElements() const;
+
+    // Test whether the key is currently in the queue.
+    inline bool Contains(size_t key) const;
+
+    // Get the value associated with a key that is currently in the queue.
+    inline ValueType const& GetValue(size_t key) const;
+
+    // Insert a key that is not in the queue.  The return value is 'false'
+    // when the key is out of range or already in the queue.
+    bool Insert(size_t key, ValueType const& value);
+
+    // Remove an element of the first nonempty bucket and return its key and
+    // value.  The return value is 'true' whenever the queue was not empty
+    // before the Remove call.
+    bool Remove(size_t& key, ValueType& value);
+
+    // Modify the value of a key that is in the queue.  The return value is
+    // 'false' when the key is not in the queue.
+    bool Update(size_t key, ValueType const& value);
+
+private:
+    void Push(size_t key, ValueType const& value);
+
+    ValueType mBucketWidth, mInvBucketWidth;
+    int mNumBuckets, mNumElements;
+    long long mCurrent;
+    std::vector<std::vector<std::pair<size_t, ValueType>>> mBuckets;
+    std::vector<ValueType> mValues;
+    std::vector<bool> mContained;
+};
+
+
+template <typename ValueType>
+UntidyPriorityQueue<ValueType>::UntidyPriorityQueue(size_t maxKeys,
+    ValueType bucketWidth, int numBuckets)
+{
+    Reset(maxKeys, bucketWidth, numBuckets);
+}
+
+template <typename ValueType>
+void UntidyPriorityQueue<ValueType>::Reset(size_t maxKeys,
+    ValueType bucketWidth, int numBuckets)
+{
+    mBucketWidth = (bucketWidth > (ValueType)0 ? bucketWidth : (ValueType)1);
+    mInvBucketWidth = (ValueType)1 / mBucketWidth;
+    mNumBuckets = (numBuckets > 0 ? numBuckets : 1);
+    mNumElements = 0;
+    mCurrent = 0;
+    mBuckets.clear();
+    mBuckets.resize(mNumBuckets);
+    mValues.resize(maxKeys);
+    mContained.assign(maxKeys, false);
+}
+
+template <typename ValueType> inline
+size_t UntidyPriorityQueue<ValueType>::GetMaxKeys() const
+{
+    return mContained.size();
+}
+
+template <typename ValueType> inline
+ValueType UntidyPriorityQueue<ValueType>::GetBucketWidth() const
+{
+    return mBucketWidth;
+}
+
+template <typename ValueType> inline
+int UntidyPriorityQueue<ValueType>::GetNumBuckets() const
+{
+    return mNumBuckets;
+}
+
+template <typename ValueType> inline
+int UntidyPriorityQueue<ValueType>::GetNumElements() const
+{
+    return mNumElements;
+}
+
+template <typename ValueType> inline
+bool UntidyPriorityQueue<ValueType>::Contains(size_t key) const
+{
+    return mContained[key];
+}
+
+template <typename ValueType> inline
+ValueType const& UntidyPriorityQueue<ValueType>::GetValue(size_t key) const
+{
+    return mValues[key];
+}
+
+template <typename ValueType>
+bool UntidyPriorityQueue<ValueType>::Insert(size_t key, ValueType const& value)
+{
+    if (key >= mContained.size() || mContained[key])
+    {
+        return false;
+    }
+
+    if (mNumElements == 0)
+    {
+        // Start the circular array at the bucket of the value.
+        mCurrent = static_cast<long long>(std::floor(value * mInvBucketWidth));
+    }
+
+    mContained[key] = true;
+    ++mNumElements;
+    Push(key, value);
+    return true;
+}
+
+template <typename ValueType>
+bool UntidyPriorityQueue<ValueType>::Remove(size_t& key, ValueType& value)
+{
+    while (mNumElements > 0)
+    {
+        auto& bucket = mBuckets[static_cast<size_t>(mCurrent % mNumBuckets)];
+        if (bucket.size() == 0)
+        {
+            ++mCurrent;
+            continue;
+        }
+
+        std::pair<size_t, ValueType> entry = bucket.back();
+        bucket.pop_back();
+        if (mContained[entry.first] && mValues[entry.first] == entry.second)
+        {
+            key = entry.first;
+            value = entry.second;
+            mContained[key] = false;
+            --mNumElements;
+            return true;
+        }
+        // else: The entry is obsolete because of an Update.
+    }
+    return false;
+}
+
+template <typename ValueType>
+bool UntidyPriorityQueue<ValueType>::Update(size_t key, ValueType const& value)
+{
+    if (key >= mContained.size() || !mContained[key])
+    {
+        return false;
+    }
+
+    Push(key, value);
+    return true;
+}
+
+template <typename ValueType>
+void UntidyPriorityQueue<ValueType>::Push(size_t key, ValueType const& value)
+{
+    long long bucket = static_cast<long long>(std::floor(value * mInvBucketWidth));
+    if (bucket < mCurrent)
+    {
+        bucket = mCurrent;
+    }
+    else if (bucket >= mCurrent + mNumBuckets)
+    {
+        bucket = mCurrent + mNumBuckets - 1;
+    }
+
+    mValues[key] = value;
+    mBuckets[static_cast<size_t>(bucket % mNumBuckets)].push_back(
+        std::make_pair(key, value));
+}
+
+}
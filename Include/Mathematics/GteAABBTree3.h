@@ -0,0 +1,522 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteAlignedBox.h>
+#include <Mathematics/GteVector3.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// A bounding volume hierarchy of axis-aligned boxes for a set of primitives
+// that are represented by their bounding boxes.  The tree is built top-down
+// using the surface area heuristic (SAH) evaluated on NUM_BINS bins of the
+// box centers along each axis, as described in
+//   On fast Construction of SAH-based Bounding Volume Hierarchies,
+//   Ingo Wald,
+//   Proceedings of the 2007 IEEE Symposium on Interactive Ray Tracing
+//
+// The nodes are stored in a single array with the root at index 0.  The
+// children of an interior node are consecutive in the array and have larger
+// indices than the node, so a traversal of the array in reverse order visits
+// children before parents; Refit uses this to recompute the boxes when the
+// primitives move but the tree topology is kept.  A leaf node stores the
+// range [first,first+count) of the array returned by GetPrimitives(), whose
+// elements are the indices of the input boxes.
+//
+// For numThreads > 1, Build splits the nodes near the root breadth-first
+// until there are several subtrees per thread and then builds the subtrees
+// on the threads.  The splits do not depend on the number of threads, so
+// the tree is the same as for a single thread except for the order of the
+// nodes in the array.
+
+namespace gte
+{
+
+template <typename Real>
+class AABBTree3
+{
+public:
+    // For Real = float, a node occupies 32 bytes.  An interior node has
+    // count = 0 and its children are at indices index and index+1.  A leaf
+    // node has count > 0 and its primitives are GetPrimitives()[index+j]
+    // for 0 <= j < count.
+    struct Node
+    {
+        std::array<Real, 3> min, max;
+        int32_t index, count;
+
+        inline bool IsLeaf() const;
+    };
+
+    enum { NUM_BINS = 16 };
+
+    // Construction.  The tree is empty until Build is called.
+    AABBTree3();
+
+    // Build the tree.  A leaf has at most maxLeafSize primitives, unless the
+    // box centers of more primitives coincide.
+    void Build(std::vector<AlignedBox3<Real>> const& boxes, int maxLeafSize = 4,
+        unsigned int numThreads = 1);
+
+    // Recompute the node boxes for new primitive boxes.  The number of
+    // boxes must be the same as for Build.  The tree quality degrades when
+    // the primitives move far from their original locations, in which case
+    // the tree should be rebuilt.
+    void Refit(std::vector<AlignedBox3<Real>> const& boxes);
+
+    // Member access.
+    inline std::vector<Node> const& GetNodes() const;
+    inline std::vector<int> const& GetPrimitives() const;
+    inline int GetNumPrimitives() const;
+    inline bool IsEmpty() const;
+
+    // Visit the primitives whose boxes intersect the linear component
+    // P + t*D for t in [tmin,tmax].  Use tmin = -max and tmax = +max for a
+    // line, where max = std::numeric_limits<Real>::max().  The function
+    // visitor(int primitive) is called for each such primitive, where
+    // 'primitive' is the index of its box in the array passed to Build.
+    template <typename Visitor>
+    void VisitLine(Vector3<Real> const& P, Vector3<Real> const& D,
+        Real tmin, Real tmax, Visitor&& visitor) const;
+
+    // Test whether the linear component P + t*D for t in [tmin,tmax]
+    // intersects the box of a node.
+    static bool Intersects(Node const& node, Vector3<Real> const& P,
+        Vector3<Real> const& D, Real tmin, Real tmax);
+
+private:
+    // Split a node by the SAH and append its children to 'nodes'.  The
+    // return value is 'false' when the node remains a leaf.  Build calls
+    // the function concurrently for nodes with disjoint primitive ranges.
+    bool Split(std::vector<Node>& nodes, int nodeIndex,
+        std::vector<AlignedBox3<Real>> const& boxes,
+        std::vector<std::array<Real, 3>> const& centers, int maxLeafSize);
+
+    // Split the nodes of the subtree rooted at nodes[root] in depth-first
+    // order.
+    void BuildSubtree(std::vector<Node>& nodes, int root,
+        std::vector<AlignedBox3<Real>> const& boxes,
+        std::vector<std::array<Real, 3>> const& centers, int maxLeafSize);
+
+    void SetBox(Node& node, int first, int count,
+        std::vector<AlignedBox3<Real>> const& boxes) const;
+
+    static Real HalfArea(std::array<Real, 3> const& bmin,
+        std::array<Real, 3> const& bmax);
+
+    std::vector<Node> mNodes;
+    std::vector<int> mPrimitives;
+};
+
+
+template <typename Real> inline
+bool AABBTree3<Real>::Node::IsLeaf() const
+{
+    return count > 0;
+}
+
+template <typename Real>
+AABBTree3<Real>::AABBTree3()
+{
+}
+
+template <typename Real>
+void AABBTree3<Real>::Build(std::vector<AlignedBox3<Real>> const& boxes,
+    int maxLeafSize, unsigned int numThreads)
+{
+    mNodes.clear();
+    mPrimitives.clear();
+    int const numPrimitives = static_cast<int>(boxes.size());
+    if (numPrimitives == 0)
+    {
+        return;
+    }
+    maxLeafSize = std::max(maxLeafSize, 1);
+
+    std::vector<std::array<Real, 3>> centers(numPrimitives);
+    mPrimitives.resize(numPrimitives);
+    for (int i = 0; i < numPrimitives; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            centers[i][j] = (Real)0.5 * (boxes[i].min[j] + boxes[i].max[j]);
+        }
+        mPrimitives[i] = i;
+    }
+
+    // A binary tree with at most maxLeafSize primitives per leaf has fewer
+    // than 2*numPrimitives nodes.
+    mNodes.reserve(2 * static_cast<size_t>(numPrimitives));
+    mNodes.push_back(Node());
+    SetBox(mNodes[0], 0, numPrimitives, boxes);
+    mNodes[0].index = 0;
+    mNodes[0].count = numPrimitives;
+
+    if (numThreads <= 1)
+    {
+        BuildSubtree(mNodes, 0, boxes, centers, maxLeafSize);
+        return;
+    }
+
+    // Split breadth-first until there are enough subtrees to balance the
+    // work of the threads.  The nodes that are not split are leaves.
+    size_t const minSubtrees = 4 * static_cast<size_t>(numThreads);
+    std::vector<int> subtrees(1, 0), next;
+    while (subtrees.size() > 0 && subtrees.size() < minSubtrees)
+    {
+        next.clear();
+        for (auto nodeIndex : subtrees)
+        {
+            if (Split(mNodes, nodeIndex, boxes, centers, maxLeafSize))
+            {
+                next.push_back(mNodes[nodeIndex].index);
+                next.push_back(mNodes[nodeIndex].index + 1);
+            }
+        }
+        std::swap(subtrees, next);
+    }
+
+    // Build the subtrees in separate arrays whose root is a copy of the
+    // subtree node.  The primitive ranges of the subtrees are disjoint.
+    size_t const numSubtrees = subtrees.size();
+    std::vector<std::vector<Node>> local(numSubtrees);
+    ParallelFor(numSubtrees, 1, numThreads, [this, &subtrees, &local,
+        &boxes, &centers, maxLeafSize](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            Node const& root = mNodes[subtrees[k]];
+            local[k].reserve(2 * static_cast<size_t>(root.count));
+            local[k].push_back(root);
+            BuildSubtree(local[k], 0, boxes, centers, maxLeafSize);
+        }
+    });
+
+    // Append the subtrees.  Node i > 0 of a local array is stored at
+    // base + i - 1, and its root replaces the subtree node.
+    for (size_t k = 0; k < numSubtrees; ++k)
+    {
+        int const base = static_cast<int>(mNodes.size());
+        for (auto& node : local[k])
+        {
+            if (!node.IsLeaf())
+            {
+                node.index += base - 1;
+            }
+        }
+        mNodes[subtrees[k]] = local[k][0];
+        mNodes.insert(mNodes.end(), local[k].begin() + 1, local[k].end());
+    }
+}
+
+template <typename Real>
+void AABBTree3<Real>::Refit(std::vector<AlignedBox3<Real>> const& boxes)
+{
+    if (static_cast<int>(boxes.size()) != GetNumPrimitives())
+    {
+        LogError("The number of boxes must be that passed to Build.");
+        return;
+    }
+
+    for (auto node = mNodes.rbegin(); node != mNodes.rend(); ++node)
+    {
+        if (node->IsLeaf())
+        {
+            SetBox(*node, node->index, node->count, boxes);
+        }
+        else
+        {
+            Node const& left = mNodes[node->index];
+            Node const& right = mNodes[node->index + 1];
+            for (int j = 0; j < 3; ++j)
+            {
+                node->min[j] = std::min(left.min[j], right.min[j]);
+                node->max[j] = std::max(left.max[j], right.max[j]);
+            }
+        }
+    }
+}
+
+template <typename Real> inline
+std::vector<typename AABBTree3<Real>::Node> const& AABBTree3<Real>::GetNodes() const
+{
+    return mNodes;
+}
+
+template <typename Real> inline
+std::vector<int> const& AABBTree3<Real>::GetPrimitives() const
+{
+    return mPrimitives;
+}
+
+template <typename Real> inline
+int AABBTree3<Real>::GetNumPrimitives() const
+{
+    return static_cast<int>(mPrimitives.size());
+}
+
+template <typename Real> inline
+bool AABBTree3<Real>::IsEmpty() const
+{
+    return mNodes.size() == 0;
+}
+
+template <typename Real>
+template <typename Visitor>
+void AABBTree3<Real>::VisitLine(Vector3<Real> const& P, Vector3<Real> const& D,
+    Real tmin, Real tmax, Visitor&& visitor) const
+{
+    if (mNodes.size() == 0)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (stack.size() > 0)
+    {
+        Node const& node = mNodes[stack.back()];
+        stack.pop_back();
+        if (!Intersects(node, P, D, tmin, tmax))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            for (int i = node.index; i < node.index + node.count; ++i)
+            {
+                visitor(mPrimitives[i]);
+            }
+        }
+        else
+        {
+            stack.push_back(node.index + 1);
+            stack.push_back(node.index);
+        }
+    }
+}
+
+template <typename Real>
+bool AABBTree3<Real>::Intersects(Node const& node, Vector3<Real> const& P,
+    Vector3<Real> const& D, Real tmin, Real tmax)
+{
+    // Clip the parameter interval against the slabs of the box.
+    for (int j = 0; j < 3; ++j)
+    {
+        if (D[j] != (Real)0)
+        {
+            Real invD = (Real)1 / D[j];
+            Real t0 = (node.min[j] - P[j]) * invD;
+            Real t1 = (node.max[j] - P[j]) * invD;
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+            tmin = std::max(tmin, t0);
+            tmax = std::min(tmax, t1);
+            if (tmin > tmax)
+            {
+                return false;
+            }
+        }
+        else if (P[j] < node.min[j] || P[j] > node.max[j])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Real>
+bool AABBTree3<Real>::Split(std::vector<Node>& nodes, int nodeIndex,
+    std::vector<AlignedBox3<Real>> const& boxes,
+    std::vector<std::array<Real, 3>> const& centers, int maxLeafSize)
+{
+    int const first = nodes[nodeIndex].index;
+    int const count = nodes[nodeIndex].count;
+    if (count <= maxLeafSize)
+    {
+        return false;
+    }
+
+    Real const maxReal = std::numeric_limits<Real>::max();
+
+    // Compute the bounding box of the centers.
+    std::array<Real, 3> cmin = { maxReal, maxReal, maxReal };
+    std::array<Real, 3> cmax = { -maxReal, -maxReal, -maxReal };
+    for (int i = first; i < first + count; ++i)
+    {
+        auto const& center = centers[mPrimitives[i]];
+        for (int j = 0; j < 3; ++j)
+        {
+            cmin[j] = std::min(cmin[j], center[j]);
+            cmax[j] = std::max(cmax[j], center[j]);
+        }
+    }
+
+    // Evaluate the SAH for the NUM_BINS-1 split planes of each axis.
+    // The cost of a split is A(L)*N(L) + A(R)*N(R).
+    int bestAxis = -1, bestSplit = 0;
+    Real bestCost = maxReal;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        Real extent = cmax[axis] - cmin[axis];
+        if (extent <= (Real)0)
+        {
+            continue;
+        }
+        Real scale = (Real)NUM_BINS / extent;
+
+        std::array<int, NUM_BINS> binCounts;
+        std::array<std::array<Real, 3>, NUM_BINS> binMin, binMax;
+        binCounts.fill(0);
+        binMin.fill({ maxReal, maxReal, maxReal });
+        binMax.fill({ -maxReal, -maxReal, -maxReal });
+        for (int i = first; i < first + count; ++i)
+        {
+            int p = mPrimitives[i];
+            int bin = std::min(static_cast<int>((centers[p][axis] - cmin[axis]) * scale),
+                static_cast<int>(NUM_BINS) - 1);
+            ++binCounts[bin];
+            for (int j = 0; j < 3; ++j)
+            {
+                binMin[bin][j] = std::min(binMin[bin][j], boxes[p].min[j]);
+                binMax[bin][j] = std::max(binMax[bin][j], boxes[p].max[j]);
+            }
+        }
+
+        // rightCost[s] is the cost of the bins s+1 and above.
+        std::array<Real, NUM_BINS> rightCost;
+        std::array<Real, 3> rmin = { maxReal, maxReal, maxReal };
+        std::array<Real, 3> rmax = { -maxReal, -maxReal, -maxReal };
+        int rightCount = 0;
+        for (int s = NUM_BINS - 1; s > 0; --s)
+        {
+            rightCount += binCounts[s];
+            for (int j = 0; j < 3; ++j)
+            {
+                rmin[j] = std::min(rmin[j], binMin[s][j]);
+                rmax[j] = std::max(rmax[j], binMax[s][j]);
+            }
+            rightCost[s - 1] = (rightCount > 0 ? HalfArea(rmin, rmax) * rightCount : (Real)0);
+        }
+
+        std::array<Real, 3> lmin = { maxReal, maxReal, maxReal };
+        std::array<Real, 3> lmax = { -maxReal, -maxReal, -maxReal };
+        int leftCount = 0;
+        for (int s = 0; s < NUM_BINS - 1; ++s)
+        {
+            leftCount += binCounts[s];
+            for (int j = 0; j < 3; ++j)
+            {
+                lmin[j] = std::min(lmin[j], binMin[s][j]);
+                lmax[j] = std::max(lmax[j], binMax[s][j]);
+            }
+            if (leftCount > 0 && leftCount < count)
+            {
+                Real cost = HalfArea(lmin, lmax) * leftCount + rightCost[s];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = s;
+                }
+            }
+        }
+    }
+
+    int middle;
+    if (bestAxis >= 0)
+    {
+        Real scale = (Real)NUM_BINS / (cmax[bestAxis] - cmin[bestAxis]);
+        Real origin = cmin[bestAxis];
+        auto begin = mPrimitives.begin() + first, end = begin + count;
+        auto split = std::partition(begin, end, [&](int p)
+        {
+            int bin = std::min(static_cast<int>((centers[p][bestAxis] - origin) * scale),
+                static_cast<int>(NUM_BINS) - 1);
+            return bin <= bestSplit;
+        });
+        middle = static_cast<int>(split - mPrimitives.begin());
+    }
+    else
+    {
+        // All centers coincide.  The node remains a leaf.
+        return false;
+    }
+
+    int const left = static_cast<int>(nodes.size());
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    Node& leftNode = nodes[left];
+    Node& rightNode = nodes[left + 1];
+    leftNode.index = first;
+    leftNode.count = middle - first;
+    rightNode.index = middle;
+    rightNode.count = first + count - middle;
+    SetBox(leftNode, leftNode.index, leftNode.count, boxes);
+    SetBox(rightNode, rightNode.index, rightNode.count, boxes);
+    nodes[nodeIndex].index = left;
+    nodes[nodeIndex].count = 0;
+    return true;
+}
+
+template <typename Real>
+void AABBTree3<Real>::BuildSubtree(std::vector<Node>& nodes, int root,
+    std::vector<AlignedBox3<Real>> const& boxes,
+    std::vector<std::array<Real, 3>> const& centers, int maxLeafSize)
+{
+    // Split the nodes in depth-first order using an explicit stack.
+    std::vector<int> stack;
+    stack.push_back(root);
+    while (stack.size() > 0)
+    {
+        int nodeIndex = stack.back();
+        stack.pop_back();
+        if (Split(nodes, nodeIndex, boxes, centers, maxLeafSize))
+        {
+            stack.push_back(nodes[nodeIndex].index + 1);
+            stack.push_back(nodes[nodeIndex].index);
+        }
+    }
+}
+
+template <typename Real>
+void AABBTree3<Real>::SetBox(Node& node, int first, int count,
+    std::vector<AlignedBox3<Real>> const& boxes) const
+{
+    Real const maxReal = std::numeric_limits<Real>::max();
+    node.min = { maxReal, maxReal, maxReal };
+    node.max = { -maxReal, -maxReal, -maxReal };
+    for (int i = first; i < first + count; ++i)
+    {
+        auto const& box = boxes[mPrimitives[i]];
+        for (int j = 0; j < 3; ++j)
+        {
+            node.min[j] = std::min(node.min[j], box.min[j]);
+            node.max[j] = std::max(node.max[j], box.max[j]);
+        }
+    }
+}
+
+template <typename Real>
+Real AABBTree3<Real>::HalfArea(std::array<Real, 3> const& bmin,
+    std::array<Real, 3> const& bmax)
+{
+    Real dx = bmax[0] - bmin[0], dy = bmax[1] - bmin[1], dz = bmax[2] - bmin[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+}
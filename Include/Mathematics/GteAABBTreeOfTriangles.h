@@ -0,0 +1,725 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteAABBTree3.h>
+#include <Mathematics/GteDistPointTriangle.h>
+#include <Mathematics/GteDistTriangle3Triangle3.h>
+#include <Mathematics/GteIntrRay3Triangle3.h>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A bounding volume hierarchy for a static triangle mesh, built on
+// AABBTree3, with closest-point, signed-distance, ray and mesh-mesh distance
+// queries.  The triangle tests at the leaves are the existing queries
+// DCPQuery<Real,Vector3<Real>,Triangle3<Real>>,
+// DCPQuery<Real,Triangle3<Real>,Triangle3<Real>> and
+// FIQuery<Real,Ray3<Real>,Triangle3<Real>>.  The traversals visit the
+// nearer child first and skip the nodes that are farther than the current
+// best result.
+//
+// The signed distance is negative inside the mesh.  Its sign is that of
+// Dot(P-C,N), where C is the closest point to P and N is the angle-weighted
+// pseudonormal of the mesh feature (vertex, edge or face) that contains C,
+//   Signed Distance Computation Using the Angle Weighted Pseudonormal,
+//   J. Andreas Baerentzen and Henrik Aanaes,
+//   IEEE Transactions on Visualization and Computer Graphics,
+//   vol. 11, no. 3, 2005
+// The sign is correct for a closed manifold mesh whose triangles are
+// counterclockwise ordered when viewed from outside.
+//
+// The batch queries process the inputs on numThreads threads.  The inputs
+// are distributed dynamically in blocks of BLOCK_SIZE, because the costs of
+// the queries vary with the location of the inputs.
+
+namespace gte
+{
+
+template <typename Real>
+class AABBTreeForTriangles
+{
+public:
+    enum { BLOCK_SIZE = 256 };
+
+    struct ClosestResult
+    {
+        // The triangle is -1 when no triangle is closer than the maximum
+        // distance passed to the query.  The parameters are the barycentric
+        // coordinates of the closest point for the triangle vertices.
+        Real distance, sqrDistance;
+        int triangle;
+        Real parameter[3];
+        Vector3<Real> closest;
+    };
+
+    struct RayResult
+    {
+        // The triangle is -1 when the ray does not intersect the mesh.
+        bool intersect;
+        int triangle;
+        Real parameter;
+        Real triangleBary[3];
+        Vector3<Real> point;
+    };
+
+    struct MeshResult
+    {
+        // The triangles of this mesh and the other mesh and their closest
+        // points.
+        Real distance, sqrDistance;
+        int triangle[2];
+        Vector3<Real> closest[2];
+    };
+
+    // Construction.  The tree is empty until Build is called.
+    AABBTreeForTriangles();
+
+    // Build the tree and the pseudonormals for a mesh with 3 indices per
+    // triangle.  The mesh is copied.  The function fails when the number
+    // of indices is not a multiple of 3 or an index is out of range.
+    bool Build(std::vector<Vector3<Real>> const& vertices,
+        std::vector<int> const& indices, int maxLeafSize = 4,
+        unsigned int numThreads = 1);
+
+    // Member access.
+    inline AABBTree3<Real> const& GetTree() const;
+    inline std::vector<Vector3<Real>> const& GetVertices() const;
+    inline std::vector<int> const& GetIndices() const;
+    inline int GetNumTriangles() const;
+    inline Triangle3<Real> GetTriangle(int triangle) const;
+
+    // The closest point of the mesh to 'point' within maxDistance.
+    ClosestResult GetClosest(Vector3<Real> const& point,
+        Real maxDistance = std::numeric_limits<Real>::max()) const;
+
+    // The signed distance from 'point' to the mesh.  The closest point is
+    // returned when the pointer is not null.  The function returns 0 for an
+    // empty mesh.
+    Real GetSignedDistance(Vector3<Real> const& point,
+        ClosestResult* closest = nullptr) const;
+
+    // The first intersection of the ray with the mesh for ray parameters
+    // in [0,tmax].  The ray direction need not be unit length.
+    RayResult GetFirstHit(Ray3<Real> const& ray,
+        Real tmax = std::numeric_limits<Real>::max()) const;
+
+    // The minimum distance between the meshes of two trees, 0 when the
+    // meshes intersect.
+    MeshResult GetMinDistance(AABBTreeForTriangles const& other) const;
+
+    // Batch queries.  The outputs are resized to the number of inputs.
+    void GetClosest(std::vector<Vector3<Real>> const& points,
+        std::vector<ClosestResult>& results, unsigned int numThreads = 1,
+        Real maxDistance = std::numeric_limits<Real>::max()) const;
+
+    void GetSignedDistance(std::vector<Vector3<Real>> const& points,
+        std::vector<Real>& distances, unsigned int numThreads = 1) const;
+
+    void GetFirstHit(std::vector<Ray3<Real>> const& rays,
+        std::vector<RayResult>& results, unsigned int numThreads = 1,
+        Real tmax = std::numeric_limits<Real>::max()) const;
+
+private:
+    typedef typename AABBTree3<Real>::Node Node;
+
+    // The traversal stack is passed to the queries so that the batch
+    // queries allocate it once per thread.
+    struct Entry
+    {
+        Real sqrDistance;
+        int node;
+    };
+
+    void GetClosest(Vector3<Real> const& point, Real maxDistance,
+        std::vector<Entry>& stack, ClosestResult& result) const;
+
+    Real GetSignedDistance(Vector3<Real> const& point,
+        std::vector<Entry>& stack, ClosestResult& result) const;
+
+    void GetFirstHit(Ray3<Real> const& ray, Real tmax,
+        std::vector<int>& stack, RayResult& result) const;
+
+    // The pseudonormal of the feature that contains the point with the
+    // specified barycentric coordinates.
+    Vector3<Real> GetPseudonormal(int triangle, Real const parameter[3]) const;
+
+    static Real SqrDistance(Node const& node, Vector3<Real> const& point);
+    static Real SqrDistance(Node const& node0, Node const& node1);
+    static Real HalfArea(Node const& node);
+
+    std::vector<Vector3<Real>> mVertices;
+    std::vector<int> mIndices;
+    AABBTree3<Real> mTree;
+
+    // The face normals are unit length.  The edge pseudonormal of edge j
+    // of triangle t, with vertices j and (j+1)%3, is mEdgeNormals[3*t+j].
+    // The edge and vertex pseudonormals are not normalized, because only
+    // the signs of their dot products are used.
+    std::vector<Vector3<Real>> mFaceNormals;
+    std::vector<Vector3<Real>> mEdgeNormals;
+    std::vector<Vector3<Real>> mVertexNormals;
+};
+
+
+template <typename Real>
+AABBTreeForTriangles<Real>::AABBTreeForTriangles()
+{
+}
+
+template <typename Real>
+bool AABBTreeForTriangles<Real>::Build(std::vector<Vector3<Real>> const& vertices,
+    std::vector<int> const& indices, int maxLeafSize, unsigned int numThreads)
+{
+    mVertices.clear();
+    mIndices.clear();
+    mFaceNormals.clear();
+    mEdgeNormals.clear();
+    mVertexNormals.clear();
+    mTree.Build(std::vector<AlignedBox3<Real>>());
+
+    int const numVertices = static_cast<int>(vertices.size());
+    if (indices.size() % 3 != 0)
+    {
+        LogError("The number of indices must be a multiple of 3.");
+        return false;
+    }
+    for (auto index : indices)
+    {
+        if (index < 0 || index >= numVertices)
+        {
+            LogError("Invalid index.");
+            return false;
+        }
+    }
+
+    mVertices = vertices;
+    mIndices = indices;
+    int const numTriangles = static_cast<int>(indices.size() / 3);
+
+    // The face normals, the angle-weighted vertex pseudonormals and the
+    // bounding boxes of the triangles.
+    std::vector<AlignedBox3<Real>> boxes(numTriangles);
+    mFaceNormals.resize(numTriangles);
+    mVertexNormals.resize(numVertices);
+    std::fill(mVertexNormals.begin(), mVertexNormals.end(), Vector3<Real>::Zero());
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        int const* v = &mIndices[3 * t];
+        Vector3<Real> const& V0 = mVertices[v[0]];
+        Vector3<Real> const& V1 = mVertices[v[1]];
+        Vector3<Real> const& V2 = mVertices[v[2]];
+        Vector3<Real> normal = Cross(V1 - V0, V2 - V0);
+        Normalize(normal);
+        mFaceNormals[t] = normal;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            Vector3<Real> E0 = mVertices[v[(i + 1) % 3]] - mVertices[v[i]];
+            Vector3<Real> E1 = mVertices[v[(i + 2) % 3]] - mVertices[v[i]];
+            if (Normalize(E0) > (Real)0 && Normalize(E1) > (Real)0)
+            {
+                Real cs = std::min(std::max(Dot(E0, E1), (Real)-1), (Real)1);
+                mVertexNormals[v[i]] += std::acos(cs) * normal;
+            }
+        }
+
+        for (int j = 0; j < 3; ++j)
+        {
+            boxes[t].min[j] = std::min(std::min(V0[j], V1[j]), V2[j]);
+            boxes[t].max[j] = std::max(std::max(V0[j], V1[j]), V2[j]);
+        }
+    }
+
+    // The edge pseudonormals are the sums of the normals of the triangles
+    // that share the edges.
+    std::unordered_map<uint64_t, Vector3<Real>> edgeNormals;
+    edgeNormals.reserve(3 * static_cast<size_t>(numTriangles) / 2);
+    auto edgeKey = [this](int t, int j)
+    {
+        uint64_t v0 = static_cast<uint32_t>(mIndices[3 * t + j]);
+        uint64_t v1 = static_cast<uint32_t>(mIndices[3 * t + (j + 1) % 3]);
+        return (v0 < v1 ? (v0 << 32) | v1 : (v1 << 32) | v0);
+    };
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            auto inserted = edgeNormals.insert(std::make_pair(edgeKey(t, j), mFaceNormals[t]));
+            if (!inserted.second)
+            {
+                inserted.first->second += mFaceNormals[t];
+            }
+        }
+    }
+    mEdgeNormals.resize(3 * static_cast<size_t>(numTriangles));
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            mEdgeNormals[3 * t + j] = edgeNormals[edgeKey(t, j)];
+        }
+    }
+
+    mTree.Build(boxes, maxLeafSize, numThreads);
+    return true;
+}
+
+template <typename Real> inline
+AABBTree3<Real> const& AABBTreeForTriangles<Real>::GetTree() const
+{
+    return mTree;
+}
+
+template <typename Real> inline
+std::vector<Vector3<Real>> const& AABBTreeForTriangles<Real>::GetVertices() const
+{
+    return mVertices;
+}
+
+template <typename Real> inline
+std::vector<int> const& AABBTreeForTriangles<Real>::GetIndices() const
+{
+    return mIndices;
+}
+
+template <typename Real> inline
+int AABBTreeForTriangles<Real>::GetNumTriangles() const
+{
+    return static_cast<int>(mIndices.size() / 3);
+}
+
+template <typename Real> inline
+Triangle3<Real> AABBTreeForTriangles<Real>::GetTriangle(int triangle) const
+{
+    int const* v = &mIndices[3 * triangle];
+    return Triangle3<Real>(mVertices[v[0]], mVertices[v[1]], mVertices[v[2]]);
+}
+
+template <typename Real>
+typename AABBTreeForTriangles<Real>::ClosestResult
+AABBTreeForTriangles<Real>::GetClosest(Vector3<Real> const& point,
+    Real maxDistance) const
+{
+    std::vector<Entry> stack;
+    ClosestResult result;
+    GetClosest(point, maxDistance, stack, result);
+    return result;
+}
+
+template <typename Real>
+Real AABBTreeForTriangles<Real>::GetSignedDistance(Vector3<Real> const& point,
+    ClosestResult* closest) const
+{
+    std::vector<Entry> stack;
+    ClosestResult result;
+    Real distance = GetSignedDistance(point, stack, result);
+    if (closest)
+    {
+        *closest = result;
+    }
+    return distance;
+}
+
+template <typename Real>
+typename AABBTreeForTriangles<Real>::RayResult
+AABBTreeForTriangles<Real>::GetFirstHit(Ray3<Real> const& ray, Real tmax) const
+{
+    std::vector<int> stack;
+    RayResult result;
+    GetFirstHit(ray, tmax, stack, result);
+    return result;
+}
+
+template <typename Real>
+typename AABBTreeForTriangles<Real>::MeshResult
+AABBTreeForTriangles<Real>::GetMinDistance(AABBTreeForTriangles const& other) const
+{
+    MeshResult result;
+    result.sqrDistance = std::numeric_limits<Real>::max();
+    result.distance = result.sqrDistance;
+    result.triangle[0] = -1;
+    result.triangle[1] = -1;
+    if (mTree.IsEmpty() || other.mTree.IsEmpty())
+    {
+        return result;
+    }
+
+    auto const& nodes0 = mTree.GetNodes();
+    auto const& nodes1 = other.mTree.GetNodes();
+    auto const& primitives0 = mTree.GetPrimitives();
+    auto const& primitives1 = other.mTree.GetPrimitives();
+    DCPQuery<Real, Triangle3<Real>, Triangle3<Real>> query;
+
+    // Traverse the pairs of nodes.  The node with the larger box is
+    // descended, and the nearer pair of children is visited first.
+    struct Pair
+    {
+        Real sqrDistance;
+        int node0, node1;
+    };
+    std::vector<Pair> stack;
+    stack.push_back({ SqrDistance(nodes0[0], nodes1[0]), 0, 0 });
+    while (stack.size() > 0 && result.sqrDistance > (Real)0)
+    {
+        Pair pair = stack.back();
+        stack.pop_back();
+        if (pair.sqrDistance >= result.sqrDistance)
+        {
+            continue;
+        }
+
+        Node const& node0 = nodes0[pair.node0];
+        Node const& node1 = nodes1[pair.node1];
+        if (node0.IsLeaf() && node1.IsLeaf())
+        {
+            for (int i0 = node0.index; i0 < node0.index + node0.count; ++i0)
+            {
+                int t0 = primitives0[i0];
+                Triangle3<Real> triangle0 = GetTriangle(t0);
+                for (int i1 = node1.index; i1 < node1.index + node1.count; ++i1)
+                {
+                    int t1 = primitives1[i1];
+                    auto tri = query(triangle0, other.GetTriangle(t1));
+                    if (tri.sqrDistance < result.sqrDistance)
+                    {
+                        result.sqrDistance = tri.sqrDistance;
+                        result.triangle[0] = t0;
+                        result.triangle[1] = t1;
+                        result.closest[0] = tri.closestPoint[0];
+                        result.closest[1] = tri.closestPoint[1];
+                    }
+                }
+            }
+            continue;
+        }
+
+        Pair children[2];
+        if (node1.IsLeaf() || (!node0.IsLeaf() && HalfArea(node0) >= HalfArea(node1)))
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                children[j].node0 = node0.index + j;
+                children[j].node1 = pair.node1;
+            }
+        }
+        else
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                children[j].node0 = pair.node0;
+                children[j].node1 = node1.index + j;
+            }
+        }
+        for (int j = 0; j < 2; ++j)
+        {
+            children[j].sqrDistance = SqrDistance(nodes0[children[j].node0],
+                nodes1[children[j].node1]);
+        }
+        if (children[0].sqrDistance < children[1].sqrDistance)
+        {
+            std::swap(children[0], children[1]);
+        }
+        for (int j = 0; j < 2; ++j)
+        {
+            if (children[j].sqrDistance < result.sqrDistance)
+            {
+                stack.push_back(children[j]);
+            }
+        }
+    }
+
+    result.distance = std::sqrt(result.sqrDistance);
+    return result;
+}
+
+template <typename Real>
+void AABBTreeForTriangles<Real>::GetClosest(
+    std::vector<Vector3<Real>> const& points,
+    std::vector<ClosestResult>& results, unsigned int numThreads,
+    Real maxDistance) const
+{
+    results.resize(points.size());
+    std::vector<std::vector<Entry>> stacks(std::max(numThreads, 1u));
+    ParallelFor(points.size(), BLOCK_SIZE, numThreads,
+        [this, &points, &results, maxDistance, &stacks](unsigned int t, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                GetClosest(points[i], maxDistance, stacks[t], results[i]);
+            }
+        });
+}
+
+template <typename Real>
+void AABBTreeForTriangles<Real>::GetSignedDistance(
+    std::vector<Vector3<Real>> const& points, std::vector<Real>& distances,
+    unsigned int numThreads) const
+{
+    distances.resize(points.size());
+    std::vector<std::vector<Entry>> stacks(std::max(numThreads, 1u));
+    ParallelFor(points.size(), BLOCK_SIZE, numThreads,
+        [this, &points, &distances, &stacks](unsigned int t, size_t begin, size_t end)
+        {
+            ClosestResult result;
+            for (size_t i = begin; i < end; ++i)
+            {
+                distances[i] = GetSignedDistance(points[i], stacks[t], result);
+            }
+        });
+}
+
+template <typename Real>
+void AABBTreeForTriangles<Real>::GetFirstHit(std::vector<Ray3<Real>> const& rays,
+    std::vector<RayResult>& results, unsigned int numThreads, Real tmax) const
+{
+    results.resize(rays.size());
+    std::vector<std::vector<int>> stacks(std::max(numThreads, 1u));
+    ParallelFor(rays.size(), BLOCK_SIZE, numThreads,
+        [this, &rays, &results, tmax, &stacks](unsigned int t, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                GetFirstHit(rays[i], tmax, stacks[t], results[i]);
+            }
+        });
+}
+
+template <typename Real>
+void AABBTreeForTriangles<Real>::GetClosest(Vector3<Real> const& point,
+    Real maxDistance, std::vector<Entry>& stack, ClosestResult& result) const
+{
+    Real const maxReal = std::numeric_limits<Real>::max();
+    result.sqrDistance = (maxDistance < std::sqrt(maxReal) ?
+        maxDistance * maxDistance : maxReal);
+    result.triangle = -1;
+    if (mTree.IsEmpty())
+    {
+        result.distance = maxReal;
+        return;
+    }
+
+    auto const& nodes = mTree.GetNodes();
+    auto const& primitives = mTree.GetPrimitives();
+    DCPQuery<Real, Vector3<Real>, Triangle3<Real>> query;
+
+    stack.clear();
+    stack.push_back({ SqrDistance(nodes[0], point), 0 });
+    while (stack.size() > 0)
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.sqrDistance > result.sqrDistance)
+        {
+            continue;
+        }
+
+        Node const& node = nodes[entry.node];
+        if (node.IsLeaf())
+        {
+            for (int i = node.index; i < node.index + node.count; ++i)
+            {
+                int t = primitives[i];
+                auto tri = query(point, GetTriangle(t));
+                if (tri.sqrDistance <= result.sqrDistance)
+                {
+                    result.sqrDistance = tri.sqrDistance;
+                    result.triangle = t;
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        result.parameter[j] = tri.parameter[j];
+                    }
+                    result.closest = tri.closest;
+                }
+            }
+            continue;
+        }
+
+        Entry children[2];
+        for (int j = 0; j < 2; ++j)
+        {
+            children[j].node = node.index + j;
+            children[j].sqrDistance = SqrDistance(nodes[node.index + j], point);
+        }
+        if (children[0].sqrDistance < children[1].sqrDistance)
+        {
+            std::swap(children[0], children[1]);
+        }
+        for (int j = 0; j < 2; ++j)
+        {
+            if (children[j].sqrDistance <= result.sqrDistance)
+            {
+                stack.push_back(children[j]);
+            }
+        }
+    }
+
+    result.distance = (result.triangle >= 0 ? std::sqrt(result.sqrDistance) : maxReal);
+}
+
+template <typename Real>
+Real AABBTreeForTriangles<Real>::GetSignedDistance(Vector3<Real> const& point,
+    std::vector<Entry>& stack, ClosestResult& result) const
+{
+    GetClosest(point, std::numeric_limits<Real>::max(), stack, result);
+    if (result.triangle < 0)
+    {
+        return (Real)0;
+    }
+
+    Vector3<Real> normal = GetPseudonormal(result.triangle, result.parameter);
+    return (Dot(point - result.closest, normal) < (Real)0 ?
+        -result.distance : result.distance);
+}
+
+template <typename Real>
+void AABBTreeForTriangles<Real>::GetFirstHit(Ray3<Real> const& ray, Real tmax,
+    std::vector<int>& stack, RayResult& result) const
+{
+    result.intersect = false;
+    result.triangle = -1;
+    result.parameter = tmax;
+    if (mTree.IsEmpty())
+    {
+        return;
+    }
+
+    auto const& nodes = mTree.GetNodes();
+    auto const& primitives = mTree.GetPrimitives();
+    FIQuery<Real, Ray3<Real>, Triangle3<Real>> query;
+
+    // The children are pushed so that the child on the side of the ray
+    // origin along the split axis is visited first.
+    stack.clear();
+    stack.push_back(0);
+    while (stack.size() > 0)
+    {
+        Node const& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!AABBTree3<Real>::Intersects(node, ray.origin, ray.direction,
+            (Real)0, result.parameter))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            for (int i = node.index; i < node.index + node.count; ++i)
+            {
+                int t = primitives[i];
+                auto tri = query(ray, GetTriangle(t));
+                if (tri.intersect && tri.parameter <= result.parameter)
+                {
+                    result.intersect = true;
+                    result.triangle = t;
+                    result.parameter = tri.parameter;
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        result.triangleBary[j] = tri.triangleBary[j];
+                    }
+                    result.point = tri.point;
+                }
+            }
+            continue;
+        }
+
+        Node const& child0 = nodes[node.index];
+        Node const& child1 = nodes[node.index + 1];
+        int axis = 0;
+        Real maxGap = (Real)0;
+        for (int j = 0; j < 3; ++j)
+        {
+            Real gap = std::abs((child1.min[j] + child1.max[j]) - (child0.min[j] + child0.max[j]));
+            if (gap > maxGap)
+            {
+                maxGap = gap;
+                axis = j;
+            }
+        }
+        bool firstIsChild0 = ((child1.min[axis] + child1.max[axis] >=
+            child0.min[axis] + child0.max[axis]) == (ray.direction[axis] >= (Real)0));
+        stack.push_back(firstIsChild0 ? node.index + 1 : node.index);
+        stack.push_back(firstIsChild0 ? node.index : node.index + 1);
+    }
+}
+
+template <typename Real>
+Vector3<Real> AABBTreeForTriangles<Real>::GetPseudonormal(int triangle,
+    Real const parameter[3]) const
+{
+    // The closest-point query produces barycentric coordinates that are
+    // exactly 0 on the boundary of the triangle for most inputs; the
+    // tolerance classifies the points numerically near the boundary.  An
+    // edge or vertex pseudonormal is also valid for such points.
+    Real const epsilon = (Real)1e-6;
+    int numZero = 0, zero = 0, maxIndex = 0;
+    for (int j = 0; j < 3; ++j)
+    {
+        if (parameter[j] <= epsilon)
+        {
+            ++numZero;
+            zero = j;
+        }
+        if (parameter[j] > parameter[maxIndex])
+        {
+            maxIndex = j;
+        }
+    }
+
+    if (numZero >= 2)
+    {
+        return mVertexNormals[mIndices[3 * triangle + maxIndex]];
+    }
+    if (numZero == 1)
+    {
+        // The edge opposite vertex 'zero' has vertices (zero+1)%3 and
+        // (zero+2)%3, which is edge (zero+1)%3.
+        return mEdgeNormals[3 * triangle + (zero + 1) % 3];
+    }
+    return mFaceNormals[triangle];
+}
+
+template <typename Real>
+Real AABBTreeForTriangles<Real>::SqrDistance(Node const& node,
+    Vector3<Real> const& point)
+{
+    Real sqrDistance = (Real)0;
+    for (int j = 0; j < 3; ++j)
+    {
+        Real delta = std::max(std::max(node.min[j] - point[j], point[j] - node.max[j]), (Real)0);
+        sqrDistance += delta * delta;
+    }
+    return sqrDistance;
+}
+
+template <typename Real>
+Real AABBTreeForTriangles<Real>::SqrDistance(Node const& node0, Node const& node1)
+{
+    Real sqrDistance = (Real)0;
+    for (int j = 0; j < 3; ++j)
+    {
+        Real delta = std::max(std::max(node0.min[j] - node1.max[j], node1.min[j] - node0.max[j]), (Real)0);
+        sqrDistance += delta * delta;
+    }
+    return sqrDistance;
+}
+
+template <typename Real>
+Real AABBTreeForTriangles<Real>::HalfArea(Node const& node)
+{
+    Real dx = node.max[0] - node.min[0];
+    Real dy = node.max[1] - node.min[1];
+    Real dz = node.max[2] - node.min[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+}
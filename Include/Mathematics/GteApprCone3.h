@@ -9,6 +9,7 @@
 
 #include <Mathematics/GteGaussNewtonMinimizer.h>
 #include <Mathematics/GteLevenbergMarquardtMinimizer.h>
+#include <Mathematics/GteMultiStartMinimizer.h>
 #include <Mathematics/GteRootsPolynomial.h>
 #include <Mathematics/GteMath.h>
 
@@ -97,27 +98,8 @@ namespace gte
             mPoints = points;
             GaussNewtonMinimizer<Real> minimizer(6, mNumPoints, mFFunction, mJFunction);
 
-            Real coneCosAngle;
-            if (useConeInputAsInitialGuess)
-            {
-                Normalize(coneAxis);
-                coneCosAngle = std::cos(coneAngle);
-            }
-            else
-            {
-                ComputeInitialCone(coneVertex, coneAxis, coneCosAngle);
-            }
-
-            // The initial guess for the cone vertex.
             GVector<Real> initial(6);
-            initial[0] = coneVertex[0];
-            initial[1] = coneVertex[1];
-            initial[2] = coneVertex[2];
-
-            // The initial guess for the weighted cone axis.
-            initial[3] = coneAxis[0] / coneCosAngle;
-            initial[4] = coneAxis[1] / coneCosAngle;
-            initial[5] = coneAxis[2] / coneCosAngle;
+            GetInitialGuess(useConeInputAsInitialGuess, coneVertex, coneAxis, coneAngle, initial);
 
             auto result = minimizer(initial, maxIterations, updateLengthTolerance,
                 errorDifferenceTolerance);
@@ -125,18 +107,7 @@ namespace gte
             // No test is made for result.converged so that we return some
             // estimates of the cone.  The caller can decide how to respond
             // when result.converged is false.
-            for (int i = 0; i < 3; ++i)
-            {
-                coneVertex[i] = result.minLocation[i];
-                coneAxis[i] = result.minLocation[i + 3];
-            }
-
-            // We know that coneCosAngle will be nonnegative.  The std::min
-            // call guards against rounding errors leading to a number
-            // slightly larger than 1.  The clamping ensures std::acos will
-            // not return a NaN.
-            coneCosAngle = std::min((Real)1 / Normalize(coneAxis), (Real)1);
-            coneAngle = std::acos(coneCosAngle);
+            GetCone(&result.minLocation[0], coneVertex, coneAxis, coneAngle);
 
             mNumPoints = 0;
             mPoints = nullptr;
@@ -159,6 +130,84 @@ namespace gte
             mPoints = points;
             LevenbergMarquardtMinimizer<Real> minimizer(6, mNumPoints, mFFunction, mJFunction);
 
+            GVector<Real> initial(6);
+            GetInitialGuess(useConeInputAsInitialGuess, coneVertex, coneAxis, coneAngle, initial);
+
+            auto result = minimizer(initial, maxIterations, updateLengthTolerance,
+                errorDifferenceTolerance, lambdaFactor, lambdaAdjust, maxAdjustments);
+
+            // No test is made for result.converged so that we return some
+            // estimates of the cone.  The caller can decide how to respond
+            // when result.converged is false.
+            GetCone(&result.minLocation[0], coneVertex, coneAxis, coneAngle);
+
+            mNumPoints = 0;
+            mPoints = nullptr;
+            return result;
+        }
+
+        // Multistart fitting with the Gauss-Newton minimizer.  Start 0 is
+        // the initial guess of the single-start function and the other
+        // starts are random perturbations of it.  The maxIterations are
+        // split between the probe and the continuation of a start other
+        // than start 0, which runs all of them, so the error is at most that
+        // of the single-start function.  The error is result.minValue.  See
+        // GteMultiStartMinimizer.h for the parameters and the statistics.
+        typename MultiStartMinimizer<Real>::Result
+        operator()(int numPoints, Vector<3, Real> const* points,
+            size_t maxIterations, Real updateLengthTolerance, Real errorDifferenceTolerance,
+            bool useConeInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            Vector<3, Real>& coneVertex, Vector<3, Real>& coneAxis, Real& coneAngle)
+        {
+            auto local = [this, updateLengthTolerance, errorDifferenceTolerance](
+                Real const* start, int iterations, Real* location)
+            {
+                GaussNewtonMinimizer<Real> minimizer(6, mNumPoints, mFFunction, mJFunction);
+                GVector<Real> initial(6);
+                std::copy(start, start + 6, &initial[0]);
+                auto result = minimizer(initial, static_cast<size_t>(iterations),
+                    updateLengthTolerance, errorDifferenceTolerance);
+                std::copy(&result.minLocation[0], &result.minLocation[0] + 6, location);
+                return result.minError;
+            };
+
+            return MultiStart(numPoints, points, maxIterations, useConeInputAsInitialGuess,
+                numStarts, seed, parameters, local, coneVertex, coneAxis, coneAngle);
+        }
+
+        // Multistart fitting with the Levenberg-Marquardt minimizer.  See
+        // the comments for the Gauss-Newton version.
+        typename MultiStartMinimizer<Real>::Result
+        operator()(int numPoints, Vector<3, Real> const* points,
+            size_t maxIterations, Real updateLengthTolerance, Real errorDifferenceTolerance,
+            Real lambdaFactor, Real lambdaAdjust, size_t maxAdjustments,
+            bool useConeInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            Vector<3, Real>& coneVertex, Vector<3, Real>& coneAxis, Real& coneAngle)
+        {
+            auto local = [this, updateLengthTolerance, errorDifferenceTolerance,
+                lambdaFactor, lambdaAdjust, maxAdjustments](
+                Real const* start, int iterations, Real* location)
+            {
+                LevenbergMarquardtMinimizer<Real> minimizer(6, mNumPoints, mFFunction, mJFunction);
+                GVector<Real> initial(6);
+                std::copy(start, start + 6, &initial[0]);
+                auto result = minimizer(initial, static_cast<size_t>(iterations),
+                    updateLengthTolerance, errorDifferenceTolerance, lambdaFactor,
+                    lambdaAdjust, maxAdjustments);
+                std::copy(&result.minLocation[0], &result.minLocation[0] + 6, location);
+                return result.minError;
+            };
+
+            return MultiStart(numPoints, points, maxIterations, useConeInputAsInitialGuess,
+                numStarts, seed, parameters, local, coneVertex, coneAxis, coneAngle);
+        }
+
+    private:
+        void GetInitialGuess(bool useConeInputAsInitialGuess, Vector<3, Real>& coneVertex,
+            Vector<3, Real>& coneAxis, Real coneAngle, GVector<Real>& initial)
+        {
             Real coneCosAngle;
             if (useConeInputAsInitialGuess)
             {
@@ -171,7 +220,6 @@ namespace gte
             }
 
             // The initial guess for the cone vertex.
-            GVector<Real> initial(6);
             initial[0] = coneVertex[0];
             initial[1] = coneVertex[1];
             initial[2] = coneVertex[2];
@@ -180,32 +228,70 @@ namespace gte
             initial[3] = coneAxis[0] / coneCosAngle;
             initial[4] = coneAxis[1] / coneCosAngle;
             initial[5] = coneAxis[2] / coneCosAngle;
+        }
 
-            auto result = minimizer(initial, maxIterations, updateLengthTolerance,
-                errorDifferenceTolerance, lambdaFactor, lambdaAdjust, maxAdjustments);
-
-            // No test is made for result.converged so that we return some
-            // estimates of the cone.  The caller can decide how to respond
-            // when result.converged is false.
+        void GetCone(Real const* location, Vector<3, Real>& coneVertex,
+            Vector<3, Real>& coneAxis, Real& coneAngle)
+        {
             for (int i = 0; i < 3; ++i)
             {
-                coneVertex[i] = result.minLocation[i];
-                coneAxis[i] = result.minLocation[i + 3];
+                coneVertex[i] = location[i];
+                coneAxis[i] = location[i + 3];
             }
 
             // We know that coneCosAngle will be nonnegative.  The std::min
             // call guards against rounding errors leading to a number
             // slightly larger than 1.  The clamping ensures std::acos will
             // not return a NaN.
-            coneCosAngle = std::min((Real)1 / Normalize(coneAxis), (Real)1);
+            Real coneCosAngle = std::min((Real)1 / Normalize(coneAxis), (Real)1);
             coneAngle = std::acos(coneCosAngle);
+        }
+
+        typename MultiStartMinimizer<Real>::Result
+        MultiStart(int numPoints, Vector<3, Real> const* points, size_t maxIterations,
+            bool useConeInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            typename MultiStartMinimizer<Real>::LocalFunction const& local,
+            Vector<3, Real>& coneVertex, Vector<3, Real>& coneAxis, Real& coneAngle)
+        {
+            mNumPoints = numPoints;
+            mPoints = points;
+
+            GVector<Real> initial(6);
+            GetInitialGuess(useConeInputAsInitialGuess, coneVertex, coneAxis, coneAngle, initial);
+
+            // The vertex is perturbed by up to half the average distance
+            // from the points to the vertex and the weighted axis by up to
+            // half its length in each component.
+            Real averageDistance = (Real)0;
+            for (int i = 0; i < mNumPoints; ++i)
+            {
+                averageDistance += Length(mPoints[i] - coneVertex);
+            }
+            averageDistance /= static_cast<Real>(mNumPoints);
+            Real const axisLength = std::sqrt(initial[3] * initial[3] +
+                initial[4] * initial[4] + initial[5] * initial[5]);
+            Real const half = (Real)0.5;
+            Real scale[6] =
+            {
+                half * averageDistance, half * averageDistance, half * averageDistance,
+                half * axisLength, half * axisLength, half * axisLength
+            };
+
+            std::vector<Real> starts;
+            MultiStartMinimizer<Real>::GeneratePerturbedStarts(6, &initial[0], scale,
+                numStarts, seed, starts);
+
+            MultiStartMinimizer<Real> minimizer(parameters);
+            auto result = minimizer(6, numStarts, starts.data(),
+                static_cast<int>(maxIterations), local);
+            GetCone(result.minLocation.data(), coneVertex, coneAxis, coneAngle);
 
             mNumPoints = 0;
             mPoints = nullptr;
             return result;
         }
 
-    private:
         void ComputeInitialCone(Vector<3, Real>& coneVertex, Vector<3, Real>& coneAxis, Real& coneCosAngle)
         {
             // Compute the average of the sample points.
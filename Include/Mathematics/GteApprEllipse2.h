@@ -23,6 +23,7 @@
 #include <Mathematics/GteDistPointHyperellipsoid.h>
 #include <Mathematics/GteMath.h>
 #include <Mathematics/GteMinimizeN.h>
+#include <Mathematics/GteMultiStartMinimizer.h>
 
 namespace gte
 {
@@ -34,7 +35,22 @@ public:
     Real operator()(int numPoints, Vector2<Real> const* points,
         Vector2<Real>& center, Matrix2x2<Real>& rotate, Real diagonal[2]);
 
+    // Multistart fitting.  Start 0 is the initial guess of the previous
+    // function and the other starts are uniformly distributed in its search
+    // domain.  The error is result.minValue.  See GteMultiStartMinimizer.h
+    // for the parameters and the statistics.
+    typename MultiStartMinimizer<Real>::Result operator()(int numPoints,
+        Vector2<Real> const* points, int numStarts, unsigned int seed,
+        typename MultiStartMinimizer<Real>::Parameters const& parameters,
+        Vector2<Real>& center, Matrix2x2<Real>& rotate, Real diagonal[2]);
+
 private:
+    // Compute the search domain [v0,v1] and the initial guess of the
+    // minimizer.
+    static void GetInitialGuess(int numPoints, Vector2<Real> const* points,
+        Real v0[5], Real v1[5], Real vInitial[5]);
+    static void GetEllipse(Real const vMin[5], Vector2<Real>& center,
+        Matrix2x2<Real>& rotate, Real diagonal[2]);
     static Real Energy(int numPoints, Vector2<Real> const* points,
         Real const* input);
 };
@@ -56,8 +72,51 @@ Real ApprEllipse2<Real>::operator()(int numPoints,
 
     MinimizeN<Real> minimizer(5, energy, 8, 8, 32);
 
+    Real v0[5], v1[5], vInitial[5];
+    GetInitialGuess(numPoints, points, v0, v1, vInitial);
+
+    Real vMin[5], error;
+    minimizer.GetMinimum(v0, v1, vInitial, vMin, error);
+    GetEllipse(vMin, center, rotate, diagonal);
+    return error;
+}
+
+template <typename Real>
+typename MultiStartMinimizer<Real>::Result ApprEllipse2<Real>::operator()(
+    int numPoints, Vector2<Real> const* points, int numStarts,
+    unsigned int seed,
+    typename MultiStartMinimizer<Real>::Parameters const& parameters,
+    Vector2<Real>& center, Matrix2x2<Real>& rotate, Real diagonal[2])
+{
+    std::function<Real(Real const*)> energy =
+        [numPoints, points](Real const* input)
+    {
+        return Energy(numPoints, points, input);
+    };
+
+    Real v0[5], v1[5], vInitial[5];
+    GetInitialGuess(numPoints, points, v0, v1, vInitial);
+
+    std::vector<Real> starts;
+    MultiStartMinimizer<Real>::GenerateStarts(5, v0, v1, vInitial, numStarts,
+        seed, starts);
+
+    MultiStartMinimizer<Real> minimizer(parameters);
+    auto result = minimizer(5, energy, 8, 8, 32, v0, v1, numStarts,
+        starts.data());
+    GetEllipse(result.minLocation.data(), center, rotate, diagonal);
+    return result;
+}
+
+template <typename Real>
+void ApprEllipse2<Real>::GetInitialGuess(int numPoints,
+    Vector2<Real> const* points, Real v0[5], Real v1[5], Real vInitial[5])
+{
     // The initial guess for the minimizer is based on an oriented box that
     // contains the points.
+    Vector2<Real> center;
+    Matrix2x2<Real> rotate;
+    Real diagonal[2];
     OrientedBox2<Real> box;
     GetContainer(numPoints, points, box);
     center = box.center;
@@ -75,43 +134,34 @@ Real ApprEllipse2<Real>::operator()(int numPoints,
         diagonal[0] * std::abs(rotate(0, 1)) +
         diagonal[1] * std::abs(rotate(1, 1));
 
-    Real v0[5] =
-    {
-        ((Real)0.5)*diagonal[0],
-        ((Real)0.5)*diagonal[1],
-        center[0] - e0,
-        center[1] - e1,
-        -(Real)GTE_C_PI
-    };
-
-    Real v1[5] =
-    {
-        ((Real)2)*diagonal[0],
-        ((Real)2)*diagonal[1],
-        center[0] + e0,
-        center[1] + e1,
-        (Real)GTE_C_PI
-    };
-
-    Real vInitial[5] =
-    {
-        diagonal[0],
-        diagonal[1],
-        center[0],
-        center[1],
-        angle
-    };
-
-    Real vMin[5], error;
-    minimizer.GetMinimum(v0, v1, vInitial, vMin, error);
+    v0[0] = ((Real)0.5)*diagonal[0];
+    v0[1] = ((Real)0.5)*diagonal[1];
+    v0[2] = center[0] - e0;
+    v0[3] = center[1] - e1;
+    v0[4] = -(Real)GTE_C_PI;
+
+    v1[0] = ((Real)2)*diagonal[0];
+    v1[1] = ((Real)2)*diagonal[1];
+    v1[2] = center[0] + e0;
+    v1[3] = center[1] + e1;
+    v1[4] = (Real)GTE_C_PI;
+
+    vInitial[0] = diagonal[0];
+    vInitial[1] = diagonal[1];
+    vInitial[2] = center[0];
+    vInitial[3] = center[1];
+    vInitial[4] = angle;
+}
 
+template <typename Real>
+void ApprEllipse2<Real>::GetEllipse(Real const vMin[5],
+    Vector2<Real>& center, Matrix2x2<Real>& rotate, Real diagonal[2])
+{
     diagonal[0] = vMin[0];
     diagonal[1] = vMin[1];
     center[0] = vMin[2];
     center[1] = vMin[3];
     MakeRotation(-vMin[4], rotate);
-
-    return error;
 }
 
 template <typename Real>
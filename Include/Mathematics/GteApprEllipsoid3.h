@@ -18,6 +18,11 @@
 //
 // Find the least squares fit of a set of N points P[0] through P[N-1].
 // The error return value is the least-squares energy function at (U,R,D).
+//
+// The minimizer finds a local minimum near an initial guess computed from
+// an oriented box containing the points.  The second operator() runs a
+// multistart search from that guess and from random guesses; see
+// GteMultiStartMinimizer.h.
 
 #include <Mathematics/GteMatrix3x3.h>
 #include <Mathematics/GteRotation.h>
@@ -25,6 +30,7 @@
 #include <Mathematics/GteDistPointHyperellipsoid.h>
 #include <Mathematics/GteMath.h>
 #include <Mathematics/GteMinimizeN.h>
+#include <Mathematics/GteMultiStartMinimizer.h>
 
 namespace gte
 {
@@ -36,7 +42,21 @@ public:
     Real operator()(int numPoints, Vector3<Real> const* points,
         Vector3<Real>& center, Matrix3x3<Real>& rotate, Real diagonal[3]);
 
+    // Multistart fitting.  Start 0 is the initial guess of the previous
+    // function and the other starts are uniformly distributed in its search
+    // domain.  The error is result.minValue.
+    typename MultiStartMinimizer<Real>::Result operator()(int numPoints,
+        Vector3<Real> const* points, int numStarts, unsigned int seed,
+        typename MultiStartMinimizer<Real>::Parameters const& parameters,
+        Vector3<Real>& center, Matrix3x3<Real>& rotate, Real diagonal[3]);
+
 private:
+    // Compute the search domain [v0,v1] and the initial guess of the
+    // minimizer.
+    static void GetInitialGuess(int numPoints, Vector3<Real> const* points,
+        Real v0[9], Real v1[9], Real vInitial[9]);
+    static void GetEllipsoid(Real const vMin[9], Vector3<Real>& center,
+        Matrix3x3<Real>& rotate, Real diagonal[3]);
     static void MatrixToAngles(Matrix3x3<Real> const& rotate, Real angle[3]);
     static void AnglesToMatrix(Real const angle[3], Matrix3x3<Real>& rotate);
     static Real Energy(int numPoints, Vector3<Real> const* points,
@@ -60,8 +80,51 @@ Real ApprEllipsoid3<Real>::operator()(int numPoints,
 
     MinimizeN<Real> minimizer(9, energy, 8, 8, 32);
 
+    Real v0[9], v1[9], vInitial[9];
+    GetInitialGuess(numPoints, points, v0, v1, vInitial);
+
+    Real vMin[9], error;
+    minimizer.GetMinimum(v0, v1, vInitial, vMin, error);
+    GetEllipsoid(vMin, center, rotate, diagonal);
+    return error;
+}
+
+template <typename Real>
+typename MultiStartMinimizer<Real>::Result ApprEllipsoid3<Real>::operator()(
+    int numPoints, Vector3<Real> const* points, int numStarts,
+    unsigned int seed,
+    typename MultiStartMinimizer<Real>::Parameters const& parameters,
+    Vector3<Real>& center, Matrix3x3<Real>& rotate, Real diagonal[3])
+{
+    std::function<Real(Real const*)> energy =
+        [numPoints, points](Real const* input)
+    {
+        return Energy(numPoints, points, input);
+    };
+
+    Real v0[9], v1[9], vInitial[9];
+    GetInitialGuess(numPoints, points, v0, v1, vInitial);
+
+    std::vector<Real> starts;
+    MultiStartMinimizer<Real>::GenerateStarts(9, v0, v1, vInitial, numStarts,
+        seed, starts);
+
+    MultiStartMinimizer<Real> minimizer(parameters);
+    auto result = minimizer(9, energy, 8, 8, 32, v0, v1, numStarts,
+        starts.data());
+    GetEllipsoid(result.minLocation.data(), center, rotate, diagonal);
+    return result;
+}
+
+template <typename Real>
+void ApprEllipsoid3<Real>::GetInitialGuess(int numPoints,
+    Vector3<Real> const* points, Real v0[9], Real v1[9], Real vInitial[9])
+{
     // The initial guess for the minimizer is based on an oriented box that
     // contains the points.
+    Vector3<Real> center;
+    Matrix3x3<Real> rotate;
+    Real diagonal[3];
     OrientedBox3<Real> box;
     GetContainer(numPoints, points, box);
     center = box.center;
@@ -89,48 +152,28 @@ Real ApprEllipsoid3<Real>::operator()(int numPoints,
         diagonal[2] * std::abs(rotate(2, 2))
     };
 
-    Real v0[9] =
-    {
-        ((Real)0.5)*diagonal[0],
-        ((Real)0.5)*diagonal[1],
-        ((Real)0.5)*diagonal[2],
-        center[0] - extent[0],
-        center[1] - extent[1],
-        center[2] - extent[2],
-        -(Real)GTE_C_PI,
-        (Real)0,
-        (Real)0
-    };
-
-    Real v1[9] =
-    {
-        ((Real)2)*diagonal[0],
-        ((Real)2)*diagonal[1],
-        ((Real)2)*diagonal[2],
-        center[0] + extent[0],
-        center[1] + extent[1],
-        center[2] + extent[2],
-        (Real)GTE_C_PI,
-        (Real)GTE_C_PI,
-        (Real)GTE_C_PI
-    };
-
-    Real vInitial[9] =
+    for (int i = 0; i < 3; ++i)
     {
-        diagonal[0],
-        diagonal[1],
-        diagonal[2],
-        center[0],
-        center[1],
-        center[2],
-        angle[0],
-        angle[1],
-        angle[2]
-    };
-
-    Real vMin[9], error;
-    minimizer.GetMinimum(v0, v1, vInitial, vMin, error);
+        v0[i] = ((Real)0.5)*diagonal[i];
+        v0[i + 3] = center[i] - extent[i];
+        v1[i] = ((Real)2)*diagonal[i];
+        v1[i + 3] = center[i] + extent[i];
+        vInitial[i] = diagonal[i];
+        vInitial[i + 3] = center[i];
+        vInitial[i + 6] = angle[i];
+    }
+    v0[6] = -(Real)GTE_C_PI;
+    v0[7] = (Real)0;
+    v0[8] = (Real)0;
+    v1[6] = (Real)GTE_C_PI;
+    v1[7] = (Real)GTE_C_PI;
+    v1[8] = (Real)GTE_C_PI;
+}
 
+template <typename Real>
+void ApprEllipsoid3<Real>::GetEllipsoid(Real const vMin[9],
+    Vector3<Real>& center, Matrix3x3<Real>& rotate, Real diagonal[3])
+{
     diagonal[0] = vMin[0];
     diagonal[1] = vMin[1];
     diagonal[2] = vMin[2];
@@ -138,8 +181,6 @@ Real ApprEllipsoid3<Real>::operator()(int numPoints,
     center[1] = vMin[4];
     center[2] = vMin[5];
     AnglesToMatrix(&vMin[6], rotate);
-
-    return error;
 }
 
 template <typename Real>
@@ -152,6 +193,7 @@ void ApprEllipsoid3<Real>::MatrixToAngles(Matrix3x3<Real> const& rotate,
     Real const zero = (Real)0;
     Real const one = (Real)1;
     AxisAngle<3, Real> aa = Rotation<3, Real>(rotate);
+    angle[2] = aa.angle;
 
     if (-one < aa.axis[2])
     {
@@ -13,6 +13,7 @@
 #include <Mathematics/GteRootsPolynomial.h>
 #include <Mathematics/GteGaussNewtonMinimizer.h>
 #include <Mathematics/GteLevenbergMarquardtMinimizer.h>
+#include <Mathematics/GteMultiStartMinimizer.h>
 
 // Let the torus center be C with plane of symmetry containing C and having
 // directions D0 and D1.  The axis of symmetry is the line containing C and
@@ -249,34 +250,8 @@ namespace gte
             mPoints = points;
             GaussNewtonMinimizer<Real> minimizer(7, mNumPoints, mFFunction, mJFunction);
 
-            if (!useTorusInputAsInitialGuess)
-            {
-                operator()(numPoints, points, C, N, r0, r1);
-            }
-
             GVector<Real> initial(7);
-
-            // The initial guess for the plane origin.
-            initial[0] = C[0];
-            initial[1] = C[1];
-            initial[2] = C[2];
-
-            // The initial guess for the plane normal.  The angles must be
-            // extracted for spherical coordinates.
-            if (std::abs(N[2]) < (Real)1)
-            {
-                initial[3] = std::atan2(N[1], N[0]);
-                initial[4] = std::acos(N[2]);
-            }
-            else
-            {
-                initial[3] = (Real)0;
-                initial[4] = (Real)0;
-            }
-
-            // The initial guess for the radii-related parameters.
-            initial[5] = r0 * r0;
-            initial[6] = initial[5] - r1 * r1;
+            GetInitialGuess(numPoints, points, useTorusInputAsInitialGuess, C, N, r0, r1, initial);
 
             auto result = minimizer(initial, maxIterations, updateLengthTolerance,
                 errorDifferenceTolerance);
@@ -284,24 +259,7 @@ namespace gte
             // No test is made for result.converged so that we return some
             // estimates of the torus.  The caller can decide how to respond
             // when result.converged is false.
-            C[0] = result.minLocation[0];
-            C[1] = result.minLocation[1];
-            C[2] = result.minLocation[2];
-
-            Real theta = result.minLocation[3];
-            Real phi = result.minLocation[4];
-            Real csTheta = std::cos(theta);
-            Real snTheta = std::sin(theta);
-            Real csPhi = std::cos(phi);
-            Real snPhi = std::sin(phi);
-            N[0] = csTheta * snPhi;
-            N[1] = snTheta * snPhi;
-            N[2] = csPhi;
-
-            Real u = result.minLocation[5];
-            Real v = result.minLocation[6];
-            r0 = std::sqrt(u);
-            r1 = std::sqrt(u - v);
+            GetTorus(&result.minLocation[0], C, N, r0, r1);
 
             mNumPoints = 0;
             mPoints = nullptr;
@@ -327,13 +285,91 @@ namespace gte
             mPoints = points;
             LevenbergMarquardtMinimizer<Real> minimizer(7, mNumPoints, mFFunction, mJFunction);
 
+            GVector<Real> initial(7);
+            GetInitialGuess(numPoints, points, useTorusInputAsInitialGuess, C, N, r0, r1, initial);
+
+            auto result = minimizer(initial, maxIterations, updateLengthTolerance,
+                errorDifferenceTolerance, lambdaFactor, lambdaAdjust, maxAdjustments);
+
+            // No test is made for result.converged so that we return some
+            // estimates of the torus.  The caller can decide how to respond
+            // when result.converged is false.
+            GetTorus(&result.minLocation[0], C, N, r0, r1);
+
+            mNumPoints = 0;
+            mPoints = nullptr;
+            return result;
+        }
+
+        // Multistart fitting with the Gauss-Newton minimizer.  Start 0 is
+        // the initial guess of the single-start function and the other
+        // starts are random perturbations of it.  The maxIterations are
+        // split between the probe and the continuation of a start.  The
+        // error is result.minValue.  See GteMultiStartMinimizer.h for the
+        // parameters and the statistics.
+        typename MultiStartMinimizer<Real>::Result
+        operator()(int numPoints, Vector<3, Real> const* points,
+            size_t maxIterations, Real updateLengthTolerance, Real errorDifferenceTolerance,
+            bool useTorusInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            Vector<3, Real>& C, Vector<3, Real>& N, Real& r0, Real& r1)
+        {
+            auto local = [this, updateLengthTolerance, errorDifferenceTolerance](
+                Real const* start, int iterations, Real* location)
+            {
+                GaussNewtonMinimizer<Real> minimizer(7, mNumPoints, mFFunction, mJFunction);
+                GVector<Real> initial(7);
+                std::copy(start, start + 7, &initial[0]);
+                auto result = minimizer(initial, static_cast<size_t>(iterations),
+                    updateLengthTolerance, errorDifferenceTolerance);
+                std::copy(&result.minLocation[0], &result.minLocation[0] + 7, location);
+                return result.minError;
+            };
+
+            return MultiStart(numPoints, points, maxIterations, useTorusInputAsInitialGuess,
+                numStarts, seed, parameters, local, C, N, r0, r1);
+        }
+
+        // Multistart fitting with the Levenberg-Marquardt minimizer.  See
+        // the comments for the Gauss-Newton version.
+        typename MultiStartMinimizer<Real>::Result
+        operator()(int numPoints, Vector<3, Real> const* points,
+            size_t maxIterations, Real updateLengthTolerance, Real errorDifferenceTolerance,
+            Real lambdaFactor, Real lambdaAdjust, size_t maxAdjustments,
+            bool useTorusInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            Vector<3, Real>& C, Vector<3, Real>& N, Real& r0, Real& r1)
+        {
+            auto local = [this, updateLengthTolerance, errorDifferenceTolerance,
+                lambdaFactor, lambdaAdjust, maxAdjustments](
+                Real const* start, int iterations, Real* location)
+            {
+                LevenbergMarquardtMinimizer<Real> minimizer(7, mNumPoints, mFFunction, mJFunction);
+                GVector<Real> initial(7);
+                std::copy(start, start + 7, &initial[0]);
+                auto result = minimizer(initial, static_cast<size_t>(iterations),
+                    updateLengthTolerance, errorDifferenceTolerance, lambdaFactor,
+                    lambdaAdjust, maxAdjustments);
+                std::copy(&result.minLocation[0], &result.minLocation[0] + 7, location);
+                return result.minError;
+            };
+
+            return MultiStart(numPoints, points, maxIterations, useTorusInputAsInitialGuess,
+                numStarts, seed, parameters, local, C, N, r0, r1);
+        }
+
+    private:
+        typedef BSRational<UIntegerAP32> Rational;
+
+        void GetInitialGuess(int numPoints, Vector<3, Real> const* points,
+            bool useTorusInputAsInitialGuess, Vector<3, Real>& C, Vector<3, Real>& N,
+            Real& r0, Real& r1, GVector<Real>& initial)
+        {
             if (!useTorusInputAsInitialGuess)
             {
                 operator()(numPoints, points, C, N, r0, r1);
             }
 
-            GVector<Real> initial(7);
-
             // The initial guess for the plane origin.
             initial[0] = C[0];
             initial[1] = C[1];
@@ -355,19 +391,17 @@ namespace gte
             // The initial guess for the radii-related parameters.
             initial[5] = r0 * r0;
             initial[6] = initial[5] - r1 * r1;
+        }
 
-            auto result = minimizer(initial, maxIterations, updateLengthTolerance,
-                errorDifferenceTolerance, lambdaFactor, lambdaAdjust, maxAdjustments);
-
-            // No test is made for result.converged so that we return some
-            // estimates of the torus.  The caller can decide how to respond
-            // when result.converged is false.
-            C[0] = result.minLocation[0];
-            C[1] = result.minLocation[1];
-            C[2] = result.minLocation[2];
+        void GetTorus(Real const* location, Vector<3, Real>& C, Vector<3, Real>& N,
+            Real& r0, Real& r1)
+        {
+            C[0] = location[0];
+            C[1] = location[1];
+            C[2] = location[2];
 
-            Real theta = result.minLocation[3];
-            Real phi = result.minLocation[4];
+            Real theta = location[3];
+            Real phi = location[4];
             Real csTheta = std::cos(theta);
             Real snTheta = std::sin(theta);
             Real csPhi = std::cos(phi);
@@ -376,19 +410,49 @@ namespace gte
             N[1] = snTheta * snPhi;
             N[2] = csPhi;
 
-            Real u = result.minLocation[5];
-            Real v = result.minLocation[6];
+            Real u = location[5];
+            Real v = location[6];
             r0 = std::sqrt(u);
             r1 = std::sqrt(u - v);
+        }
+
+        typename MultiStartMinimizer<Real>::Result
+        MultiStart(int numPoints, Vector<3, Real> const* points, size_t maxIterations,
+            bool useTorusInputAsInitialGuess, int numStarts, unsigned int seed,
+            typename MultiStartMinimizer<Real>::Parameters const& parameters,
+            typename MultiStartMinimizer<Real>::LocalFunction const& local,
+            Vector<3, Real>& C, Vector<3, Real>& N, Real& r0, Real& r1)
+        {
+            GVector<Real> initial(7);
+            GetInitialGuess(numPoints, points, useTorusInputAsInitialGuess, C, N, r0, r1, initial);
+            mNumPoints = numPoints;
+            mPoints = points;
+
+            // The center is perturbed by up to half the outer radius, the
+            // normal angles over their full ranges and the radii-related
+            // parameters by up to half their values.
+            Real const half = (Real)0.5;
+            Real scale[7] =
+            {
+                half * r0, half * r0, half * r0,
+                (Real)GTE_C_PI, (Real)GTE_C_HALF_PI,
+                half * std::abs(initial[5]), half * std::abs(initial[6])
+            };
+
+            std::vector<Real> starts;
+            MultiStartMinimizer<Real>::GeneratePerturbedStarts(7, &initial[0], scale,
+                numStarts, seed, starts);
+
+            MultiStartMinimizer<Real> minimizer(parameters);
+            auto result = minimizer(7, numStarts, starts.data(),
+                static_cast<int>(maxIterations), local);
+            GetTorus(result.minLocation.data(), C, N, r0, r1);
 
             mNumPoints = 0;
             mPoints = nullptr;
             return result;
         }
 
-    private:
-        typedef BSRational<UIntegerAP32> Rational;
-
         int mNumPoints;
         Vector<3, Real> const* mPoints;
         std::function<void(GVector<Real> const&, GVector<Real>&)> mFFunction;
@@ -8,9 +8,12 @@
 #pragma once
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteAABBTree3.h>
 #include <Mathematics/GteContPointInPolygon2.h>
 #include <Mathematics/GteIntrRay3Plane3.h>
 #include <Mathematics/GteIntrRay3Triangle3.h>
+#include <cstdint>
 #include <vector>
 
 // This class contains various implementations for point-in-polyhedron
@@ -29,6 +32,27 @@
 // Whichever result occurs N+1 or more times is the "winner".  The input
 // rayQuantity is 2*N+1.  The input array Direction must have rayQuantity
 // elements.  If you are feeling lucky, choose rayQuantity to be 1.
+//
+// BuildTree preprocesses the faces into a bounding volume hierarchy
+// (AABBTree3), after which Contains tests only the faces whose boxes are
+// intersected by the rays.  The tree also supports the generalized winding
+// number,
+//   Fast Winding Numbers for Soups and Clouds,
+//   Gavin Barill, Neil G. Dickson, Ryan Schmidt, David I.W. Levin and
+//   Alec Jacobson,
+//   ACM Transactions on Graphics, vol. 37, no. 4, 2018
+// which is 1 inside a closed polyhedron and 0 outside, and which degrades
+// gracefully for meshes with holes or self-intersections.  The solid angles
+// of the faces near the point are computed exactly.  The faces of a node
+// whose distance to the point is more than beta times the node radius are
+// approximated by a dipole at the area-weighted centroid of the faces with
+// the sum of the area vectors as its moment.  The relative error decreases
+// with beta; beta = 0 computes all solid angles exactly.
+//
+// The queries do not modify the object, so they can be called concurrently
+// from several threads.  The batch queries process the points on numThreads
+// threads.  The points are distributed dynamically in blocks of 256, because
+// the cost of a query depends on the location of the point.
 
 namespace gte
 {
@@ -124,6 +148,29 @@ public:
     // constructor you used for this class.
     bool Contains(Vector3<Real> const& p) const;
 
+    // Build the bounding volume hierarchy of the faces.  The points and
+    // faces passed to the constructor must not change afterwards.
+    void BuildTree(int maxLeafSize = 4, unsigned int numThreads = 1);
+    inline AABBTree3<Real> const& GetTree() const;
+
+    // The generalized winding number of the polyhedron at p.  BuildTree
+    // must be called first.
+    Real GetWindingNumber(Vector3<Real> const& p, Real beta = (Real)2) const;
+
+    // The batch queries.  The outputs are resized to the number of points.
+    // The winding-number classification reports a point as inside when its
+    // winding number is larger than 1/2.
+    void Contains(std::vector<Vector3<Real>> const& points,
+        std::vector<uint8_t>& inside, unsigned int numThreads = 1) const;
+
+    void GetWindingNumbers(std::vector<Vector3<Real>> const& points,
+        std::vector<Real>& windingNumbers, Real beta = (Real)2,
+        unsigned int numThreads = 1) const;
+
+    void ContainsByWindingNumber(std::vector<Vector3<Real>> const& points,
+        std::vector<uint8_t>& inside, Real beta = (Real)2,
+        unsigned int numThreads = 1) const;
+
 private:
     // For all types of faces.  The ray origin is the test point.  The ray
     // direction is one of those passed to the constructors.  The plane origin
@@ -132,16 +179,34 @@ private:
     static bool FastNoIntersect(Ray3<Real> const& ray,
         Plane3<Real> const& plane);
 
+    // Test whether the ray intersects face i.  The array projVertices is
+    // temporary storage for those methods that reduce the problem to 2D
+    // point-in-polygon queries.  It stores the projections of face vertices
+    // onto the plane of the face and is resized as needed.
+    bool Intersects(Ray3<Real> const& ray, int i,
+        std::vector<Vector2<Real>>& projVertices) const;
+
     // For triangle faces.
-    bool ContainsT0(Vector3<Real> const& p) const;
+    bool IntersectsT0(Ray3<Real> const& ray, TriangleFace const& face) const;
 
     // For convex faces.
-    bool ContainsC0(Vector3<Real> const& p) const;
-    bool ContainsC1C2(Vector3<Real> const& p, unsigned int method) const;
+    bool IntersectsC0(Ray3<Real> const& ray, ConvexFace const& face) const;
+    bool IntersectsC1C2(Ray3<Real> const& ray, ConvexFace const& face,
+        unsigned int method, std::vector<Vector2<Real>>& projVertices) const;
 
     // For simple faces.
-    bool ContainsS0(Vector3<Real> const& p) const;
-    bool ContainsS1(Vector3<Real> const& p) const;
+    bool IntersectsS0(Ray3<Real> const& ray, SimpleFace const& face) const;
+    bool IntersectsS1(Ray3<Real> const& ray, SimpleFace const& face,
+        std::vector<Vector2<Real>>& projVertices) const;
+
+    // The vertex indices of face i.  The winding number uses the triangle
+    // fan from vertex 0 for all types of faces.  The signed solid angles of
+    // the fan triangles of a planar polygon sum to the solid angle of the
+    // polygon even when the polygon is not convex.
+    inline void GetFace(int i, int const*& indices, int& numIndices) const;
+
+    // The signed solid angle of face i as seen from p.
+    Real GetSolidAngle(Vector3<Real> const& p, int i) const;
 
     int mNumPoints;
     Vector3<Real> const* mPoints;
@@ -155,10 +220,18 @@ private:
     int mNumRays;
     Vector3<Real> const* mDirections;
 
-    // Temporary storage for those methods that reduce the problem to 2D
-    // point-in-polygon queries.  The array stores the projections of
-    // face vertices onto the plane of the face.  It is resized as needed.
-    mutable std::vector<Vector2<Real>> mProjVertices;
+    // The bounding volume hierarchy of the faces and the dipole data of its
+    // nodes:  the area-weighted centroid of the faces, the sum of the area
+    // vectors of the faces and the distance from the centroid to the
+    // farthest corner of the node box.
+    struct Dipole
+    {
+        Vector3<Real> center, areaNormal;
+        Real radius;
+    };
+
+    AABBTree3<Real> mTree;
+    std::vector<Dipole> mDipoles;
 };
 
 
@@ -216,35 +289,274 @@ PointInPolyhedron3<Real>::PointInPolyhedron3(int numPoints,
 template <typename Real>
 bool PointInPolyhedron3<Real>::Contains(Vector3<Real> const& p) const
 {
-    if (mTFaces)
+    int insideCount = 0;
+
+    std::vector<Vector2<Real>> projVertices;
+    Ray3<Real> ray;
+    ray.origin = p;
+
+    for (int j = 0; j < mNumRays; ++j)
     {
-        return ContainsT0(p);
+        ray.direction = mDirections[j];
+
+        // Zero intersections to start with.
+        bool odd = false;
+        auto visitor = [this, &ray, &projVertices, &odd](int i)
+        {
+            if (Intersects(ray, i, projVertices))
+            {
+                // The ray intersects the face.
+                odd = !odd;
+            }
+        };
+
+        if (mTree.IsEmpty())
+        {
+            for (int i = 0; i < mNumFaces; ++i)
+            {
+                visitor(i);
+            }
+        }
+        else
+        {
+            mTree.VisitLine(ray.origin, ray.direction, (Real)0,
+                std::numeric_limits<Real>::max(), visitor);
+        }
+
+        if (odd)
+        {
+            insideCount++;
+        }
     }
 
-    if (mCFaces)
+    return insideCount > mNumRays / 2;
+}
+
+template <typename Real>
+void PointInPolyhedron3<Real>::BuildTree(int maxLeafSize, unsigned int numThreads)
+{
+    // The bounding boxes, area vectors and area-weighted centroids of the
+    // faces.
+    Real const maxReal = std::numeric_limits<Real>::max();
+    std::vector<AlignedBox3<Real>> boxes(mNumFaces);
+    std::vector<Vector3<Real>> areaNormals(mNumFaces), centroids(mNumFaces);
+    std::vector<Real> areas(mNumFaces);
+    for (int i = 0; i < mNumFaces; ++i)
     {
-        if (mMethod == 0)
+        int const* indices;
+        int numIndices;
+        GetFace(i, indices, numIndices);
+
+        AlignedBox3<Real>& box = boxes[i];
+        box.min = { maxReal, maxReal, maxReal };
+        box.max = { -maxReal, -maxReal, -maxReal };
+        for (int k = 0; k < numIndices; ++k)
         {
-            return ContainsC0(p);
+            Vector3<Real> const& V = mPoints[indices[k]];
+            for (int j = 0; j < 3; ++j)
+            {
+                box.min[j] = std::min(box.min[j], V[j]);
+                box.max[j] = std::max(box.max[j], V[j]);
+            }
         }
 
-        return ContainsC1C2(p, mMethod);
+        areaNormals[i] = Vector3<Real>::Zero();
+        centroids[i] = Vector3<Real>::Zero();
+        areas[i] = (Real)0;
+        Vector3<Real> const& V0 = mPoints[indices[0]];
+        for (int k = 1; k + 1 < numIndices; ++k)
+        {
+            Vector3<Real> const& V1 = mPoints[indices[k]];
+            Vector3<Real> const& V2 = mPoints[indices[k + 1]];
+            Vector3<Real> areaNormal = ((Real)0.5) * Cross(V1 - V0, V2 - V0);
+            Real area = Length(areaNormal);
+            areaNormals[i] += areaNormal;
+            centroids[i] += (area / (Real)3) * (V0 + V1 + V2);
+            areas[i] += area;
+        }
+        if (areas[i] > (Real)0)
+        {
+            centroids[i] /= areas[i];
+        }
+        else
+        {
+            centroids[i] = V0;
+        }
     }
 
-    if (mSFaces)
+    mTree.Build(boxes, maxLeafSize, numThreads);
+
+    // Compute the dipoles of the nodes.  The children have larger indices
+    // than their parent, so a reverse traversal of the nodes visits the
+    // children first.
+    auto const& nodes = mTree.GetNodes();
+    auto const& primitives = mTree.GetPrimitives();
+    std::vector<Real> nodeAreas(nodes.size());
+    mDipoles.resize(nodes.size());
+    for (size_t n = nodes.size(); n-- > 0; )
     {
-        if (mMethod == 0)
+        auto const& node = nodes[n];
+        Dipole& dipole = mDipoles[n];
+        dipole.center = Vector3<Real>::Zero();
+        dipole.areaNormal = Vector3<Real>::Zero();
+        Real area = (Real)0;
+        if (node.IsLeaf())
         {
-            return ContainsS0(p);
+            for (int k = node.index; k < node.index + node.count; ++k)
+            {
+                int i = primitives[k];
+                dipole.center += areas[i] * centroids[i];
+                dipole.areaNormal += areaNormals[i];
+                area += areas[i];
+            }
+        }
+        else
+        {
+            for (int c = node.index; c <= node.index + 1; ++c)
+            {
+                dipole.center += nodeAreas[c] * mDipoles[c].center;
+                dipole.areaNormal += mDipoles[c].areaNormal;
+                area += nodeAreas[c];
+            }
         }
+        nodeAreas[n] = area;
 
-        if (mMethod == 1)
+        Vector3<Real> boxCenter, boxExtent;
+        for (int j = 0; j < 3; ++j)
         {
-            return ContainsS1(p);
+            boxCenter[j] = (Real)0.5 * (node.max[j] + node.min[j]);
+            boxExtent[j] = (Real)0.5 * (node.max[j] - node.min[j]);
         }
+        dipole.center = (area > (Real)0 ? dipole.center / area : boxCenter);
+
+        // The farthest corner of the box is in the direction opposite the
+        // offset of the centroid from the box center.
+        Vector3<Real> farthest;
+        for (int j = 0; j < 3; ++j)
+        {
+            farthest[j] = std::abs(dipole.center[j] - boxCenter[j]) + boxExtent[j];
+        }
+        dipole.radius = Length(farthest);
     }
+}
 
-    return false;
+template <typename Real> inline
+AABBTree3<Real> const& PointInPolyhedron3<Real>::GetTree() const
+{
+    return mTree;
+}
+
+template <typename Real>
+Real PointInPolyhedron3<Real>::GetWindingNumber(Vector3<Real> const& p, Real beta) const
+{
+    LogAssert(!mTree.IsEmpty() || mNumFaces == 0, "BuildTree must be called first.");
+    if (mTree.IsEmpty())
+    {
+        return (Real)0;
+    }
+
+    auto const& nodes = mTree.GetNodes();
+    auto const& primitives = mTree.GetPrimitives();
+    Real const sqrBeta = beta * beta;
+    Real solidAngle = (Real)0;
+    int stack[64];
+    int top = 0;
+    stack[0] = 0;
+    while (top >= 0)
+    {
+        int n = stack[top--];
+        auto const& node = nodes[n];
+        Dipole const& dipole = mDipoles[n];
+        Vector3<Real> diff = dipole.center - p;
+        Real sqrLength = Dot(diff, diff);
+        if (beta > (Real)0 && sqrLength > sqrBeta * dipole.radius * dipole.radius)
+        {
+            // The far-field approximation of the solid angle.
+            solidAngle += Dot(dipole.areaNormal, diff) / (sqrLength * std::sqrt(sqrLength));
+        }
+        else if (node.IsLeaf())
+        {
+            for (int k = node.index; k < node.index + node.count; ++k)
+            {
+                solidAngle += GetSolidAngle(p, primitives[k]);
+            }
+        }
+        else if (top + 2 < 64)
+        {
+            stack[++top] = node.index + 1;
+            stack[++top] = node.index;
+        }
+        else
+        {
+            // The tree is deeper than the stack, which happens only for
+            // degenerate inputs.  Evaluate the subtree exactly.
+            std::vector<int> subtree(1, n);
+            while (subtree.size() > 0)
+            {
+                auto const& sub = nodes[subtree.back()];
+                subtree.pop_back();
+                if (sub.IsLeaf())
+                {
+                    for (int k = sub.index; k < sub.index + sub.count; ++k)
+                    {
+                        solidAngle += GetSolidAngle(p, primitives[k]);
+                    }
+                }
+                else
+                {
+                    subtree.push_back(sub.index + 1);
+                    subtree.push_back(sub.index);
+                }
+            }
+        }
+    }
+
+    return solidAngle / ((Real)4 * (Real)GTE_C_PI);
+}
+
+template <typename Real>
+void PointInPolyhedron3<Real>::Contains(std::vector<Vector3<Real>> const& points,
+    std::vector<uint8_t>& inside, unsigned int numThreads) const
+{
+    inside.resize(points.size());
+    ParallelFor(points.size(), 256, numThreads,
+        [this, &points, &inside](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            inside[i] = (Contains(points[i]) ? 1 : 0);
+        }
+    });
+}
+
+template <typename Real>
+void PointInPolyhedron3<Real>::GetWindingNumbers(std::vector<Vector3<Real>> const& points,
+    std::vector<Real>& windingNumbers, Real beta, unsigned int numThreads) const
+{
+    windingNumbers.resize(points.size());
+    ParallelFor(points.size(), 256, numThreads,
+        [this, &points, &windingNumbers, beta](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            windingNumbers[i] = GetWindingNumber(points[i], beta);
+        }
+    });
+}
+
+template <typename Real>
+void PointInPolyhedron3<Real>::ContainsByWindingNumber(std::vector<Vector3<Real>> const& points,
+    std::vector<uint8_t>& inside, Real beta, unsigned int numThreads) const
+{
+    inside.resize(points.size());
+    ParallelFor(points.size(), 256, numThreads,
+        [this, &points, &inside, beta](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            inside[i] = (GetWindingNumber(points[i], beta) > (Real)0.5 ? 1 : 0);
+        }
+    });
 }
 
 template <typename Real>
@@ -278,335 +590,291 @@ bool PointInPolyhedron3<Real>::FastNoIntersect(Ray3<Real> const& ray,
 }
 
 template <typename Real>
-bool PointInPolyhedron3<Real>::ContainsT0(Vector3<Real> const& p) const
+bool PointInPolyhedron3<Real>::Intersects(Ray3<Real> const& ray, int i,
+    std::vector<Vector2<Real>>& projVertices) const
 {
-    int insideCount = 0;
-
-    TIQuery<Real, Ray3<Real>, Triangle3<Real>> rtQuery;
-    Triangle3<Real> triangle;
-    Ray3<Real> ray;
-    ray.origin = p;
-
-    for (int j = 0; j < mNumRays; ++j)
+    if (mTFaces)
     {
-        ray.direction = mDirections[j];
-
-        // Zero intersections to start with.
-        bool odd = false;
+        return IntersectsT0(ray, mTFaces[i]);
+    }
 
-        TriangleFace const* face = mTFaces;
-        for (int i = 0; i < mNumFaces; ++i, ++face)
+    if (mCFaces)
+    {
+        if (mMethod == 0)
         {
-            // Attempt to quickly cull the triangle.
-            if (FastNoIntersect(ray, face->plane))
-            {
-                continue;
-            }
+            return IntersectsC0(ray, mCFaces[i]);
+        }
 
-            // Get the triangle vertices.
-            for (int k = 0; k < 3; ++k)
-            {
-                triangle.v[k] = mPoints[face->indices[k]];
-            }
+        return IntersectsC1C2(ray, mCFaces[i], mMethod, projVertices);
+    }
 
-            // Test for intersection.
-            if (rtQuery(ray, triangle).intersect)
-            {
-                // The ray intersects the triangle.
-                odd = !odd;
-            }
+    if (mSFaces)
+    {
+        if (mMethod == 0)
+        {
+            return IntersectsS0(ray, mSFaces[i]);
         }
 
-        if (odd)
+        if (mMethod == 1)
         {
-            insideCount++;
+            return IntersectsS1(ray, mSFaces[i], projVertices);
         }
     }
 
-    return insideCount > mNumRays / 2;
+    return false;
 }
 
 template <typename Real>
-bool PointInPolyhedron3<Real>::ContainsC0(Vector3<Real> const& p) const
+bool PointInPolyhedron3<Real>::IntersectsT0(Ray3<Real> const& ray,
+    TriangleFace const& face) const
 {
-    int insideCount = 0;
+    // Attempt to quickly cull the triangle.
+    if (FastNoIntersect(ray, face.plane))
+    {
+        return false;
+    }
 
-    TIQuery<Real, Ray3<Real>, Triangle3<Real>> rtQuery;
+    // Get the triangle vertices.
     Triangle3<Real> triangle;
-    Ray3<Real> ray;
-    ray.origin = p;
-
-    for (int j = 0; j < mNumRays; ++j)
+    for (int k = 0; k < 3; ++k)
     {
-        ray.direction = mDirections[j];
-
-        // Zero intersections to start with.
-        bool odd = false;
-
-        ConvexFace const* face = mCFaces;
-        for (int i = 0; i < mNumFaces; ++i, ++face)
-        {
-            // Attempt to quickly cull the triangle.
-            if (FastNoIntersect(ray, face->plane))
-            {
-                continue;
-            }
-
-            // Process the triangles in a trifan of the face.
-            size_t numVerticesM1 = face->indices.size() - 1;
-            triangle.v[0] = mPoints[face->indices[0]];
-            for (size_t k = 1; k < numVerticesM1; ++k)
-            {
-                triangle.v[1] = mPoints[face->indices[k]];
-                triangle.v[2] = mPoints[face->indices[k + 1]];
-
-                if (rtQuery(ray, triangle).intersect)
-                {
-                    // The ray intersects the triangle.
-                    odd = !odd;
-                }
-            }
-        }
-
-        if (odd)
-        {
-            insideCount++;
-        }
+        triangle.v[k] = mPoints[face.indices[k]];
     }
 
-    return insideCount > mNumRays / 2;
+    // Test for intersection.
+    TIQuery<Real, Ray3<Real>, Triangle3<Real>> rtQuery;
+    return rtQuery(ray, triangle).intersect;
 }
 
 template <typename Real>
-bool PointInPolyhedron3<Real>::ContainsS0(Vector3<Real> const& p) const
+bool PointInPolyhedron3<Real>::IntersectsC0(Ray3<Real> const& ray,
+    ConvexFace const& face) const
 {
-    int insideCount = 0;
+    // Attempt to quickly cull the triangle.
+    if (FastNoIntersect(ray, face.plane))
+    {
+        return false;
+    }
 
+    // Process the triangles in a trifan of the face.
     TIQuery<Real, Ray3<Real>, Triangle3<Real>> rtQuery;
     Triangle3<Real> triangle;
-    Ray3<Real> ray;
-    ray.origin = p;
-
-    for (int j = 0; j < mNumRays; ++j)
+    bool odd = false;
+    size_t numVerticesM1 = face.indices.size() - 1;
+    triangle.v[0] = mPoints[face.indices[0]];
+    for (size_t k = 1; k < numVerticesM1; ++k)
     {
-        ray.direction = mDirections[j];
-
-        // Zero intersections to start with.
-        bool odd = false;
-
-        SimpleFace const* face = mSFaces;
-        for (int i = 0; i < mNumFaces; ++i, ++face)
-        {
-            // Attempt to quickly cull the triangle.
-            if (FastNoIntersect(ray, face->plane))
-            {
-                continue;
-            }
-
-            // The triangulation must exist to use it.
-            size_t numTriangles = face->triangles.size() / 3;
-            LogAssert(numTriangles > 0, "Triangulation must exist.");
-
-            // Process the triangles in a triangulation of the face.
-            int const* currIndex = &face->triangles[0];
-            for (size_t t = 0; t < numTriangles; ++t)
-            {
-                // Get the triangle vertices.
-                for (int k = 0; k < 3; ++k)
-                {
-                    triangle.v[k] = mPoints[*currIndex++];
-                }
-
-                // Test for intersection.
-                if (rtQuery(ray, triangle).intersect)
-                {
-                    // The ray intersects the triangle.
-                    odd = !odd;
-                }
-            }
-        }
+        triangle.v[1] = mPoints[face.indices[k]];
+        triangle.v[2] = mPoints[face.indices[k + 1]];
 
-        if (odd)
+        if (rtQuery(ray, triangle).intersect)
         {
-            insideCount++;
+            // The ray intersects the triangle.
+            odd = !odd;
         }
     }
-
-    return insideCount > mNumRays / 2;
+    return odd;
 }
 
 template <typename Real>
-bool PointInPolyhedron3<Real>::ContainsC1C2(Vector3<Real> const& p,
-    unsigned int method) const
+bool PointInPolyhedron3<Real>::IntersectsS0(Ray3<Real> const& ray,
+    SimpleFace const& face) const
 {
-    int insideCount = 0;
-
-    FIQuery<Real, Ray3<Real>, Plane3<Real>> rpQuery;
-    Ray3<Real> ray;
-    ray.origin = p;
-
-    for (int j = 0; j < mNumRays; ++j)
+    // Attempt to quickly cull the triangle.
+    if (FastNoIntersect(ray, face.plane))
     {
-        ray.direction = mDirections[j];
+        return false;
+    }
 
-        // Zero intersections to start with.
-        bool odd = false;
+    // The triangulation must exist to use it.
+    size_t numTriangles = face.triangles.size() / 3;
+    LogAssert(numTriangles > 0, "Triangulation must exist.");
 
-        ConvexFace const* face = mCFaces;
-        for (int i = 0; i < mNumFaces; ++i, ++face)
+    // Process the triangles in a triangulation of the face.
+    TIQuery<Real, Ray3<Real>, Triangle3<Real>> rtQuery;
+    Triangle3<Real> triangle;
+    bool odd = false;
+    int const* currIndex = &face.triangles[0];
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        // Get the triangle vertices.
+        for (int k = 0; k < 3; ++k)
         {
-            // Attempt to quickly cull the triangle.
-            if (FastNoIntersect(ray, face->plane))
-            {
-                continue;
-            }
-
-            // Compute the ray-plane intersection.
-            auto result = rpQuery(ray, face->plane);
-
-            // If you trigger this assertion, numerical round-off errors have
-            // led to a discrepancy between FastNoIntersect and the Find()
-            // result.
-            LogAssert(result.intersect, "Unexpected condition.");
-
-            // Get a coordinate system for the plane.  Use vertex 0 as the
-            // origin.
-            Vector3<Real> const& V0 = mPoints[face->indices[0]];
-            Vector3<Real> basis[3];
-            basis[0] = face->plane.normal;
-            ComputeOrthogonalComplement(1, basis);
-
-            // Project the intersection onto the plane.
-            Vector3<Real> diff = result.point - V0;
-            Vector2<Real> projIntersect{
-                Dot(basis[1], diff), Dot(basis[2], diff) };
-
-            // Project the face vertices onto the plane of the face.
-            if (face->indices.size() > mProjVertices.size())
-            {
-                mProjVertices.resize(face->indices.size());
-            }
-
-            // Project the remaining vertices.  Vertex 0 is always the origin.
-            size_t numIndices = face->indices.size();
-            mProjVertices[0] = Vector2<Real>::Zero();
-            for (size_t k = 1; k < numIndices; ++k)
-            {
-                diff = mPoints[face->indices[k]] - V0;
-                mProjVertices[k][0] = Dot(basis[1], diff);
-                mProjVertices[k][1] = Dot(basis[2], diff);
-            }
-
-            // Test whether the intersection point is in the convex polygon.
-            PointInPolygon2<Real> PIP(static_cast<int>(mProjVertices.size()),
-                &mProjVertices[0]);
-
-            if (method == 1)
-            {
-                if (PIP.ContainsConvexOrderN(projIntersect))
-                {
-                    // The ray intersects the triangle.
-                    odd = !odd;
-                }
-            }
-            else
-            {
-                if (PIP.ContainsConvexOrderLogN(projIntersect))
-                {
-                    // The ray intersects the triangle.
-                    odd = !odd;
-                }
-            }
+            triangle.v[k] = mPoints[*currIndex++];
         }
 
-        if (odd)
+        // Test for intersection.
+        if (rtQuery(ray, triangle).intersect)
         {
-            insideCount++;
+            // The ray intersects the triangle.
+            odd = !odd;
         }
     }
-
-    return insideCount > mNumRays / 2;
+    return odd;
 }
 
 template <typename Real>
-bool PointInPolyhedron3<Real>::ContainsS1(Vector3<Real> const& p) const
+bool PointInPolyhedron3<Real>::IntersectsC1C2(Ray3<Real> const& ray,
+    ConvexFace const& face, unsigned int method,
+    std::vector<Vector2<Real>>& projVertices) const
 {
-    int insideCount = 0;
+    // Attempt to quickly cull the triangle.
+    if (FastNoIntersect(ray, face.plane))
+    {
+        return false;
+    }
 
+    // Compute the ray-plane intersection.
     FIQuery<Real, Ray3<Real>, Plane3<Real>> rpQuery;
-    Ray3<Real> ray;
-    ray.origin = p;
-
-    for (int j = 0; j < mNumRays; ++j)
+    auto result = rpQuery(ray, face.plane);
+
+    // If you trigger this assertion, numerical round-off errors have
+    // led to a discrepancy between FastNoIntersect and the Find()
+    // result.
+    LogAssert(result.intersect, "Unexpected condition.");
+
+    // Get a coordinate system for the plane.  Use vertex 0 as the
+    // origin.
+    Vector3<Real> const& V0 = mPoints[face.indices[0]];
+    Vector3<Real> basis[3];
+    basis[0] = face.plane.normal;
+    ComputeOrthogonalComplement(1, basis);
+
+    // Project the intersection onto the plane.
+    Vector3<Real> diff = result.point - V0;
+    Vector2<Real> projIntersect{
+        Dot(basis[1], diff), Dot(basis[2], diff) };
+
+    // Project the face vertices onto the plane of the face.
+    if (face.indices.size() > projVertices.size())
     {
-        ray.direction = mDirections[j];
-
-        // Zero intersections to start with.
-        bool odd = false;
-
-        SimpleFace const* face = mSFaces;
-        for (int i = 0; i < mNumFaces; ++i, ++face)
-        {
-            // Attempt to quickly cull the triangle.
-            if (FastNoIntersect(ray, face->plane))
-            {
-                continue;
-            }
-
-            // Compute the ray-plane intersection.
-            auto result = rpQuery(ray, face->plane);
+        projVertices.resize(face.indices.size());
+    }
 
-            // If you trigger this assertion, numerical round-off errors have
-            // led to a discrepancy between FastNoIntersect and the Find()
-            // result.
-            LogAssert(result.intersect, "Unexpected condition.");
+    // Project the remaining vertices.  Vertex 0 is always the origin.
+    size_t numIndices = face.indices.size();
+    projVertices[0] = Vector2<Real>::Zero();
+    for (size_t k = 1; k < numIndices; ++k)
+    {
+        diff = mPoints[face.indices[k]] - V0;
+        projVertices[k][0] = Dot(basis[1], diff);
+        projVertices[k][1] = Dot(basis[2], diff);
+    }
 
-            // Get a coordinate system for the plane.  Use vertex 0 as the
-            // origin.
-            Vector3<Real> const& V0 = mPoints[face->indices[0]];
-            Vector3<Real> basis[3];
-            basis[0] = face->plane.normal;
-            ComputeOrthogonalComplement(1, basis);
+    // Test whether the intersection point is in the convex polygon.  The
+    // storage can have more elements than the face has vertices.
+    PointInPolygon2<Real> PIP(static_cast<int>(numIndices), &projVertices[0]);
 
-            // Project the intersection onto the plane.
-            Vector3<Real> diff = result.point - V0;
-            Vector2<Real> projIntersect{
-                Dot(basis[1], diff), Dot(basis[2], diff) };
+    if (method == 1)
+    {
+        return PIP.ContainsConvexOrderN(projIntersect);
+    }
+    else
+    {
+        return PIP.ContainsConvexOrderLogN(projIntersect);
+    }
+}
 
-            // Project the face vertices onto the plane of the face.
-            if (face->indices.size() > mProjVertices.size())
-            {
-                mProjVertices.resize(face->indices.size());
-            }
+template <typename Real>
+bool PointInPolyhedron3<Real>::IntersectsS1(Ray3<Real> const& ray,
+    SimpleFace const& face, std::vector<Vector2<Real>>& projVertices) const
+{
+    // Attempt to quickly cull the triangle.
+    if (FastNoIntersect(ray, face.plane))
+    {
+        return false;
+    }
 
-            // Project the remaining vertices.  Vertex 0 is always the origin.
-            size_t numIndices = face->indices.size();
-            mProjVertices[0] = Vector2<Real>::Zero();
-            for (size_t k = 1; k < numIndices; ++k)
-            {
-                diff = mPoints[face->indices[k]] - V0;
-                mProjVertices[k][0] = Dot(basis[1], diff);
-                mProjVertices[k][1] = Dot(basis[2], diff);
-            }
+    // Compute the ray-plane intersection.
+    FIQuery<Real, Ray3<Real>, Plane3<Real>> rpQuery;
+    auto result = rpQuery(ray, face.plane);
+
+    // If you trigger this assertion, numerical round-off errors have
+    // led to a discrepancy between FastNoIntersect and the Find()
+    // result.
+    LogAssert(result.intersect, "Unexpected condition.");
+
+    // Get a coordinate system for the plane.  Use vertex 0 as the
+    // origin.
+    Vector3<Real> const& V0 = mPoints[face.indices[0]];
+    Vector3<Real> basis[3];
+    basis[0] = face.plane.normal;
+    ComputeOrthogonalComplement(1, basis);
+
+    // Project the intersection onto the plane.
+    Vector3<Real> diff = result.point - V0;
+    Vector2<Real> projIntersect{
+        Dot(basis[1], diff), Dot(basis[2], diff) };
+
+    // Project the face vertices onto the plane of the face.
+    if (face.indices.size() > projVertices.size())
+    {
+        projVertices.resize(face.indices.size());
+    }
 
-            // Test whether the intersection point is in the convex polygon.
-            PointInPolygon2<Real> PIP(static_cast<int>(mProjVertices.size()),
-                &mProjVertices[0]);
+    // Project the remaining vertices.  Vertex 0 is always the origin.
+    size_t numIndices = face.indices.size();
+    projVertices[0] = Vector2<Real>::Zero();
+    for (size_t k = 1; k < numIndices; ++k)
+    {
+        diff = mPoints[face.indices[k]] - V0;
+        projVertices[k][0] = Dot(basis[1], diff);
+        projVertices[k][1] = Dot(basis[2], diff);
+    }
 
-            if (PIP.Contains(projIntersect))
-            {
-                // The ray intersects the triangle.
-                odd = !odd;
-            }
-        }
+    // Test whether the intersection point is in the polygon.  The storage
+    // can have more elements than the face has vertices.
+    PointInPolygon2<Real> PIP(static_cast<int>(numIndices), &projVertices[0]);
+    return PIP.Contains(projIntersect);
+}
 
-        if (odd)
-        {
-            insideCount++;
-        }
+template <typename Real> inline
+void PointInPolyhedron3<Real>::GetFace(int i, int const*& indices, int& numIndices) const
+{
+    if (mTFaces)
+    {
+        indices = mTFaces[i].indices;
+        numIndices = 3;
     }
+    else if (mCFaces)
+    {
+        indices = mCFaces[i].indices.data();
+        numIndices = static_cast<int>(mCFaces[i].indices.size());
+    }
+    else
+    {
+        indices = mSFaces[i].indices.data();
+        numIndices = static_cast<int>(mSFaces[i].indices.size());
+    }
+}
 
-    return insideCount > mNumRays / 2;
+template <typename Real>
+Real PointInPolyhedron3<Real>::GetSolidAngle(Vector3<Real> const& p, int i) const
+{
+    // The signed solid angle of a triangle with vertices A, B and C
+    // relative to p is 2*atan2(det[a,b,c], |a||b||c| + Dot(a,b)|c| +
+    // Dot(b,c)|a| + Dot(c,a)|b|), where a = A-p, b = B-p and c = C-p,
+    //   The Solid Angle of a Plane Triangle,
+    //   A. van Oosterom and J. Strackee,
+    //   IEEE Transactions on Biomedical Engineering, vol. 30, no. 2, 1983
+    int const* indices;
+    int numIndices;
+    GetFace(i, indices, numIndices);
+
+    Real solidAngle = (Real)0;
+    Vector3<Real> a = mPoints[indices[0]] - p;
+    Real lengthA = Length(a);
+    for (int k = 1; k + 1 < numIndices; ++k)
+    {
+        Vector3<Real> b = mPoints[indices[k]] - p;
+        Vector3<Real> c = mPoints[indices[k + 1]] - p;
+        Real lengthB = Length(b), lengthC = Length(c);
+        Real numer = DotCross(a, b, c);
+        Real denom = lengthA * lengthB * lengthC + Dot(a, b) * lengthC +
+            Dot(b, c) * lengthA + Dot(c, a) * lengthB;
+        solidAngle += (Real)2 * std::atan2(numer, denom);
+    }
+    return solidAngle;
 }
 
 
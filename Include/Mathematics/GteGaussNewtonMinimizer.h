@@ -8,7 +8,9 @@
 #pragma once
 
 #include <Mathematics/GteCholeskyDecomposition.h>
+#include <Mathematics/GteSparseNormalEquations.h>
 #include <functional>
+#include <memory>
 
 // Let F(p) = (F_{0}(p), F_{1}(p), ..., F_{n-1}(p)) be a vector-valued
 // function of the parameters p = (p_{0}, p_{1}, ..., p_{m-1}).  The
@@ -49,6 +51,12 @@
 // advantage; for example, 3-tuples of components of F(p) might correspond to
 // vectors that can be manipulated using an already existing mathematics
 // library.  The implementation here supports both approaches.
+//
+// When the number of parameters is large but each group of components of F
+// depends on only a few parameters, J and J^T*J are sparse.  The minimizer
+// has a third constructor for this case, where J^T*J is assembled and solved
+// in sparse form and the groups are evaluated concurrently.  See
+// GteSparseNormalEquations.h for the details.
 
 namespace gte
 {
@@ -66,6 +74,8 @@ namespace gte
         typedef std::function<void(DVector const&, RVector&)> FFunction;
         typedef std::function<void(DVector const&, JMatrix&)> JFunction;
         typedef std::function<void(DVector const&, JTJMatrix&, JTFVector&)> JPlusFunction;
+        typedef typename SparseNormalEquations<Real>::Block SparseBlock;
+        typedef typename SparseNormalEquations<Real>::BlockFunction SparseBlockFunction;
 
         // NOTE: The C++ compiler for Microsoft Visual Studio 12.0.21005.1 REL
         // (MSVS 2013) appears to have a bug regarding passing std::function
@@ -118,6 +128,26 @@ namespace gte
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
         }
 
+        // Create the minimizer that computes F(p) and J(p) by blocks and
+        // solves the normal equations in sparse form.  The blocks are
+        // evaluated by 'numThreads' threads.
+        GaussNewtonMinimizer(int numPDimensions, std::vector<SparseBlock> const& blocks,
+            SparseBlockFunction const& blockFunction, unsigned int numThreads = 1)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(0),
+            mJ(0, 0),
+            mJTJ(0, 0),
+            mNegJTF(mNumPDimensions),
+            mDecomposer(mNumPDimensions),
+            mSparse(std::make_unique<SparseNormalEquations<Real>>(
+                numPDimensions, blocks, blockFunction, numThreads)),
+            mUseJFunction(false)
+        {
+            mNumFDimensions = mSparse->GetNumFDimensions();
+            mF.SetSize(mNumFDimensions);
+        }
+
         // Disallow copy, assignment and move semantics.
         GaussNewtonMinimizer(GaussNewtonMinimizer const&) = delete;
         GaussNewtonMinimizer& operator=(GaussNewtonMinimizer const&) = delete;
@@ -127,6 +157,11 @@ namespace gte
         inline int GetNumPDimensions() const { return mNumPDimensions; }
         inline int GetNumFDimensions() const { return mNumFDimensions; }
 
+        // Access to the sparse solver, which is null unless the minimizer
+        // was created with the blocks constructor.  Use it to set the
+        // conjugate gradient parameters.
+        inline SparseNormalEquations<Real>* GetSparseSolver() const { return mSparse.get(); }
+
         struct Result
         {
             DVector minLocation;
@@ -153,7 +188,7 @@ namespace gte
             errorDifferenceTolerance = std::max(errorDifferenceTolerance, (Real)0);
 
             // Compute the initial error.
-            mFFunction(p0, mF);
+            ComputeF(p0);
             result.minError = Dot(mF, mF);
 
             // Do the Gauss-Newton iterations.
@@ -161,7 +196,7 @@ namespace gte
             for (result.numIterations = 1; result.numIterations <= maxIterations; ++result.numIterations)
             {
                 ComputeLinearSystemInputs(pCurrent);
-                if (!mDecomposer.Factor(mJTJ))
+                if (!SolveLinearSystem())
                 {
                     // TODO: The matrix mJTJ is positive semi-definite, so the
                     // failure can occur when mJTJ has a zero eigenvalue in
@@ -169,11 +204,9 @@ namespace gte
                     // anyway, perhaps using gradient descent?
                     return result;
                 }
-                mDecomposer.SolveLower(mJTJ, mNegJTF);
-                mDecomposer.SolveUpper(mJTJ, mNegJTF);
 
                 auto pNext = pCurrent + mNegJTF;
-                mFFunction(pNext, mF);
+                ComputeF(pNext);
                 Real error = Dot(mF, mF);
                 if (error < result.minError)
                 {
@@ -196,9 +229,25 @@ namespace gte
         }
 
     private:
+        void ComputeF(DVector const& p)
+        {
+            if (mSparse)
+            {
+                mSparse->ComputeF(p, mF);
+            }
+            else
+            {
+                mFFunction(p, mF);
+            }
+        }
+
         void ComputeLinearSystemInputs(DVector const& pCurrent)
         {
-            if (mUseJFunction)
+            if (mSparse)
+            {
+                mSparse->ComputeLinearSystemInputs(pCurrent, (Real)0, mF, mNegJTF);
+            }
+            else if (mUseJFunction)
             {
                 mJFunction(pCurrent, mJ);
                 mJTJ = MultiplyATB(mJ, mJ);
@@ -210,6 +259,24 @@ namespace gte
             }
         }
 
+        // Solve the normal equations.  On success, mNegJTF stores the
+        // update to the parameters.
+        bool SolveLinearSystem()
+        {
+            if (mSparse)
+            {
+                return mSparse->Solve(mNegJTF);
+            }
+
+            if (!mDecomposer.Factor(mJTJ))
+            {
+                return false;
+            }
+            mDecomposer.SolveLower(mJTJ, mNegJTF);
+            mDecomposer.SolveUpper(mJTJ, mNegJTF);
+            return true;
+        }
+
         int mNumPDimensions, mNumFDimensions;
         FFunction mFFunction;
         JFunction mJFunction;
@@ -223,6 +290,9 @@ namespace gte
 
         CholeskyDecomposition<Real> mDecomposer;
 
+        // The solver for the blocks constructor.
+        std::unique_ptr<SparseNormalEquations<Real>> mSparse;
+
         bool mUseJFunction;
     };
 }
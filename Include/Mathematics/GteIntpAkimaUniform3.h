@@ -9,9 +9,12 @@
 
 #include <LowLevel/GteArray3.h>
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstring>
+#include <vector>
 
 // The interpolator is for uniformly spaced(x,y z)-values.  The input samples
 // must be stored in lexicographical order to represent f(x,y,z); that is,
@@ -58,6 +61,27 @@ public:
     Real operator()(Real x, Real y, Real z) const;
     Real operator()(int xOrder, int yOrder, int zOrder, Real x, Real y, Real z) const;
 
+    // Evaluate the function or its derivatives at the points (x[i],y[i],z[i])
+    // for 0 <= i < numPoints, storing the results in output[i].  The results
+    // are the same as those of the operator()(...) calls.  The points are
+    // distributed over 'numThreads' threads.
+    void Evaluate(int xOrder, int yOrder, int zOrder, size_t numPoints,
+        Real const* x, Real const* y, Real const* z, Real* output,
+        unsigned int numThreads = 1) const;
+
+    // Resample the function (or a derivative) on an output grid of size
+    // xSize-by-ySize-by-zSize that is related to the input domain by an
+    // affine map.  The output[i + xSize*(j + ySize*k)] is the function at
+    // (x,y,z) = origin + i*xStep + j*yStep + k*zStep.  The z-slabs of the
+    // output are distributed over 'numThreads' threads.  When the output
+    // rows are parallel to the x-axis (xStep[1] = xStep[2] = 0), the cell
+    // polynomials are reduced to cubics in x once per row.
+    void Resample(int xOrder, int yOrder, int zOrder, int xSize, int ySize,
+        int zSize, std::array<Real, 3> const& origin,
+        std::array<Real, 3> const& xStep, std::array<Real, 3> const& yStep,
+        std::array<Real, 3> const& zStep, Real* output,
+        unsigned int numThreads = 1) const;
+
 private:
     class Polynomial
     {
@@ -68,6 +92,7 @@ private:
         // The tensor term A[ix][iy][iz] corresponds to the polynomial term
         // x^{ix} y^{iy} z^{iz}.
         Real& A(int ix, int iy, int iz);
+        Real const& A(int ix, int iy, int iz) const;
         Real operator()(Real x, Real y, Real z) const;
         Real operator()(int xOrder, int yOrder, int zOrder, Real x, Real y, Real z) const;
 
@@ -98,6 +123,33 @@ private:
     void YLookup(Real y, int& yIndex, Real& dy) const;
     void ZLookup(Real z, int& zIndex, Real& dz) const;
 
+    // The common implementation of XLookup, YLookup and ZLookup.  The input
+    // t must be in [tMin,tMin+spacing*(bound-1)].
+    static void Lookup(Real t, Real tMin, Real spacing, int bound,
+        int& index, Real& d);
+
+    // Support for batch evaluation.  The samples are processed in packets of
+    // NumLanes samples.  The lookups and the power computations are loops
+    // over the lanes of a packet, so the compiler can vectorize them.
+    enum { NumLanes = 16 };
+
+    // Compute the coefficients of the polynomials for the order-th
+    // derivatives of the powers 1, d, d^2 and d^3, namely
+    // power[i](d) = sum_p coeff[i][p]*d^p.  The function returns 'false'
+    // when the order is larger than 3.
+    static bool GetPowerPolynomials(int order, Real coeff[4][4]);
+
+    static void GetPowers(int numLanes, Real const* t, Real tMin, Real tMax,
+        Real spacing, int bound, Real const coeff[4][4], int* index,
+        Real power[4][NumLanes]);
+
+    void EvaluatePacket(int numLanes, Real const* x, Real const* y,
+        Real const* z, Real const coeff[3][4][4], Real* output) const;
+
+    void ResampleAlignedRow(int xSize, std::array<Real, 3> const& start,
+        Real xStep, Real const coeff[3][4][4], std::vector<Real>& line,
+        Real* output) const;
+
     int mXBound, mYBound, mZBound, mQuantity;
     Real mXMin, mXMax, mXSpacing;
     Real mYMin, mYMax, mYSpacing;
@@ -281,6 +333,92 @@ Real IntpAkimaUniform3<Real>::operator()(int xOrder, int yOrder, int zOrder,
     return mPoly[iz][iy][ix](xOrder, yOrder, zOrder, dx, dy, dz);
 }
 
+template <typename Real>
+void IntpAkimaUniform3<Real>::Evaluate(int xOrder, int yOrder, int zOrder,
+    size_t numPoints, Real const* x, Real const* y, Real const* z,
+    Real* output, unsigned int numThreads) const
+{
+    Real coeff[3][4][4];
+    if (!GetPowerPolynomials(xOrder, coeff[0])
+        || !GetPowerPolynomials(yOrder, coeff[1])
+        || !GetPowerPolynomials(zOrder, coeff[2]))
+    {
+        std::fill(output, output + numPoints, (Real)0);
+        return;
+    }
+
+    ParallelFor(numPoints, 256, numThreads,
+        [this, x, y, z, output, &coeff](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i += NumLanes)
+        {
+            int numLanes = static_cast<int>(std::min(static_cast<size_t>(NumLanes), end - i));
+            EvaluatePacket(numLanes, x + i, y + i, z + i, coeff, output + i);
+        }
+    });
+}
+
+template <typename Real>
+void IntpAkimaUniform3<Real>::Resample(int xOrder, int yOrder, int zOrder,
+    int xSize, int ySize, int zSize, std::array<Real, 3> const& origin,
+    std::array<Real, 3> const& xStep, std::array<Real, 3> const& yStep,
+    std::array<Real, 3> const& zStep, Real* output,
+    unsigned int numThreads) const
+{
+    size_t const rowSize = static_cast<size_t>(xSize);
+    size_t const sliceSize = rowSize * static_cast<size_t>(ySize);
+    Real coeff[3][4][4];
+    if (!GetPowerPolynomials(xOrder, coeff[0])
+        || !GetPowerPolynomials(yOrder, coeff[1])
+        || !GetPowerPolynomials(zOrder, coeff[2]))
+    {
+        std::fill(output, output + sliceSize * static_cast<size_t>(zSize), (Real)0);
+        return;
+    }
+
+    bool const alignedRows = (xStep[1] == (Real)0 && xStep[2] == (Real)0);
+    ParallelFor(static_cast<size_t>(zSize), 1, numThreads,
+        [this, xSize, ySize, rowSize, sliceSize, alignedRows, &origin, &xStep,
+        &yStep, &zStep, output, &coeff](unsigned int, size_t kBegin, size_t kEnd)
+    {
+        Real x[NumLanes], y[NumLanes], z[NumLanes];
+        std::vector<Real> line;
+        for (size_t k = kBegin; k < kEnd; ++k)
+        {
+            Real const fk = static_cast<Real>(k);
+            for (int j = 0; j < ySize; ++j)
+            {
+                Real const fj = static_cast<Real>(j);
+                std::array<Real, 3> start;
+                for (int d = 0; d < 3; ++d)
+                {
+                    start[d] = origin[d] + fj * yStep[d] + fk * zStep[d];
+                }
+
+                Real* row = output + rowSize * static_cast<size_t>(j) + sliceSize * k;
+                if (alignedRows)
+                {
+                    ResampleAlignedRow(xSize, start, xStep[0], coeff, line, row);
+                    continue;
+                }
+
+                for (int i = 0; i < xSize; i += NumLanes)
+                {
+                    int numLanes = std::min(static_cast<int>(NumLanes), xSize - i);
+                    for (int lane = 0; lane < numLanes; ++lane)
+                    {
+                        Real const fi = static_cast<Real>(i + lane);
+                        x[lane] = start[0] + fi * xStep[0];
+                        y[lane] = start[1] + fi * xStep[1];
+                        z[lane] = start[2] + fi * xStep[2];
+                    }
+                    EvaluatePacket(numLanes, x, y, z, coeff, row + i);
+                }
+            }
+        }
+    });
+}
+
 template <typename Real>
 void IntpAkimaUniform3<Real>::GetFX(Array3<Real> const& F, Array3<Real>& FX)
 {
@@ -1307,49 +1445,185 @@ void IntpAkimaUniform3<Real>::Construct(Polynomial& poly,
 template <typename Real>
 void IntpAkimaUniform3<Real>::XLookup(Real x, int& xIndex, Real& dx) const
 {
-    for (xIndex = 0; xIndex + 1 < mXBound; ++xIndex)
+    Lookup(x, mXMin, mXSpacing, mXBound, xIndex, dx);
+}
+
+template <typename Real>
+void IntpAkimaUniform3<Real>::YLookup(Real y, int& yIndex, Real& dy) const
+{
+    Lookup(y, mYMin, mYSpacing, mYBound, yIndex, dy);
+}
+
+template <typename Real>
+void IntpAkimaUniform3<Real>::ZLookup(Real z, int& zIndex, Real& dz) const
+{
+    Lookup(z, mZMin, mZSpacing, mZBound, zIndex, dz);
+}
+
+template <typename Real>
+void IntpAkimaUniform3<Real>::Lookup(Real t, Real tMin, Real spacing,
+    int bound, int& index, Real& d)
+{
+    // The index is the smallest i in [0,bound-2] for which
+    // t < tMin + spacing*(i+1), or bound-2 when there is no such i.  The
+    // estimate from the division is corrected for rounding errors so that
+    // the index is the same as that of a linear search.
+    int i = static_cast<int>((t - tMin) / spacing);
+    i = std::min(std::max(i, 0), bound - 2);
+    while (i > 0 && t < tMin + spacing*i)
+    {
+        --i;
+    }
+    while (i < bound - 2 && !(t < tMin + spacing*(i + 1)))
     {
-        if (x < mXMin + mXSpacing*(xIndex + 1))
+        ++i;
+    }
+
+    index = i;
+    d = t - (tMin + spacing*i);
+}
+
+template <typename Real>
+bool IntpAkimaUniform3<Real>::GetPowerPolynomials(int order, Real coeff[4][4])
+{
+    if (order < 0 || order > 3)
+    {
+        return false;
+    }
+
+    // The order-th derivative of d^i is (i!/(i-order)!)*d^{i-order} for
+    // i >= order and 0 for i < order.
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int p = 0; p < 4; ++p)
         {
-            dx = x - (mXMin + mXSpacing*xIndex);
-            return;
+            coeff[i][p] = (Real)0;
         }
-    }
 
-    --xIndex;
-    dx = x - (mXMin + mXSpacing*xIndex);
+        if (i >= order)
+        {
+            Real factor = (Real)1;
+            for (int m = i; m > i - order; --m)
+            {
+                factor *= static_cast<Real>(m);
+            }
+            coeff[i][i - order] = factor;
+        }
+    }
+    return true;
 }
 
 template <typename Real>
-void IntpAkimaUniform3<Real>::YLookup(Real y, int& yIndex, Real& dy) const
+void IntpAkimaUniform3<Real>::GetPowers(int numLanes, Real const* t,
+    Real tMin, Real tMax, Real spacing, int bound, Real const coeff[4][4],
+    int* index, Real power[4][NumLanes])
 {
-    for (yIndex = 0; yIndex + 1 < mYBound; ++yIndex)
+    Real d[NumLanes];
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        Real tClamp = std::min(std::max(t[lane], tMin), tMax);
+        Lookup(tClamp, tMin, spacing, bound, index[lane], d[lane]);
+    }
+
+    for (int i = 0; i < 4; ++i)
     {
-        if (y < mYMin + mYSpacing*(yIndex + 1))
+        for (int lane = 0; lane < numLanes; ++lane)
         {
-            dy = y - (mYMin + mYSpacing*yIndex);
-            return;
+            power[i][lane] = coeff[i][0] + d[lane] * (coeff[i][1] +
+                d[lane] * (coeff[i][2] + d[lane] * coeff[i][3]));
         }
     }
+}
 
-    --yIndex;
-    dy = y - (mYMin + mYSpacing*yIndex);
+template <typename Real>
+void IntpAkimaUniform3<Real>::EvaluatePacket(int numLanes, Real const* x,
+    Real const* y, Real const* z, Real const coeff[3][4][4],
+    Real* output) const
+{
+    int ix[NumLanes], iy[NumLanes], iz[NumLanes];
+    Real xPow[4][NumLanes], yPow[4][NumLanes], zPow[4][NumLanes];
+    GetPowers(numLanes, x, mXMin, mXMax, mXSpacing, mXBound, coeff[0], ix, xPow);
+    GetPowers(numLanes, y, mYMin, mYMax, mYSpacing, mYBound, coeff[1], iy, yPow);
+    GetPowers(numLanes, z, mZMin, mZMax, mZSpacing, mZBound, coeff[2], iz, zPow);
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        Polynomial const& poly = mPoly[iz[lane]][iy[lane]][ix[lane]];
+        Real p = (Real)0;
+        for (int i = 0; i <= 3; ++i)
+        {
+            Real sum = (Real)0;
+            for (int j = 0; j <= 3; ++j)
+            {
+                sum += yPow[j][lane] * (
+                    poly.A(i, j, 0) * zPow[0][lane] +
+                    poly.A(i, j, 1) * zPow[1][lane] +
+                    poly.A(i, j, 2) * zPow[2][lane] +
+                    poly.A(i, j, 3) * zPow[3][lane]);
+            }
+            p += xPow[i][lane] * sum;
+        }
+        output[lane] = p;
+    }
 }
 
 template <typename Real>
-void IntpAkimaUniform3<Real>::ZLookup(Real z, int& zIndex, Real& dz) const
+void IntpAkimaUniform3<Real>::ResampleAlignedRow(int xSize,
+    std::array<Real, 3> const& start, Real xStep, Real const coeff[3][4][4],
+    std::vector<Real>& line, Real* output) const
 {
-    for (zIndex = 0; zIndex + 1 < mZBound; ++zIndex)
+    // The y- and z-powers are constant along the row.
+    int iy, iz;
+    Real yPow[4][NumLanes], zPow[4][NumLanes];
+    GetPowers(1, &start[1], mYMin, mYMax, mYSpacing, mYBound, coeff[1], &iy, yPow);
+    GetPowers(1, &start[2], mZMin, mZMax, mZSpacing, mZBound, coeff[2], &iz, zPow);
+
+    // The x-index is a nondecreasing function of x, so the row touches the
+    // cells between those of its first and last samples.
+    Real xEnds[2] = { start[0], start[0] + static_cast<Real>(xSize - 1) * xStep };
+    int ixEnds[2];
+    Real unused[4][NumLanes];
+    GetPowers(2, xEnds, mXMin, mXMax, mXSpacing, mXBound, coeff[0], ixEnds, unused);
+    int const cMin = std::min(ixEnds[0], ixEnds[1]);
+    int const cMax = std::max(ixEnds[0], ixEnds[1]);
+
+    // Reduce the cell polynomials to cubics in x.
+    line.resize(4 * static_cast<size_t>(mXBound - 1));
+    for (int c = cMin; c <= cMax; ++c)
     {
-        if (z < mZMin + mZSpacing*(zIndex + 1))
+        Polynomial const& poly = mPoly[iz][iy][c];
+        for (int i = 0; i <= 3; ++i)
         {
-            dz = z - (mZMin + mZSpacing*zIndex);
-            return;
+            Real sum = (Real)0;
+            for (int j = 0; j <= 3; ++j)
+            {
+                for (int k = 0; k <= 3; ++k)
+                {
+                    sum += poly.A(i, j, k) * yPow[j][0] * zPow[k][0];
+                }
+            }
+            line[4 * c + i] = sum;
         }
     }
 
-    --zIndex;
-    dz = z - (mZMin + mZSpacing*zIndex);
+    // Evaluate the cubics.
+    Real x[NumLanes], xPow[4][NumLanes];
+    int ix[NumLanes];
+    for (int i = 0; i < xSize; i += NumLanes)
+    {
+        int numLanes = std::min(static_cast<int>(NumLanes), xSize - i);
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            x[lane] = start[0] + static_cast<Real>(i + lane) * xStep;
+        }
+        GetPowers(numLanes, x, mXMin, mXMax, mXSpacing, mXBound, coeff[0], ix, xPow);
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            Real const* cubic = &line[4 * ix[lane]];
+            output[i + lane] = xPow[0][lane] * cubic[0] + xPow[1][lane] * cubic[1] +
+                xPow[2][lane] * cubic[2] + xPow[3][lane] * cubic[3];
+        }
+    }
 }
 
 template <typename Real>
@@ -1364,6 +1638,12 @@ Real& IntpAkimaUniform3<Real>::Polynomial::A(int ix, int iy, int iz)
     return mCoeff[ix][iy][iz];
 }
 
+template <typename Real>
+Real const& IntpAkimaUniform3<Real>::Polynomial::A(int ix, int iy, int iz) const
+{
+    return mCoeff[ix][iy][iz];
+}
+
 template <typename Real>
 Real IntpAkimaUniform3<Real>::Polynomial::operator()(Real x, Real y, Real z)
 const
@@ -7,9 +7,14 @@
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GtePolynomial1.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <mutex>
 
 // IntpBSplineUniform is the class for B-spline interpolation of uniformly
 // spaced N-dimensional data.  The algorithm is described in
@@ -17,6 +22,10 @@
 // A sample application for this topic is
 //   GeometricTools/GTEngine/Samples/Imagics/BSplineInterpolation
 //
+// IntpBSplineUniformFixed, at the end of this file, is a variation for which
+// the dimension and degree are known at compile time.  It is intended for
+// resampling large images and volumes; see the comments before the class.
+//
 // The Controls adapter allows access to your control points without regard
 // to how you organize your data.  You can even defer the computation of a
 // control point until it is needed via the operator()(...) calls that
@@ -127,6 +136,21 @@ namespace gte
             mNumLocalControls(0)
         {
         }
+
+        // Construction for derived classes that store their own evaluation
+        // parameters.  Only the constructor inputs are set, and the derived
+        // class must set mValid.
+        IntpBSplineUniformShared(int numDimensions, Controls const& controls,
+            typename Controls::Type ctZero, int cacheMode)
+            :
+            mNumDimensions(numDimensions),
+            mControls(&controls),
+            mCTZero(ctZero),
+            mCacheMode(cacheMode),
+            mNumLocalControls(0),
+            mValid(false)
+        {
+        }
 #endif
 
     public:
@@ -1453,4 +1477,531 @@ namespace gte
     };
 }
 
+
+// Specialization for compile-time dimension and degree.  The dimension N and
+// the degree are template parameters, so all per-evaluation storage has
+// fixed size and lives on the stack; Evaluate(...) performs no heap
+// allocations, and the loops over the local controls are fully known to the
+// compiler.  The degree is the same for all dimensions, which is the common
+// case of resampling images and volumes with (for example) cubic B-splines.
+// The Controls adapter needs only the accessor operator()(int const* tuple).
+//
+// The caching modes have the same meaning as for IntpBSplineUniform, but the
+// cache is organized differently.  The blended tensor for a cell (a block of
+// (degree+1)^N elements) is computed in one pass by contracting the local
+// controls with the blending matrix one dimension at a time.  The cells are
+// grouped into tiles of tileSize^N cells.  With ON_DEMAND_CACHING, a tile is
+// allocated the first time one of its cells is needed and the cell tensor is
+// computed at that time, so the memory used is proportional to the region of
+// the domain that is actually sampled.  With PRE_CACHING, all tiles are
+// allocated and filled by the constructor.  Pass tileSize = 0 to choose a
+// tile size of at most 4096 cells per tile.  The cache is thread-safe, so
+// the batch Evaluate(...) may be called with multiple threads in any of the
+// caching modes.
+//
+// The batch Evaluate(...) is designed for query points that are sorted so
+// that consecutive points tend to lie in the same cell (for example, the
+// samples of a scanline of a resampled volume).  Consecutive points in the
+// same cell reuse the cell tensor (or the local controls when there is no
+// caching), so only the polynomial weights are computed per point.
+namespace gte
+{
+    // Compile-time integer power used to size the local control arrays.
+    inline constexpr int IntpBSplineUniformPower(int base, int exponent)
+    {
+        return (exponent > 0 ? base * IntpBSplineUniformPower(base, exponent - 1) : 1);
+    }
+
+    template <typename Real, typename Controls, int N, int Degree>
+    class IntpBSplineUniformFixed : public IntpBSplineUniformShared<Real, Controls>
+    {
+    public:
+        static_assert(N >= 1, "Invalid dimension.");
+        static_assert(Degree >= 0, "Invalid degree.");
+
+        enum
+        {
+            DegreeP1 = Degree + 1,
+            NumLocalControls = IntpBSplineUniformPower(Degree + 1, N)
+        };
+
+        // The caller is responsible for ensuring that the
+        // IntpBSplineUniformFixed object persists as long as the input
+        // 'controls' exists.  The 'numThreads' input is used only for
+        // PRE_CACHING.
+        IntpBSplineUniformFixed(Controls const& controls, typename Controls::Type ctZero,
+            int cacheMode, int tileSize = 0, unsigned int numThreads = 1)
+            :
+            IntpBSplineUniformShared<Real, Controls>(N, controls, ctZero, cacheMode),
+            mTileSize(0),
+            mNumTileCells(0),
+            mNumTiles(0)
+        {
+            this->mValid = IsValid();
+            if (!this->mValid)
+            {
+                return;
+            }
+
+            std::vector<Real> blender;
+            this->ComputeBlendingMatrix(Degree, blender);
+            std::copy(blender.begin(), blender.end(), mBlender.begin());
+
+            // mFalling[order][k] = k!/(k-order)! is the coefficient of
+            // u^{k-order} in the order-th derivative of u^k.
+            for (int order = 0; order <= Degree; ++order)
+            {
+                for (int k = 0; k <= Degree; ++k)
+                {
+                    Real coefficient = (Real)(k >= order ? 1 : 0);
+                    for (int m = k - order + 1; m <= k; ++m)
+                    {
+                        coefficient *= static_cast<Real>(m);
+                    }
+                    mFalling[order][k] = coefficient;
+                }
+            }
+
+            for (int dim = 0; dim < N; ++dim)
+            {
+                mNumControls[dim] = this->mControls->GetSize(dim);
+                mNumCells[dim] = mNumControls[dim] - Degree;
+                mTMin[dim] = (Real)-0.5;
+                mTMax[dim] = static_cast<Real>(mNumControls[dim]) - (Real)0.5;
+                mDSDT[dim] = static_cast<Real>(mNumControls[dim] - Degree) / (mTMax[dim] - mTMin[dim]);
+                mPowerDSDT[dim][0] = (Real)1;
+                for (int i = 1; i <= Degree; ++i)
+                {
+                    mPowerDSDT[dim][i] = mPowerDSDT[dim][i - 1] * mDSDT[dim];
+                }
+            }
+
+            if (this->mCacheMode != this->NO_CACHING)
+            {
+                InitializeTiles(tileSize, numThreads);
+            }
+        }
+
+        // Disallow copying and moving.
+        IntpBSplineUniformFixed(IntpBSplineUniformFixed const&) = delete;
+        IntpBSplineUniformFixed& operator=(IntpBSplineUniformFixed const&) = delete;
+        IntpBSplineUniformFixed(IntpBSplineUniformFixed&&) = delete;
+        IntpBSplineUniformFixed& operator=(IntpBSplineUniformFixed&&) = delete;
+
+        // Member access.
+        inline int GetDegree(int) const { return Degree; }
+        inline int GetNumControls(int dim) const { return mNumControls[dim]; }
+        inline Real GetTMin(int dim) const { return mTMin[dim]; }
+        inline Real GetTMax(int dim) const { return mTMax[dim]; }
+        inline int GetTileSize() const { return mTileSize; }
+
+        // The number of tiles that have been allocated by the cache.
+        size_t GetNumAllocatedTiles()
+        {
+            std::lock_guard<std::mutex> lock(mTileMutex);
+            return mTileStorage.size();
+        }
+
+        // Evaluate the interpolator.  The order is (0,...,0) when you want
+        // the B-spline function value itself.  The order[d] is 1 for the
+        // first derivative with respect to t[d], and so on.
+        typename Controls::Type Evaluate(std::array<int, N> const& order,
+            std::array<Real, N> const& t)
+        {
+            if (this->mValid && IsValidOrder(order))
+            {
+                std::array<int, N> cell;
+                std::array<std::array<Real, DegreeP1>, N> factors;
+                GetCell(t, cell, order, factors);
+                if (this->mCacheMode == this->NO_CACHING)
+                {
+                    std::array<typename Controls::Type, NumLocalControls> local;
+                    GatherControls(cell, local.data());
+                    return Combine(factors, local.data());
+                }
+                else
+                {
+                    return Combine(factors, GetCellTensor(cell));
+                }
+            }
+            return this->mCTZero;
+        }
+
+        // Evaluate the interpolator at a batch of points.  The output has
+        // the same number of elements as 't'.  For best performance, sort
+        // the points so that consecutive points tend to share cells.
+        void Evaluate(std::array<int, N> const& order,
+            std::vector<std::array<Real, N>> const& t,
+            std::vector<typename Controls::Type>& output,
+            unsigned int numThreads = 1)
+        {
+            output.resize(t.size());
+            if (!this->mValid || !IsValidOrder(order))
+            {
+                std::fill(output.begin(), output.end(), this->mCTZero);
+                return;
+            }
+
+            // The inputs are distributed over the threads in contiguous
+            // blocks, so their sorted order is preserved within each block.
+            ParallelFor(t.size(), 256, numThreads, [this, &order, &t,
+                &output](unsigned int, size_t begin, size_t end)
+            {
+                std::array<int, N> cell, previous;
+                std::array<std::array<Real, DegreeP1>, N> factors;
+                std::array<typename Controls::Type, NumLocalControls> local;
+                typename Controls::Type const* tensor = nullptr;
+                previous.fill(-1);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    GetCell(t[i], cell, order, factors);
+                    if (cell != previous)
+                    {
+                        if (this->mCacheMode == this->NO_CACHING)
+                        {
+                            GatherControls(cell, local.data());
+                            tensor = local.data();
+                        }
+                        else
+                        {
+                            tensor = GetCellTensor(cell);
+                        }
+                        previous = cell;
+                    }
+                    output[i] = Combine(factors, tensor);
+                }
+            });
+        }
+
+    protected:
+        // A tile of the sparse tensor cache.  The tensors of the cells are
+        // stored contiguously, NumLocalControls elements per cell.
+        struct Tile
+        {
+            Tile(int numCells)
+                :
+                tensors(static_cast<size_t>(numCells) * NumLocalControls),
+                cached(new std::atomic<bool>[numCells])
+            {
+                for (int i = 0; i < numCells; ++i)
+                {
+                    cached[i].store(false, std::memory_order_relaxed);
+                }
+            }
+
+            std::vector<typename Controls::Type> tensors;
+            std::unique_ptr<std::atomic<bool>[]> cached;
+            std::mutex mutex;
+        };
+
+        // Verify that the constraints for number of controls and degrees
+        // are satisfied.
+        bool IsValid()
+        {
+            // The condition c+1 > d+1 is required so that when s = c+1-d, its
+            // maximum value, we have at least two s-knots (d and d + 1).
+            for (int dim = 0; dim < N; ++dim)
+            {
+                if (this->mControls->GetSize(dim) <= Degree + 1)
+                {
+                    LogError("Incompatible degree and number of controls.");
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool IsValidOrder(std::array<int, N> const& order)
+        {
+            for (int dim = 0; dim < N; ++dim)
+            {
+                if (order[dim] < 0 || order[dim] > Degree)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Compute the cell containing t and the polynomial factors for each
+        // dimension.  The factors[dim][k] are the coefficients that multiply
+        // the power-k terms of the cell tensor, including the chain-rule
+        // factor (ds/dt)^order.
+        void GetCell(std::array<Real, N> const& t, std::array<int, N>& cell,
+            std::array<int, N> const& order,
+            std::array<std::array<Real, DegreeP1>, N>& factors) const
+        {
+            for (int dim = 0; dim < N; ++dim)
+            {
+                Real u;
+                this->GetKey(t[dim], mTMin[dim], mTMax[dim], mDSDT[dim],
+                    mNumControls[dim], Degree, cell[dim], u);
+
+                // The powers u^{k-order} are computed for all k so that the
+                // loops have compile-time bounds; the falling factorials are
+                // zero for k < order.
+                int const o = order[dim];
+                std::array<Real, DegreeP1> power;
+                power[0] = mPowerDSDT[dim][o];
+                for (int k = 1; k <= Degree; ++k)
+                {
+                    power[k] = power[k - 1] * u;
+                }
+                std::array<Real, DegreeP1> monomial;
+                for (int k = 0; k <= Degree; ++k)
+                {
+                    monomial[k] = mFalling[o][k] * power[k >= o ? k - o : 0];
+                }
+
+                if (this->mCacheMode == this->NO_CACHING)
+                {
+                    // Convert the power-basis factors to the B-spline basis
+                    // values phi[j] = sum_k A(j,k) * monomial[k].
+                    for (int j = 0; j <= Degree; ++j)
+                    {
+                        Real phi = (Real)0;
+                        for (int k = 0; k <= Degree; ++k)
+                        {
+                            phi += mBlender[k + DegreeP1 * j] * monomial[k];
+                        }
+                        factors[dim][j] = phi;
+                    }
+                }
+                else
+                {
+                    factors[dim] = monomial;
+                }
+            }
+        }
+
+        // Contract the (degree+1)^N elements with the per-dimension factors,
+        // one dimension at a time.  The element with multi-index
+        // (k0,...,k{N-1}) is stored at k0 + DegreeP1 * (k1 + DegreeP1 * (...)).
+        // The partial sums of a dimension are independent of each other,
+        // which avoids a long chain of dependent additions.
+        static typename Controls::Type Combine(
+            std::array<std::array<Real, DegreeP1>, N> const& factors,
+            typename Controls::Type const* elements)
+        {
+            std::array<typename Controls::Type, NumLocalControls / DegreeP1> partial;
+            typename Controls::Type const* source = elements;
+            for (int dim = 0, size = NumLocalControls / DegreeP1; dim < N; ++dim, size /= DegreeP1)
+            {
+                std::array<Real, DegreeP1> const& factor = factors[dim];
+                for (int i = 0; i < size; ++i)
+                {
+                    typename Controls::Type const* row = source + DegreeP1 * i;
+                    auto sum = row[0] * factor[0];
+                    for (int k = 1; k <= Degree; ++k)
+                    {
+                        sum = sum + row[k] * factor[k];
+                    }
+                    partial[i] = sum;
+                }
+                source = partial.data();
+            }
+            return partial[0];
+        }
+
+        // Copy the local controls of a cell, using the same ordering as the
+        // cell tensor.
+        void GatherControls(std::array<int, N> const& cell,
+            typename Controls::Type* local) const
+        {
+            std::array<int, N> tuple = cell;
+            for (int i = 0; i < NumLocalControls; i += DegreeP1)
+            {
+                for (int k = 0; k <= Degree; ++k)
+                {
+                    tuple[0] = cell[0] + k;
+                    local[i + k] = (*this->mControls)(tuple.data());
+                }
+                for (int dim = 1; dim < N; ++dim)
+                {
+                    if (++tuple[dim] <= cell[dim] + Degree)
+                    {
+                        break;
+                    }
+                    tuple[dim] = cell[dim];
+                }
+            }
+        }
+
+        // Compute the blended tensor of a cell.  The local controls are
+        // multiplied by the blending matrix along one dimension at a time,
+        // which costs N*(degree+1)^(N+1) operations rather than the
+        // (degree+1)^(2N) operations of computing each element separately.
+        void ComputeCellTensor(std::array<int, N> const& cell,
+            typename Controls::Type* tensor) const
+        {
+            GatherControls(cell, tensor);
+
+            std::array<typename Controls::Type, DegreeP1> column;
+            for (int dim = 0, stride = 1; dim < N; ++dim, stride *= DegreeP1)
+            {
+                int const blockSize = stride * DegreeP1;
+                for (int base = 0; base < NumLocalControls; base += blockSize)
+                {
+                    for (int offset = 0; offset < stride; ++offset)
+                    {
+                        typename Controls::Type* slice = tensor + base + offset;
+                        for (int j = 0; j <= Degree; ++j)
+                        {
+                            column[j] = slice[stride * j];
+                        }
+                        for (int k = 0; k <= Degree; ++k)
+                        {
+                            auto element = this->mCTZero;
+                            for (int j = 0; j <= Degree; ++j)
+                            {
+                                element = element + column[j] * mBlender[k + DegreeP1 * j];
+                            }
+                            slice[stride * k] = element;
+                        }
+                    }
+                }
+            }
+        }
+
+        void InitializeTiles(int tileSize, unsigned int numThreads)
+        {
+            if (tileSize <= 0)
+            {
+                // Choose the largest tile size with at most 4096 cells per
+                // tile.
+                tileSize = 1;
+                while (IntpBSplineUniformPower(tileSize + 1, N) <= 4096)
+                {
+                    ++tileSize;
+                }
+            }
+            mTileSize = std::min(tileSize, *std::max_element(mNumCells.begin(), mNumCells.end()));
+            mNumTileCells = IntpBSplineUniformPower(mTileSize, N);
+
+            mNumTiles = 1;
+            for (int dim = 0; dim < N; ++dim)
+            {
+                mTileGrid[dim] = (mNumCells[dim] + mTileSize - 1) / mTileSize;
+                mNumTiles *= static_cast<size_t>(mTileGrid[dim]);
+            }
+            mTiles.reset(new std::atomic<Tile*>[mNumTiles]);
+            for (size_t i = 0; i < mNumTiles; ++i)
+            {
+                mTiles[i].store(nullptr, std::memory_order_relaxed);
+            }
+
+            if (this->mCacheMode == this->PRE_CACHING)
+            {
+                // Allocate all tiles and then compute the cell tensors.  Each
+                // cell is visited by exactly one thread.
+                mTileStorage.resize(mNumTiles);
+                for (size_t i = 0; i < mNumTiles; ++i)
+                {
+                    mTileStorage[i].reset(new Tile(mNumTileCells));
+                    mTiles[i].store(mTileStorage[i].get(), std::memory_order_relaxed);
+                }
+
+                size_t numCells = 1;
+                for (int dim = 0; dim < N; ++dim)
+                {
+                    numCells *= static_cast<size_t>(mNumCells[dim]);
+                }
+
+                ParallelFor(numCells, 256, numThreads, [this](unsigned int,
+                    size_t begin, size_t end)
+                {
+                    std::array<int, N> cell;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        size_t index = i;
+                        for (int dim = 0; dim < N; ++dim)
+                        {
+                            cell[dim] = static_cast<int>(index % mNumCells[dim]);
+                            index /= mNumCells[dim];
+                        }
+
+                        size_t tileIndex;
+                        int cellIndex;
+                        GetTileLocation(cell, tileIndex, cellIndex);
+                        Tile* tile = mTileStorage[tileIndex].get();
+                        ComputeCellTensor(cell, &tile->tensors[static_cast<size_t>(cellIndex) * NumLocalControls]);
+                        tile->cached[cellIndex].store(true, std::memory_order_relaxed);
+                    }
+                });
+            }
+        }
+
+        void GetTileLocation(std::array<int, N> const& cell, size_t& tileIndex,
+            int& cellIndex) const
+        {
+            tileIndex = 0;
+            cellIndex = 0;
+            size_t tileStride = 1;
+            int cellStride = 1;
+            for (int dim = 0; dim < N; ++dim)
+            {
+                int const q = cell[dim] / mTileSize;
+                tileIndex += tileStride * static_cast<size_t>(q);
+                cellIndex += cellStride * (cell[dim] - q * mTileSize);
+                tileStride *= static_cast<size_t>(mTileGrid[dim]);
+                cellStride *= mTileSize;
+            }
+        }
+
+        // Get the blended tensor of a cell, computing it (and allocating its
+        // tile) on first use.  The atomic flags allow the common case of an
+        // already cached cell to proceed without locking.
+        typename Controls::Type const* GetCellTensor(std::array<int, N> const& cell)
+        {
+            size_t tileIndex;
+            int cellIndex;
+            GetTileLocation(cell, tileIndex, cellIndex);
+
+            Tile* tile = mTiles[tileIndex].load(std::memory_order_acquire);
+            if (!tile)
+            {
+                std::lock_guard<std::mutex> lock(mTileMutex);
+                tile = mTiles[tileIndex].load(std::memory_order_relaxed);
+                if (!tile)
+                {
+                    mTileStorage.push_back(std::unique_ptr<Tile>(new Tile(mNumTileCells)));
+                    tile = mTileStorage.back().get();
+                    mTiles[tileIndex].store(tile, std::memory_order_release);
+                }
+            }
+
+            typename Controls::Type* tensor =
+                &tile->tensors[static_cast<size_t>(cellIndex) * NumLocalControls];
+            if (!tile->cached[cellIndex].load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(tile->mutex);
+                if (!tile->cached[cellIndex].load(std::memory_order_relaxed))
+                {
+                    ComputeCellTensor(cell, tensor);
+                    tile->cached[cellIndex].store(true, std::memory_order_release);
+                }
+            }
+            return tensor;
+        }
+
+        // Parameters for B-spline evaluation.  The constructor inputs and
+        // mValid are members of the base class.
+        std::array<int, N> mNumControls;
+        std::array<int, N> mNumCells;
+        std::array<Real, N> mTMin, mTMax, mDSDT;
+        std::array<Real, DegreeP1 * DegreeP1> mBlender;
+        std::array<std::array<Real, DegreeP1>, DegreeP1> mFalling;
+        std::array<std::array<Real, DegreeP1>, N> mPowerDSDT;
+
+        // Support for the sparse tensor cache.  The mTiles[] pointers are
+        // null until a tile is first used; mTileStorage owns the tiles.
+        int mTileSize, mNumTileCells;
+        std::array<int, N> mTileGrid;
+        size_t mNumTiles;
+        std::unique_ptr<std::atomic<Tile*>[]> mTiles;
+        std::vector<std::unique_ptr<Tile>> mTileStorage;
+        std::mutex mTileMutex;
+    };
+}
+
 #endif
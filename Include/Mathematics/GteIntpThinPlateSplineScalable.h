@@ -0,0 +1,1138 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteGMatrix.h>
+#include <Mathematics/GteMath.h>
+#include <Mathematics/GteVector.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// IntpThinPlateSplineScalable is a thin plate spline interpolator for large
+// point sets in dimensions 2 and 3.  It computes the spline of
+// IntpThinPlateSpline2 (N = 2) or IntpThinPlateSpline3 (N = 3): the same
+// kernel, smoothing parameter, affine term and optional transformation of
+// the inputs to the unit square or cube.  Those classes build and invert the
+// dense system, which costs O(numPoints^3), and each evaluation costs
+// O(numPoints).  This class avoids both.
+//
+// 1. The points are stored in a kd-tree.  The kernel sums are computed by a
+//    treecode.  A cluster of points that is far from the target, measured
+//    by radius/distance < theta, is replaced by (degree+1)^N proxy charges
+//    located at the Chebyshev points of the cluster box; the proxy charges
+//    are obtained by barycentric Lagrange interpolation of the kernel.  Near
+//    clusters are summed directly.  A kernel sum costs O(log(numPoints))
+//    cluster interactions.
+//
+// 2. The saddle-point system
+//      +-          -+ +- -+   +- -+
+//      | K + s*I  B | | a |   | f |
+//      | B^T      0 | | b | = | 0 |
+//      +-          -+ +- -+   +- -+
+//    is solved by restarted GMRES with a two-level domain-decomposition
+//    preconditioner.  Each leaf of the kd-tree is the core of an overlapping
+//    subdomain that consists of the nearest 'subdomainSize' points.  The
+//    thin plate spline system of a subdomain is solved exactly and the
+//    solution is kept at the core points (restricted additive Schwarz).  A
+//    thin plate spline system on 'coarseSize' points spread over the domain
+//    captures the global and affine components.
+//
+// The accuracy of the kernel sums is controlled by 'degree' and 'theta' and
+// the accuracy of the solve is controlled by 'tolerance'.  The memory used
+// by the preconditioner is about leafSize*subdomainSize Real values per leaf
+// plus (coarseSize+N+1)^2 Real values for the coarse system.
+
+namespace gte
+{
+
+template <int N, typename Real>
+class IntpThinPlateSplineScalable
+{
+public:
+    static_assert(N == 2 || N == 3, "Invalid dimension.");
+
+    struct Parameters
+    {
+        Parameters()
+            :
+            leafSize(32),
+            subdomainSize(128),
+            coarseSize(512),
+            degree(N == 2 ? 8 : 5),
+            theta((Real)0.5),
+            tolerance((Real)1e-6),
+            maxIterations(200),
+            restart(50),
+            numThreads(1)
+        {
+        }
+
+        // The maximum number of points in a kd-tree leaf, which is also the
+        // size of a subdomain core.
+        int leafSize;
+
+        // The number of points in an overlapping subdomain.
+        int subdomainSize;
+
+        // The number of points of the coarse system.  If numPoints is at
+        // most coarseSize, the system is solved directly.
+        int coarseSize;
+
+        // The Chebyshev interpolation degree and the acceptance parameter
+        // of the far-field approximations.
+        int degree;
+        Real theta;
+
+        // The GMRES parameters.  The iteration stops when the residual norm
+        // is at most tolerance times the norm of the right-hand side.
+        Real tolerance;
+        int maxIterations;
+        int restart;
+
+        // The number of threads used by the construction and by Evaluate.
+        unsigned int numThreads;
+    };
+
+    // Construction.  Data points are (point,f(point)).  The smoothing
+    // parameter must be nonnegative.
+    IntpThinPlateSplineScalable(int numPoints, Vector<N, Real> const* points,
+        Real const* F, Real smooth, bool transformToUnitCube,
+        Parameters const& parameters = Parameters());
+
+    // Check this after the constructor call to see whether the thin plate
+    // spline coefficients were successfully computed, which requires the
+    // iterative solver to reach the tolerance.  If so, then calls to
+    // operator()(Vector<N,Real>) will work properly.
+    inline bool IsInitialized() const;
+
+    // The number of GMRES iterations and the final relative residual of the
+    // solve.
+    inline int GetNumIterations() const;
+    inline Real GetRelativeResidual() const;
+
+    // Evaluate the interpolator.  If IsInitialized() returns 'false', the
+    // operator will return std::numeric_limits<Real>::max().
+    Real operator()(Vector<N, Real> const& point) const;
+
+    // Evaluate the interpolator at a batch of points using the number of
+    // threads specified by the construction parameters.
+    void Evaluate(int numPoints, Vector<N, Real> const* points,
+        Real* output) const;
+
+    // Compute the functional value a^T*M*a when lambda is zero or
+    // lambda*w^T*(M+lambda*I)*w when lambda is positive.  See the thin plate
+    // splines PDF for a description of these quantities.  The kernel sums
+    // are computed by the treecode.
+    Real ComputeFunctional() const;
+
+private:
+    enum { NumAffine = N + 1 };
+
+    // A node of the kd-tree.  The points of the node are mPoints[i] for
+    // begin <= i < end.  The node is a leaf when child[0] is -1.  The proxy
+    // index is -1 when the node is too small to have proxy charges.
+    struct Node
+    {
+        std::array<Real, N> min, max;
+        int begin, end;
+        int child[2];
+        int proxy;
+    };
+
+    // The core of a subdomain is the leaf mPoints[begin..end-1].  The
+    // indices are those of the subdomain points, the core points first.
+    // The inverse stores the rows of the inverse of the local system for the
+    // core points and the columns for the subdomain points, in row-major
+    // order.  It is empty when the local system is singular.
+    struct Subdomain
+    {
+        int begin, end;
+        std::vector<int> indices;
+        std::vector<Real> inverse;
+    };
+
+    // Kernel(t) = t^2 * log(t^2) when N = 2 and Kernel(t) = -|t| when N = 3,
+    // as a function of t^2.
+    static Real Kernel(Real sqrLength);
+
+    void BuildTree(std::vector<Vector<N, Real>> const& points,
+        std::vector<int>& permutation);
+
+    void FindNearest(Vector<N, Real> const& point, int numNearest,
+        std::vector<int>& indices) const;
+
+    // The barycentric Lagrange polynomials for the Chebyshev points of the
+    // interval [center-halfExtent,center+halfExtent], evaluated at t.
+    void GetLagrange(Real t, Real center, Real halfExtent, Real* L) const;
+
+    void ComputeProxyCharges(std::vector<Real> const& charges,
+        std::vector<Real>& proxyCharges) const;
+
+    Real KernelSum(Vector<N, Real> const& point,
+        std::vector<Real> const& charges,
+        std::vector<Real> const& proxyCharges) const;
+
+    // Support for the iterative solver.  The vectors have numPoints+N+1
+    // elements, the a-coefficients followed by the b-coefficients.
+    void Multiply(std::vector<Real> const& x, std::vector<Real>& y) const;
+    void BuildPreconditioner();
+    void Precondition(std::vector<Real> const& r, std::vector<Real>& z) const;
+    bool Solve(std::vector<Real> const& rhs, std::vector<Real>& x);
+
+    // Input data, transformed and stored in kd-tree order.
+    int mNumPoints;
+    std::vector<Vector<N, Real>> mPoints;
+    Real mSmooth;
+    Parameters mParameters;
+
+    // The kd-tree and the Chebyshev points of the far-field expansions.
+    std::vector<Node> mNodes;
+    int mNumProxyNodes, mNumProxies;
+    std::vector<Real> mChebyshev, mBarycentric;
+
+    // The preconditioner.
+    std::vector<Subdomain> mSubdomains;
+    std::vector<int> mCoarse;
+    GMatrix<Real> mCoarseInverse;
+
+    // Thin plate spline coefficients.  The A[] coefficients are associated
+    // with the Green's functions and the B[] coefficients are associated
+    // with the affine term B[0] + B[1]*x[0] + ... + B[N]*x[N-1].  The proxy
+    // charges of A[] are used for evaluation.
+    std::vector<Real> mA;
+    std::array<Real, NumAffine> mB;
+    std::vector<Real> mProxyCharges;
+
+    // Extent of input data.
+    std::array<Real, N> mMin, mInvRange;
+
+    int mNumIterations;
+    Real mResidual;
+    bool mInitialized;
+};
+
+
+template <int N, typename Real>
+IntpThinPlateSplineScalable<N, Real>::IntpThinPlateSplineScalable(
+    int numPoints, Vector<N, Real> const* points, Real const* F, Real smooth,
+    bool transformToUnitCube, Parameters const& parameters)
+    :
+    mNumPoints(numPoints),
+    mSmooth(smooth),
+    mParameters(parameters),
+    mNumProxyNodes(0),
+    mNumProxies(0),
+    mNumIterations(0),
+    mResidual(std::numeric_limits<Real>::max()),
+    mInitialized(false)
+{
+    if (numPoints < N + 1 || !points || !F || smooth < (Real)0
+        || parameters.leafSize < 1 || parameters.degree < 1
+        || parameters.theta <= (Real)0 || parameters.theta >= (Real)1
+        || parameters.tolerance <= (Real)0 || parameters.restart < 1)
+    {
+        LogError("Invalid input.");
+        return;
+    }
+
+    std::vector<Vector<N, Real>> transformed(numPoints);
+    if (transformToUnitCube)
+    {
+        // Map the input points to the unit cube.  This is not part of the
+        // classical thin-plate spline algorithm because the interpolation
+        // is not invariant to scalings.
+        for (int d = 0; d < N; ++d)
+        {
+            Real dMin = points[0][d], dMax = points[0][d];
+            for (int i = 1; i < numPoints; ++i)
+            {
+                dMin = std::min(dMin, points[i][d]);
+                dMax = std::max(dMax, points[i][d]);
+            }
+            mMin[d] = dMin;
+            mInvRange[d] = ((Real)1) / (dMax - dMin);
+            for (int i = 0; i < numPoints; ++i)
+            {
+                transformed[i][d] = (points[i][d] - mMin[d]) * mInvRange[d];
+            }
+        }
+    }
+    else
+    {
+        // The classical thin-plate spline uses the data as is.
+        mMin.fill((Real)0);
+        mInvRange.fill((Real)1);
+        std::copy(points, points + numPoints, transformed.begin());
+    }
+
+    // The Chebyshev points of the second kind cos(k*pi/degree) and their
+    // barycentric weights (-1)^k, halved for the endpoints.
+    int const degree = mParameters.degree;
+    Real const pi = (Real)GTE_C_PI;
+    mChebyshev.resize(degree + 1);
+    mBarycentric.resize(degree + 1);
+    for (int k = 0; k <= degree; ++k)
+    {
+        mChebyshev[k] = std::cos(pi * static_cast<Real>(k) / static_cast<Real>(degree));
+        mBarycentric[k] = ((k & 1) ? (Real)-1 : (Real)1);
+    }
+    mBarycentric[0] *= (Real)0.5;
+    mBarycentric[degree] *= (Real)0.5;
+    mNumProxies = 1;
+    for (int d = 0; d < N; ++d)
+    {
+        mNumProxies *= degree + 1;
+    }
+
+    std::vector<int> permutation;
+    BuildTree(transformed, permutation);
+    BuildPreconditioner();
+
+    std::vector<Real> rhs(mNumPoints + NumAffine, (Real)0), x;
+    for (int i = 0; i < mNumPoints; ++i)
+    {
+        rhs[i] = F[permutation[i]];
+    }
+
+    if (Solve(rhs, x))
+    {
+        mA.assign(x.begin(), x.begin() + mNumPoints);
+        for (int j = 0; j < NumAffine; ++j)
+        {
+            mB[j] = x[mNumPoints + j];
+        }
+        ComputeProxyCharges(mA, mProxyCharges);
+        mInitialized = true;
+    }
+}
+
+template <int N, typename Real> inline
+bool IntpThinPlateSplineScalable<N, Real>::IsInitialized() const
+{
+    return mInitialized;
+}
+
+template <int N, typename Real> inline
+int IntpThinPlateSplineScalable<N, Real>::GetNumIterations() const
+{
+    return mNumIterations;
+}
+
+template <int N, typename Real> inline
+Real IntpThinPlateSplineScalable<N, Real>::GetRelativeResidual() const
+{
+    return mResidual;
+}
+
+template <int N, typename Real>
+Real IntpThinPlateSplineScalable<N, Real>::operator()(
+    Vector<N, Real> const& point) const
+{
+    if (mInitialized)
+    {
+        // Map the point to the unit cube.
+        Vector<N, Real> p;
+        Real result = mB[0];
+        for (int d = 0; d < N; ++d)
+        {
+            p[d] = (point[d] - mMin[d]) * mInvRange[d];
+            result += mB[d + 1] * p[d];
+        }
+        return result + KernelSum(p, mA, mProxyCharges);
+    }
+
+    return std::numeric_limits<Real>::max();
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::Evaluate(int numPoints,
+    Vector<N, Real> const* points, Real* output) const
+{
+    ParallelFor(static_cast<size_t>(numPoints), 64, mParameters.numThreads,
+        [this, points, output](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            output[i] = operator()(points[i]);
+        }
+    });
+}
+
+template <int N, typename Real>
+Real IntpThinPlateSplineScalable<N, Real>::ComputeFunctional() const
+{
+    if (!mInitialized)
+    {
+        return (Real)0;
+    }
+
+    std::vector<Real> sums(mNumPoints);
+    ParallelFor(static_cast<size_t>(mNumPoints), 64, mParameters.numThreads,
+        [this, &sums](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            sums[i] = KernelSum(mPoints[i], mA, mProxyCharges);
+        }
+    });
+
+    Real functional = (Real)0;
+    for (int i = 0; i < mNumPoints; ++i)
+    {
+        functional += mA[i] * (sums[i] + mSmooth * mA[i]);
+    }
+
+    if (mSmooth > (Real)0)
+    {
+        functional *= mSmooth;
+    }
+
+    return functional;
+}
+
+template <int N, typename Real>
+Real IntpThinPlateSplineScalable<N, Real>::Kernel(Real sqrLength)
+{
+    if (N == 2)
+    {
+        return (sqrLength > (Real)0 ? sqrLength * std::log(sqrLength) : (Real)0);
+    }
+    else
+    {
+        return -std::sqrt(sqrLength);
+    }
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::BuildTree(
+    std::vector<Vector<N, Real>> const& points, std::vector<int>& permutation)
+{
+    permutation.resize(mNumPoints);
+    for (int i = 0; i < mNumPoints; ++i)
+    {
+        permutation[i] = i;
+    }
+
+    // Split the nodes breadth first at the median of the longest extent.
+    Node root;
+    root.begin = 0;
+    root.end = mNumPoints;
+    mNodes.clear();
+    mNodes.push_back(root);
+    for (size_t n = 0; n < mNodes.size(); ++n)
+    {
+        Node& node = mNodes[n];
+        node.child[0] = -1;
+        node.child[1] = -1;
+        for (int d = 0; d < N; ++d)
+        {
+            node.min[d] = points[permutation[node.begin]][d];
+            node.max[d] = node.min[d];
+        }
+        for (int i = node.begin + 1; i < node.end; ++i)
+        {
+            Vector<N, Real> const& p = points[permutation[i]];
+            for (int d = 0; d < N; ++d)
+            {
+                node.min[d] = std::min(node.min[d], p[d]);
+                node.max[d] = std::max(node.max[d], p[d]);
+            }
+        }
+
+        if (node.end - node.begin > mParameters.leafSize)
+        {
+            int axis = 0;
+            for (int d = 1; d < N; ++d)
+            {
+                if (node.max[d] - node.min[d] > node.max[axis] - node.min[axis])
+                {
+                    axis = d;
+                }
+            }
+
+            int const begin = node.begin, end = node.end;
+            int const middle = (begin + end) / 2;
+            std::nth_element(permutation.begin() + begin,
+                permutation.begin() + middle, permutation.begin() + end,
+                [&points, axis](int i0, int i1)
+                {
+                    return points[i0][axis] < points[i1][axis];
+                });
+
+            int const child = static_cast<int>(mNodes.size());
+            node.child[0] = child;
+            node.child[1] = child + 1;
+
+            // The push_back calls invalidate 'node'.
+            Node node0, node1;
+            node0.begin = begin;
+            node0.end = middle;
+            node1.begin = middle;
+            node1.end = end;
+            mNodes.push_back(node0);
+            mNodes.push_back(node1);
+        }
+    }
+
+    // Proxy charges are useful only for nodes with more points than
+    // proxies.
+    mNumProxyNodes = 0;
+    for (auto& node : mNodes)
+    {
+        node.proxy = (node.end - node.begin > mNumProxies ? mNumProxyNodes++ : -1);
+    }
+
+    mPoints.resize(mNumPoints);
+    for (int i = 0; i < mNumPoints; ++i)
+    {
+        mPoints[i] = points[permutation[i]];
+    }
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::FindNearest(
+    Vector<N, Real> const& point, int numNearest,
+    std::vector<int>& indices) const
+{
+    // Best-first search that keeps the nearest points in a max-heap.
+    std::priority_queue<std::pair<Real, int>> heap;
+    std::vector<std::pair<Real, int>> stack;
+    stack.push_back(std::make_pair((Real)0, 0));
+    while (stack.size() > 0)
+    {
+        auto top = stack.back();
+        stack.pop_back();
+        if (static_cast<int>(heap.size()) == numNearest && top.first >= heap.top().first)
+        {
+            continue;
+        }
+
+        Node const& node = mNodes[top.second];
+        if (node.child[0] == -1)
+        {
+            for (int i = node.begin; i < node.end; ++i)
+            {
+                Real sqrDistance = (Real)0;
+                for (int d = 0; d < N; ++d)
+                {
+                    Real diff = point[d] - mPoints[i][d];
+                    sqrDistance += diff * diff;
+                }
+
+                if (static_cast<int>(heap.size()) < numNearest)
+                {
+                    heap.push(std::make_pair(sqrDistance, i));
+                }
+                else if (sqrDistance < heap.top().first)
+                {
+                    heap.pop();
+                    heap.push(std::make_pair(sqrDistance, i));
+                }
+            }
+        }
+        else
+        {
+            std::pair<Real, int> children[2];
+            for (int c = 0; c < 2; ++c)
+            {
+                Node const& child = mNodes[node.child[c]];
+                Real sqrDistance = (Real)0;
+                for (int d = 0; d < N; ++d)
+                {
+                    Real diff = std::max(child.min[d] - point[d],
+                        std::max(point[d] - child.max[d], (Real)0));
+                    sqrDistance += diff * diff;
+                }
+                children[c] = std::make_pair(sqrDistance, node.child[c]);
+            }
+
+            // Push the farther child first so that the nearer one is
+            // visited first.
+            if (children[0].first < children[1].first)
+            {
+                std::swap(children[0], children[1]);
+            }
+            stack.push_back(children[0]);
+            stack.push_back(children[1]);
+        }
+    }
+
+    indices.resize(heap.size());
+    for (size_t i = indices.size(); i > 0; --i)
+    {
+        indices[i - 1] = heap.top().second;
+        heap.pop();
+    }
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::GetLagrange(Real t, Real center,
+    Real halfExtent, Real* L) const
+{
+    int const degree = mParameters.degree;
+    Real sum = (Real)0;
+    for (int k = 0; k <= degree; ++k)
+    {
+        Real diff = t - (center + halfExtent * mChebyshev[k]);
+        if (diff == (Real)0)
+        {
+            // The point is a Chebyshev point.
+            std::fill(L, L + degree + 1, (Real)0);
+            L[k] = (Real)1;
+            return;
+        }
+        L[k] = mBarycentric[k] / diff;
+        sum += L[k];
+    }
+
+    Real invSum = ((Real)1) / sum;
+    for (int k = 0; k <= degree; ++k)
+    {
+        L[k] *= invSum;
+    }
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::ComputeProxyCharges(
+    std::vector<Real> const& charges, std::vector<Real>& proxyCharges) const
+{
+    proxyCharges.assign(static_cast<size_t>(mNumProxyNodes) * mNumProxies, (Real)0);
+    int const numNodes = static_cast<int>(mNodes.size());
+    int const degreeP1 = mParameters.degree + 1;
+    ParallelFor(static_cast<size_t>(numNodes), 1, mParameters.numThreads,
+        [this, &charges, &proxyCharges, degreeP1](unsigned int, size_t begin, size_t end)
+    {
+        std::vector<Real> L(N * degreeP1), weights(mNumProxies);
+        for (size_t n = begin; n < end; ++n)
+        {
+            Node const& node = mNodes[n];
+            if (node.proxy < 0)
+            {
+                continue;
+            }
+
+            // Each charge is distributed to the proxies with the weights
+            // L[0][k0]*...*L[N-1][k{N-1}].
+            Real* proxy = &proxyCharges[static_cast<size_t>(node.proxy) * mNumProxies];
+            for (int i = node.begin; i < node.end; ++i)
+            {
+                for (int d = 0; d < N; ++d)
+                {
+                    Real center = (Real)0.5 * (node.min[d] + node.max[d]);
+                    Real halfExtent = (Real)0.5 * (node.max[d] - node.min[d]);
+                    GetLagrange(mPoints[i][d], center, halfExtent, &L[d * degreeP1]);
+                }
+
+                weights[0] = charges[i];
+                for (int d = 0, size = 1; d < N; ++d, size *= degreeP1)
+                {
+                    for (int k = degreeP1 - 1; k >= 0; --k)
+                    {
+                        Real const factor = L[d * degreeP1 + k];
+                        for (int j = 0; j < size; ++j)
+                        {
+                            weights[size * k + j] = weights[j] * factor;
+                        }
+                    }
+                }
+
+                for (int j = 0; j < mNumProxies; ++j)
+                {
+                    proxy[j] += weights[j];
+                }
+            }
+        }
+    });
+}
+
+template <int N, typename Real>
+Real IntpThinPlateSplineScalable<N, Real>::KernelSum(
+    Vector<N, Real> const& point, std::vector<Real> const& charges,
+    std::vector<Real> const& proxyCharges) const
+{
+    int const degreeP1 = mParameters.degree + 1;
+    Real const sqrTheta = mParameters.theta * mParameters.theta;
+    std::array<std::vector<Real>, N> sqrDiff;
+    for (int d = 0; d < N; ++d)
+    {
+        sqrDiff[d].resize(degreeP1);
+    }
+
+    Real result = (Real)0;
+    int stack[128];
+    int top = 0;
+    stack[0] = 0;
+    while (top >= 0)
+    {
+        Node const& node = mNodes[stack[top--]];
+
+        if (node.proxy >= 0)
+        {
+            // Use the proxy charges when the node is well separated from
+            // the point.
+            Real sqrDistance = (Real)0, sqrRadius = (Real)0;
+            for (int d = 0; d < N; ++d)
+            {
+                Real center = (Real)0.5 * (node.min[d] + node.max[d]);
+                Real halfExtent = (Real)0.5 * (node.max[d] - node.min[d]);
+                Real diff = point[d] - center;
+                sqrDistance += diff * diff;
+                sqrRadius += halfExtent * halfExtent;
+            }
+
+            if (sqrRadius < sqrTheta * sqrDistance)
+            {
+                for (int d = 0; d < N; ++d)
+                {
+                    Real center = (Real)0.5 * (node.min[d] + node.max[d]);
+                    Real halfExtent = (Real)0.5 * (node.max[d] - node.min[d]);
+                    for (int k = 0; k < degreeP1; ++k)
+                    {
+                        Real diff = point[d] - (center + halfExtent * mChebyshev[k]);
+                        sqrDiff[d][k] = diff * diff;
+                    }
+                }
+
+                Real const* proxy = &proxyCharges[static_cast<size_t>(node.proxy) * mNumProxies];
+                std::array<int, N> k;
+                k.fill(0);
+                for (int j = 0; j < mNumProxies; ++j)
+                {
+                    Real sqrLength = (Real)0;
+                    for (int d = 0; d < N; ++d)
+                    {
+                        sqrLength += sqrDiff[d][k[d]];
+                    }
+                    result += Kernel(sqrLength) * proxy[j];
+
+                    for (int d = 0; d < N; ++d)
+                    {
+                        if (++k[d] < degreeP1)
+                        {
+                            break;
+                        }
+                        k[d] = 0;
+                    }
+                }
+                continue;
+            }
+        }
+
+        if (node.child[0] == -1)
+        {
+            for (int i = node.begin; i < node.end; ++i)
+            {
+                Real sqrLength = (Real)0;
+                for (int d = 0; d < N; ++d)
+                {
+                    Real diff = point[d] - mPoints[i][d];
+                    sqrLength += diff * diff;
+                }
+                result += Kernel(sqrLength) * charges[i];
+            }
+        }
+        else
+        {
+            stack[++top] = node.child[0];
+            stack[++top] = node.child[1];
+        }
+    }
+    return result;
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::Multiply(
+    std::vector<Real> const& x, std::vector<Real>& y) const
+{
+    std::vector<Real> proxyCharges;
+    ComputeProxyCharges(x, proxyCharges);
+
+    // The first x-block is a[], the second is b[].  The y-block for the
+    // points is (K + s*I)*a + B*b.
+    Real const* b = &x[mNumPoints];
+    ParallelFor(static_cast<size_t>(mNumPoints), 64, mParameters.numThreads,
+        [this, &x, &y, &proxyCharges, b](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            Real result = KernelSum(mPoints[i], x, proxyCharges) + mSmooth * x[i] + b[0];
+            for (int d = 0; d < N; ++d)
+            {
+                result += b[d + 1] * mPoints[i][d];
+            }
+            y[i] = result;
+        }
+    });
+
+    // The y-block for the affine constraints is B^T*a.
+    for (int j = 0; j < NumAffine; ++j)
+    {
+        y[mNumPoints + j] = (Real)0;
+    }
+    for (int i = 0; i < mNumPoints; ++i)
+    {
+        y[mNumPoints] += x[i];
+        for (int d = 0; d < N; ++d)
+        {
+            y[mNumPoints + d + 1] += x[i] * mPoints[i][d];
+        }
+    }
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::BuildPreconditioner()
+{
+    // Build the local system of the specified points, A = M + lambda*I with
+    // the affine border, and invert it.
+    auto invert = [this](std::vector<int> const& indices, bool& invertible)
+    {
+        int const numLocal = static_cast<int>(indices.size());
+        GMatrix<Real> AMat(numLocal + NumAffine, numLocal + NumAffine);
+        for (int row = 0; row < numLocal; ++row)
+        {
+            Vector<N, Real> const& p = mPoints[indices[row]];
+            for (int col = 0; col < numLocal; ++col)
+            {
+                if (row == col)
+                {
+                    AMat(row, col) = mSmooth;
+                }
+                else
+                {
+                    Vector<N, Real> const& q = mPoints[indices[col]];
+                    Real sqrLength = (Real)0;
+                    for (int d = 0; d < N; ++d)
+                    {
+                        Real diff = p[d] - q[d];
+                        sqrLength += diff * diff;
+                    }
+                    AMat(row, col) = Kernel(sqrLength);
+                }
+            }
+
+            AMat(row, numLocal) = (Real)1;
+            AMat(numLocal, row) = (Real)1;
+            for (int d = 0; d < N; ++d)
+            {
+                AMat(row, numLocal + d + 1) = p[d];
+                AMat(numLocal + d + 1, row) = p[d];
+            }
+        }
+        return Inverse(AMat, &invertible);
+    };
+
+    // The coarse system uses points spread over the domain, which the
+    // kd-tree order provides.
+    int const numCoarse = std::min(mParameters.coarseSize, mNumPoints);
+    mCoarse.resize(numCoarse);
+    for (int i = 0; i < numCoarse; ++i)
+    {
+        mCoarse[i] = static_cast<int>((static_cast<int64_t>(i) * mNumPoints) / numCoarse);
+    }
+
+    bool invertible = false;
+    if (numCoarse >= NumAffine)
+    {
+        mCoarseInverse = invert(mCoarse, invertible);
+    }
+    if (!invertible)
+    {
+        mCoarse.clear();
+    }
+
+    // The coarse system is the full system when it contains all points.
+    mSubdomains.clear();
+    if (numCoarse == mNumPoints && invertible)
+    {
+        return;
+    }
+
+    for (auto const& node : mNodes)
+    {
+        if (node.child[0] == -1)
+        {
+            Subdomain subdomain;
+            subdomain.begin = node.begin;
+            subdomain.end = node.end;
+            mSubdomains.push_back(subdomain);
+        }
+    }
+
+    int const subdomainSize = std::min(mNumPoints,
+        std::max(mParameters.subdomainSize, mParameters.leafSize));
+    ParallelFor(mSubdomains.size(), 1, mParameters.numThreads,
+        [this, subdomainSize, &invert](unsigned int, size_t begin, size_t end)
+    {
+        std::vector<int> nearest;
+        for (size_t s = begin; s < end; ++s)
+        {
+            Subdomain& subdomain = mSubdomains[s];
+
+            // The core points are first, followed by the nearest points to
+            // the center of the core that are not in the core.
+            Vector<N, Real> center;
+            for (int d = 0; d < N; ++d)
+            {
+                center[d] = (Real)0;
+            }
+            for (int i = subdomain.begin; i < subdomain.end; ++i)
+            {
+                subdomain.indices.push_back(i);
+                center += mPoints[i];
+            }
+            center /= static_cast<Real>(subdomain.end - subdomain.begin);
+
+            FindNearest(center, subdomainSize, nearest);
+            for (auto i : nearest)
+            {
+                if (static_cast<int>(subdomain.indices.size()) == subdomainSize)
+                {
+                    break;
+                }
+                if (i < subdomain.begin || i >= subdomain.end)
+                {
+                    subdomain.indices.push_back(i);
+                }
+            }
+
+            bool localInvertible = false;
+            GMatrix<Real> invAMat = invert(subdomain.indices, localInvertible);
+            if (localInvertible)
+            {
+                int const numCore = subdomain.end - subdomain.begin;
+                int const numLocal = static_cast<int>(subdomain.indices.size());
+                subdomain.inverse.resize(static_cast<size_t>(numCore) * numLocal);
+                for (int row = 0; row < numCore; ++row)
+                {
+                    for (int col = 0; col < numLocal; ++col)
+                    {
+                        subdomain.inverse[col + numLocal * row] = invAMat(row, col);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <int N, typename Real>
+void IntpThinPlateSplineScalable<N, Real>::Precondition(
+    std::vector<Real> const& r, std::vector<Real>& z) const
+{
+    std::fill(z.begin(), z.end(), (Real)0);
+
+    // Restricted additive Schwarz:  solve the local systems with zero
+    // affine residual and keep the solutions at the core points.
+    ParallelFor(mSubdomains.size(), 16, mParameters.numThreads,
+        [this, &r, &z](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t s = begin; s < end; ++s)
+        {
+            Subdomain const& subdomain = mSubdomains[s];
+            if (subdomain.inverse.size() == 0)
+            {
+                continue;
+            }
+
+            int const numLocal = static_cast<int>(subdomain.indices.size());
+            Real const* inverse = subdomain.inverse.data();
+            for (int i = subdomain.begin; i < subdomain.end; ++i, inverse += numLocal)
+            {
+                Real sum = (Real)0;
+                for (int col = 0; col < numLocal; ++col)
+                {
+                    sum += inverse[col] * r[subdomain.indices[col]];
+                }
+                z[i] = sum;
+            }
+        }
+    });
+
+    // The coarse correction, which also provides the affine coefficients.
+    int const numCoarse = static_cast<int>(mCoarse.size());
+    if (numCoarse > 0)
+    {
+        std::vector<Real> rc(numCoarse + NumAffine);
+        for (int i = 0; i < numCoarse; ++i)
+        {
+            rc[i] = r[mCoarse[i]];
+        }
+        for (int j = 0; j < NumAffine; ++j)
+        {
+            rc[numCoarse + j] = r[mNumPoints + j];
+        }
+
+        for (int row = 0; row < numCoarse + NumAffine; ++row)
+        {
+            Real sum = (Real)0;
+            for (int col = 0; col < numCoarse + NumAffine; ++col)
+            {
+                sum += mCoarseInverse(row, col) * rc[col];
+            }
+
+            if (row < numCoarse)
+            {
+                z[mCoarse[row]] += sum;
+            }
+            else
+            {
+                z[mNumPoints + row - numCoarse] = sum;
+            }
+        }
+    }
+}
+
+template <int N, typename Real>
+bool IntpThinPlateSplineScalable<N, Real>::Solve(std::vector<Real> const& rhs,
+    std::vector<Real>& x)
+{
+    // Restarted GMRES with right preconditioning, x = M*y.
+    size_t const size = rhs.size();
+    int const restart = mParameters.restart;
+    Real const tolerance = mParameters.tolerance;
+    auto dot = [size](std::vector<Real> const& u, std::vector<Real> const& v)
+    {
+        Real sum = (Real)0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            sum += u[i] * v[i];
+        }
+        return sum;
+    };
+
+    x.assign(size, (Real)0);
+    Real const rhsNorm = std::sqrt(dot(rhs, rhs));
+    mNumIterations = 0;
+    if (rhsNorm == (Real)0)
+    {
+        mResidual = (Real)0;
+        return true;
+    }
+
+    std::vector<std::vector<Real>> V(restart + 1, std::vector<Real>(size));
+    std::vector<Real> H((restart + 1) * restart), cs(restart), sn(restart);
+    std::vector<Real> g(restart + 1), w(size), z(size);
+    for (;;)
+    {
+        // Compute the true residual at the start of a cycle.
+        Multiply(x, w);
+        for (size_t i = 0; i < size; ++i)
+        {
+            V[0][i] = rhs[i] - w[i];
+        }
+        Real beta = std::sqrt(dot(V[0], V[0]));
+        mResidual = beta / rhsNorm;
+        if (mResidual <= tolerance || mNumIterations >= mParameters.maxIterations)
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            V[0][i] /= beta;
+        }
+        std::fill(g.begin(), g.end(), (Real)0);
+        g[0] = beta;
+
+        int numColumns = 0;
+        while (numColumns < restart && mNumIterations < mParameters.maxIterations)
+        {
+            int const j = numColumns++;
+            ++mNumIterations;
+
+            // Arnoldi step with modified Gram-Schmidt.
+            Precondition(V[j], z);
+            Multiply(z, w);
+            for (int i = 0; i <= j; ++i)
+            {
+                Real h = dot(w, V[i]);
+                H[i * restart + j] = h;
+                for (size_t k = 0; k < size; ++k)
+                {
+                    w[k] -= h * V[i][k];
+                }
+            }
+            Real hNext = std::sqrt(dot(w, w));
+            if (hNext > (Real)0)
+            {
+                for (size_t k = 0; k < size; ++k)
+                {
+                    V[j + 1][k] = w[k] / hNext;
+                }
+            }
+
+            // Apply the previous Givens rotations to the new column and
+            // compute the rotation that eliminates hNext.
+            for (int i = 0; i < j; ++i)
+            {
+                Real h0 = H[i * restart + j], h1 = H[(i + 1) * restart + j];
+                H[i * restart + j] = cs[i] * h0 + sn[i] * h1;
+                H[(i + 1) * restart + j] = -sn[i] * h0 + cs[i] * h1;
+            }
+            Real hjj = H[j * restart + j];
+            Real length = std::sqrt(hjj * hjj + hNext * hNext);
+            if (length == (Real)0)
+            {
+                --numColumns;
+                break;
+            }
+            cs[j] = hjj / length;
+            sn[j] = hNext / length;
+            H[j * restart + j] = length;
+            g[j + 1] = -sn[j] * g[j];
+            g[j] = cs[j] * g[j];
+
+            if (std::abs(g[j + 1]) <= tolerance * rhsNorm || hNext == (Real)0)
+            {
+                break;
+            }
+        }
+
+        if (numColumns == 0)
+        {
+            break;
+        }
+
+        // Solve the upper triangular system H*y = g and update
+        // x += M*(V*y).
+        std::vector<Real> y(numColumns);
+        for (int i = numColumns - 1; i >= 0; --i)
+        {
+            Real sum = g[i];
+            for (int k = i + 1; k < numColumns; ++k)
+            {
+                sum -= H[i * restart + k] * y[k];
+            }
+            y[i] = sum / H[i * restart + i];
+        }
+
+        std::fill(w.begin(), w.end(), (Real)0);
+        for (int i = 0; i < numColumns; ++i)
+        {
+            for (size_t k = 0; k < size; ++k)
+            {
+                w[k] += y[i] * V[i][k];
+            }
+        }
+        Precondition(w, z);
+        for (size_t k = 0; k < size; ++k)
+        {
+            x[k] += z[k];
+        }
+    }
+
+    return mResidual <= tolerance;
+}
+
+
+}
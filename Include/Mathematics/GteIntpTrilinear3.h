@@ -8,6 +8,10 @@
 #pragma once
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
+#include <array>
+#include <vector>
 
 // The interpolator is for uniformly spaced(x,y z)-values.  The input samples
 // must be stored in lexicographical order to represent f(x,y,z); that is,
@@ -54,7 +58,62 @@ public:
     Real operator()(int xOrder, int yOrder, int zOrder, Real x, Real y,
         Real z) const;
 
+    // Evaluate the function or its derivatives at the points (x[i],y[i],z[i])
+    // for 0 <= i < numPoints, storing the results in output[i].  The results
+    // are the same as those of the operator()(...) calls.  Consecutive points
+    // in the same boundary cell share the gathered 2x2x2 block of clamped
+    // samples; interior cells are read in place.  Coherent inputs (for
+    // example, points sorted along scan lines) are evaluated fastest.  The points are distributed over 'numThreads' threads.
+    void Evaluate(int xOrder, int yOrder, int zOrder, size_t numPoints,
+        Real const* x, Real const* y, Real const* z, Real* output,
+        unsigned int numThreads = 1) const;
+
+    // Resample the function (or a derivative) on an output grid of size
+    // xSize-by-ySize-by-zSize that is related to the input domain by an
+    // affine map.  The output[i + xSize*(j + ySize*k)] is the function at
+    // (x,y,z) = origin + i*xStep + j*yStep + k*zStep.  The z-slabs of the
+    // output are distributed over 'numThreads' threads.  When the output
+    // rows are parallel to the x-axis (xStep[1] = xStep[2] = 0), the samples
+    // are blended in y and z once per row, leaving a 2-tap filter in x for
+    // each output sample.
+    void Resample(int xOrder, int yOrder, int zOrder, int xSize, int ySize,
+        int zSize, std::array<Real, 3> const& origin,
+        std::array<Real, 3> const& xStep, std::array<Real, 3> const& yStep,
+        std::array<Real, 3> const& zStep, Real* output,
+        unsigned int numThreads = 1) const;
+
 private:
+    // Support for batch evaluation.  The samples are processed in packets of
+    // NumLanes samples.  The index and weight computations are loops over
+    // the lanes of a packet, so the compiler can vectorize them.
+    enum { NumLanes = 16 };
+
+    // The last gathered 2x2x2 block of samples of a boundary cell,
+    // D[col + 2*(row + 2*slice)].
+    struct Cell
+    {
+        int ix, iy, iz;
+        Real D[8];
+    };
+
+    // Compute the coefficients of the weight polynomials for a derivative
+    // order, weight[row](d) = sum_p coeff[row][p]*d^p, including the
+    // derivative multiplier.  The function returns 'false' when the order
+    // is not supported by the interpolator.
+    bool GetWeightPolynomials(int order, Real invSpacing, Real coeff[2][2]) const;
+
+    static void GetWeights(int numLanes, Real const* t, Real tMin,
+        Real invSpacing, int bound, Real const coeff[2][2], int* index,
+        Real weight[2][NumLanes]);
+
+    void EvaluatePacket(int numLanes, Real const* x, Real const* y,
+        Real const* z, Real const coeff[3][2][2], Cell& cell,
+        Real* output) const;
+
+    void ResampleAlignedRow(int xSize, std::array<Real, 3> const& start,
+        Real xStep, Real const coeff[3][2][2], std::vector<Real>& line,
+        Real* output) const;
+
     int mXBound, mYBound, mZBound, mQuantity;
     Real mXMin, mXMax, mXSpacing, mInvXSpacing;
     Real mYMin, mYMax, mYSpacing, mInvYSpacing;
@@ -436,5 +495,271 @@ Real IntpTrilinear3<Real>::operator()(int xOrder, int yOrder, int zOrder,
     return result;
 }
 
+template <typename Real>
+void IntpTrilinear3<Real>::Evaluate(int xOrder, int yOrder, int zOrder,
+    size_t numPoints, Real const* x, Real const* y, Real const* z,
+    Real* output, unsigned int numThreads) const
+{
+    Real coeff[3][2][2];
+    if (!GetWeightPolynomials(xOrder, mInvXSpacing, coeff[0])
+        || !GetWeightPolynomials(yOrder, mInvYSpacing, coeff[1])
+        || !GetWeightPolynomials(zOrder, mInvZSpacing, coeff[2]))
+    {
+        std::fill(output, output + numPoints, (Real)0);
+        return;
+    }
+
+    ParallelFor(numPoints, 256, numThreads,
+        [this, x, y, z, output, &coeff](unsigned int, size_t begin, size_t end)
+    {
+        Cell cell;
+        cell.ix = -1;
+        for (size_t i = begin; i < end; i += NumLanes)
+        {
+            int numLanes = static_cast<int>(std::min(static_cast<size_t>(NumLanes), end - i));
+            EvaluatePacket(numLanes, x + i, y + i, z + i, coeff, cell, output + i);
+        }
+    });
+}
+
+template <typename Real>
+void IntpTrilinear3<Real>::Resample(int xOrder, int yOrder, int zOrder,
+    int xSize, int ySize, int zSize, std::array<Real, 3> const& origin,
+    std::array<Real, 3> const& xStep, std::array<Real, 3> const& yStep,
+    std::array<Real, 3> const& zStep, Real* output,
+    unsigned int numThreads) const
+{
+    size_t const rowSize = static_cast<size_t>(xSize);
+    size_t const sliceSize = rowSize * static_cast<size_t>(ySize);
+    Real coeff[3][2][2];
+    if (!GetWeightPolynomials(xOrder, mInvXSpacing, coeff[0])
+        || !GetWeightPolynomials(yOrder, mInvYSpacing, coeff[1])
+        || !GetWeightPolynomials(zOrder, mInvZSpacing, coeff[2]))
+    {
+        std::fill(output, output + sliceSize * static_cast<size_t>(zSize), (Real)0);
+        return;
+    }
+
+    bool const alignedRows = (xStep[1] == (Real)0 && xStep[2] == (Real)0);
+    ParallelFor(static_cast<size_t>(zSize), 1, numThreads,
+        [this, xSize, ySize, rowSize, sliceSize, alignedRows, &origin, &xStep,
+        &yStep, &zStep, output, &coeff](unsigned int, size_t kBegin, size_t kEnd)
+    {
+        Real x[NumLanes], y[NumLanes], z[NumLanes];
+        Cell cell;
+        cell.ix = -1;
+        std::vector<Real> line;
+        for (size_t k = kBegin; k < kEnd; ++k)
+        {
+            Real const fk = static_cast<Real>(k);
+            for (int j = 0; j < ySize; ++j)
+            {
+                Real const fj = static_cast<Real>(j);
+                std::array<Real, 3> start;
+                for (int d = 0; d < 3; ++d)
+                {
+                    start[d] = origin[d] + fj * yStep[d] + fk * zStep[d];
+                }
+
+                Real* row = output + rowSize * static_cast<size_t>(j) + sliceSize * k;
+                if (alignedRows)
+                {
+                    ResampleAlignedRow(xSize, start, xStep[0], coeff, line, row);
+                    continue;
+                }
+
+                for (int i = 0; i < xSize; i += NumLanes)
+                {
+                    int numLanes = std::min(static_cast<int>(NumLanes), xSize - i);
+                    for (int lane = 0; lane < numLanes; ++lane)
+                    {
+                        Real const fi = static_cast<Real>(i + lane);
+                        x[lane] = start[0] + fi * xStep[0];
+                        y[lane] = start[1] + fi * xStep[1];
+                        z[lane] = start[2] + fi * xStep[2];
+                    }
+                    EvaluatePacket(numLanes, x, y, z, coeff, cell, row + i);
+                }
+            }
+        }
+    });
+}
+
+template <typename Real>
+bool IntpTrilinear3<Real>::GetWeightPolynomials(int order, Real invSpacing,
+    Real coeff[2][2]) const
+{
+    // The weights are P = M*U, where U = (1,d) for the function and
+    // U = (0,1) for the first derivative.
+    switch (order)
+    {
+    case 0:
+        for (int row = 0; row < 2; ++row)
+        {
+            coeff[row][0] = mBlend[row][0];
+            coeff[row][1] = mBlend[row][1];
+        }
+        return true;
+    case 1:
+        for (int row = 0; row < 2; ++row)
+        {
+            coeff[row][0] = mBlend[row][1] * invSpacing;
+            coeff[row][1] = (Real)0;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename Real>
+void IntpTrilinear3<Real>::GetWeights(int numLanes, Real const* t, Real tMin,
+    Real invSpacing, int bound, Real const coeff[2][2], int* index,
+    Real weight[2][NumLanes])
+{
+    Real d[NumLanes];
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        Real tIndex = (t[lane] - tMin) * invSpacing;
+        int i = std::min(std::max(static_cast<int>(tIndex), 0), bound - 1);
+        index[lane] = i;
+        d[lane] = tIndex - i;
+    }
+
+    for (int row = 0; row < 2; ++row)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            weight[row][lane] = coeff[row][0] + coeff[row][1] * d[lane];
+        }
+    }
+}
+
+template <typename Real>
+void IntpTrilinear3<Real>::EvaluatePacket(int numLanes, Real const* x,
+    Real const* y, Real const* z, Real const coeff[3][2][2], Cell& cell,
+    Real* output) const
+{
+    int ix[NumLanes], iy[NumLanes], iz[NumLanes];
+    Real P[2][NumLanes], Q[2][NumLanes], R[2][NumLanes];
+    GetWeights(numLanes, x, mXMin, mInvXSpacing, mXBound, coeff[0], ix, P);
+    GetWeights(numLanes, y, mYMin, mInvYSpacing, mYBound, coeff[1], iy, Q);
+    GetWeights(numLanes, z, mZMin, mInvZSpacing, mZBound, coeff[2], iz, R);
+
+    size_t const xyBound = static_cast<size_t>(mXBound) * static_cast<size_t>(mYBound);
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        // The samples of an interior cell are read in place.  The samples
+        // of a boundary cell are gathered with clamping, and the gathered
+        // block is reused while consecutive samples stay in that cell.
+        Real const* D;
+        size_t rowStride, sliceStride;
+        if (ix[lane] + 1 < mXBound && iy[lane] + 1 < mYBound && iz[lane] + 1 < mZBound)
+        {
+            D = &mF[ix[lane] + mXBound * (iy[lane] + static_cast<size_t>(mYBound) * iz[lane])];
+            rowStride = static_cast<size_t>(mXBound);
+            sliceStride = xyBound;
+        }
+        else
+        {
+            if (ix[lane] != cell.ix || iy[lane] != cell.iy || iz[lane] != cell.iz)
+            {
+                // Gather the 2x2x2 subimage containing (x,y,z).
+                cell.ix = ix[lane];
+                cell.iy = iy[lane];
+                cell.iz = iz[lane];
+                int const x1 = std::min(cell.ix + 1, mXBound - 1);
+                for (int slice = 0; slice < 2; ++slice)
+                {
+                    int zClamp = std::min(cell.iz + slice, mZBound - 1);
+                    for (int row = 0; row < 2; ++row)
+                    {
+                        int yClamp = std::min(cell.iy + row, mYBound - 1);
+                        Real const* F = &mF[mXBound * (yClamp + mYBound * zClamp)];
+                        cell.D[2 * (row + 2 * slice)] = F[cell.ix];
+                        cell.D[1 + 2 * (row + 2 * slice)] = F[x1];
+                    }
+                }
+            }
+            D = cell.D;
+            rowStride = 2;
+            sliceStride = 4;
+        }
+
+        Real result = (Real)0;
+        for (int slice = 0; slice < 2; ++slice)
+        {
+            Real sum = (Real)0;
+            for (int row = 0; row < 2; ++row)
+            {
+                Real const* block = D + rowStride * row + sliceStride * slice;
+                sum += Q[row][lane] * (P[0][lane] * block[0] + P[1][lane] * block[1]);
+            }
+            result += R[slice][lane] * sum;
+        }
+        output[lane] = result;
+    }
+}
+
+template <typename Real>
+void IntpTrilinear3<Real>::ResampleAlignedRow(int xSize,
+    std::array<Real, 3> const& start, Real xStep, Real const coeff[3][2][2],
+    std::vector<Real>& line, Real* output) const
+{
+    // The y- and z-weights are constant along the row.
+    int iy, iz;
+    Real Q[2][NumLanes], R[2][NumLanes];
+    GetWeights(1, &start[1], mYMin, mInvYSpacing, mYBound, coeff[1], &iy, Q);
+    GetWeights(1, &start[2], mZMin, mInvZSpacing, mZBound, coeff[2], &iz, R);
+
+    // The x-index is a nondecreasing function of x, so the row touches the
+    // cells between those of its first and last samples.
+    Real xEnds[2] = { start[0], start[0] + static_cast<Real>(xSize - 1) * xStep };
+    int ixEnds[2];
+    Real unused[2][NumLanes];
+    GetWeights(2, xEnds, mXMin, mInvXSpacing, mXBound, coeff[0], ixEnds, unused);
+    int const cMin = std::min(ixEnds[0], ixEnds[1]);
+    int const cMax = std::min(std::max(ixEnds[0], ixEnds[1]) + 1, mXBound - 1);
+
+    // Blend the samples in y and z for the columns used by the row.
+    line.resize(mXBound);
+    for (int c = cMin; c <= cMax; ++c)
+    {
+        line[c] = (Real)0;
+    }
+    for (int slice = 0; slice < 2; ++slice)
+    {
+        int zClamp = std::min(iz + slice, mZBound - 1);
+        for (int row = 0; row < 2; ++row)
+        {
+            int yClamp = std::min(iy + row, mYBound - 1);
+            Real const weight = Q[row][0] * R[slice][0];
+            Real const* F = &mF[mXBound * (yClamp + mYBound * zClamp)];
+            for (int c = cMin; c <= cMax; ++c)
+            {
+                line[c] += weight * F[c];
+            }
+        }
+    }
+
+    // Apply the 2-tap x-filter to the blended line.
+    Real x[NumLanes], P[2][NumLanes];
+    int ix[NumLanes];
+    for (int i = 0; i < xSize; i += NumLanes)
+    {
+        int numLanes = std::min(static_cast<int>(NumLanes), xSize - i);
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            x[lane] = start[0] + static_cast<Real>(i + lane) * xStep;
+        }
+        GetWeights(numLanes, x, mXMin, mInvXSpacing, mXBound, coeff[0], ix, P);
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            int const x1 = std::min(ix[lane] + 1, mXBound - 1);
+            output[i + lane] = P[0][lane] * line[ix[lane]] + P[1][lane] * line[x1];
+        }
+    }
+}
+
 
 }
@@ -8,10 +8,13 @@
 #pragma once
 
 #include <Mathematics/GteCholeskyDecomposition.h>
+#include <Mathematics/GteSparseNormalEquations.h>
 #include <functional>
+#include <memory>
 
 // See GteGaussNewtonMinimizer.h for a formulation of the minimization
-// problem and how Levenberg-Marquardt relates to Gauss-Newton.
+// problem and how Levenberg-Marquardt relates to Gauss-Newton, and see
+// GteSparseNormalEquations.h for the sparse mode of the minimizer.
 
 namespace gte
 {
@@ -29,6 +32,8 @@ namespace gte
         typedef std::function<void(DVector const&, RVector&)> FFunction;
         typedef std::function<void(DVector const&, JMatrix&)> JFunction;
         typedef std::function<void(DVector const&, JTJMatrix&, JTFVector&)> JPlusFunction;
+        typedef typename SparseNormalEquations<Real>::Block SparseBlock;
+        typedef typename SparseNormalEquations<Real>::BlockFunction SparseBlockFunction;
 
         // NOTE: The C++ compiler for Microsoft Visual Studio 12.0.21005.1 REL
         // (MSVS 2013) appears to have a bug regarding passing std::function
@@ -81,6 +86,26 @@ namespace gte
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
         }
 
+        // Create the minimizer that computes F(p) and J(p) by blocks and
+        // solves the normal equations in sparse form.  The blocks are
+        // evaluated by 'numThreads' threads.
+        LevenbergMarquardtMinimizer(int numPDimensions, std::vector<SparseBlock> const& blocks,
+            SparseBlockFunction const& blockFunction, unsigned int numThreads = 1)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(0),
+            mJ(0, 0),
+            mJTJ(0, 0),
+            mNegJTF(mNumPDimensions),
+            mDecomposer(mNumPDimensions),
+            mSparse(std::make_unique<SparseNormalEquations<Real>>(
+                numPDimensions, blocks, blockFunction, numThreads)),
+            mUseJFunction(false)
+        {
+            mNumFDimensions = mSparse->GetNumFDimensions();
+            mF.SetSize(mNumFDimensions);
+        }
+
         // Disallow copy, assignment and move semantics.
         LevenbergMarquardtMinimizer(LevenbergMarquardtMinimizer const&) = delete;
         LevenbergMarquardtMinimizer& operator=(LevenbergMarquardtMinimizer const&) = delete;
@@ -90,6 +115,11 @@ namespace gte
         inline int GetNumPDimensions() const { return mNumPDimensions; }
         inline int GetNumFDimensions() const { return mNumFDimensions; }
 
+        // Access to the sparse solver, which is null unless the minimizer
+        // was created with the blocks constructor.  Use it to set the
+        // conjugate gradient parameters.
+        inline SparseNormalEquations<Real>* GetSparseSolver() const { return mSparse.get(); }
+
         // The lambda is positive, the multiplier is positive, and the initial
         // guess for the p-parameter is p0.  Typical choices are lambda =
         // 0.001 and multiplier = 10.  TODO: Explain lambda in more detail,
@@ -134,7 +164,7 @@ namespace gte
             errorDifferenceTolerance = std::max(errorDifferenceTolerance, (Real)0);
 
             // Compute the initial error.
-            mFFunction(p0, mF);
+            ComputeF(p0);
             result.minError = Dot(mF, mF);
 
             // Do the Levenberg-Marquart iterations.
@@ -200,8 +230,26 @@ namespace gte
         }
 
     private:
+        void ComputeF(DVector const& p)
+        {
+            if (mSparse)
+            {
+                mSparse->ComputeF(p, mF);
+            }
+            else
+            {
+                mFFunction(p, mF);
+            }
+        }
+
         void ComputeLinearSystemInputs(DVector const& pCurrent, Real lambda)
         {
+            if (mSparse)
+            {
+                mSparse->ComputeLinearSystemInputs(pCurrent, lambda, mF, mNegJTF);
+                return;
+            }
+
             if (mUseJFunction)
             {
                 mJFunction(pCurrent, mJ);
@@ -226,6 +274,24 @@ namespace gte
             }
         }
 
+        // Solve the normal equations.  On success, mNegJTF stores the
+        // update to the parameters.
+        bool SolveLinearSystem()
+        {
+            if (mSparse)
+            {
+                return mSparse->Solve(mNegJTF);
+            }
+
+            if (!mDecomposer.Factor(mJTJ))
+            {
+                return false;
+            }
+            mDecomposer.SolveLower(mJTJ, mNegJTF);
+            mDecomposer.SolveUpper(mJTJ, mNegJTF);
+            return true;
+        }
+
         // The returned 'first' is true when the linear system cannot be
         // solved (result.converged is false in this case) or when the
         // error is reduced to within the tolerances specified by the caller
@@ -237,7 +303,7 @@ namespace gte
             Result& result)
         {
             ComputeLinearSystemInputs(pCurrent, lambdaFactor);
-            if (!mDecomposer.Factor(mJTJ))
+            if (!SolveLinearSystem())
             {
                 // TODO: The matrix mJTJ is positive semi-definite, so the
                 // failure can occur when mJTJ has a zero eigenvalue in
@@ -245,11 +311,9 @@ namespace gte
                 // anyway, perhaps using gradient descent?
                 return std::make_pair(true, false);
             }
-            mDecomposer.SolveLower(mJTJ, mNegJTF);
-            mDecomposer.SolveUpper(mJTJ, mNegJTF);
 
             pNext = pCurrent + mNegJTF;
-            mFFunction(pNext, mF);
+            ComputeF(pNext);
             Real error = Dot(mF, mF);
             if (error < result.minError)
             {
@@ -287,6 +351,9 @@ namespace gte
 
         CholeskyDecomposition<Real> mDecomposer;
 
+        // The solver for the blocks constructor.
+        std::unique_ptr<SparseNormalEquations<Real>> mSparse;
+
         bool mUseJFunction;
     };
 }
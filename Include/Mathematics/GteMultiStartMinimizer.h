@@ -0,0 +1,245 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteMinimizeN.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Local minimizers such as MinimizeN, GaussNewtonMinimizer and
+// LevenbergMarquardtMinimizer find a local minimum near the initial guess.
+// A multistart search runs the local minimizer from many initial guesses
+// and keeps the best result.  The starts are independent, so they are
+// distributed to threads.
+//
+// Most starts of a multistart search end at poor local minima.  To avoid
+// spending the full iteration budget on them, the search first runs every
+// start for 'probeIterations' iterations, then it continues only the best
+// 'keepFraction' of the starts for the remaining iterations.  The others
+// are pruned.  Set probeIterations to zero or keepFraction to one to run
+// all starts to completion.  The result does not depend on the number of
+// threads.
+//
+// A continuation restarts the local minimizer from the probe location, so
+// its result can differ from that of one run with the full iteration
+// budget.  Start 0, typically the initial guess of a single-start fit, is
+// therefore not probed.  It is always run for the full maxIterations, so the
+// multistart result is never worse than the local minimization from start 0
+// alone.
+
+namespace gte
+{
+    template <typename Real>
+    class MultiStartMinimizer
+    {
+    public:
+        struct Parameters
+        {
+            Parameters()
+                :
+                numThreads(1),
+                probeIterations(4),
+                keepFraction((Real)0.25)
+            {
+            }
+
+            unsigned int numThreads;
+            int probeIterations;
+            Real keepFraction;
+        };
+
+        struct Result
+        {
+            // The location and value of the best minimum and the index of
+            // the start that led to it.
+            std::vector<Real> minLocation;
+            Real minValue;
+            int minStart;
+
+            // Statistics.  The values are the final values of the starts
+            // that were run to completion and the probe values of the
+            // pruned starts.  The non-finite values of failed local
+            // minimizations are replaced by std::numeric_limits<Real>::max().
+            int numStarts;
+            int numPruned;
+            std::vector<Real> values;
+            std::vector<bool> pruned;
+        };
+
+        // The local minimizer is called as
+        //   value = local(start, maxIterations, location)
+        // to run at most maxIterations iterations from start[0..d-1] and
+        // return the value at the final location[0..d-1], where d is
+        // 'dimensions'.  The function is called concurrently, so it must be
+        // thread-safe.
+        typedef std::function<Real(Real const*, int, Real*)> LocalFunction;
+
+        MultiStartMinimizer(Parameters const& parameters = Parameters())
+            :
+            mParameters(parameters)
+        {
+        }
+
+        // The starts are stored consecutively in starts[], so start i is
+        // starts[i*d..i*d+d-1].
+        Result operator()(int dimensions, int numStarts, Real const* starts,
+            int maxIterations, LocalFunction const& local) const
+        {
+            LogAssert(dimensions > 0 && numStarts > 0 && starts != nullptr, "Invalid input.");
+
+            Result result;
+            result.minValue = std::numeric_limits<Real>::max();
+            result.minStart = -1;
+            result.numStarts = numStarts;
+            result.numPruned = 0;
+            result.values.resize(numStarts);
+            result.pruned.assign(numStarts, false);
+
+            // The local minimization of start s runs iterations[s]
+            // iterations from locations[s*d..s*d+d-1].
+            size_t const d = static_cast<size_t>(dimensions);
+            std::vector<Real> locations(starts, starts + numStarts * d);
+            std::vector<int> iterations(numStarts, maxIterations);
+            auto run = [&result, &locations, &iterations, &local, d](std::vector<int> const& indices)
+            {
+                return [&result, &locations, &iterations, &local, &indices, d](
+                    unsigned int, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        int const s = indices[i];
+                        Real* location = &locations[s * d];
+                        std::vector<Real> start(location, location + d);
+                        Real value = local(start.data(), iterations[s], location);
+                        result.values[s] = (std::isfinite(value) ? value : std::numeric_limits<Real>::max());
+                    }
+                };
+            };
+
+            std::vector<int> indices(numStarts);
+            std::iota(indices.begin(), indices.end(), 0);
+            int const probeIterations = mParameters.probeIterations;
+            if (numStarts > 1 && 0 < probeIterations && probeIterations < maxIterations
+                && mParameters.keepFraction < (Real)1)
+            {
+                // Probe the starts other than start 0.
+                std::vector<int> probed(indices.begin() + 1, indices.end());
+                int const numProbed = numStarts - 1;
+                std::fill(iterations.begin() + 1, iterations.end(), probeIterations);
+                ParallelFor(probed.size(), 1, mParameters.numThreads, run(probed));
+
+                // Keep the starts with the smallest probe values.  Ties are
+                // broken by start index so that the result is deterministic.
+                std::sort(probed.begin(), probed.end(), [&result](int i0, int i1)
+                {
+                    Real v0 = result.values[i0], v1 = result.values[i1];
+                    return v0 < v1 || (v0 == v1 && i0 < i1);
+                });
+                int numKeep = static_cast<int>(std::ceil(
+                    std::max(mParameters.keepFraction, (Real)0) * static_cast<Real>(numProbed)));
+                numKeep = std::max(numKeep, 1);
+                for (int i = numKeep; i < numProbed; ++i)
+                {
+                    result.pruned[probed[i]] = true;
+                }
+                result.numPruned = numProbed - numKeep;
+
+                // Continue the kept starts and run start 0, which is first
+                // in the sorted order, to completion.
+                indices.resize(1);
+                indices.insert(indices.end(), probed.begin(), probed.begin() + numKeep);
+                std::sort(indices.begin(), indices.end());
+                std::fill(iterations.begin() + 1, iterations.end(), maxIterations - probeIterations);
+                ParallelFor(indices.size(), 1, mParameters.numThreads, run(indices));
+            }
+            else
+            {
+                ParallelFor(indices.size(), 1, mParameters.numThreads, run(indices));
+            }
+
+            for (auto s : indices)
+            {
+                if (result.minStart == -1 || result.values[s] < result.minValue)
+                {
+                    result.minValue = result.values[s];
+                    result.minStart = s;
+                }
+            }
+            result.minLocation.assign(locations.begin() + result.minStart * d,
+                locations.begin() + (result.minStart + 1) * d);
+            return result;
+        }
+
+        // Multistart search with MinimizeN<Real> as the local minimizer.
+        // The inputs other than the starts are those of the MinimizeN
+        // constructor and MinimizeN::GetMinimum.  The number of iterations
+        // of MinimizeN is split between the probe and the continuation of
+        // the starts other than start 0.
+        Result operator()(int dimensions, std::function<Real(Real const*)> const& F,
+            int maxLevel, int maxBracket, int maxIterations, Real const* t0, Real const* t1,
+            int numStarts, Real const* starts, Real epsilon = (Real)1e-06) const
+        {
+            LocalFunction local = [dimensions, &F, maxLevel, maxBracket, t0, t1, epsilon](
+                Real const* start, int iterations, Real* location)
+            {
+                MinimizeN<Real> minimizer(dimensions, F, maxLevel, maxBracket, iterations, epsilon);
+                Real value;
+                minimizer.GetMinimum(t0, t1, start, location, value);
+                return value;
+            };
+
+            return operator()(dimensions, numStarts, starts, maxIterations, local);
+        }
+
+        // Generate starts uniformly distributed in the Cartesian-product
+        // domain [t0[0],t1[0]]x...x[t0[d-1],t1[d-1]].  If 'initial' is not
+        // null, it is used for start 0.
+        static void GenerateStarts(int dimensions, Real const* t0, Real const* t1,
+            Real const* initial, int numStarts, unsigned int seed, std::vector<Real>& starts)
+        {
+            std::mt19937 mte(seed);
+            std::uniform_real_distribution<Real> rnd((Real)0, (Real)1);
+            starts.resize(static_cast<size_t>(numStarts) * dimensions);
+            for (int i = 0, k = 0; i < numStarts; ++i)
+            {
+                for (int j = 0; j < dimensions; ++j, ++k)
+                {
+                    starts[k] = (i == 0 && initial ? initial[j] : t0[j] + rnd(mte) * (t1[j] - t0[j]));
+                }
+            }
+        }
+
+        // Generate starts that are random perturbations of 'initial', each
+        // component j perturbed uniformly in [-scale[j],scale[j]].  Start 0
+        // is 'initial'.  Use this for unbounded local minimizers such as
+        // GaussNewtonMinimizer.
+        static void GeneratePerturbedStarts(int dimensions, Real const* initial,
+            Real const* scale, int numStarts, unsigned int seed, std::vector<Real>& starts)
+        {
+            std::mt19937 mte(seed);
+            std::uniform_real_distribution<Real> rnd((Real)-1, (Real)1);
+            starts.resize(static_cast<size_t>(numStarts) * dimensions);
+            for (int i = 0, k = 0; i < numStarts; ++i)
+            {
+                for (int j = 0; j < dimensions; ++j, ++k)
+                {
+                    starts[k] = initial[j] + (i == 0 ? (Real)0 : rnd(mte) * scale[j]);
+                }
+            }
+        }
+
+    private:
+        Parameters mParameters;
+    };
+}
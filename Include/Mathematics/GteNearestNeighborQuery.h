@@ -8,8 +8,10 @@
 #pragma once
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteVector.h>
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <vector>
 
@@ -22,6 +24,14 @@
 // 'Vector<N,Real> GetPosition () const'. The Site template parameter
 // allows the query to be applied even when it has more local information
 // than just point location.
+//
+// For numThreads > 1, the constructor splits the nodes of the first levels
+// on the calling thread and then builds the subtrees on the threads.  The
+// tree is the same as for a single thread except for the order of the nodes
+// in the array.  The coordinates of the sorted points are also stored as
+// one array per axis, which the leaf loops of FindKNearest and FindInRadius
+// read sequentially.  The batch queries distribute the points over the
+// threads in blocks of BLOCK_SIZE.
 
 namespace gte
 {
@@ -80,8 +90,11 @@ namespace gte
             int right;
         };
 
+        enum { BLOCK_SIZE = 256 };
+
         // Construction.
-        NearestNeighborQuery(std::vector<Site> const& sites, int maxLeafSize, int maxLevel)
+        NearestNeighborQuery(std::vector<Site> const& sites, int maxLeafSize, int maxLevel,
+            unsigned int numThreads = 1)
             :
             mMaxLeafSize(maxLeafSize),
             mMaxLevel(maxLevel),
@@ -98,7 +111,25 @@ namespace gte
             }
 
             mNodes.push_back(Node());
-            Build(numSites, 0, 0, 0);
+            if (numThreads <= 1)
+            {
+                Build(mNodes, numSites, 0, 0, 0, mDepth, mLargestNodeSize);
+            }
+            else
+            {
+                BuildParallel(numSites, numThreads);
+            }
+
+            mIndices.resize(numSites);
+            mCoordinates.resize(N * static_cast<size_t>(numSites));
+            for (int j = 0; j < numSites; ++j)
+            {
+                mIndices[j] = mSortedPoints[j].second;
+                for (int axis = 0; axis < N; ++axis)
+                {
+                    mCoordinates[axis * static_cast<size_t>(numSites) + j] = mSortedPoints[j].first[axis];
+                }
+            }
         }
 
         // Member access.
@@ -256,23 +287,446 @@ namespace gte
             return numNeighbors;
         }
 
+        // Compute the k nearest neighbors of the point within the specified
+        // radius, sorted by increasing distance.  The returned integer is the
+        // number of neighbors found, at most k.  The neighbors array stores
+        // indices into the array passed to the constructor, and the squared
+        // distances are returned when the pointer is not null.  For
+        // epsilon > 0, the search is approximate:  a subtree is skipped when
+        // its distance times 1+epsilon is at least the distance of the k-th
+        // neighbor found so far, so the distance of the i-th neighbor found
+        // is at most 1+epsilon times that of the true i-th neighbor.
+        int FindKNearest(Vector<N, Real> const& point, int k, std::vector<int>& neighbors,
+            std::vector<Real>* sqrDistances = nullptr, Real epsilon = (Real)0,
+            Real radius = std::numeric_limits<Real>::max()) const
+        {
+            std::vector<Cell> stack;
+            std::vector<Entry> heap;
+            int numNeighbors = FindKNearest(point, k, epsilon, radius, stack, heap);
+            neighbors.resize(numNeighbors);
+            if (sqrDistances)
+            {
+                sqrDistances->resize(numNeighbors);
+            }
+            for (int i = 0; i < numNeighbors; ++i)
+            {
+                neighbors[i] = heap[i].index;
+                if (sqrDistances)
+                {
+                    (*sqrDistances)[i] = heap[i].sqrDistance;
+                }
+            }
+            return numNeighbors;
+        }
+
+        // Compute all neighbors within the specified radius of the point,
+        // in no particular order.  The returned integer is the number of
+        // neighbors found.
+        int FindInRadius(Vector<N, Real> const& point, Real radius, std::vector<int>& neighbors,
+            std::vector<Real>* sqrDistances = nullptr) const
+        {
+            std::vector<Entry> stack;
+            neighbors.clear();
+            if (sqrDistances)
+            {
+                sqrDistances->clear();
+            }
+            FindInRadius(point, radius, stack, [&neighbors, sqrDistances](int index, Real sqrDistance)
+            {
+                neighbors.push_back(index);
+                if (sqrDistances)
+                {
+                    sqrDistances->push_back(sqrDistance);
+                }
+            });
+            return static_cast<int>(neighbors.size());
+        }
+
+        // Batch k-nearest query.  The neighbors of points[i] are stored in
+        // neighbors[k*i] through neighbors[k*i+k-1] sorted by increasing
+        // distance; the unused elements are -1, and their squared distances
+        // are std::numeric_limits<Real>::max().
+        void FindKNearest(std::vector<Vector<N, Real>> const& points, int k,
+            std::vector<int>& neighbors, std::vector<Real>* sqrDistances = nullptr,
+            unsigned int numThreads = 1, Real epsilon = (Real)0,
+            Real radius = std::numeric_limits<Real>::max()) const
+        {
+            FindKNearest(points.size(), [&points](size_t i)
+            {
+                return std::make_pair(points[i], i);
+            },
+            k, neighbors, sqrDistances, numThreads, epsilon, radius);
+        }
+
+        // Batch k-nearest query for the sites themselves, for example to
+        // estimate normals of a point cloud.  The output is that of the
+        // batch query for the site positions, so the neighbors of site i
+        // include i.  The sites are queried in the order of the sorted
+        // points, so consecutive queries visit the same nodes and the
+        // memory accesses are more coherent than for arbitrary points.
+        void FindKNearest(int k, std::vector<int>& neighbors,
+            std::vector<Real>* sqrDistances = nullptr, unsigned int numThreads = 1,
+            Real epsilon = (Real)0, Real radius = std::numeric_limits<Real>::max()) const
+        {
+            FindKNearest(mSortedPoints.size(), [this](size_t j)
+            {
+                return std::make_pair(mSortedPoints[j].first, static_cast<size_t>(mSortedPoints[j].second));
+            },
+            k, neighbors, sqrDistances, numThreads, epsilon, radius);
+        }
+
+        // Batch radius query.  The neighbors of points[i] are stored in
+        // neighbors[offsets[i]] through neighbors[offsets[i+1]-1], in no
+        // particular order.  The offsets array has points.size()+1 elements.
+        void FindInRadius(std::vector<Vector<N, Real>> const& points, Real radius,
+            std::vector<size_t>& offsets, std::vector<int>& neighbors,
+            unsigned int numThreads = 1) const
+        {
+            size_t const numPoints = points.size();
+            size_t const numBlocks = (numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            std::vector<std::vector<int>> blockNeighbors(numBlocks);
+            offsets.resize(numPoints + 1);
+            offsets[0] = 0;
+
+            // Each block stores its neighbors in a separate array, and the
+            // counts are stored in offsets[i+1] for the prefix sum.
+            ParallelFor(numPoints, BLOCK_SIZE, numThreads, [this, &points, radius,
+                &offsets, &blockNeighbors](unsigned int, size_t first, size_t last)
+            {
+                std::vector<Entry> stack;
+                auto& output = blockNeighbors[first / BLOCK_SIZE];
+                for (size_t i = first; i < last; ++i)
+                {
+                    size_t const start = output.size();
+                    FindInRadius(points[i], radius, stack, [&output](int index, Real)
+                    {
+                        output.push_back(index);
+                    });
+                    offsets[i + 1] = output.size() - start;
+                }
+            });
+
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                offsets[i + 1] += offsets[i];
+            }
+            neighbors.resize(offsets[numPoints]);
+            for (size_t b = 0; b < numBlocks; ++b)
+            {
+                std::copy(blockNeighbors[b].begin(), blockNeighbors[b].end(),
+                    neighbors.begin() + offsets[b * BLOCK_SIZE]);
+            }
+        }
+
         inline std::vector<SortedPoint> const& GetSortedPoints() const
         {
             return mSortedPoints;
         }
 
     private:
+        // A node to be visited with a lower bound of the squared distance of
+        // its points, or a neighbor with its squared distance.
+        struct Entry
+        {
+            Real sqrDistance;
+            int index;
+
+            bool operator<(Entry const& entry) const
+            {
+                return sqrDistance < entry.sqrDistance;
+            }
+        };
+
+        // The batch k-nearest query.  The function query(i) returns the
+        // i-th query point and the index of its output.
+        template <typename Query>
+        void FindKNearest(size_t numPoints, Query const& query, int k,
+            std::vector<int>& neighbors, std::vector<Real>* sqrDistances,
+            unsigned int numThreads, Real epsilon, Real radius) const
+        {
+            k = std::max(k, 0);
+            neighbors.resize(numPoints * k);
+            if (sqrDistances)
+            {
+                sqrDistances->resize(numPoints * k);
+            }
+
+            ParallelFor(numPoints, BLOCK_SIZE, numThreads, [this, &query, k, &neighbors,
+                sqrDistances, epsilon, radius](unsigned int, size_t first, size_t last)
+            {
+                std::vector<Cell> stack;
+                std::vector<Entry> heap;
+                for (size_t i = first; i < last; ++i)
+                {
+                    auto input = query(i);
+                    int numNeighbors = FindKNearest(input.first, k, epsilon, radius, stack, heap);
+                    int* outIndex = &neighbors[input.second * k];
+                    for (int j = 0; j < k; ++j)
+                    {
+                        outIndex[j] = (j < numNeighbors ? heap[j].index : -1);
+                    }
+                    if (sqrDistances)
+                    {
+                        Real* outSqrDistance = &(*sqrDistances)[input.second * k];
+                        for (int j = 0; j < k; ++j)
+                        {
+                            outSqrDistance[j] = (j < numNeighbors ? heap[j].sqrDistance :
+                                std::numeric_limits<Real>::max());
+                        }
+                    }
+                }
+            });
+        }
+
+        // A node to be visited by the k-nearest query.  The offsets are the
+        // signed distances from the query point to the nearest split planes
+        // of the ancestors, and sqrDistance is the sum of their squares,
+        // which is the squared distance from the point to the node cell.
+        struct Cell
+        {
+            Real sqrDistance;
+            int node;
+            std::array<Real, N> offset;
+        };
+
+        // The k-nearest query used by the single-point and batch functions.
+        // On return, heap[0] through heap[numNeighbors-1] are the neighbors
+        // sorted by increasing distance.
+        int FindKNearest(Vector<N, Real> const& point, int k, Real epsilon, Real radius,
+            std::vector<Cell>& stack, std::vector<Entry>& heap) const
+        {
+            heap.clear();
+            if (k <= 0 || mIndices.size() == 0)
+            {
+                return 0;
+            }
+
+            // The heap is a max-heap of the neighbors found so far, so the
+            // k-th neighbor is at heap[0] once the heap is full.  A subtree
+            // is skipped when its squared distance bound is larger than
+            // pruneSqrDistance, which is the squared radius until the heap
+            // is full and then the squared distance of the k-th neighbor
+            // divided by (1+epsilon)^2.
+            Real const factor = ((Real)1 + epsilon) * ((Real)1 + epsilon);
+            Real maxSqrDistance = (radius < std::sqrt(std::numeric_limits<Real>::max()) ?
+                radius * radius : std::numeric_limits<Real>::max());
+            Real pruneSqrDistance = maxSqrDistance;
+            size_t const numSites = mIndices.size();
+
+            Cell cell;
+            cell.sqrDistance = (Real)0;
+            cell.node = 0;
+            cell.offset.fill((Real)0);
+            stack.clear();
+            stack.push_back(cell);
+            while (stack.size() > 0)
+            {
+                cell = stack.back();
+                stack.pop_back();
+                if (cell.sqrDistance > pruneSqrDistance)
+                {
+                    continue;
+                }
+
+                Node const& node = mNodes[cell.node];
+                if (node.siteOffset != -1)
+                {
+                    for (int j = node.siteOffset; j < node.siteOffset + node.numSites; ++j)
+                    {
+                        Real sqrLength = (Real)0;
+                        for (int axis = 0; axis < N; ++axis)
+                        {
+                            Real diff = mCoordinates[axis * numSites + j] - point[axis];
+                            sqrLength += diff * diff;
+                        }
+                        if (sqrLength <= maxSqrDistance)
+                        {
+                            if (static_cast<int>(heap.size()) == k)
+                            {
+                                std::pop_heap(heap.begin(), heap.end());
+                                heap.pop_back();
+                            }
+                            heap.push_back({ sqrLength, mIndices[j] });
+                            std::push_heap(heap.begin(), heap.end());
+                            if (static_cast<int>(heap.size()) == k)
+                            {
+                                maxSqrDistance = heap[0].sqrDistance;
+                                pruneSqrDistance = maxSqrDistance / factor;
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+                // Visit the child on the side of the point first.  The cell
+                // of the far child is farther by the offset to the split
+                // plane along the axis of the node.
+                Real diff = point[node.axis] - node.split;
+                int nearChild = (diff <= (Real)0 ? node.left : node.right);
+                int farChild = (diff <= (Real)0 ? node.right : node.left);
+                Real oldOffset = cell.offset[node.axis];
+                Real farSqrDistance = cell.sqrDistance - oldOffset * oldOffset + diff * diff;
+                if (farSqrDistance <= pruneSqrDistance)
+                {
+                    Cell far = cell;
+                    far.sqrDistance = farSqrDistance;
+                    far.node = farChild;
+                    far.offset[node.axis] = diff;
+                    stack.push_back(far);
+                }
+                cell.node = nearChild;
+                stack.push_back(cell);
+            }
+
+            std::sort_heap(heap.begin(), heap.end());
+            return static_cast<int>(heap.size());
+        }
+
+        // The radius query used by the single-point and batch functions.
+        // The function output(index, sqrDistance) is called for each
+        // neighbor.
+        template <typename Output>
+        void FindInRadius(Vector<N, Real> const& point, Real radius,
+            std::vector<Entry>& stack, Output&& output) const
+        {
+            if (mIndices.size() == 0)
+            {
+                return;
+            }
+
+            Real const sqrRadius = radius * radius;
+            size_t const numSites = mIndices.size();
+            stack.clear();
+            stack.push_back({ (Real)0, 0 });
+            while (stack.size() > 0)
+            {
+                Node const& node = mNodes[stack.back().index];
+                stack.pop_back();
+                if (node.siteOffset != -1)
+                {
+                    for (int j = node.siteOffset; j < node.siteOffset + node.numSites; ++j)
+                    {
+                        Real sqrLength = (Real)0;
+                        for (int axis = 0; axis < N; ++axis)
+                        {
+                            Real diff = mCoordinates[axis * numSites + j] - point[axis];
+                            sqrLength += diff * diff;
+                        }
+                        if (sqrLength <= sqrRadius)
+                        {
+                            output(mIndices[j], sqrLength);
+                        }
+                    }
+                    continue;
+                }
+
+                if (point[node.axis] - radius <= node.split)
+                {
+                    stack.push_back({ (Real)0, node.left });
+                }
+                if (point[node.axis] + radius >= node.split)
+                {
+                    stack.push_back({ (Real)0, node.right });
+                }
+            }
+        }
+
+        // Split the nodes of the first levels on the calling thread until
+        // there are several subtrees per thread, build the subtrees in
+        // separate arrays on the threads and append them to mNodes.
+        void BuildParallel(int numSites, unsigned int numThreads)
+        {
+            struct Subtree
+            {
+                int numSites, siteOffset, node, level;
+            };
+
+            size_t const minSubtrees = 4 * static_cast<size_t>(numThreads);
+            std::vector<Subtree> subtrees(1, { numSites, 0, 0, 0 }), next;
+            while (subtrees.size() > 0 && subtrees.size() < minSubtrees)
+            {
+                next.clear();
+                for (auto const& subtree : subtrees)
+                {
+                    if (Split(mNodes, subtree.numSites, subtree.siteOffset, subtree.node,
+                        subtree.level, mDepth, mLargestNodeSize))
+                    {
+                        Node const& node = mNodes[subtree.node];
+                        int half = subtree.numSites / 2;
+                        next.push_back({ half, subtree.siteOffset, node.left, subtree.level + 1 });
+                        next.push_back({ subtree.numSites - half, subtree.siteOffset + half,
+                            node.right, subtree.level + 1 });
+                    }
+                }
+                std::swap(subtrees, next);
+            }
+
+            // The site ranges of the subtrees are disjoint.  The root of a
+            // local array is a placeholder for the subtree node.
+            size_t const numSubtrees = subtrees.size();
+            std::vector<std::vector<Node>> local(numSubtrees);
+            std::vector<int> depth(numSubtrees, 0), largest(numSubtrees, 0);
+            ParallelFor(numSubtrees, 1, numThreads, [this, &subtrees, &local, &depth,
+                &largest](unsigned int, size_t begin, size_t end)
+            {
+                for (size_t k = begin; k < end; ++k)
+                {
+                    Subtree const& subtree = subtrees[k];
+                    local[k].push_back(Node());
+                    Build(local[k], subtree.numSites, subtree.siteOffset, 0,
+                        subtree.level, depth[k], largest[k]);
+                }
+            });
+
+            // Node i > 0 of a local array is stored at base + i - 1, and its
+            // root replaces the subtree node.
+            for (size_t k = 0; k < numSubtrees; ++k)
+            {
+                int const base = static_cast<int>(mNodes.size());
+                for (auto& node : local[k])
+                {
+                    if (node.siteOffset == -1)
+                    {
+                        node.left += base - 1;
+                        node.right += base - 1;
+                    }
+                }
+                mNodes[subtrees[k].node] = local[k][0];
+                mNodes.insert(mNodes.end(), local[k].begin() + 1, local[k].end());
+                mDepth = std::max(mDepth, depth[k]);
+                mLargestNodeSize = std::max(mLargestNodeSize, largest[k]);
+            }
+        }
+
         // Populate the node so that it contains the points split along the
         // coordinate axes.
-        void Build(int numSites, int siteOffset, int nodeIndex, int level)
+        void Build(std::vector<Node>& nodes, int numSites, int siteOffset, int nodeIndex,
+            int level, int& depth, int& largestNodeSize)
+        {
+            if (Split(nodes, numSites, siteOffset, nodeIndex, level, depth, largestNodeSize))
+            {
+                int halfNumSites = numSites / 2;
+                int left = nodes[nodeIndex].left, right = nodes[nodeIndex].right;
+                int nextLevel = level + 1;
+                Build(nodes, halfNumSites, siteOffset, left, nextLevel, depth, largestNodeSize);
+                Build(nodes, numSites - halfNumSites, siteOffset + halfNumSites, right, nextLevel,
+                    depth, largestNodeSize);
+            }
+        }
+
+        // Split the node at the median and append its children to 'nodes',
+        // or make the node a leaf.  The return value is 'true' when the
+        // node is split.
+        bool Split(std::vector<Node>& nodes, int numSites, int siteOffset, int nodeIndex,
+            int level, int& depth, int& largestNodeSize)
         {
             LogAssert(siteOffset != -1, "Invalid site offset.");
             LogAssert(nodeIndex != -1, "Invalid node index.");
             LogAssert(numSites > 0, "Empty point list.");
 
-            mDepth = std::max(mDepth, level);
+            depth = std::max(depth, level);
 
-            Node& node = mNodes[nodeIndex];
+            Node& node = nodes[nodeIndex];
             node.numSites = numSites;
 
             if (numSites > mMaxLeafSize && level <= mMaxLevel)
@@ -300,15 +754,12 @@ namespace gte
                 node.siteOffset = -1;
 
                 // Apply a divide-and-conquer step.
-                int left = (int)mNodes.size(), right = left + 1;
+                int left = (int)nodes.size(), right = left + 1;
                 node.left = left;
                 node.right = right;
-                mNodes.push_back(Node());
-                mNodes.push_back(Node());
-
-                int nextLevel = level + 1;
-                Build(halfNumSites, siteOffset, left, nextLevel);
-                Build(numSites - halfNumSites, siteOffset + halfNumSites, right, nextLevel);
+                nodes.push_back(Node());
+                nodes.push_back(Node());
+                return true;
             }
             else
             {
@@ -320,7 +771,8 @@ namespace gte
                 node.left = -1;
                 node.right = -1;
 
-                mLargestNodeSize = std::max(mLargestNodeSize, node.numSites);
+                largestNodeSize = std::max(largestNodeSize, node.numSites);
+                return false;
             }
         }
 
@@ -330,5 +782,11 @@ namespace gte
         std::vector<Node> mNodes;
         int mDepth;
         int mLargestNodeSize;
+
+        // The site indices and the coordinates of the sorted points.  The
+        // coordinate of axis a of sorted point j is
+        // mCoordinates[a*numSites+j].
+        std::vector<int> mIndices;
+        std::vector<Real> mCoordinates;
     };
 }
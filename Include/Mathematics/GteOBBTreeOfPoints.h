@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteBitHacks.h>
 #include <Mathematics/GteContOrientedBox3.h>
+#include <Mathematics/GteIntrOrientedBox3OrientedBox3.h>
+#include <Mathematics/GteMatrix3x3.h>
 
 // The depth of a node in a (nonempty) tree is the distance from the node to
 // the root of the tree.  The height is the maximum depth.  A tree with a
@@ -17,6 +20,32 @@
 // complete binary tree of height H has 2^{H+1}-1 nodes.  The level
 // corresponding to depth D has 2^D nodes, in which case the number of
 // leaf nodes (depth H) is 2^H.
+//
+// For numThreads > 1, the constructor builds the nodes of the first levels
+// on the calling thread and the subtrees below them on the threads.  The
+// tree is the same as for a single thread except for the order of the nodes
+// in the array.  The children of a node have larger indices than the node.
+// The box of an interior node is fitted to its points with the principal
+// axes and then enlarged to contain the boxes of its children, so the boxes
+// are nested and a subtree whose box is separated from another box can be
+// skipped by the queries.
+//
+// Refit updates the boxes after the points move, for example for a
+// deforming object, and keeps the partition and the box axes.  The leaf
+// boxes are fitted to their points and the interior boxes to the boxes of
+// their children, so the boxes remain bounding boxes but become larger
+// than those of a rebuilt tree as the deformation increases.
+//
+// The tree-tree queries traverse the pairs of nodes of two trees with a
+// stack, descending into the node with the larger box.  The boxes of the
+// other tree are transformed by a rigid motion, X' = rotation*X+translation,
+// so a tree can be built once in the model space of a rigid object.
+// Overlaps and FindOverlaps use TIQuery<Real,OrientedBox3,OrientedBox3>.
+// The points have no volume, so the leaves of trees used for overlap tests
+// should contain several points, which is the case for height less than
+// the maximum.  GetMinDistance computes the minimum distance between the
+// point sets; the node pairs are pruned by a lower bound of the distance
+// between their boxes that is computed from the 6 box face normals.
 
 namespace gte
 {
@@ -34,7 +63,6 @@ public:
         uint32_t leftChild, rightChild;
     };
 
-
     // The 'points' array is a collection of vertices, each occupying a
     // chunk of memory with 'stride' bytes.  A vertex must start at the
     // first byte of this chunk but does not necessarily fill it.  The
@@ -43,7 +71,8 @@ public:
     // then the entire tree is built and the actual height is computed
     // from 'numPoints'.
     OBBTreeForPoints(uint32_t numPoints, char const* points, size_t stride,
-        uint32_t height = std::numeric_limits<uint32_t>::max());
+        uint32_t height = std::numeric_limits<uint32_t>::max(),
+        unsigned int numThreads = 1);
 
     // Member access.
     inline uint32_t GetNumPoints() const;
@@ -53,13 +82,89 @@ public:
     inline uint32_t GetHeight() const;
     inline std::vector<uint32_t> const& GetPartition() const;
 
+    // A node is a leaf when it has no children.
+    inline static bool IsLeaf(Node const& node);
+
+    // Recompute the boxes after the points in the 'points' array passed to
+    // the constructor have been modified.  The leaf boxes are computed on
+    // numThreads threads.
+    void Refit(unsigned int numThreads = 1);
+
+    // Test whether the trees overlap, which is the case when a leaf box of
+    // this tree intersects a transformed leaf box of the other tree.
+    bool Overlaps(OBBTreeForPoints const& other,
+        Matrix3x3<Real> const& rotation = Matrix3x3<Real>::Identity(),
+        Vector3<Real> const& translation = Vector3<Real>::Zero()) const;
+
+    // Compute the pairs of intersecting leaves.  The first index of a pair
+    // is a node of this tree and the second index is a node of the other
+    // tree.
+    void FindOverlaps(OBBTreeForPoints const& other,
+        std::vector<std::array<uint32_t, 2>>& leafPairs,
+        Matrix3x3<Real> const& rotation = Matrix3x3<Real>::Identity(),
+        Vector3<Real> const& translation = Vector3<Real>::Zero()) const;
+
+    // The minimum distance between the points of this tree and the
+    // transformed points of the other tree.  The point indices are into
+    // the 'points' arrays, and closest[1] is the transformed point.
+    struct DistanceResult
+    {
+        Real distance, sqrDistance;
+        uint32_t point[2];
+        Vector3<Real> closest[2];
+    };
+
+    DistanceResult GetMinDistance(OBBTreeForPoints const& other,
+        Matrix3x3<Real> const& rotation = Matrix3x3<Real>::Identity(),
+        Vector3<Real> const& translation = Vector3<Real>::Zero()) const;
+
 private:
     inline Vector3<Real> GetPosition(uint32_t index) const;
-    void BuildTree(Node& node, uint32_t i0, uint32_t i1);
+
+    // Build the subtree rooted at tree[nodeIndex], whose minIndex, maxIndex
+    // and depth are set.
+    void BuildTree(std::vector<Node>& tree, uint32_t nodeIndex);
+
+    // Compute the box of tree[nodeIndex] and append its children to the
+    // tree when the node is split.  The return value is 'true' when the
+    // node is split.
+    bool BuildNode(std::vector<Node>& tree, uint32_t nodeIndex);
+
+    void BuildParallel(unsigned int numThreads);
     void ComputeOBB(uint32_t i0, uint32_t i1, OrientedBox3<Real>& box);
     void SplitPoints(uint32_t i0, uint32_t i1, uint32_t& j0, uint32_t& j1,
         Vector3<Real> const& origin, Vector3<Real> const& direction);
 
+    // Enlarge the interior boxes, keeping their axes, so that each one
+    // contains the boxes of its children.  The tree-tree queries prune the
+    // subtrees whose boxes are separated, which is conservative only when
+    // the boxes are nested.
+    void FitInteriorBoxes();
+
+    // Refit a box to points or to the boxes of two children, keeping the
+    // axes.
+    void FitToPoints(OrientedBox3<Real>& box, uint32_t i0, uint32_t i1) const;
+    static void FitToBoxes(OrientedBox3<Real>& box, OrientedBox3<Real> const& box0,
+        OrientedBox3<Real> const& box1);
+
+    static OrientedBox3<Real> Transform(OrientedBox3<Real> const& box,
+        Matrix3x3<Real> const& rotation, Vector3<Real> const& translation);
+
+    // A lower bound of the squared distance between two boxes.
+    static Real SqrDistanceBound(OrientedBox3<Real> const& box0,
+        OrientedBox3<Real> const& box1);
+
+    // The pair of nodes whose children are visited by the tree-tree
+    // queries.  The return value is 'false' when both nodes are leaves.
+    static bool Descend(Node const& node0, Node const& node1, uint32_t index0,
+        uint32_t index1, std::array<uint32_t, 2> children[2]);
+
+    // Visit the pairs of leaves whose boxes intersect.  The function
+    // visitor(index0, index1) returns 'false' to stop the traversal.
+    template <typename Visitor>
+    void VisitOverlaps(OBBTreeForPoints const& other, Matrix3x3<Real> const& rotation,
+        Vector3<Real> const& translation, Visitor&& visitor) const;
+
     struct ProjectionInfo
     {
         ProjectionInfo();
@@ -77,7 +182,8 @@ private:
 };
 
 template <typename Real>
-OBBTreeForPoints<Real>::OBBTreeForPoints(uint32_t numPoints, char const* points, size_t stride, uint32_t height)
+OBBTreeForPoints<Real>::OBBTreeForPoints(uint32_t numPoints, char const* points, size_t stride, uint32_t height,
+    unsigned int numThreads)
     :
     mNumPoints(numPoints),
     mPoints(points),
@@ -113,12 +219,8 @@ OBBTreeForPoints<Real>::OBBTreeForPoints(uint32_t numPoints, char const* points,
         }
     }
 
-    // The tree is built recursively.  A reference to a Node is passed
-    // to BuildTree and nodes are appended to a std::vector.  Because the
-    // references are on the stack, we must guarantee no reallocations
-    // to avoid invalidating the references.  TODO: This design can be
-    // modified to pass indices to the nodes so that reallocation is not
-    // a problem.
+    // The tree is built recursively.  The nodes are referenced by their
+    // indices, because appending nodes to the array can reallocate it.
     mTree.reserve(numNodes);
 
     // Build the tree recursively.  The array mPartition stores the
@@ -130,7 +232,20 @@ OBBTreeForPoints<Real>::OBBTreeForPoints(uint32_t numPoints, char const* points,
         mPartition[i] = i;
     }
     mTree.push_back(Node());
-    BuildTree(mTree.back(), 0, mNumPoints - 1);
+    mTree[0].minIndex = 0;
+    mTree[0].maxIndex = mNumPoints - 1;
+    if (numThreads <= 1)
+    {
+        BuildTree(mTree, 0);
+    }
+    else
+    {
+        BuildParallel(numThreads);
+    }
+
+    // The box of an interior node is fitted to its points, but the boxes
+    // of its children need not be contained in it.
+    FitInteriorBoxes();
 }
 
 template <typename Real>
@@ -169,6 +284,154 @@ inline std::vector<uint32_t> const& OBBTreeForPoints<Real>::GetPartition() const
     return mPartition;
 }
 
+template <typename Real>
+inline bool OBBTreeForPoints<Real>::IsLeaf(Node const& node)
+{
+    return node.leftChild == std::numeric_limits<uint32_t>::max();
+}
+
+template <typename Real>
+void OBBTreeForPoints<Real>::Refit(unsigned int numThreads)
+{
+    // Fit the leaf boxes to their points.
+    std::vector<uint32_t> leaves;
+    for (uint32_t n = 0; n < static_cast<uint32_t>(mTree.size()); ++n)
+    {
+        if (IsLeaf(mTree[n]))
+        {
+            leaves.push_back(n);
+        }
+    }
+
+    ParallelFor(leaves.size(), 64, numThreads,
+        [this, &leaves](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            Node& node = mTree[leaves[k]];
+            FitToPoints(node.box, node.minIndex, node.maxIndex);
+        }
+    });
+
+    FitInteriorBoxes();
+}
+
+template <typename Real>
+bool OBBTreeForPoints<Real>::Overlaps(OBBTreeForPoints const& other,
+    Matrix3x3<Real> const& rotation, Vector3<Real> const& translation) const
+{
+    bool overlaps = false;
+    VisitOverlaps(other, rotation, translation, [&overlaps](uint32_t, uint32_t)
+    {
+        overlaps = true;
+        return false;
+    });
+    return overlaps;
+}
+
+template <typename Real>
+void OBBTreeForPoints<Real>::FindOverlaps(OBBTreeForPoints const& other,
+    std::vector<std::array<uint32_t, 2>>& leafPairs,
+    Matrix3x3<Real> const& rotation, Vector3<Real> const& translation) const
+{
+    leafPairs.clear();
+    VisitOverlaps(other, rotation, translation, [&leafPairs](uint32_t index0, uint32_t index1)
+    {
+        leafPairs.push_back({ index0, index1 });
+        return true;
+    });
+}
+
+template <typename Real>
+typename OBBTreeForPoints<Real>::DistanceResult
+OBBTreeForPoints<Real>::GetMinDistance(OBBTreeForPoints const& other,
+    Matrix3x3<Real> const& rotation, Vector3<Real> const& translation) const
+{
+    DistanceResult result;
+    result.sqrDistance = std::numeric_limits<Real>::max();
+    result.distance = result.sqrDistance;
+    result.point[0] = std::numeric_limits<uint32_t>::max();
+    result.point[1] = std::numeric_limits<uint32_t>::max();
+    if (mTree.size() == 0 || other.mTree.size() == 0)
+    {
+        return result;
+    }
+
+    // The stack stores the node pairs with their distance bounds.  The
+    // nearer pair of children is visited first.
+    struct Pair
+    {
+        Real sqrDistance;
+        uint32_t index0, index1;
+    };
+    std::vector<Pair> stack;
+    std::vector<Vector3<Real>> points1;
+    stack.push_back({ (Real)0, 0, 0 });
+    while (stack.size() > 0 && result.sqrDistance > (Real)0)
+    {
+        Pair pair = stack.back();
+        stack.pop_back();
+        if (pair.sqrDistance >= result.sqrDistance)
+        {
+            continue;
+        }
+
+        Node const& node0 = mTree[pair.index0];
+        Node const& node1 = other.mTree[pair.index1];
+        std::array<uint32_t, 2> children[2];
+        if (!Descend(node0, node1, pair.index0, pair.index1, children))
+        {
+            // Compare the points of the leaves.
+            points1.resize(node1.maxIndex - node1.minIndex + 1);
+            for (uint32_t i1 = node1.minIndex; i1 <= node1.maxIndex; ++i1)
+            {
+                points1[i1 - node1.minIndex] = rotation * other.GetPosition(other.mPartition[i1]) + translation;
+            }
+            for (uint32_t i0 = node0.minIndex; i0 <= node0.maxIndex; ++i0)
+            {
+                Vector3<Real> point0 = GetPosition(mPartition[i0]);
+                for (uint32_t i1 = node1.minIndex; i1 <= node1.maxIndex; ++i1)
+                {
+                    Vector3<Real> diff = points1[i1 - node1.minIndex] - point0;
+                    Real sqrDistance = Dot(diff, diff);
+                    if (sqrDistance < result.sqrDistance)
+                    {
+                        result.sqrDistance = sqrDistance;
+                        result.point[0] = mPartition[i0];
+                        result.point[1] = other.mPartition[i1];
+                        result.closest[0] = point0;
+                        result.closest[1] = points1[i1 - node1.minIndex];
+                    }
+                }
+            }
+            continue;
+        }
+
+        Pair childPairs[2];
+        for (int j = 0; j < 2; ++j)
+        {
+            childPairs[j].index0 = children[j][0];
+            childPairs[j].index1 = children[j][1];
+            childPairs[j].sqrDistance = SqrDistanceBound(mTree[children[j][0]].box,
+                Transform(other.mTree[children[j][1]].box, rotation, translation));
+        }
+        if (childPairs[0].sqrDistance < childPairs[1].sqrDistance)
+        {
+            std::swap(childPairs[0], childPairs[1]);
+        }
+        for (int j = 0; j < 2; ++j)
+        {
+            if (childPairs[j].sqrDistance < result.sqrDistance)
+            {
+                stack.push_back(childPairs[j]);
+            }
+        }
+    }
+
+    result.distance = std::sqrt(result.sqrDistance);
+    return result;
+}
+
 template <typename Real>
 inline Vector3<Real> OBBTreeForPoints<Real>::GetPosition(uint32_t index) const
 {
@@ -176,10 +439,22 @@ inline Vector3<Real> OBBTreeForPoints<Real>::GetPosition(uint32_t index) const
 }
 
 template <typename Real>
-void OBBTreeForPoints<Real>::BuildTree(Node& node, uint32_t i0, uint32_t i1)
+void OBBTreeForPoints<Real>::BuildTree(std::vector<Node>& tree, uint32_t nodeIndex)
+{
+    if (BuildNode(tree, nodeIndex))
+    {
+        uint32_t leftChild = tree[nodeIndex].leftChild;
+        uint32_t rightChild = tree[nodeIndex].rightChild;
+        BuildTree(tree, leftChild);
+        BuildTree(tree, rightChild);
+    }
+}
+
+template <typename Real>
+bool OBBTreeForPoints<Real>::BuildNode(std::vector<Node>& tree, uint32_t nodeIndex)
 {
-    node.minIndex = i0;
-    node.maxIndex = i1;
+    Node& node = tree[nodeIndex];
+    uint32_t const i0 = node.minIndex, i1 = node.maxIndex;
 
     if (i0 == i1)
     {
@@ -192,36 +467,92 @@ void OBBTreeForPoints<Real>::BuildTree(Node& node, uint32_t i0, uint32_t i1)
         node.box.axis[1] = Vector3<Real>{ (Real)0, (Real)1, (Real)0 };
         node.box.axis[2] = Vector3<Real>{ (Real)0, (Real)0, (Real)1 };
         node.box.extent = Vector3<Real>{ (Real)0, (Real)0, (Real)0 };
+        return false;
     }
-    else  // i0 < i1
+
+    // We are at an interior node.  Compute an oriented bounding box.
+    ComputeOBB(i0, i1, node.box);
+
+    if (node.depth == mHeight)
     {
-        // We are at an interior node.  Compute an oriented bounding box.
-        ComputeOBB(i0, i1, node.box);
+        return false;
+    }
+
+    // Use the box axis corresponding to largest extent for the splitting
+    // axis.  Partition the points into two subsets, one for the left child
+    // and one for the right child. The subsets have numbers of elements
+    // that differ by at most 1, so the tree is balanced.
+    Vector3<Real> axis2 = node.box.axis[2];
+    uint32_t j0, j1;
+    SplitPoints(i0, i1, j0, j1, node.box.center, axis2);
+
+    uint32_t const depth = node.depth + 1;
+    uint32_t const leftChild = static_cast<uint32_t>(tree.size());
+    node.leftChild = leftChild;
+    node.rightChild = leftChild + 1;
+    tree.push_back(Node());
+    tree.push_back(Node());
+    tree[leftChild].depth = depth;
+    tree[leftChild].minIndex = i0;
+    tree[leftChild].maxIndex = j0;
+    tree[leftChild + 1].depth = depth;
+    tree[leftChild + 1].minIndex = j1;
+    tree[leftChild + 1].maxIndex = i1;
+    return true;
+}
 
-        if (node.depth == mHeight)
+template <typename Real>
+void OBBTreeForPoints<Real>::BuildParallel(unsigned int numThreads)
+{
+    // Build the nodes breadth-first until there are several subtrees per
+    // thread.
+    size_t const minSubtrees = 4 * static_cast<size_t>(numThreads);
+    std::vector<uint32_t> subtrees(1, 0), next;
+    while (subtrees.size() > 0 && subtrees.size() < minSubtrees)
+    {
+        next.clear();
+        for (auto nodeIndex : subtrees)
         {
-            return;
+            if (BuildNode(mTree, nodeIndex))
+            {
+                next.push_back(mTree[nodeIndex].leftChild);
+                next.push_back(mTree[nodeIndex].rightChild);
+            }
+        }
+        std::swap(subtrees, next);
+    }
+
+    // Build the subtrees in separate arrays whose root is a copy of the
+    // subtree node.  The point ranges of the subtrees are disjoint.
+    size_t const numSubtrees = subtrees.size();
+    std::vector<std::vector<Node>> local(numSubtrees);
+    ParallelFor(numSubtrees, 1, numThreads,
+        [this, &subtrees, &local](unsigned int, size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            Node const& root = mTree[subtrees[k]];
+            local[k].reserve(2 * static_cast<size_t>(root.maxIndex - root.minIndex + 1));
+            local[k].push_back(root);
+            BuildTree(local[k], 0);
         }
+    });
 
-        // Use the box axis corresponding to largest extent for the
-        // splitting axis.  Partition the points into two subsets, one for
-        // the left child and one for the right child. The subsets have
-        // numbers of elements that differ by at most 1, so the tree is
-        // balanced.
-        Vector3<Real> axis2 = node.box.axis[2];
-        uint32_t j0, j1;
-        SplitPoints(i0, i1, j0, j1, node.box.center, axis2);
-
-        node.leftChild = static_cast<uint32_t>(mTree.size());
-        node.rightChild = node.leftChild + 1;
-        mTree.push_back(Node());
-        Node& leftTree = mTree.back();
-        mTree.push_back(Node());
-        Node& rightTree = mTree.back();
-        leftTree.depth = node.depth + 1;
-        rightTree.depth = node.depth + 1;
-        BuildTree(leftTree, i0, j0);
-        BuildTree(rightTree, j1, i1);
+    // Node i > 0 of a local array is stored at base + i - 1, and its root
+    // replaces the subtree node.
+    for (size_t k = 0; k < numSubtrees; ++k)
+    {
+        uint32_t const base = static_cast<uint32_t>(mTree.size());
+        for (auto& node : local[k])
+        {
+            if (!IsLeaf(node))
+            {
+                node.leftChild += base - 1;
+                node.rightChild += base - 1;
+            }
+        }
+        mTree[subtrees[k]] = local[k][0];
+        mTree.insert(mTree.end(), local[k].begin() + 1, local[k].end());
     }
 }
 
@@ -331,6 +662,183 @@ void OBBTreeForPoints<Real>::SplitPoints(uint32_t i0, uint32_t i1, uint32_t& j0,
     }
 }
 
+template <typename Real>
+void OBBTreeForPoints<Real>::FitInteriorBoxes()
+{
+    // The children have larger indices than their parent, both for the
+    // serial and for the parallel build.
+    for (size_t n = mTree.size(); n-- > 0; )
+    {
+        Node& node = mTree[n];
+        if (!IsLeaf(node))
+        {
+            FitToBoxes(node.box, mTree[node.leftChild].box, mTree[node.rightChild].box);
+        }
+    }
+}
+
+template <typename Real>
+void OBBTreeForPoints<Real>::FitToPoints(OrientedBox3<Real>& box, uint32_t i0, uint32_t i1) const
+{
+    Real const maxReal = std::numeric_limits<Real>::max();
+    Vector3<Real> origin = box.center;
+    Vector3<Real> pmin{ maxReal, maxReal, maxReal };
+    Vector3<Real> pmax{ -maxReal, -maxReal, -maxReal };
+    for (uint32_t i = i0; i <= i1; ++i)
+    {
+        Vector3<Real> diff = GetPosition(mPartition[i]) - origin;
+        for (int j = 0; j < 3; ++j)
+        {
+            Real dot = Dot(diff, box.axis[j]);
+            pmin[j] = std::min(pmin[j], dot);
+            pmax[j] = std::max(pmax[j], dot);
+        }
+    }
+
+    Real const half(0.5);
+    for (int j = 0; j < 3; ++j)
+    {
+        box.center += (half * (pmin[j] + pmax[j])) * box.axis[j];
+        box.extent[j] = half * (pmax[j] - pmin[j]);
+    }
+}
+
+template <typename Real>
+void OBBTreeForPoints<Real>::FitToBoxes(OrientedBox3<Real>& box,
+    OrientedBox3<Real> const& box0, OrientedBox3<Real> const& box1)
+{
+    // The projection of a child box onto a box axis U is the interval
+    // with center Dot(U,C-origin) and radius sum_i e[i]*|Dot(U,A[i])|.
+    Vector3<Real> origin = box.center;
+    Vector3<Real> pmin, pmax;
+    for (int j = 0; j < 3; ++j)
+    {
+        Vector3<Real> const& U = box.axis[j];
+        Real center0 = Dot(U, box0.center - origin);
+        Real center1 = Dot(U, box1.center - origin);
+        Real radius0 = (Real)0, radius1 = (Real)0;
+        for (int i = 0; i < 3; ++i)
+        {
+            radius0 += box0.extent[i] * std::abs(Dot(U, box0.axis[i]));
+            radius1 += box1.extent[i] * std::abs(Dot(U, box1.axis[i]));
+        }
+        pmin[j] = std::min(center0 - radius0, center1 - radius1);
+        pmax[j] = std::max(center0 + radius0, center1 + radius1);
+    }
+
+    Real const half(0.5);
+    for (int j = 0; j < 3; ++j)
+    {
+        box.center += (half * (pmin[j] + pmax[j])) * box.axis[j];
+        box.extent[j] = half * (pmax[j] - pmin[j]);
+    }
+}
+
+template <typename Real>
+OrientedBox3<Real> OBBTreeForPoints<Real>::Transform(OrientedBox3<Real> const& box,
+    Matrix3x3<Real> const& rotation, Vector3<Real> const& translation)
+{
+    OrientedBox3<Real> result;
+    result.center = rotation * box.center + translation;
+    for (int i = 0; i < 3; ++i)
+    {
+        result.axis[i] = rotation * box.axis[i];
+    }
+    result.extent = box.extent;
+    return result;
+}
+
+template <typename Real>
+Real OBBTreeForPoints<Real>::SqrDistanceBound(OrientedBox3<Real> const& box0,
+    OrientedBox3<Real> const& box1)
+{
+    // The distance between the boxes is at least the gap between their
+    // projections onto any unit-length direction.  The directions are the
+    // face normals of the boxes.
+    Vector3<Real> delta = box1.center - box0.center;
+    Real maxGap = (Real)0;
+    for (int k = 0; k < 2; ++k)
+    {
+        OrientedBox3<Real> const& box = (k == 0 ? box0 : box1);
+        for (int j = 0; j < 3; ++j)
+        {
+            Vector3<Real> const& U = box.axis[j];
+            Real radius = box.extent[j];
+            OrientedBox3<Real> const& opposite = (k == 0 ? box1 : box0);
+            for (int i = 0; i < 3; ++i)
+            {
+                radius += opposite.extent[i] * std::abs(Dot(U, opposite.axis[i]));
+            }
+            maxGap = std::max(maxGap, std::abs(Dot(U, delta)) - radius);
+        }
+    }
+    return maxGap * maxGap;
+}
+
+template <typename Real>
+bool OBBTreeForPoints<Real>::Descend(Node const& node0, Node const& node1,
+    uint32_t index0, uint32_t index1, std::array<uint32_t, 2> children[2])
+{
+    bool isLeaf0 = IsLeaf(node0), isLeaf1 = IsLeaf(node1);
+    if (isLeaf0 && isLeaf1)
+    {
+        return false;
+    }
+
+    // Descend into the node with the larger box.
+    Real size0 = node0.box.extent[0] + node0.box.extent[1] + node0.box.extent[2];
+    Real size1 = node1.box.extent[0] + node1.box.extent[1] + node1.box.extent[2];
+    if (isLeaf1 || (!isLeaf0 && size0 >= size1))
+    {
+        children[0] = { node0.leftChild, index1 };
+        children[1] = { node0.rightChild, index1 };
+    }
+    else
+    {
+        children[0] = { index0, node1.leftChild };
+        children[1] = { index0, node1.rightChild };
+    }
+    return true;
+}
+
+template <typename Real>
+template <typename Visitor>
+void OBBTreeForPoints<Real>::VisitOverlaps(OBBTreeForPoints const& other,
+    Matrix3x3<Real> const& rotation, Vector3<Real> const& translation,
+    Visitor&& visitor) const
+{
+    if (mTree.size() == 0 || other.mTree.size() == 0)
+    {
+        return;
+    }
+
+    TIQuery<Real, OrientedBox3<Real>, OrientedBox3<Real>> query;
+    std::vector<std::array<uint32_t, 2>> stack;
+    stack.push_back({ 0, 0 });
+    while (stack.size() > 0)
+    {
+        std::array<uint32_t, 2> pair = stack.back();
+        stack.pop_back();
+        Node const& node0 = mTree[pair[0]];
+        Node const& node1 = other.mTree[pair[1]];
+        if (!query(node0.box, Transform(node1.box, rotation, translation)).intersect)
+        {
+            continue;
+        }
+
+        std::array<uint32_t, 2> children[2];
+        if (Descend(node0, node1, pair[0], pair[1], children))
+        {
+            stack.push_back(children[1]);
+            stack.push_back(children[0]);
+        }
+        else if (!visitor(pair[0], pair[1]))
+        {
+            return;
+        }
+    }
+}
+
 template <typename Real>
 OBBTreeForPoints<Real>::Node::Node()
     :
@@ -0,0 +1,716 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// OdeEnsemble integrates many independent systems dx/dt = F(t,x) of the
+// same dimension, for example the trajectories of a Monte Carlo dispersion
+// analysis.  The OdeSolver-derived classes integrate one system per call
+// through a function that returns a TVector, so the per-call overhead is
+// paid by every system and every stage.  OdeEnsemble stores the states in
+// structure-of-arrays (SoA) layout:  component d of system s is
+// GetComponent(d)[s].  The systems are processed in chunks of consecutive
+// systems (lanes), and the function F is called once per stage for all the
+// lanes of a chunk.  The chunks are distributed to threads.
+//
+// The function is called as F(numLanes, t, x, dxdt), where t[l] is the time
+// of lane l, x[d][l] is component d of the state of lane l, and dxdt[d][l]
+// must be set to component d of F(t[l],x[l]), for 0 <= l < numLanes and
+// 0 <= d < dimension.  Write the lane loops innermost so that the compiler
+// can vectorize them.  The function is called concurrently for different
+// chunks, so it must be thread-safe.
+//
+// Update(...) advances all systems by fixed steps using the explicit Euler,
+// midpoint or fourth-order Runge-Kutta method, the same methods as
+// OdeEuler, OdeMidpoint and OdeRungeKutta4.  Integrate(...) advances all
+// systems to a final time using the Dormand-Prince 5(4) embedded
+// Runge-Kutta method with error control and a step size for each system.
+// Within a chunk, the systems that have reached the final time are masked
+// out; they still pass through F but their states do not change.
+
+namespace gte
+{
+
+template <typename Real>
+class OdeEnsemble
+{
+public:
+    typedef std::function<void(int, Real const*, Real const* const*, Real* const*)> Function;
+
+    enum class Method
+    {
+        EULER,
+        MIDPOINT,
+        RUNGE_KUTTA_4
+    };
+
+    struct AdaptiveParameters
+    {
+        AdaptiveParameters()
+            :
+            absoluteTolerance((Real)1e-8),
+            relativeTolerance((Real)1e-6),
+            initialStep((Real)0),
+            minStep((Real)0),
+            maxStep(std::numeric_limits<Real>::max()),
+            safety((Real)0.9),
+            minScale((Real)0.2),
+            maxScale((Real)5),
+            maxSteps(100000)
+        {
+        }
+
+        // The error of a step is accepted when its root-mean-square over
+        // the components, each divided by absoluteTolerance +
+        // relativeTolerance * |x[d]|, is at most 1.
+        Real absoluteTolerance, relativeTolerance;
+
+        // The first step of a system whose step size is not positive.  If
+        // initialStep is zero, the step is estimated from x and F(t,x).
+        Real initialStep;
+
+        // Step size bounds.  The step sizes are clamped to [minStep,maxStep]
+        // and a system fails when a step of size minStep is rejected.
+        Real minStep, maxStep;
+
+        // The new step size is h * safety * error^(-1/5), clamped to
+        // [minScale*h, maxScale*h].
+        Real safety, minScale, maxScale;
+
+        // The maximum number of steps (accepted or rejected) per system and
+        // per call to Integrate.
+        int maxSteps;
+    };
+
+    struct AdaptiveResult
+    {
+        // Summed over all systems.
+        size_t numAccepted, numRejected;
+
+        // The number of systems that did not reach the final time because
+        // a step of size minStep was rejected or maxSteps was reached.
+        int numFailed;
+    };
+
+    // Construction.  The states and times are initialized to zero and must
+    // be set by the caller.
+    OdeEnsemble(int dimension, int numSystems, Function const& F,
+        int chunkSize = 256, unsigned int numThreads = 1);
+
+    // Member access.  The time of system s is GetTimes()[s].  The step size
+    // of system s for Integrate(...) is GetStepSizes()[s]; it is updated by
+    // Integrate(...), so consecutive calls continue with the last step
+    // sizes.  A step size of zero means the first step is estimated.
+    inline int GetDimension() const;
+    inline int GetNumSystems() const;
+    inline Real* GetComponent(int d);
+    inline Real const* GetComponent(int d) const;
+    inline Real* GetTimes();
+    inline Real const* GetTimes() const;
+    inline Real* GetStepSizes();
+    inline Real const* GetStepSizes() const;
+
+    // Convenience functions for setting and getting the state of a single
+    // system, x[0..dimension-1].
+    void SetState(int s, Real t, Real const* x);
+    void GetState(int s, Real& t, Real* x) const;
+
+    // Advance every system by numSteps steps of size tDelta.
+    void Update(Method method, Real tDelta, int numSteps);
+
+    // Advance every system from its current time to tFinal.  Systems whose
+    // time is already at least tFinal are not modified.
+    AdaptiveResult Integrate(Real tFinal,
+        AdaptiveParameters const& parameters = AdaptiveParameters());
+
+private:
+    // The state of a chunk, as pointers to the components.
+    typedef std::vector<Real*> State;
+
+    // Scratch memory for one thread, organized as 'numArrays' arrays of
+    // dimension*chunkSize values each.
+    struct Scratch
+    {
+        std::vector<Real> values;
+        std::vector<Real> t1, h, error;
+        std::vector<Real*> pointers;
+    };
+
+    // Get the chunk pointers for array i of the scratch memory.
+    Real* const* GetScratchState(Scratch& scratch, int i) const;
+
+    void UpdateChunk(Method method, Real tDelta, int numSteps, int begin,
+        int numLanes, Scratch& scratch);
+
+    void IntegrateChunk(Real tFinal, AdaptiveParameters const& parameters,
+        int begin, int numLanes, Scratch& scratch, size_t& numAccepted,
+        size_t& numRejected, int& numFailed);
+
+    int mDimension, mNumSystems;
+    Function mFunction;
+    int mChunkSize;
+    unsigned int mNumThreads;
+
+    // The SoA states, the times and the adaptive step sizes.
+    std::vector<Real> mState, mTimes, mStepSizes;
+};
+
+
+template <typename Real>
+OdeEnsemble<Real>::OdeEnsemble(int dimension, int numSystems,
+    Function const& F, int chunkSize, unsigned int numThreads)
+    :
+    mDimension(dimension),
+    mNumSystems(numSystems),
+    mFunction(F),
+    mChunkSize(std::max(chunkSize, 1)),
+    mNumThreads(std::max(numThreads, 1u)),
+    mState(static_cast<size_t>(dimension) * numSystems, (Real)0),
+    mTimes(numSystems, (Real)0),
+    mStepSizes(numSystems, (Real)0)
+{
+    LogAssert(dimension > 0 && numSystems > 0, "Invalid dimensions.");
+}
+
+template <typename Real> inline
+int OdeEnsemble<Real>::GetDimension() const
+{
+    return mDimension;
+}
+
+template <typename Real> inline
+int OdeEnsemble<Real>::GetNumSystems() const
+{
+    return mNumSystems;
+}
+
+template <typename Real> inline
+Real* OdeEnsemble<Real>::GetComponent(int d)
+{
+    return &mState[static_cast<size_t>(d) * mNumSystems];
+}
+
+template <typename Real> inline
+Real const* OdeEnsemble<Real>::GetComponent(int d) const
+{
+    return &mState[static_cast<size_t>(d) * mNumSystems];
+}
+
+template <typename Real> inline
+Real* OdeEnsemble<Real>::GetTimes()
+{
+    return mTimes.data();
+}
+
+template <typename Real> inline
+Real const* OdeEnsemble<Real>::GetTimes() const
+{
+    return mTimes.data();
+}
+
+template <typename Real> inline
+Real* OdeEnsemble<Real>::GetStepSizes()
+{
+    return mStepSizes.data();
+}
+
+template <typename Real> inline
+Real const* OdeEnsemble<Real>::GetStepSizes() const
+{
+    return mStepSizes.data();
+}
+
+template <typename Real>
+void OdeEnsemble<Real>::SetState(int s, Real t, Real const* x)
+{
+    mTimes[s] = t;
+    for (int d = 0; d < mDimension; ++d)
+    {
+        GetComponent(d)[s] = x[d];
+    }
+}
+
+template <typename Real>
+void OdeEnsemble<Real>::GetState(int s, Real& t, Real* x) const
+{
+    t = mTimes[s];
+    for (int d = 0; d < mDimension; ++d)
+    {
+        x[d] = GetComponent(d)[s];
+    }
+}
+
+template <typename Real>
+void OdeEnsemble<Real>::Update(Method method, Real tDelta, int numSteps)
+{
+    std::vector<Scratch> scratch(mNumThreads);
+    size_t const numChunks = (static_cast<size_t>(mNumSystems) + mChunkSize - 1) / mChunkSize;
+    ParallelFor(numChunks, 1, mNumThreads, [this, method, tDelta, numSteps,
+        &scratch](unsigned int t, size_t first, size_t last)
+    {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            int begin = static_cast<int>(chunk) * mChunkSize;
+            int numLanes = std::min(mChunkSize, mNumSystems - begin);
+            UpdateChunk(method, tDelta, numSteps, begin, numLanes, scratch[t]);
+        }
+    });
+}
+
+template <typename Real>
+typename OdeEnsemble<Real>::AdaptiveResult OdeEnsemble<Real>::Integrate(
+    Real tFinal, AdaptiveParameters const& parameters)
+{
+    std::vector<Scratch> scratch(mNumThreads);
+    std::vector<size_t> numAccepted(mNumThreads, 0), numRejected(mNumThreads, 0);
+    std::vector<int> numFailed(mNumThreads, 0);
+    size_t const numChunks = (static_cast<size_t>(mNumSystems) + mChunkSize - 1) / mChunkSize;
+    ParallelFor(numChunks, 1, mNumThreads, [this, tFinal, &parameters, &scratch,
+        &numAccepted, &numRejected, &numFailed](unsigned int t, size_t first, size_t last)
+    {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            int begin = static_cast<int>(chunk) * mChunkSize;
+            int numLanes = std::min(mChunkSize, mNumSystems - begin);
+            IntegrateChunk(tFinal, parameters, begin, numLanes, scratch[t],
+                numAccepted[t], numRejected[t], numFailed[t]);
+        }
+    });
+
+    AdaptiveResult result = { 0, 0, 0 };
+    for (unsigned int t = 0; t < mNumThreads; ++t)
+    {
+        result.numAccepted += numAccepted[t];
+        result.numRejected += numRejected[t];
+        result.numFailed += numFailed[t];
+    }
+    return result;
+}
+
+template <typename Real>
+Real* const* OdeEnsemble<Real>::GetScratchState(Scratch& scratch, int i) const
+{
+    return &scratch.pointers[static_cast<size_t>(i) * mDimension];
+}
+
+template <typename Real>
+void OdeEnsemble<Real>::UpdateChunk(Method method, Real tDelta, int numSteps,
+    int begin, int numLanes, Scratch& scratch)
+{
+    // Arrays 0 through 3 store F-values, array 4 stores a temporary state.
+    int const numArrays = 5;
+    int const dimension = mDimension;
+    size_t const stride = static_cast<size_t>(mChunkSize);
+    scratch.values.resize(numArrays * dimension * stride);
+    scratch.pointers.resize(numArrays * dimension);
+    for (int i = 0; i < numArrays * dimension; ++i)
+    {
+        scratch.pointers[i] = &scratch.values[i * stride];
+    }
+    scratch.t1.resize(stride);
+
+    State x(dimension);
+    for (int d = 0; d < dimension; ++d)
+    {
+        x[d] = GetComponent(d) + begin;
+    }
+    Real* t = &mTimes[begin];
+    Real* tTemp = scratch.t1.data();
+    Real* const* f1 = GetScratchState(scratch, 0);
+    Real* const* f2 = GetScratchState(scratch, 1);
+    Real* const* f3 = GetScratchState(scratch, 2);
+    Real* const* f4 = GetScratchState(scratch, 3);
+    Real* const* xTemp = GetScratchState(scratch, 4);
+    Real const halfTDelta = ((Real)0.5) * tDelta;
+    Real const sixthTDelta = tDelta / (Real)6;
+
+    for (int step = 0; step < numSteps; ++step)
+    {
+        mFunction(numLanes, t, x.data(), f1);
+
+        if (method == Method::EULER)
+        {
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    x[d][l] += tDelta * f1[d][l];
+                }
+            }
+        }
+        else if (method == Method::MIDPOINT)
+        {
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    xTemp[d][l] = x[d][l] + halfTDelta * f1[d][l];
+                }
+            }
+            for (int l = 0; l < numLanes; ++l)
+            {
+                tTemp[l] = t[l] + halfTDelta;
+            }
+
+            mFunction(numLanes, tTemp, xTemp, f2);
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    x[d][l] += tDelta * f2[d][l];
+                }
+            }
+        }
+        else  // Method::RUNGE_KUTTA_4
+        {
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    xTemp[d][l] = x[d][l] + halfTDelta * f1[d][l];
+                }
+            }
+            for (int l = 0; l < numLanes; ++l)
+            {
+                tTemp[l] = t[l] + halfTDelta;
+            }
+
+            mFunction(numLanes, tTemp, xTemp, f2);
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    xTemp[d][l] = x[d][l] + halfTDelta * f2[d][l];
+                }
+            }
+
+            mFunction(numLanes, tTemp, xTemp, f3);
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    xTemp[d][l] = x[d][l] + tDelta * f3[d][l];
+                }
+            }
+            for (int l = 0; l < numLanes; ++l)
+            {
+                tTemp[l] = t[l] + tDelta;
+            }
+
+            mFunction(numLanes, tTemp, xTemp, f4);
+            for (int d = 0; d < dimension; ++d)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    x[d][l] += sixthTDelta * (f1[d][l] +
+                        ((Real)2)*(f2[d][l] + f3[d][l]) + f4[d][l]);
+                }
+            }
+        }
+
+        for (int l = 0; l < numLanes; ++l)
+        {
+            t[l] += tDelta;
+        }
+    }
+}
+
+template <typename Real>
+void OdeEnsemble<Real>::IntegrateChunk(Real tFinal,
+    AdaptiveParameters const& parameters, int begin, int numLanes,
+    Scratch& scratch, size_t& numAccepted, size_t& numRejected,
+    int& numFailed)
+{
+    // The Dormand-Prince 5(4) coefficients.  The fifth-order solution is
+    // propagated and the stage k7 is the k1 of the next step.
+    Real const c2 = (Real)1 / (Real)5, c3 = (Real)3 / (Real)10;
+    Real const c4 = (Real)4 / (Real)5, c5 = (Real)8 / (Real)9;
+    Real const a21 = (Real)1 / (Real)5;
+    Real const a31 = (Real)3 / (Real)40, a32 = (Real)9 / (Real)40;
+    Real const a41 = (Real)44 / (Real)45, a42 = (Real)-56 / (Real)15;
+    Real const a43 = (Real)32 / (Real)9;
+    Real const a51 = (Real)19372 / (Real)6561, a52 = (Real)-25360 / (Real)2187;
+    Real const a53 = (Real)64448 / (Real)6561, a54 = (Real)-212 / (Real)729;
+    Real const a61 = (Real)9017 / (Real)3168, a62 = (Real)-355 / (Real)33;
+    Real const a63 = (Real)46732 / (Real)5247, a64 = (Real)49 / (Real)176;
+    Real const a65 = (Real)-5103 / (Real)18656;
+    Real const b1 = (Real)35 / (Real)384, b3 = (Real)500 / (Real)1113;
+    Real const b4 = (Real)125 / (Real)192, b5 = (Real)-2187 / (Real)6784;
+    Real const b6 = (Real)11 / (Real)84;
+    Real const e1 = (Real)71 / (Real)57600, e3 = (Real)-71 / (Real)16695;
+    Real const e4 = (Real)71 / (Real)1920, e5 = (Real)-17253 / (Real)339200;
+    Real const e6 = (Real)22 / (Real)525, e7 = (Real)-1 / (Real)40;
+
+    // Arrays 0 through 6 store the stages k1 through k7, array 7 stores the
+    // stage state and array 8 stores the new state.
+    int const numArrays = 9;
+    int const dimension = mDimension;
+    size_t const stride = static_cast<size_t>(mChunkSize);
+    scratch.values.resize(numArrays * dimension * stride);
+    scratch.pointers.resize(numArrays * dimension);
+    for (int i = 0; i < numArrays * dimension; ++i)
+    {
+        scratch.pointers[i] = &scratch.values[i * stride];
+    }
+    scratch.t1.resize(stride);
+    scratch.h.resize(stride);
+    scratch.error.resize(stride);
+
+    State x(dimension);
+    for (int d = 0; d < dimension; ++d)
+    {
+        x[d] = GetComponent(d) + begin;
+    }
+    Real* t = &mTimes[begin];
+    Real* hLane = &mStepSizes[begin];
+    Real* tStage = scratch.t1.data();
+    Real* h = scratch.h.data();
+    Real* error = scratch.error.data();
+    Real* const* k1 = GetScratchState(scratch, 0);
+    Real* const* k2 = GetScratchState(scratch, 1);
+    Real* const* k3 = GetScratchState(scratch, 2);
+    Real* const* k4 = GetScratchState(scratch, 3);
+    Real* const* k5 = GetScratchState(scratch, 4);
+    Real* const* k6 = GetScratchState(scratch, 5);
+    Real* const* k7 = GetScratchState(scratch, 6);
+    Real* const* xStage = GetScratchState(scratch, 7);
+    Real* const* xNew = GetScratchState(scratch, 8);
+
+    // A lane is active while its time is smaller than tFinal and it has
+    // not failed.
+    std::vector<char> active(numLanes);
+    std::vector<int> numSteps(numLanes, 0);
+    int numActive = 0;
+    for (int l = 0; l < numLanes; ++l)
+    {
+        active[l] = (t[l] < tFinal ? 1 : 0);
+        numActive += active[l];
+    }
+    if (numActive == 0)
+    {
+        return;
+    }
+
+    // The error weight of component d of lane l.
+    auto weight = [&parameters](Real x0, Real x1)
+    {
+        return parameters.absoluteTolerance + parameters.relativeTolerance *
+            std::max(std::abs(x0), std::abs(x1));
+    };
+
+    auto clampStep = [&parameters](Real step)
+    {
+        return std::min(std::max(step, parameters.minStep), parameters.maxStep);
+    };
+
+    mFunction(numLanes, t, x.data(), k1);
+
+    // Estimate the first step for lanes without a step size.  The step sizes
+    // set by the caller are clamped.
+    for (int l = 0; l < numLanes; ++l)
+    {
+        if (active[l] && hLane[l] > (Real)0)
+        {
+            hLane[l] = clampStep(hLane[l]);
+        }
+        else if (active[l])
+        {
+            if (parameters.initialStep > (Real)0)
+            {
+                hLane[l] = clampStep(parameters.initialStep);
+            }
+            else
+            {
+                Real sqrNormX = (Real)0, sqrNormF = (Real)0;
+                for (int d = 0; d < dimension; ++d)
+                {
+                    Real w = weight(x[d][l], x[d][l]);
+                    sqrNormX += (x[d][l] / w) * (x[d][l] / w);
+                    sqrNormF += (k1[d][l] / w) * (k1[d][l] / w);
+                }
+                Real const tiny = (Real)1e-5;
+                Real normX = std::sqrt(sqrNormX / static_cast<Real>(dimension));
+                Real normF = std::sqrt(sqrNormF / static_cast<Real>(dimension));
+                hLane[l] = clampStep(normX < tiny || normF < tiny ? (Real)1e-6 : (Real)0.01 * normX / normF);
+            }
+        }
+    }
+
+    while (numActive > 0)
+    {
+        // Inactive lanes take zero steps, so their stage states are their
+        // current states.
+        for (int l = 0; l < numLanes; ++l)
+        {
+            h[l] = (active[l] ? std::min(hLane[l], tFinal - t[l]) : (Real)0);
+        }
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xStage[d][l] = x[d][l] + h[l] * (a21 * k1[d][l]);
+            }
+        }
+        for (int l = 0; l < numLanes; ++l)
+        {
+            tStage[l] = t[l] + c2 * h[l];
+        }
+        mFunction(numLanes, tStage, xStage, k2);
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xStage[d][l] = x[d][l] + h[l] * (a31 * k1[d][l] + a32 * k2[d][l]);
+            }
+        }
+        for (int l = 0; l < numLanes; ++l)
+        {
+            tStage[l] = t[l] + c3 * h[l];
+        }
+        mFunction(numLanes, tStage, xStage, k3);
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xStage[d][l] = x[d][l] + h[l] * (a41 * k1[d][l] + a42 * k2[d][l]
+                    + a43 * k3[d][l]);
+            }
+        }
+        for (int l = 0; l < numLanes; ++l)
+        {
+            tStage[l] = t[l] + c4 * h[l];
+        }
+        mFunction(numLanes, tStage, xStage, k4);
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xStage[d][l] = x[d][l] + h[l] * (a51 * k1[d][l] + a52 * k2[d][l]
+                    + a53 * k3[d][l] + a54 * k4[d][l]);
+            }
+        }
+        for (int l = 0; l < numLanes; ++l)
+        {
+            tStage[l] = t[l] + c5 * h[l];
+        }
+        mFunction(numLanes, tStage, xStage, k5);
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xStage[d][l] = x[d][l] + h[l] * (a61 * k1[d][l] + a62 * k2[d][l]
+                    + a63 * k3[d][l] + a64 * k4[d][l] + a65 * k5[d][l]);
+            }
+        }
+        for (int l = 0; l < numLanes; ++l)
+        {
+            tStage[l] = t[l] + h[l];
+        }
+        mFunction(numLanes, tStage, xStage, k6);
+
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                xNew[d][l] = x[d][l] + h[l] * (b1 * k1[d][l] + b3 * k3[d][l]
+                    + b4 * k4[d][l] + b5 * k5[d][l] + b6 * k6[d][l]);
+            }
+        }
+        mFunction(numLanes, tStage, xNew, k7);
+
+        // The error estimate is the difference between the fifth-order
+        // and fourth-order solutions.
+        std::fill(error, error + numLanes, (Real)0);
+        for (int d = 0; d < dimension; ++d)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                Real e = h[l] * (e1 * k1[d][l] + e3 * k3[d][l] + e4 * k4[d][l]
+                    + e5 * k5[d][l] + e6 * k6[d][l] + e7 * k7[d][l]);
+                e /= weight(x[d][l], xNew[d][l]);
+                error[l] += e * e;
+            }
+        }
+
+        for (int l = 0; l < numLanes; ++l)
+        {
+            if (!active[l])
+            {
+                continue;
+            }
+
+            Real err = std::sqrt(error[l] / static_cast<Real>(dimension));
+            bool accept = (err <= (Real)1);
+            bool failed = false;
+            Real scale;
+            if (err > (Real)0)
+            {
+                scale = parameters.safety * std::pow(err, (Real)-0.2);
+                scale = std::min(std::max(scale, parameters.minScale), parameters.maxScale);
+            }
+            else
+            {
+                scale = parameters.maxScale;
+            }
+
+            if (accept)
+            {
+                ++numAccepted;
+                for (int d = 0; d < dimension; ++d)
+                {
+                    x[d][l] = xNew[d][l];
+                    k1[d][l] = k7[d][l];
+                }
+
+                // Land exactly on tFinal when the step was clamped.
+                t[l] = (h[l] == tFinal - t[l] ? tFinal : t[l] + h[l]);
+
+                // The step size is not increased from a step that was
+                // clamped to reach tFinal.
+                if (h[l] == hLane[l])
+                {
+                    hLane[l] = clampStep(h[l] * scale);
+                }
+            }
+            else
+            {
+                ++numRejected;
+                failed = (hLane[l] <= parameters.minStep);
+                hLane[l] = clampStep(h[l] * std::min(scale, (Real)1));
+            }
+
+            ++numSteps[l];
+            if (t[l] >= tFinal)
+            {
+                active[l] = 0;
+                --numActive;
+            }
+            else if (failed || numSteps[l] >= parameters.maxSteps || !std::isfinite(err))
+            {
+                active[l] = 0;
+                --numActive;
+                ++numFailed;
+            }
+        }
+    }
+}
+
+
+}
@@ -0,0 +1,377 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#pragma once
+
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteGVector.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Support for the sparse mode of GaussNewtonMinimizer and
+// LevenbergMarquardtMinimizer.  See GteGaussNewtonMinimizer.h for a
+// formulation of the minimization problem.
+//
+// In many applications, such as bundle adjustment, the components of
+// F(p) are partitioned into observation blocks and each block depends on
+// only a few of the parameters.  The Jacobian J is then mostly zeros, and
+// so is J^T*J when the number of parameters is large.  The caller describes
+// each block by its number of F-components and the indices of the parameters
+// it depends on, and it provides a function that computes the F-components
+// of a block and the derivatives of those components with respect to the
+// block parameters.  The blocks are evaluated concurrently, J^T*J is
+// assembled in compressed sparse row format, and the normal equations are
+// solved by the conjugate gradient method with a Jacobi preconditioner.
+
+namespace gte
+{
+    template <typename Real>
+    class SparseNormalEquations
+    {
+    public:
+        struct Block
+        {
+            // The number of components of F in the block.  The components
+            // of the blocks are stored consecutively in F, in block order.
+            int numFDimensions;
+
+            // The indices of the parameters on which the block depends.
+            std::vector<int> parameters;
+        };
+
+        // The function computes the block F-components F_b(p) in F[] and,
+        // when J is not null, the block Jacobian in J[] with numFDimensions
+        // rows and parameters.size() columns, stored in row-major order.
+        // Column c is the derivative with respect to p[parameters[c]].  The
+        // function is called concurrently for different blocks, so it must
+        // be thread-safe.
+        typedef std::function<void(int, GVector<Real> const&, Real*, Real*)> BlockFunction;
+
+        SparseNormalEquations(int numPDimensions, std::vector<Block> const& blocks,
+            BlockFunction const& blockFunction, unsigned int numThreads)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(0),
+            mBlocks(blocks),
+            mBlockFunction(blockFunction),
+            mNumThreads(std::max(numThreads, 1u)),
+            mMaxIterations(numPDimensions),
+            mTolerance(std::sqrt(std::numeric_limits<Real>::epsilon())),
+            mNumIterations(0)
+        {
+            LogAssert(mNumPDimensions > 0 && mBlocks.size() > 0, "Invalid dimensions.");
+
+            // Compute the offsets of the blocks in F and in the Jacobian
+            // storage and the blocks that depend on each parameter.
+            int const numBlocks = static_cast<int>(mBlocks.size());
+            mFOffsets.resize(numBlocks);
+            mJOffsets.resize(numBlocks);
+            std::vector<int> counts(mNumPDimensions, 0);
+            size_t numJValues = 0;
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                Block const& block = mBlocks[b];
+                LogAssert(block.numFDimensions > 0 && block.parameters.size() > 0, "Invalid block.");
+                mFOffsets[b] = mNumFDimensions;
+                mJOffsets[b] = numJValues;
+                mNumFDimensions += block.numFDimensions;
+                numJValues += static_cast<size_t>(block.numFDimensions) * block.parameters.size();
+                for (auto i : block.parameters)
+                {
+                    LogAssert(0 <= i && i < mNumPDimensions, "Invalid parameter index.");
+                    ++counts[i];
+                }
+            }
+            mJValues.resize(numJValues);
+
+            mParameterOffsets.resize(mNumPDimensions + 1);
+            mParameterOffsets[0] = 0;
+            for (int i = 0; i < mNumPDimensions; ++i)
+            {
+                mParameterOffsets[i + 1] = mParameterOffsets[i] + counts[i];
+                counts[i] = mParameterOffsets[i];
+            }
+            mParameterBlocks.resize(mParameterOffsets[mNumPDimensions]);
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                int const numColumns = static_cast<int>(mBlocks[b].parameters.size());
+                for (int c = 0; c < numColumns; ++c)
+                {
+                    mParameterBlocks[counts[mBlocks[b].parameters[c]]++] = std::make_pair(b, c);
+                }
+            }
+
+            // The nonzero pattern of J^T*J.  Row i has a nonzero in column j
+            // when a block depends on both p[i] and p[j].
+            std::vector<int> marker(mNumPDimensions, -1);
+            mRowOffsets.resize(mNumPDimensions + 1);
+            mRowOffsets[0] = 0;
+            mDiagonal.resize(mNumPDimensions);
+            for (int i = 0; i < mNumPDimensions; ++i)
+            {
+                marker[i] = i;
+                mColumns.push_back(i);
+                for (int k = mParameterOffsets[i]; k < mParameterOffsets[i + 1]; ++k)
+                {
+                    for (auto j : mBlocks[mParameterBlocks[k].first].parameters)
+                    {
+                        if (marker[j] != i)
+                        {
+                            marker[j] = i;
+                            mColumns.push_back(j);
+                        }
+                    }
+                }
+                mRowOffsets[i + 1] = static_cast<int>(mColumns.size());
+
+                auto begin = mColumns.begin() + mRowOffsets[i];
+                auto end = mColumns.begin() + mRowOffsets[i + 1];
+                std::sort(begin, end);
+                mDiagonal[i] = static_cast<int>(std::lower_bound(begin, end, i) - mColumns.begin());
+            }
+            mValues.resize(mColumns.size());
+        }
+
+        // Disallow copy, assignment and move semantics.
+        SparseNormalEquations(SparseNormalEquations const&) = delete;
+        SparseNormalEquations& operator=(SparseNormalEquations const&) = delete;
+        SparseNormalEquations(SparseNormalEquations&&) = delete;
+        SparseNormalEquations& operator=(SparseNormalEquations&&) = delete;
+
+        inline int GetNumPDimensions() const { return mNumPDimensions; }
+        inline int GetNumFDimensions() const { return mNumFDimensions; }
+
+        // The number of nonzero elements of J^T*J.
+        inline size_t GetNumNonzeros() const { return mValues.size(); }
+
+        // The conjugate gradient iterations stop when the residual length
+        // is at most 'tolerance' times the length of -J^T*F or after
+        // 'maxIterations' iterations.  The defaults are the square root of
+        // the machine epsilon and the number of parameters.
+        void SetSolverParameters(int maxIterations, Real tolerance)
+        {
+            mMaxIterations = std::max(maxIterations, 1);
+            mTolerance = std::max(tolerance, (Real)0);
+        }
+
+        // The number of conjugate gradient iterations of the last Solve.
+        inline int GetNumSolverIterations() const { return mNumIterations; }
+
+        // Compute F(p).
+        void ComputeF(GVector<Real> const& p, GVector<Real>& F)
+        {
+            ParallelFor(mBlocks.size(), CHUNK_SIZE, mNumThreads,
+                [this, &p, &F](unsigned int, size_t begin, size_t end)
+            {
+                for (size_t b = begin; b < end; ++b)
+                {
+                    mBlockFunction(static_cast<int>(b), p, &F[mFOffsets[b]], nullptr);
+                }
+            });
+        }
+
+        // Compute F(p), J^T(p)*J(p) + lambda*average(diagonal(J^T*J))*I and
+        // -J^T(p)*F(p).
+        void ComputeLinearSystemInputs(GVector<Real> const& p, Real lambda,
+            GVector<Real>& F, GVector<Real>& negJTF)
+        {
+            ParallelFor(mBlocks.size(), CHUNK_SIZE, mNumThreads,
+                [this, &p, &F](unsigned int, size_t begin, size_t end)
+            {
+                for (size_t b = begin; b < end; ++b)
+                {
+                    mBlockFunction(static_cast<int>(b), p, &F[mFOffsets[b]], &mJValues[mJOffsets[b]]);
+                }
+            });
+
+            // Each row of J^T*J is assembled by one thread from the blocks
+            // that depend on the row parameter.
+            std::vector<std::vector<int>> positions(mNumThreads);
+            ParallelFor(static_cast<size_t>(mNumPDimensions), CHUNK_SIZE, mNumThreads,
+                [this, &F, &negJTF, &positions](unsigned int t, size_t begin, size_t end)
+            {
+                std::vector<int>& position = positions[t];
+                position.resize(mNumPDimensions);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    for (int k = mRowOffsets[i]; k < mRowOffsets[i + 1]; ++k)
+                    {
+                        position[mColumns[k]] = k;
+                        mValues[k] = (Real)0;
+                    }
+
+                    Real sum = (Real)0;
+                    for (int k = mParameterOffsets[i]; k < mParameterOffsets[i + 1]; ++k)
+                    {
+                        int const b = mParameterBlocks[k].first;
+                        int const column = mParameterBlocks[k].second;
+                        Block const& block = mBlocks[b];
+                        int const numColumns = static_cast<int>(block.parameters.size());
+                        Real const* blockF = &F[mFOffsets[b]];
+                        Real const* blockJ = &mJValues[mJOffsets[b]];
+                        for (int r = 0; r < block.numFDimensions; ++r, blockJ += numColumns)
+                        {
+                            Real const factor = blockJ[column];
+                            if (factor != (Real)0)
+                            {
+                                sum += factor * blockF[r];
+                                for (int c = 0; c < numColumns; ++c)
+                                {
+                                    mValues[position[block.parameters[c]]] += factor * blockJ[c];
+                                }
+                            }
+                        }
+                    }
+                    negJTF[static_cast<int>(i)] = -sum;
+                }
+            });
+
+            if (lambda > (Real)0)
+            {
+                Real diagonalSum(0);
+                for (int i = 0; i < mNumPDimensions; ++i)
+                {
+                    diagonalSum += mValues[mDiagonal[i]];
+                }
+
+                Real diagonalAdjust = lambda * diagonalSum / static_cast<Real>(mNumPDimensions);
+                for (int i = 0; i < mNumPDimensions; ++i)
+                {
+                    mValues[mDiagonal[i]] += diagonalAdjust;
+                }
+            }
+        }
+
+        // Solve (J^T*J + lambda*average*I)*d = -J^T*F using the inputs of the
+        // last call to ComputeLinearSystemInputs.  On input, negJTF is -J^T*F
+        // and on output it is d.  The function returns false when a diagonal
+        // element is not positive or the conjugate gradient method breaks
+        // down before a descent direction is computed, which happens when
+        // the matrix is singular; this is the analog of the Cholesky
+        // decomposition failing in the dense mode.
+        bool Solve(GVector<Real>& negJTF)
+        {
+            int const n = mNumPDimensions;
+            std::vector<Real> invDiagonal(n), x(n, (Real)0), r(n), z(n), d(n), w(n);
+            for (int i = 0; i < n; ++i)
+            {
+                Real diagonal = mValues[mDiagonal[i]];
+                if (diagonal <= (Real)0)
+                {
+                    mNumIterations = 0;
+                    return false;
+                }
+                invDiagonal[i] = (Real)1 / diagonal;
+                r[i] = negJTF[i];
+                z[i] = invDiagonal[i] * r[i];
+                d[i] = z[i];
+            }
+
+            Real const threshold = mTolerance * std::sqrt(Dot(r, r));
+            Real rz = Dot(r, z);
+            for (mNumIterations = 0; mNumIterations < mMaxIterations; )
+            {
+                if (std::sqrt(Dot(r, r)) <= threshold)
+                {
+                    break;
+                }
+
+                ParallelFor(static_cast<size_t>(n), CHUNK_SIZE, mNumThreads,
+                    [this, &d, &w](unsigned int, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        Real sum = (Real)0;
+                        for (int k = mRowOffsets[i]; k < mRowOffsets[i + 1]; ++k)
+                        {
+                            sum += mValues[k] * d[mColumns[k]];
+                        }
+                        w[i] = sum;
+                    }
+                });
+
+                Real dw = Dot(d, w);
+                if (dw <= (Real)0)
+                {
+                    if (mNumIterations == 0)
+                    {
+                        return false;
+                    }
+                    break;
+                }
+
+                ++mNumIterations;
+                Real alpha = rz / dw;
+                for (int i = 0; i < n; ++i)
+                {
+                    x[i] += alpha * d[i];
+                    r[i] -= alpha * w[i];
+                    z[i] = invDiagonal[i] * r[i];
+                }
+
+                Real rzNext = Dot(r, z);
+                Real beta = rzNext / rz;
+                rz = rzNext;
+                for (int i = 0; i < n; ++i)
+                {
+                    d[i] = z[i] + beta * d[i];
+                }
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                negJTF[i] = x[i];
+            }
+            return true;
+        }
+
+    private:
+        // The observation blocks and the parameter indices are distributed
+        // dynamically to the threads in chunks of CHUNK_SIZE.
+        enum { CHUNK_SIZE = 64 };
+
+        static Real Dot(std::vector<Real> const& u, std::vector<Real> const& v)
+        {
+            Real sum = (Real)0;
+            for (size_t i = 0; i < u.size(); ++i)
+            {
+                sum += u[i] * v[i];
+            }
+            return sum;
+        }
+
+        int mNumPDimensions, mNumFDimensions;
+        std::vector<Block> mBlocks;
+        BlockFunction mBlockFunction;
+        unsigned int mNumThreads;
+
+        // The offsets of the blocks in F and in the Jacobian storage.
+        std::vector<int> mFOffsets;
+        std::vector<size_t> mJOffsets;
+        std::vector<Real> mJValues;
+
+        // The (block, column) pairs of the blocks that depend on parameter
+        // i are mParameterBlocks[k] for mParameterOffsets[i] <= k <
+        // mParameterOffsets[i+1].
+        std::vector<int> mParameterOffsets;
+        std::vector<std::pair<int, int>> mParameterBlocks;
+
+        // J^T*J in compressed sparse row format, including the indices of
+        // the diagonal elements.
+        std::vector<int> mRowOffsets, mColumns, mDiagonal;
+        std::vector<Real> mValues;
+
+        // Conjugate gradient parameters.
+        int mMaxIterations;
+        Real mTolerance;
+        int mNumIterations;
+    };
+}
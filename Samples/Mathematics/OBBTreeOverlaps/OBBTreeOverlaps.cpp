@@ -0,0 +1,171 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <Mathematics/GteOBBTreeOfPoints.h>
+#include <Mathematics/GteRotation.h>
+#include <algorithm>
+#include <iostream>
+#include <random>
+using namespace gte;
+
+// Compare the tree-tree overlap queries of OBBTreeForPoints with a brute-force
+// comparison of all pairs of leaf boxes.  The trees are built from random
+// point clouds with a single thread and with several threads, and the second
+// tree is transformed by random rigid motions.
+
+typedef OBBTreeForPoints<double> Tree;
+
+std::vector<uint32_t> GetLeaves(Tree const& tree)
+{
+    std::vector<uint32_t> leaves;
+    auto const& nodes = tree.GetTree();
+    for (uint32_t n = 0; n < static_cast<uint32_t>(nodes.size()); ++n)
+    {
+        if (Tree::IsLeaf(nodes[n]))
+        {
+            leaves.push_back(n);
+        }
+    }
+    return leaves;
+}
+
+OrientedBox3<double> Transform(OrientedBox3<double> const& box,
+    Matrix3x3<double> const& rotation, Vector3<double> const& translation)
+{
+    OrientedBox3<double> result;
+    result.center = rotation * box.center + translation;
+    for (int i = 0; i < 3; ++i)
+    {
+        result.axis[i] = rotation * box.axis[i];
+    }
+    result.extent = box.extent;
+    return result;
+}
+
+bool Contains(OrientedBox3<double> const& box, OrientedBox3<double> const& child)
+{
+    // The projection of the child box onto a box axis must be contained in
+    // the projection of the box.  The tolerance allows for rounding errors.
+    double const epsilon = 1e-10;
+    for (int j = 0; j < 3; ++j)
+    {
+        double center = Dot(box.axis[j], child.center - box.center);
+        double radius = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            radius += child.extent[i] * std::abs(Dot(box.axis[j], child.axis[i]));
+        }
+        if (std::abs(center) + radius > box.extent[j] + epsilon)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CountUncontained(Tree const& tree)
+{
+    int numUncontained = 0;
+    auto const& nodes = tree.GetTree();
+    for (auto const& node : nodes)
+    {
+        if (!Tree::IsLeaf(node))
+        {
+            if (!Contains(node.box, nodes[node.leftChild].box))
+            {
+                ++numUncontained;
+            }
+            if (!Contains(node.box, nodes[node.rightChild].box))
+            {
+                ++numUncontained;
+            }
+        }
+    }
+    return numUncontained;
+}
+
+int main(int, char const*[])
+{
+    std::mt19937 mte;
+    std::uniform_real_distribution<double> rnd(-1.0, 1.0);
+    TIQuery<double, OrientedBox3<double>, OrientedBox3<double>> query;
+
+    int const numTrials = 100;
+    uint32_t const numPoints = 1024, height = 5;
+    int numFailures = 0, numOverlapping = 0, numUncontained = 0;
+    size_t numTreePairs = 0, numBrutePairs = 0;
+    for (int trial = 0; trial < numTrials; ++trial)
+    {
+        // Anisotropic clouds give boxes of varied orientations.
+        std::vector<Vector3<double>> points0(numPoints), points1(numPoints);
+        Vector3<double> scale{ 1.0 + std::abs(rnd(mte)), 0.5, 0.25 };
+        for (uint32_t i = 0; i < numPoints; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                points0[i][j] = scale[j] * rnd(mte);
+                points1[i][j] = scale[2 - j] * rnd(mte);
+            }
+        }
+
+        unsigned int const numThreads = (trial % 2 == 0 ? 1 : 4);
+        Tree tree0(numPoints, reinterpret_cast<char const*>(points0.data()),
+            sizeof(Vector3<double>), height, numThreads);
+        Tree tree1(numPoints, reinterpret_cast<char const*>(points1.data()),
+            sizeof(Vector3<double>), height, numThreads);
+        numUncontained += CountUncontained(tree0) + CountUncontained(tree1);
+
+        Vector3<double> axis{ rnd(mte), rnd(mte), rnd(mte) };
+        Normalize(axis);
+        Matrix3x3<double> rotation = Rotation<3, double>(
+            AxisAngle<3, double>(axis, GTE_C_PI * rnd(mte)));
+        Vector3<double> translation{ 1.5 * rnd(mte), 1.5 * rnd(mte), 1.5 * rnd(mte) };
+
+        std::vector<std::array<uint32_t, 2>> treePairs, brutePairs;
+        tree0.FindOverlaps(tree1, treePairs, rotation, translation);
+        bool overlaps = tree0.Overlaps(tree1, rotation, translation);
+
+        auto const& nodes0 = tree0.GetTree();
+        auto const& nodes1 = tree1.GetTree();
+        for (auto leaf0 : GetLeaves(tree0))
+        {
+            for (auto leaf1 : GetLeaves(tree1))
+            {
+                if (query(nodes0[leaf0].box, Transform(nodes1[leaf1].box,
+                    rotation, translation)).intersect)
+                {
+                    brutePairs.push_back({ leaf0, leaf1 });
+                }
+            }
+        }
+
+        std::sort(treePairs.begin(), treePairs.end());
+        numTreePairs += treePairs.size();
+        numBrutePairs += brutePairs.size();
+        if (brutePairs.size() > 0)
+        {
+            ++numOverlapping;
+        }
+        if (treePairs != brutePairs || overlaps != (brutePairs.size() > 0))
+        {
+            std::cout << "trial = " << trial << ": tree pairs = "
+                << treePairs.size() << ", brute-force pairs = "
+                << brutePairs.size() << ", overlaps = " << overlaps
+                << std::endl;
+            ++numFailures;
+        }
+    }
+
+    std::cout << "overlapping trials = " << numOverlapping << " of "
+        << numTrials << std::endl;
+    std::cout << "leaf pairs: tree = " << numTreePairs << ", brute force = "
+        << numBrutePairs << std::endl;
+    std::cout << "child boxes not contained in their parent = "
+        << numUncontained << std::endl;
+    std::cout << "failures = " << numFailures << std::endl;
+    return (numFailures == 0 && numUncontained == 0 ? 0 : -1);
+}
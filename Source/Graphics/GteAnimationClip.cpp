@@ -0,0 +1,244 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <Graphics/GteAnimationClip.h>
+#include <Graphics/GteKeyframeController.h>
+#include <algorithm>
+#include <cmath>
+using namespace gte;
+
+
+AnimationClip::~AnimationClip()
+{
+}
+
+AnimationClip::AnimationClip(int numTracks, int numKeys, float minTime, float maxTime)
+    :
+    mNumTracks(0),
+    mNumKeys(0),
+    mMinTime(minTime),
+    mMaxTime(maxTime),
+    mInvDelta(0.0f)
+{
+    if (numTracks <= 0 || numKeys < 2 || minTime >= maxTime)
+    {
+        LogError("Invalid inputs.");
+        return;
+    }
+
+    mNumTracks = numTracks;
+    mNumKeys = numKeys;
+    mInvDelta = static_cast<float>(numKeys - 1) / (maxTime - minTime);
+    mChannels.resize(numTracks);
+    std::fill(mChannels.begin(), mChannels.end(), 0);
+
+    Key identity;
+    identity.translation[0] = 0.0f;
+    identity.translation[1] = 0.0f;
+    identity.translation[2] = 0.0f;
+    identity.scale = 1.0f;
+    identity.rotation[0] = 0;
+    identity.rotation[1] = 0;
+    identity.rotation[2] = 0;
+    identity.rotation[3] = 32767;
+    mKeys.resize(static_cast<size_t>(numTracks) * numKeys);
+    std::fill(mKeys.begin(), mKeys.end(), identity);
+}
+
+void AnimationClip::SetChannels(int track, int channels)
+{
+    if (0 <= track && track < mNumTracks)
+    {
+        mChannels[track] = (channels & CHANNEL_ALL);
+        return;
+    }
+    LogError("Invalid track.");
+}
+
+void AnimationClip::SetKey(int track, int key, Vector4<float> const& translation,
+    Quaternion<float> const& rotation, float scale)
+{
+    if (0 <= track && track < mNumTracks && 0 <= key && key < mNumKeys)
+    {
+        Key& target = GetKey(track, key);
+        for (int i = 0; i < 3; ++i)
+        {
+            target.translation[i] = translation[i];
+        }
+        target.scale = scale;
+        for (int i = 0; i < 4; ++i)
+        {
+            float value = std::min(std::max(rotation[i], -1.0f), 1.0f);
+            target.rotation[i] = static_cast<int16_t>(std::lround(32767.0f * value));
+        }
+        return;
+    }
+    LogError("Invalid track or key.");
+}
+
+void AnimationClip::SetTrack(int track, KeyframeController& controller)
+{
+    if (track < 0 || track >= mNumTracks)
+    {
+        LogError("Invalid track.");
+        return;
+    }
+
+    // The channels use the common times when there are common times.
+    int const numCommonTimes = controller.GetNumCommonTimes();
+    int const numTranslations = controller.GetNumTranslations();
+    int const numRotations = controller.GetNumRotations();
+    int const numScales = controller.GetNumScales();
+    float const* commonTimes = controller.GetCommonTimes();
+    float const* translationTimes = (numCommonTimes > 0 ? commonTimes : controller.GetTranslationTimes());
+    float const* rotationTimes = (numCommonTimes > 0 ? commonTimes : controller.GetRotationTimes());
+    float const* scaleTimes = (numCommonTimes > 0 ? commonTimes : controller.GetScaleTimes());
+    Vector4<float> const* translations = controller.GetTranslations();
+    Quaternion<float> const* rotations = controller.GetRotations();
+    float const* scales = controller.GetScales();
+
+    // Find the keys i0 and i1 = i0+1 (or i1 = i0 at the ends) and the
+    // interpolation parameter u for time t.
+    auto lookup = [](float t, int numTimes, float const* times, int& i0, int& i1, float& u)
+    {
+        if (t <= times[0] || numTimes == 1)
+        {
+            i0 = 0;
+            i1 = 0;
+            u = 0.0f;
+        }
+        else if (t >= times[numTimes - 1])
+        {
+            i0 = numTimes - 1;
+            i1 = numTimes - 1;
+            u = 0.0f;
+        }
+        else
+        {
+            i1 = static_cast<int>(std::upper_bound(times, times + numTimes, t) - times);
+            i0 = i1 - 1;
+            u = (t - times[i0]) / (times[i1] - times[i0]);
+        }
+    };
+
+    Transform const& transform = controller.GetTransform();
+    Vector4<float> defaultTranslation = transform.GetTranslationW0();
+    Quaternion<float> defaultRotation;
+    transform.GetRotation(defaultRotation);
+    float defaultScale = (transform.IsUniformScale() ? transform.GetUniformScale() : 1.0f);
+
+    float const delta = (mMaxTime - mMinTime) / static_cast<float>(mNumKeys - 1);
+    for (int key = 0; key < mNumKeys; ++key)
+    {
+        float const t = mMinTime + delta * key;
+        int i0, i1;
+        float u;
+
+        Vector4<float> translation = defaultTranslation;
+        if (numTranslations > 0)
+        {
+            lookup(t, numTranslations, translationTimes, i0, i1, u);
+            translation = translations[i0] + u * (translations[i1] - translations[i0]);
+        }
+
+        Quaternion<float> rotation = defaultRotation;
+        if (numRotations > 0)
+        {
+            lookup(t, numRotations, rotationTimes, i0, i1, u);
+            rotation = Slerp(u, rotations[i0], rotations[i1]);
+        }
+
+        float scale = defaultScale;
+        if (numScales > 0)
+        {
+            lookup(t, numScales, scaleTimes, i0, i1, u);
+            scale = scales[i0] + u * (scales[i1] - scales[i0]);
+        }
+
+        SetKey(track, key, translation, rotation, scale);
+    }
+
+    SetChannels(track,
+        (numTranslations > 0 ? CHANNEL_TRANSLATION : 0) |
+        (numRotations > 0 ? CHANNEL_ROTATION : 0) |
+        (numScales > 0 ? CHANNEL_SCALE : 0));
+}
+
+void AnimationClip::Sample(int track, float time, Vector4<float>& translation,
+    Quaternion<float>& rotation, float& scale) const
+{
+    Sample(1, &track, &time, &translation, &rotation, &scale);
+}
+
+void AnimationClip::Sample(int numSamples, int const* tracks, float const* times,
+    Vector4<float>* translations, Quaternion<float>* rotations, float* scales) const
+{
+    int const BLOCK_SIZE = 64;
+    int const maxKey = mNumKeys - 2;
+    float const quantum = 1.0f / 32767.0f;
+    size_t index[BLOCK_SIZE];
+    float parameter[BLOCK_SIZE];
+    for (int s0 = 0; s0 < numSamples; s0 += BLOCK_SIZE)
+    {
+        int const n = std::min(BLOCK_SIZE, numSamples - s0);
+
+        // Compute the key indices and the interpolation parameters.  The
+        // clamped time maps to x in [0,numKeys-1], and the key pair is
+        // (k,k+1) for k = min(floor(x),numKeys-2), so the parameter is 1
+        // at maxTime.
+        for (int i = 0; i < n; ++i)
+        {
+            float const t = std::min(std::max(times[s0 + i], mMinTime), mMaxTime);
+            float const x = (t - mMinTime) * mInvDelta;
+            int const k = std::min(static_cast<int>(x), maxKey);
+            parameter[i] = x - static_cast<float>(k);
+            index[i] = tracks[s0 + i] + static_cast<size_t>(mNumTracks) * k;
+        }
+
+        // Interpolate the keys.
+        for (int i = 0; i < n; ++i)
+        {
+            Key const& key0 = mKeys[index[i]];
+            Key const& key1 = mKeys[index[i] + mNumTracks];
+            float const u = parameter[i];
+            float const oneMinusU = 1.0f - u;
+
+            Vector4<float>& translation = translations[s0 + i];
+            for (int j = 0; j < 3; ++j)
+            {
+                translation[j] = oneMinusU * key0.translation[j] + u * key1.translation[j];
+            }
+            translation[3] = 0.0f;
+
+            scales[s0 + i] = oneMinusU * key0.scale + u * key1.scale;
+
+            float q0[4], q1[4], dot = 0.0f;
+            for (int j = 0; j < 4; ++j)
+            {
+                q0[j] = static_cast<float>(key0.rotation[j]);
+                q1[j] = static_cast<float>(key1.rotation[j]);
+                dot += q0[j] * q1[j];
+            }
+            float const w0 = oneMinusU * quantum;
+            float const w1 = (dot < 0.0f ? -u : u) * quantum;
+            float q[4], sqrLength = 0.0f;
+            for (int j = 0; j < 4; ++j)
+            {
+                q[j] = w0 * q0[j] + w1 * q1[j];
+                sqrLength += q[j] * q[j];
+            }
+            float const invLength = 1.0f / std::sqrt(sqrLength);
+            Quaternion<float>& rotation = rotations[s0 + i];
+            for (int j = 0; j < 4; ++j)
+            {
+                rotation[j] = q[j] * invLength;
+            }
+        }
+    }
+}
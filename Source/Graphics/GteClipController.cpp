@@ -0,0 +1,115 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <Graphics/GteClipController.h>
+#include <Graphics/GteSpatial.h>
+using namespace gte;
+
+
+ClipController::~ClipController()
+{
+}
+
+ClipController::ClipController(std::shared_ptr<AnimationClip> const& clip,
+    int track, Transform const& localTransform)
+    :
+    TransformController(localTransform),
+    mClip(clip),
+    mTrack(track)
+{
+    if (!mClip || track < 0 || track >= mClip->GetNumTracks())
+    {
+        LogError("Invalid clip or track.");
+        mClip = nullptr;
+        return;
+    }
+
+    minTime = static_cast<double>(mClip->GetMinTime());
+    maxTime = static_cast<double>(mClip->GetMaxTime());
+}
+
+bool ClipController::Update(double applicationTime)
+{
+    if (!mClip || !Controller::Update(applicationTime))
+    {
+        return false;
+    }
+
+    float const ctrlTime = static_cast<float>(GetControlTime(applicationTime));
+    Vector4<float> translation;
+    Quaternion<float> rotation;
+    float scale;
+    mClip->Sample(mTrack, ctrlTime, translation, rotation, scale);
+    Apply(translation, rotation, scale);
+    return true;
+}
+
+void ClipController::UpdateBatch(std::vector<ClipController*> const& controllers,
+    double applicationTime)
+{
+    // Gather the active controllers with their tracks and control times.
+    std::vector<ClipController*> active;
+    std::vector<int> tracks;
+    std::vector<float> times;
+    active.reserve(controllers.size());
+    tracks.reserve(controllers.size());
+    times.reserve(controllers.size());
+    for (auto controller : controllers)
+    {
+        if (controller->mClip && controller->Controller::Update(applicationTime))
+        {
+            active.push_back(controller);
+            tracks.push_back(controller->mTrack);
+            times.push_back(static_cast<float>(controller->GetControlTime(applicationTime)));
+        }
+    }
+
+    int const numActive = static_cast<int>(active.size());
+    std::vector<Vector4<float>> translations(numActive);
+    std::vector<Quaternion<float>> rotations(numActive);
+    std::vector<float> scales(numActive);
+    for (int begin = 0, end = 0; begin < numActive; begin = end)
+    {
+        AnimationClip const* clip = active[begin]->mClip.get();
+        for (end = begin + 1; end < numActive && active[end]->mClip.get() == clip; ++end)
+        {
+        }
+
+        clip->Sample(end - begin, &tracks[begin], &times[begin], &translations[begin],
+            &rotations[begin], &scales[begin]);
+    }
+
+    for (int i = 0; i < numActive; ++i)
+    {
+        active[i]->Apply(translations[i], rotations[i], scales[i]);
+    }
+}
+
+void ClipController::Apply(Vector4<float> const& translation,
+    Quaternion<float> const& rotation, float scale)
+{
+    int const channels = mClip->GetChannels(mTrack);
+    if (channels & AnimationClip::CHANNEL_TRANSLATION)
+    {
+        mLocalTransform.SetTranslation(translation);
+    }
+
+    if (channels & AnimationClip::CHANNEL_ROTATION)
+    {
+        mLocalTransform.SetRotation(rotation);
+    }
+
+    if (channels & AnimationClip::CHANNEL_SCALE)
+    {
+        mLocalTransform.SetUniformScale(scale);
+    }
+
+    Spatial* spatial = reinterpret_cast<Spatial*>(mObject);
+    spatial->localTransform = mLocalTransform;
+}
@@ -0,0 +1,350 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <Graphics/GteControllerScheduler.h>
+#include <Graphics/GteIKController.h>
+#include <Graphics/GteMorphController.h>
+#include <Graphics/GteParticleController.h>
+#include <Graphics/GtePointController.h>
+#include <Graphics/GteSkinController.h>
+#include <Graphics/GteTransformController.h>
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
+#include <unordered_map>
+using namespace gte;
+
+
+ControllerScheduler::~ControllerScheduler()
+{
+    Clear();
+}
+
+ControllerScheduler::ControllerScheduler()
+    :
+    minTasksPerThread(4),
+    mHierarchy(nullptr)
+{
+}
+
+void ControllerScheduler::Build(SpatialHierarchy& hierarchy)
+{
+    Clear();
+    mHierarchy = &hierarchy;
+
+    std::vector<Task> ikTasks;
+    std::vector<std::shared_ptr<Controller>> local, skin;
+    int const numObjects = hierarchy.GetNumObjects();
+    for (int i = 0; i < numObjects; ++i)
+    {
+        // The controllers of an object derived from Node are updated by its
+        // Update function.
+        Spatial* object = hierarchy.GetSpatial(i);
+        if (!hierarchy.IsExpanded(i) && dynamic_cast<Node*>(object))
+        {
+            continue;
+        }
+
+        local.clear();
+        skin.clear();
+        for (auto const& controller : object->GetControllers())
+        {
+            Controller* pController = controller.get();
+            if (dynamic_cast<TransformController*>(pController)
+                || dynamic_cast<MorphController*>(pController)
+                || dynamic_cast<PointController*>(pController)
+                || dynamic_cast<ParticleController*>(pController))
+            {
+                local.push_back(controller);
+            }
+            else if (dynamic_cast<SkinController*>(pController))
+            {
+                skin.push_back(controller);
+            }
+            else if (dynamic_cast<IKController*>(pController))
+            {
+                AddTask(i, { controller }, ikTasks);
+                continue;
+            }
+            else
+            {
+                mControllers.push_back(controller);
+                mSerial.push_back(pController);
+                continue;
+            }
+
+            // Replace the post-update function by one that stores the
+            // vertex buffer for phase 7.  The lambda captures the index
+            // rather than a pointer, because mDeferred grows.
+            size_t const k = mDeferred.size();
+            Updater postUpdate = [this, k](std::shared_ptr<VertexBuffer> const& vbuffer)
+            {
+                mDeferred[k].vbuffer = vbuffer;
+            };
+            if (ExchangePostUpdate(pController, postUpdate))
+            {
+                mDeferred.push_back({ pController, postUpdate, nullptr });
+            }
+        }
+
+        if (local.size() > 0)
+        {
+            AddTask(i, local, mLocalTasks);
+        }
+        if (skin.size() > 0)
+        {
+            AddTask(i, skin, mSkinTasks);
+        }
+    }
+
+    BuildIKWaves(ikTasks);
+}
+
+void ControllerScheduler::Clear()
+{
+    for (auto& deferred : mDeferred)
+    {
+        ExchangePostUpdate(deferred.controller, deferred.postUpdate);
+    }
+
+    mHierarchy = nullptr;
+    mControllers.clear();
+    mSerial.clear();
+    mLocalTasks.clear();
+    mSkinTasks.clear();
+    mIKWaves.clear();
+    mIKObjects.clear();
+    mDeferred.clear();
+}
+
+void ControllerScheduler::Update(double applicationTime, unsigned int numThreads)
+{
+    if (!mHierarchy)
+    {
+        return;
+    }
+
+    // Phases 1 and 2.
+    for (auto controller : mSerial)
+    {
+        controller->Update(applicationTime);
+    }
+    Execute(mLocalTasks, applicationTime, numThreads);
+
+    // Phase 3.  The controllers were updated, but their objects are
+    // treated as dirty.
+    mHierarchy->Update(applicationTime, numThreads, false);
+
+    // Phase 4.
+    for (size_t wave = 0; wave < mIKWaves.size(); ++wave)
+    {
+        Execute(mIKWaves[wave], applicationTime, numThreads);
+        for (auto i : mIKObjects[wave])
+        {
+            mHierarchy->MarkDirty(i);
+        }
+        mHierarchy->UpdateDirty(applicationTime, numThreads);
+    }
+
+    // Phases 5 and 6.
+    if (mSkinTasks.size() > 0)
+    {
+        Execute(mSkinTasks, applicationTime, numThreads);
+        for (auto const& task : mSkinTasks)
+        {
+            mHierarchy->MarkDirty(task.object);
+        }
+        mHierarchy->UpdateDirty(applicationTime, numThreads);
+    }
+
+    // Phase 7.
+    for (auto& deferred : mDeferred)
+    {
+        if (deferred.vbuffer)
+        {
+            if (deferred.postUpdate)
+            {
+                deferred.postUpdate(deferred.vbuffer);
+            }
+            deferred.vbuffer = nullptr;
+        }
+    }
+}
+
+void ControllerScheduler::AddTask(int object,
+    std::vector<std::shared_ptr<Controller>> const& controllers,
+    std::vector<Task>& tasks)
+{
+    Task task;
+    task.object = object;
+    task.first = static_cast<int>(mControllers.size());
+    mControllers.insert(mControllers.end(), controllers.begin(), controllers.end());
+    task.last = static_cast<int>(mControllers.size());
+    tasks.push_back(task);
+}
+
+void ControllerScheduler::BuildIKWaves(std::vector<Task> const& tasks)
+{
+    // An IK controller writes the transforms of its joints and reads the
+    // world transforms of its object, targets, effectors and of the parents
+    // of its joints.  The world transforms of the descendants of the joints
+    // are recomputed after the wave, so they are treated as written.  The
+    // wave of a controller is later than the waves of the preceding
+    // controllers that write an object it accesses or that access an object
+    // it writes.  The objects are visited in breadth-first order, so the
+    // conflicting controllers are updated in the order of Spatial::Update.
+    // The controllers that only share targets are in the same wave.
+    std::unordered_map<Spatial const*, int> lastWrite, lastAccess;
+    std::vector<Spatial const*> reads, writes;
+    for (auto const& task : tasks)
+    {
+        auto ik = static_cast<IKController const*>(mControllers[task.first].get());
+        reads.clear();
+        writes.clear();
+        reads.push_back(mHierarchy->GetSpatial(task.object));
+        for (size_t j = 0; j < ik->GetNumJoints(); ++j)
+        {
+            Spatial* joint = ik->GetJointObject(j);
+            if (joint->GetParent())
+            {
+                reads.push_back(joint->GetParent());
+            }
+            AppendSubtree(joint, writes);
+        }
+        for (size_t g = 0; g < ik->GetNumGoals(); ++g)
+        {
+            reads.push_back(ik->GetGoalTarget(g));
+            reads.push_back(ik->GetGoalEffector(g));
+        }
+
+        int wave = 0;
+        for (auto object : reads)
+        {
+            auto iter = lastWrite.find(object);
+            if (iter != lastWrite.end())
+            {
+                wave = std::max(wave, iter->second + 1);
+            }
+        }
+        for (auto object : writes)
+        {
+            auto iter = lastAccess.find(object);
+            if (iter != lastAccess.end())
+            {
+                wave = std::max(wave, iter->second + 1);
+            }
+        }
+        for (auto object : reads)
+        {
+            int& access = lastAccess.insert(std::make_pair(object, wave)).first->second;
+            access = std::max(access, wave);
+        }
+        for (auto object : writes)
+        {
+            lastWrite[object] = wave;
+            lastAccess[object] = wave;
+        }
+
+        if (wave == static_cast<int>(mIKWaves.size()))
+        {
+            mIKWaves.push_back(std::vector<Task>());
+            mIKObjects.push_back(std::vector<int>());
+        }
+        mIKWaves[wave].push_back(task);
+
+        // Marking the joints dirty is enough for UpdateDirty to recompute
+        // their descendants.  A joint that is not in the hierarchy, for
+        // example one in the subtree of an object derived from Node, would
+        // be modified without its world data being recomputed.
+        for (size_t j = 0; j < ik->GetNumJoints(); ++j)
+        {
+            int i = mHierarchy->GetIndex(ik->GetJointObject(j));
+            if (i >= 0)
+            {
+                mIKObjects[wave].push_back(i);
+            }
+            else
+            {
+                LogError("The joint object of an IK controller is not in the hierarchy.");
+            }
+        }
+    }
+}
+
+void ControllerScheduler::AppendSubtree(Spatial* object,
+    std::vector<Spatial const*>& objects)
+{
+    objects.push_back(object);
+    auto node = dynamic_cast<Node*>(object);
+    if (node)
+    {
+        int const numChildren = node->GetNumChildren();
+        for (int i = 0; i < numChildren; ++i)
+        {
+            Spatial* child = node->GetChild(i).get();
+            if (child)
+            {
+                AppendSubtree(child, objects);
+            }
+        }
+    }
+}
+
+void ControllerScheduler::Execute(std::vector<Task> const& tasks,
+    double applicationTime, unsigned int numThreads)
+{
+    // The costs of the tasks vary widely, for example with the number of
+    // vertices of skinned meshes, so the threads take the next available
+    // task rather than a fixed range of tasks.
+    size_t const numTasks = tasks.size();
+    unsigned int const minTasks = std::max(minTasksPerThread, 1u);
+    numThreads = std::min(numThreads, static_cast<unsigned int>(numTasks / minTasks));
+    ParallelFor(numTasks, 1, numThreads, [this, &tasks, applicationTime](unsigned int,
+        size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            Task const& task = tasks[k];
+            for (int c = task.first; c < task.last; ++c)
+            {
+                mControllers[c]->Update(applicationTime);
+            }
+        }
+    });
+}
+
+bool ControllerScheduler::ExchangePostUpdate(Controller* controller, Updater& postUpdate)
+{
+    Updater previous;
+    if (auto morph = dynamic_cast<MorphController*>(controller))
+    {
+        previous = morph->GetPostUpdate();
+        morph->SetPostUpdate(postUpdate);
+    }
+    else if (auto point = dynamic_cast<PointController*>(controller))
+    {
+        previous = point->GetPostUpdate();
+        point->SetPostUpdate(postUpdate);
+    }
+    else if (auto particle = dynamic_cast<ParticleController*>(controller))
+    {
+        previous = particle->GetPostUpdate();
+        particle->SetPostUpdate(postUpdate);
+    }
+    else if (auto skin = dynamic_cast<SkinController*>(controller))
+    {
+        previous = skin->GetPostUpdate();
+        skin->SetPostUpdate(postUpdate);
+    }
+    else
+    {
+        return false;
+    }
+
+    postUpdate = previous;
+    return true;
+}
@@ -7,7 +7,9 @@
 
 #include <GTEnginePCH.h>
 #include <Graphics/GteCamera.h>
-#include <Graphics/GteSpatial.h>
+#include <Graphics/GteSpatialHierarchy.h>
+#include <algorithm>
+#include <thread>
 using namespace gte;
 
 Culler::~Culler()
@@ -52,6 +54,7 @@ void Culler::ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
     if (scene)
     {
         PushViewFrustumPlanes(camera);
+        OnComputeVisibleSet(camera);
         mVisibleSet.clear();
         scene->OnGetVisibleSet(*this, camera, false);
     }
@@ -61,6 +64,90 @@ void Culler::ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
     }
 }
 
+void Culler::ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
+    SpatialHierarchy const& hierarchy, unsigned int numThreads)
+{
+    int const numObjects = hierarchy.GetNumObjects();
+    if (numObjects == 0)
+    {
+        LogError("The hierarchy must be built and updated.");
+        return;
+    }
+
+    PushViewFrustumPlanes(camera);
+    OnComputeVisibleSet(camera);
+    mVisibleSet.clear();
+
+    // Pack the planes in the order IsVisible tests them, starting with the
+    // last pushed plane.
+    for (int j = 0; j < 4; ++j)
+    {
+        mPackedPlanes[j].resize(mPlaneQuantity);
+    }
+    mPackedPlaneMasks.resize(mPlaneQuantity);
+    for (int j = 0, index = mPlaneQuantity - 1; j < mPlaneQuantity; ++j, --index)
+    {
+        Vector4<float> N;
+        float c;
+        mPlane[index].Get(N, c);
+        mPackedPlanes[0][j] = N[0];
+        mPackedPlanes[1][j] = N[1];
+        mPackedPlanes[2][j] = N[2];
+        mPackedPlanes[3][j] = c;
+        mPackedPlaneMasks[j] = (1u << index);
+    }
+
+    // Cull the levels from the root down.  The states of the parents are
+    // final when a level is processed.
+    mObjectStates.resize(numObjects);
+    mObjectPlaneStates.resize(numObjects);
+    std::vector<int> visible;
+    std::vector<std::vector<int>> threadVisible(std::max(numThreads, 1u));
+    unsigned int const minObjects = std::max(hierarchy.minObjectsPerThread, 1u);
+    for (int level = 0; level < hierarchy.GetNumLevels(); ++level)
+    {
+        int const begin = hierarchy.GetLevelBegin(level);
+        int const end = hierarchy.GetLevelBegin(level + 1);
+        int const numElements = end - begin;
+        unsigned int const numLevelThreads = std::min(numThreads,
+            static_cast<unsigned int>(numElements) / minObjects);
+        if (numLevelThreads <= 1)
+        {
+            CullRange(hierarchy, begin, end, visible);
+            continue;
+        }
+
+        std::vector<std::thread> process(numLevelThreads);
+        for (unsigned int t = 0; t < numLevelThreads; ++t)
+        {
+            int tBegin = begin + static_cast<int>((static_cast<size_t>(t) * numElements) / numLevelThreads);
+            int tEnd = begin + static_cast<int>((static_cast<size_t>(t + 1) * numElements) / numLevelThreads);
+            threadVisible[t].clear();
+            process[t] = std::thread([this, &hierarchy, &threadVisible, t, tBegin, tEnd]()
+            {
+                CullRange(hierarchy, tBegin, tEnd, threadVisible[t]);
+            });
+        }
+
+        for (unsigned int t = 0; t < numLevelThreads; ++t)
+        {
+            process[t].join();
+            visible.insert(visible.end(), threadVisible[t].begin(), threadVisible[t].end());
+        }
+    }
+
+    // Insert the visible leaves.  A leaf that is a Node-derived object culls
+    // its subtree recursively, starting with the plane state of the leaf.
+    unsigned int savePlaneState = mPlaneState;
+    for (auto i : visible)
+    {
+        mPlaneState = mObjectPlaneStates[i];
+        hierarchy.GetSpatial(i)->GetVisibleSet(*this, camera,
+            mObjectStates[i] == STATE_NEVER_CULLED);
+    }
+    mPlaneState = savePlaneState;
+}
+
 bool Culler::IsVisible(BoundingSphere<float> const& sphere)
 {
     if (sphere.GetRadius() == 0.0f)
@@ -97,7 +184,130 @@ bool Culler::IsVisible(BoundingSphere<float> const& sphere)
         }
     }
 
-    return true;
+    return !IsOccluded(sphere);
+}
+
+void Culler::OnComputeVisibleSet(std::shared_ptr<Camera> const&)
+{
+}
+
+bool Culler::IsOccluded(BoundingSphere<float> const&) const
+{
+    return false;
+}
+
+void Culler::CullRange(SpatialHierarchy const& hierarchy, int begin, int end,
+    std::vector<int>& visible)
+{
+    std::vector<Vector4<float>> const& bounds = hierarchy.GetWorldBounds();
+    int const numPlanes = static_cast<int>(mPackedPlaneMasks.size());
+    float const* n0 = mPackedPlanes[0].data();
+    float const* n1 = mPackedPlanes[1].data();
+    float const* n2 = mPackedPlanes[2].data();
+    float const* n3 = mPackedPlanes[3].data();
+    unsigned int const* masks = mPackedPlaneMasks.data();
+
+    float x[LANES], y[LANES], z[LANES], r[LANES];
+    unsigned int planeState[LANES], culled[LANES];
+    for (int first = begin; first < end; first += LANES)
+    {
+        // Gather the bounds of the objects whose planes must be tested.  The
+        // plane state of the other lanes is zero, so no plane is active for
+        // them.
+        int const numLanes = std::min(static_cast<int>(LANES), end - first);
+        for (int k = 0; k < LANES; ++k)
+        {
+            x[k] = 0.0f;
+            y[k] = 0.0f;
+            z[k] = 0.0f;
+            r[k] = 0.0f;
+            planeState[k] = 0;
+            culled[k] = 0;
+        }
+
+        for (int k = 0; k < numLanes; ++k)
+        {
+            int const i = first + k;
+            int const parent = hierarchy.GetParent(i);
+            uint8_t state = (parent >= 0 ? mObjectStates[parent] : static_cast<uint8_t>(STATE_DYNAMIC));
+            unsigned int inherited = (parent >= 0 ? mObjectPlaneStates[parent] : mPlaneState);
+            if (state != STATE_CULLED)
+            {
+                CullingMode culling = hierarchy.GetSpatial(i)->culling;
+                if (culling == CULL_ALWAYS)
+                {
+                    state = STATE_CULLED;
+                }
+                else if (culling == CULL_NEVER)
+                {
+                    state = STATE_NEVER_CULLED;
+                }
+                else if (state == STATE_DYNAMIC)
+                {
+                    Vector4<float> const& bound = bounds[i];
+                    if (bound[3] == 0.0f)
+                    {
+                        // The object is a dummy node and cannot be visible.
+                        state = STATE_CULLED;
+                    }
+                    else
+                    {
+                        x[k] = bound[0];
+                        y[k] = bound[1];
+                        z[k] = bound[2];
+                        r[k] = bound[3];
+                        planeState[k] = inherited;
+                    }
+                }
+            }
+            mObjectStates[i] = state;
+            mObjectPlaneStates[i] = inherited;
+        }
+
+        // Compare the bounds to the active planes.  A bound on the negative
+        // side of a plane is culled and a bound on the positive side of a
+        // plane makes the plane inactive for its subtree.
+        for (int j = 0; j < numPlanes; ++j)
+        {
+            float const a0 = n0[j], a1 = n1[j], a2 = n2[j], a3 = n3[j];
+            unsigned int const mask = masks[j];
+            for (int k = 0; k < LANES; ++k)
+            {
+                float signedDistance = a0 * x[k] + a1 * y[k] + a2 * z[k] + a3;
+                unsigned int active = (planeState[k] & mask);
+                culled[k] |= (signedDistance <= -r[k] ? active : 0u);
+                planeState[k] &= ~(signedDistance >= r[k] ? active : 0u);
+            }
+        }
+
+        for (int k = 0; k < numLanes; ++k)
+        {
+            int const i = first + k;
+            if (mObjectStates[i] == STATE_DYNAMIC)
+            {
+                if (culled[k])
+                {
+                    mObjectStates[i] = STATE_CULLED;
+                    continue;
+                }
+
+                BoundingSphere<float> sphere;
+                sphere.SetCenter({ x[k], y[k], z[k] });
+                sphere.SetRadius(r[k]);
+                if (IsOccluded(sphere))
+                {
+                    mObjectStates[i] = STATE_CULLED;
+                    continue;
+                }
+                mObjectPlaneStates[i] = planeState[k];
+            }
+
+            if (mObjectStates[i] != STATE_CULLED && !hierarchy.IsExpanded(i))
+            {
+                visible.push_back(i);
+            }
+        }
+    }
 }
 
 void Culler::Insert(Visual* visible)
@@ -169,6 +169,36 @@ float IKController::GetJointMaxRotation(size_t j, int axis) const
     return std::numeric_limits<float>::infinity();
 }
 
+Spatial* IKController::GetJointObject(size_t j) const
+{
+    if (j < mJoints.size())
+    {
+        return mJoints[j].object;
+    }
+    LogError("Invalid index in GetJointObject.");
+    return nullptr;
+}
+
+Spatial* IKController::GetGoalTarget(size_t g) const
+{
+    if (g < mGoals.size())
+    {
+        return mGoals[g].target;
+    }
+    LogError("Invalid index in GetGoalTarget.");
+    return nullptr;
+}
+
+Spatial* IKController::GetGoalEffector(size_t g) const
+{
+    if (g < mGoals.size())
+    {
+        return mGoals[g].effector;
+    }
+    LogError("Invalid index in GetGoalEffector.");
+    return nullptr;
+}
+
 bool IKController::Update(double applicationTime)
 {
     if (!Controller::Update(applicationTime))
@@ -9,6 +9,7 @@
 #include <Graphics/GteKeyframeController.h>
 #include <Graphics/GteSpatial.h>
 #include <Mathematics/GteRotation.h>
+#include <algorithm>
 using namespace gte;
 
 KeyframeController::~KeyframeController()
@@ -171,30 +172,39 @@ void KeyframeController::GetKeyInfo(float ctrlTime, int numTimes, float* times,
         return;
     }
 
-    int nextIndex;
+    // The cached interval and its successor are tested first, so a
+    // sequence of increasing or decreasing times has O(1) lookups.  When the
+    // time jumps (seeking, scrubbing, random time offsets), the interval is
+    // found by a binary search rather than by a linear scan.  The key
+    // intervals are [times[i0],times[i1]) for increasing times and
+    // (times[i0],times[i1]] for decreasing times.
     if (ctrlTime > times[lastIndex])
     {
-        nextIndex = lastIndex + 1;
-        while (ctrlTime >= times[nextIndex])
+        int nextIndex = lastIndex + 1;
+        if (ctrlTime >= times[nextIndex])
         {
-            lastIndex = nextIndex;
             ++nextIndex;
+            if (ctrlTime >= times[nextIndex])
+            {
+                nextIndex = static_cast<int>(std::upper_bound(times + nextIndex + 1,
+                    times + numTimes - 1, ctrlTime) - times);
+            }
         }
 
+        lastIndex = nextIndex - 1;
         i0 = lastIndex;
         i1 = nextIndex;
         normTime = (ctrlTime - times[i0]) / (times[i1] - times[i0]);
     }
     else if (ctrlTime < times[lastIndex])
     {
-        nextIndex = lastIndex - 1;
-        while (ctrlTime <= times[nextIndex])
+        if (ctrlTime <= times[lastIndex - 1])
         {
-            lastIndex = nextIndex;
-            --nextIndex;
+            lastIndex = static_cast<int>(std::lower_bound(times + 1,
+                times + lastIndex - 1, ctrlTime) - times);
         }
 
-        i0 = nextIndex;
+        i0 = lastIndex - 1;
         i1 = lastIndex;
         normTime = (ctrlTime - times[i0]) / (times[i1] - times[i0]);
     }
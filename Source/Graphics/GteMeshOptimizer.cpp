@@ -0,0 +1,544 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <Graphics/GteMeshOptimizer.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+using namespace gte;
+
+
+MeshOptimizer::~MeshOptimizer()
+{
+}
+
+MeshOptimizer::MeshOptimizer()
+    :
+    mCacheSize(16),
+    mOverdrawThreshold(1.05f)
+{
+}
+
+bool MeshOptimizer::Optimize(Visual& visual, Statistics* before, Statistics* after) const
+{
+    auto const& vbuffer = visual.GetVertexBuffer();
+    auto const& ibuffer = visual.GetIndexBuffer();
+    if (!vbuffer || !vbuffer->GetData() || !ibuffer || !ibuffer->GetData())
+    {
+        LogError("The visual must have buffers with data in system memory.");
+        return false;
+    }
+
+    std::vector<uint32_t> allIndices;
+    if (!GetIndices(*ibuffer, allIndices))
+    {
+        return false;
+    }
+
+    std::set<DFType> required;
+    required.insert(DF_R32G32B32_FLOAT);
+    required.insert(DF_R32G32B32A32_FLOAT);
+    char const* data = vbuffer->GetChannel(VA_POSITION, 0, required);
+    if (!data)
+    {
+        LogError("The vertex buffer must have 3-tuple or 4-tuple float positions.");
+        return false;
+    }
+
+    uint32_t const numVertices = vbuffer->GetNumElements();
+    for (auto index : allIndices)
+    {
+        if (index >= numVertices)
+        {
+            LogError("Index out of range.");
+            return false;
+        }
+    }
+
+    // Only the active triangles are reordered.
+    auto const activeBegin = allIndices.begin() + 3 * static_cast<size_t>(ibuffer->GetFirstPrimitive());
+    auto const activeEnd = activeBegin + 3 * static_cast<size_t>(ibuffer->GetNumActivePrimitives());
+    std::vector<uint32_t> indices(activeBegin, activeEnd);
+
+    size_t const vertexSize = static_cast<size_t>(vbuffer->GetElementSize());
+    std::vector<Vector3<float>> positions(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i)
+    {
+        positions[i] = *reinterpret_cast<Vector3<float> const*>(data + i * vertexSize);
+    }
+
+    if (before)
+    {
+        *before = ComputeStatistics(numVertices, indices, mCacheSize);
+    }
+
+    std::vector<uint32_t> remap;
+    ReorderForVertexCache(numVertices, indices);
+    ReorderForOverdraw(positions, indices);
+    ReorderForVertexFetch(numVertices, indices, remap);
+    RemapVertices(remap, *vbuffer);
+
+    // The inactive triangles keep their positions in the index buffer, but
+    // they must use the new vertex numbering.
+    for (auto& index : allIndices)
+    {
+        index = remap[index];
+    }
+    std::copy(indices.begin(), indices.end(), activeBegin);
+    SetIndices(allIndices, *ibuffer);
+
+    if (after)
+    {
+        *after = ComputeStatistics(numVertices, indices, mCacheSize);
+    }
+    return true;
+}
+
+void MeshOptimizer::ReorderForVertexCache(uint32_t numVertices,
+    std::vector<uint32_t>& indices) const
+{
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // The scores of the cache positions and of the valences.  The three
+    // vertices of the last triangle have a fixed score, which discourages
+    // the selection of the triangle that shares an edge with it in favor of
+    // a fan around one of its vertices.  A vertex with few remaining
+    // triangles has a large score, so isolated triangles are not left over.
+    int const cacheSize = static_cast<int>(mCacheSize);
+    float const cacheDecayPower = 1.5f;
+    float const lastTriangleScore = 0.75f;
+    float const valenceBoostScale = 2.0f;
+    float const valenceBoostPower = 0.5f;
+    uint32_t const maxTableValence = 32;
+    std::vector<float> cacheScore(cacheSize), valenceScore(maxTableValence + 1);
+    for (int i = 0; i < cacheSize; ++i)
+    {
+        if (i < 3)
+        {
+            cacheScore[i] = lastTriangleScore;
+        }
+        else
+        {
+            float scale = 1.0f / static_cast<float>(cacheSize - 3);
+            cacheScore[i] = std::pow(1.0f - scale * static_cast<float>(i - 3), cacheDecayPower);
+        }
+    }
+    valenceScore[0] = 0.0f;
+    for (uint32_t v = 1; v <= maxTableValence; ++v)
+    {
+        valenceScore[v] = valenceBoostScale * std::pow(static_cast<float>(v), -valenceBoostPower);
+    }
+
+    // The vertex valences are the numbers of triangles that are not yet
+    // emitted.  The triangles of vertex v are adjacency[offset[v]+i] for
+    // 0 <= i < valence[v].
+    std::vector<uint32_t> valence(numVertices, 0), offset(numVertices + 1, 0);
+    std::vector<uint32_t> adjacency(3 * numTriangles);
+    for (auto index : indices)
+    {
+        ++offset[index + 1];
+    }
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        offset[v + 1] += offset[v];
+    }
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            uint32_t v = indices[3 * t + j];
+            adjacency[offset[v] + valence[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> position(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    auto computeVertexScore = [&](uint32_t v)
+    {
+        if (valence[v] == 0)
+        {
+            return -1.0f;
+        }
+        float score = (position[v] >= 0 ? cacheScore[position[v]] : 0.0f);
+        if (valence[v] <= maxTableValence)
+        {
+            score += valenceScore[valence[v]];
+        }
+        else
+        {
+            score += valenceBoostScale * std::pow(static_cast<float>(valence[v]), -valenceBoostPower);
+        }
+        return score;
+    };
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        vertexScore[v] = computeVertexScore(v);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    int64_t best = 0;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        triangleScore[t] = vertexScore[indices[3 * t]] +
+            vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+        if (triangleScore[t] > triangleScore[static_cast<size_t>(best)])
+        {
+            best = static_cast<int64_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> output(indices.size());
+    std::vector<char> emitted(numTriangles, 0);
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+    size_t nextTriangle = 0;
+    for (size_t k = 0; k < numTriangles; ++k)
+    {
+        if (best < 0)
+        {
+            // None of the cached vertices has triangles left.  Continue with
+            // the first triangle that is not emitted.
+            while (emitted[nextTriangle])
+            {
+                ++nextTriangle;
+            }
+            best = static_cast<int64_t>(nextTriangle);
+        }
+
+        size_t const t = static_cast<size_t>(best);
+        uint32_t const* triangle = &indices[3 * t];
+        output[3 * k] = triangle[0];
+        output[3 * k + 1] = triangle[1];
+        output[3 * k + 2] = triangle[2];
+        emitted[t] = 1;
+
+        // Remove the triangle from the adjacency lists of its vertices.
+        for (size_t j = 0; j < 3; ++j)
+        {
+            uint32_t v = triangle[j];
+            uint32_t* list = &adjacency[offset[v]];
+            for (uint32_t i = 0; i < valence[v]; ++i)
+            {
+                if (list[i] == t)
+                {
+                    list[i] = list[--valence[v]];
+                    break;
+                }
+            }
+        }
+
+        // Move the vertices of the triangle to the front of the LRU cache.
+        // The vertices beyond the cache size are evicted.
+        newCache.clear();
+        newCache.push_back(triangle[0]);
+        newCache.push_back(triangle[1]);
+        newCache.push_back(triangle[2]);
+        for (auto v : cache)
+        {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            position[newCache[i]] = (static_cast<int>(i) < cacheSize ? static_cast<int>(i) : -1);
+            vertexScore[newCache[i]] = computeVertexScore(newCache[i]);
+        }
+
+        // Update the scores of the triangles of the vertices whose scores
+        // changed and select the best of them.
+        best = -1;
+        float bestScore = -1.0f;
+        for (auto v : newCache)
+        {
+            uint32_t const* list = &adjacency[offset[v]];
+            for (uint32_t i = 0; i < valence[v]; ++i)
+            {
+                uint32_t const* other = &indices[3 * static_cast<size_t>(list[i])];
+                float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+                triangleScore[list[i]] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = static_cast<int64_t>(list[i]);
+                }
+            }
+        }
+
+        if (newCache.size() > static_cast<size_t>(cacheSize))
+        {
+            newCache.resize(cacheSize);
+        }
+        std::swap(cache, newCache);
+    }
+
+    indices = std::move(output);
+}
+
+void MeshOptimizer::ReorderForOverdraw(std::vector<Vector3<float>> const& positions,
+    std::vector<uint32_t>& indices) const
+{
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Simulate a FIFO cache.  A vertex is in the cache when fewer than
+    // cacheSize vertices were inserted after it.
+    uint32_t const numVertices = static_cast<uint32_t>(positions.size());
+    uint32_t const cacheSize = mCacheSize;
+    std::vector<uint32_t> stamp(numVertices, 0);
+    uint32_t time = cacheSize + 1;
+    auto reset = [&time, cacheSize]()
+    {
+        time += cacheSize + 1;
+    };
+    auto countMisses = [&stamp, &time, cacheSize](uint32_t const* triangle)
+    {
+        uint32_t misses = 0;
+        for (size_t j = 0; j < 3; ++j)
+        {
+            if (time - stamp[triangle[j]] > cacheSize)
+            {
+                stamp[triangle[j]] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    };
+
+    // The hard boundaries are at the triangles whose vertices are all cache
+    // misses, where the order does not depend on the preceding triangles.
+    std::vector<size_t> hard;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        if (countMisses(&indices[3 * t]) == 3)
+        {
+            hard.push_back(t);
+        }
+    }
+    if (hard.size() == 0 || hard[0] != 0)
+    {
+        hard.insert(hard.begin(), 0);
+    }
+    hard.push_back(numTriangles);
+
+    // Split the clusters further where the ACMR of the part drawn from an
+    // empty cache is within the threshold of the ACMR of the cluster.
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hard.size(); ++c)
+    {
+        size_t const first = hard[c], last = hard[c + 1];
+        reset();
+        uint32_t misses = 0;
+        for (size_t t = first; t < last; ++t)
+        {
+            misses += countMisses(&indices[3 * t]);
+        }
+        float const maxACMR = mOverdrawThreshold *
+            static_cast<float>(misses) / static_cast<float>(last - first);
+
+        clusters.push_back(first);
+        reset();
+        misses = 0;
+        size_t start = first;
+        for (size_t t = first; t + 1 < last; ++t)
+        {
+            misses += countMisses(&indices[3 * t]);
+            if (static_cast<float>(misses) <= maxACMR * static_cast<float>(t + 1 - start))
+            {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                reset();
+                misses = 0;
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+    size_t const numClusters = clusters.size() - 1;
+
+    // The area-weighted centroids and normals of the clusters and of the
+    // mesh.
+    std::vector<Vector3<float>> centroid(numClusters), normal(numClusters);
+    Vector3<float> meshCentroid{ 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    std::vector<float> area(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        centroid[c] = { 0.0f, 0.0f, 0.0f };
+        normal[c] = { 0.0f, 0.0f, 0.0f };
+        area[c] = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            Vector3<float> const& p0 = positions[indices[3 * t]];
+            Vector3<float> const& p1 = positions[indices[3 * t + 1]];
+            Vector3<float> const& p2 = positions[indices[3 * t + 2]];
+            Vector3<float> areaNormal = Cross(p1 - p0, p2 - p0);
+            float triangleArea = Length(areaNormal);
+            centroid[c] += (triangleArea / 3.0f) * (p0 + p1 + p2);
+            normal[c] += areaNormal;
+            area[c] += triangleArea;
+        }
+        meshCentroid += centroid[c];
+        meshArea += area[c];
+        if (area[c] > 0.0f)
+        {
+            centroid[c] /= area[c];
+        }
+        Normalize(normal[c]);
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Draw the clusters that face away from the centroid first.
+    std::vector<std::pair<float, size_t>> order(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        order[c] = std::make_pair(-Dot(centroid[c] - meshCentroid, normal[c]), c);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [](std::pair<float, size_t> const& c0, std::pair<float, size_t> const& c1)
+        {
+            return c0.first < c1.first;
+        });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (auto const& element : order)
+    {
+        size_t c = element.second;
+        output.insert(output.end(), indices.begin() + 3 * clusters[c],
+            indices.begin() + 3 * clusters[c + 1]);
+    }
+    indices = std::move(output);
+}
+
+void MeshOptimizer::ReorderForVertexFetch(uint32_t numVertices,
+    std::vector<uint32_t>& indices, std::vector<uint32_t>& remap)
+{
+    uint32_t const invalid = std::numeric_limits<uint32_t>::max();
+    remap.assign(numVertices, invalid);
+    uint32_t next = 0;
+    for (auto& index : indices)
+    {
+        uint32_t& newIndex = remap[index];
+        if (newIndex == invalid)
+        {
+            newIndex = next++;
+        }
+        index = newIndex;
+    }
+    for (auto& newIndex : remap)
+    {
+        if (newIndex == invalid)
+        {
+            newIndex = next++;
+        }
+    }
+}
+
+bool MeshOptimizer::RemapVertices(std::vector<uint32_t> const& remap, VertexBuffer& vbuffer)
+{
+    char* data = vbuffer.GetData();
+    if (!data || remap.size() != vbuffer.GetNumElements())
+    {
+        LogError("Invalid remap or vertex buffer.");
+        return false;
+    }
+
+    size_t const vertexSize = static_cast<size_t>(vbuffer.GetElementSize());
+    std::vector<char> copy(data, data + remap.size() * vertexSize);
+    for (size_t i = 0; i < remap.size(); ++i)
+    {
+        std::memcpy(data + remap[i] * vertexSize, copy.data() + i * vertexSize, vertexSize);
+    }
+    return true;
+}
+
+MeshOptimizer::Statistics MeshOptimizer::ComputeStatistics(uint32_t numVertices,
+    std::vector<uint32_t> const& indices, unsigned int cacheSize)
+{
+    Statistics statistics = { 0.0f, 0.0f };
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0 || cacheSize == 0)
+    {
+        return statistics;
+    }
+
+    std::vector<uint32_t> stamp(numVertices, 0);
+    std::vector<char> used(numVertices, 0);
+    uint32_t time = cacheSize + 1, misses = 0, numUsed = 0;
+    for (size_t i = 0; i < 3 * numTriangles; ++i)
+    {
+        uint32_t index = indices[i];
+        if (time - stamp[index] > cacheSize)
+        {
+            stamp[index] = time++;
+            ++misses;
+        }
+        if (!used[index])
+        {
+            used[index] = 1;
+            ++numUsed;
+        }
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(numTriangles);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(numUsed);
+    return statistics;
+}
+
+bool MeshOptimizer::GetIndices(IndexBuffer const& ibuffer, std::vector<uint32_t>& indices)
+{
+    if (ibuffer.GetPrimitiveType() != IP_TRIMESH)
+    {
+        LogError("The index buffer must be IP_TRIMESH.");
+        return false;
+    }
+
+    size_t const numIndices = 3 * static_cast<size_t>(ibuffer.GetNumPrimitives());
+    indices.resize(numIndices);
+    if (ibuffer.GetElementSize() == sizeof(uint32_t))
+    {
+        uint32_t const* source = ibuffer.Get<uint32_t>();
+        std::copy(source, source + numIndices, indices.begin());
+    }
+    else
+    {
+        uint16_t const* source = ibuffer.Get<uint16_t>();
+        std::copy(source, source + numIndices, indices.begin());
+    }
+    return true;
+}
+
+void MeshOptimizer::SetIndices(std::vector<uint32_t> const& indices, IndexBuffer& ibuffer)
+{
+    if (ibuffer.GetElementSize() == sizeof(uint32_t))
+    {
+        std::copy(indices.begin(), indices.end(), ibuffer.Get<uint32_t>());
+    }
+    else
+    {
+        uint16_t* target = ibuffer.Get<uint16_t>();
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            target[i] = static_cast<uint16_t>(indices[i]);
+        }
+    }
+}
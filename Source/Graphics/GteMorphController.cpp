@@ -9,6 +9,8 @@
 #include <LowLevel/GteLogger.h>
 #include <Graphics/GteMorphController.h>
 #include <Graphics/GteVisual.h>
+#include <algorithm>
+#include <cmath>
 using namespace gte;
 
 MorphController::~MorphController()
@@ -25,6 +27,8 @@ MorphController::MorphController(size_t numTargets, size_t numVertices, size_t n
     mTimes(numTimes),
     mWeights(numTimes * mNumTargets),
     mLastIndex(0),
+    mEpsilon(0.0f),
+    mCombination(3 * numVertices),
     mPostUpdate(postUpdate)
 {
     LogAssert(numTargets > 0 && numVertices > 0 && numTimes > 0, "Invalid input.");
@@ -34,7 +38,12 @@ void MorphController::SetVertices(size_t target, std::vector<Vector3<float>> con
 {
     if (target < mNumTargets && vertices.size() >= mNumVertices)
     {
-        std::copy(vertices.begin(), vertices.end(), mVertices.begin() + target * mNumVertices);
+        std::copy(vertices.begin(), vertices.begin() + mNumVertices,
+            mVertices.begin() + target * mNumVertices);
+        if (IsCompressed())
+        {
+            Compress(mEpsilon);
+        }
         return;
     }
     LogError("Invalid target or input vertices array is too small.");
@@ -90,6 +99,40 @@ void MorphController::GetWeights(size_t key, std::vector<float>& weights)
     LogError("Invalid key.");
 }
 
+void MorphController::Compress(float epsilon)
+{
+    mEpsilon = std::max(epsilon, 0.0f);
+    mSparseOffsets.resize(mNumTargets + 1);
+    mSparseIndices.clear();
+    mSparseDeltas.clear();
+    mSparseOffsets[0] = 0;
+    mSparseOffsets[1] = 0;
+    Vector3<float> const* base = mVertices.data();
+    for (size_t n = 1; n < mNumTargets; ++n)
+    {
+        Vector3<float> const* vertices = &mVertices[n * mNumVertices];
+        for (size_t m = 0; m < mNumVertices; ++m)
+        {
+            Vector3<float> delta = vertices[m] - base[m];
+            if (std::fabs(delta[0]) > mEpsilon
+                || std::fabs(delta[1]) > mEpsilon
+                || std::fabs(delta[2]) > mEpsilon)
+            {
+                mSparseIndices.push_back(static_cast<unsigned int>(m));
+                mSparseDeltas.push_back(delta);
+            }
+        }
+        mSparseOffsets[n + 1] = mSparseIndices.size();
+    }
+}
+
+void MorphController::Decompress()
+{
+    mSparseOffsets.clear();
+    mSparseIndices.clear();
+    mSparseDeltas.clear();
+}
+
 bool MorphController::Update(double applicationTime)
 {
     // The key interpolation uses linear interpolation.  To get higher-order
@@ -105,17 +148,7 @@ bool MorphController::Update(double applicationTime)
     Visual* visual = reinterpret_cast<Visual*>(mObject);
     auto vbuffer = visual->GetVertexBuffer();
     VertexFormat vformat = vbuffer->GetFormat();
-
-    // Initialize the 3-tuple positions (x,y,z) to zero for accumulation.
-    unsigned int numVertices = vbuffer->GetNumElements();
-    char* combination = vbuffer->GetData();
     size_t vertexSize = static_cast<size_t>(vformat.GetVertexSize());
-    for (unsigned int i = 0; i < numVertices; ++i)
-    {
-        Vector3<float>& vertex = *reinterpret_cast<Vector3<float>*>(combination);
-        vertex = { 0.0f, 0.0f, 0.0f };
-        combination += vertexSize;
-    }
 
     // Look up the bounding keys.
     float ctrlTime = static_cast<float>(GetControlTime(applicationTime));
@@ -124,24 +157,67 @@ bool MorphController::Update(double applicationTime)
     GetKeyInfo(ctrlTime, normTime, key0, key1);
     float oneMinusNormTime = 1.0f - normTime;
 
-    // Compute the weighted combination.
+    // Compute the weighted combination.  The targets with zero weight do
+    // not contribute.
     float const* weights0 = &mWeights[key0 * mNumTargets];
     float const* weights1 = &mWeights[key1 * mNumTargets];
-    Vector3<float> const* vertices = mVertices.data();
-    float wsum0 = 0.0f, wsum1 = 0.0f;
-    for (size_t n = 0; n < mNumTargets; ++n)
-    {
-        float w = oneMinusNormTime * weights0[n] + normTime * weights1[n];
-        wsum0 += weights0[n];
-        wsum1 += weights1[n];
-        combination = vbuffer->GetData();
-        for (size_t m = 0; m < mNumVertices; ++m)
+    size_t const numComponents = 3 * mNumVertices;
+    float* combination = mCombination.data();
+    if (IsCompressed())
+    {
+        float wsum = 0.0f;
+        for (size_t n = 0; n < mNumTargets; ++n)
+        {
+            wsum += oneMinusNormTime * weights0[n] + normTime * weights1[n];
+        }
+
+        float const* base = reinterpret_cast<float const*>(mVertices.data());
+        for (size_t i = 0; i < numComponents; ++i)
+        {
+            combination[i] = wsum * base[i];
+        }
+
+        for (size_t n = 1; n < mNumTargets; ++n)
         {
-            Vector3<float>& position = *reinterpret_cast<Vector3<float>*>(combination);
-            position += w * (*vertices++);  // += w * mVertices[m + mNumTargets * n];
-            combination += vertexSize;
+            float w = oneMinusNormTime * weights0[n] + normTime * weights1[n];
+            if (w != 0.0f)
+            {
+                for (size_t k = mSparseOffsets[n]; k < mSparseOffsets[n + 1]; ++k)
+                {
+                    float* position = combination + 3 * static_cast<size_t>(mSparseIndices[k]);
+                    Vector3<float> const& delta = mSparseDeltas[k];
+                    position[0] += w * delta[0];
+                    position[1] += w * delta[1];
+                    position[2] += w * delta[2];
+                }
+            }
         }
     }
+    else
+    {
+        std::fill(mCombination.begin(), mCombination.end(), 0.0f);
+        for (size_t n = 0; n < mNumTargets; ++n)
+        {
+            float w = oneMinusNormTime * weights0[n] + normTime * weights1[n];
+            if (w != 0.0f)
+            {
+                float const* vertices = reinterpret_cast<float const*>(&mVertices[n * mNumVertices]);
+                for (size_t i = 0; i < numComponents; ++i)
+                {
+                    combination[i] += w * vertices[i];
+                }
+            }
+        }
+    }
+
+    // Copy the combination to the positions of the vertex buffer.
+    char* positions = vbuffer->GetData();
+    for (size_t m = 0; m < mNumVertices; ++m, combination += 3)
+    {
+        Vector3<float>& position = *reinterpret_cast<Vector3<float>*>(positions);
+        position = { combination[0], combination[1], combination[2] };
+        positions += vertexSize;
+    }
 
     visual->UpdateModelBound();
     visual->UpdateModelNormals();
@@ -0,0 +1,326 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <Graphics/GteOcclusionCuller.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+using namespace gte;
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    :
+    mWidth(std::max(width, 1)),
+    mHeight(std::max(height, 1)),
+    mNumXTiles((mWidth + TILE_SIZE - 1) / TILE_SIZE),
+    mNumYTiles((mHeight + TILE_SIZE - 1) / TILE_SIZE),
+    mDepth(static_cast<size_t>(mWidth) * mHeight, std::numeric_limits<float>::max()),
+    mTileDepth(static_cast<size_t>(mNumXTiles) * mNumYTiles, std::numeric_limits<float>::max()),
+    mDMin(0.0f)
+{
+    mPVMatrix.MakeIdentity();
+    mEye = { 0.0f, 0.0f, 0.0f, 1.0f };
+    mDirection = { 0.0f, 0.0f, 0.0f, 0.0f };
+}
+
+void OcclusionCuller::AttachOccluder(std::shared_ptr<Visual> const& occluder)
+{
+    if (!occluder)
+    {
+        LogError("The occluder must be nonnull.");
+        return;
+    }
+
+    if (std::find(mOccluders.begin(), mOccluders.end(), occluder) == mOccluders.end())
+    {
+        mOccluders.push_back(occluder);
+    }
+}
+
+void OcclusionCuller::DetachOccluder(std::shared_ptr<Visual> const& occluder)
+{
+    auto iter = std::find(mOccluders.begin(), mOccluders.end(), occluder);
+    if (iter != mOccluders.end())
+    {
+        mOccluders.erase(iter);
+    }
+}
+
+void OcclusionCuller::DetachAllOccluders()
+{
+    mOccluders.clear();
+}
+
+void OcclusionCuller::OnComputeVisibleSet(std::shared_ptr<Camera> const& camera)
+{
+    mPVMatrix = camera->GetProjectionViewMatrix();
+    mEye = camera->GetPosition();
+    mDirection = camera->GetDVector();
+    mDMin = camera->GetDMin();
+
+    std::fill(mDepth.begin(), mDepth.end(), std::numeric_limits<float>::max());
+    for (auto const& occluder : mOccluders)
+    {
+        RasterizeOccluder(occluder.get());
+    }
+    ComputeTileDepths();
+}
+
+bool OcclusionCuller::IsOccluded(BoundingSphere<float> const& sphere) const
+{
+    if (mOccluders.size() == 0)
+    {
+        return false;
+    }
+
+    // A sphere that intersects the near plane is not occluded.
+    Vector4<float> center = HLift(sphere.GetCenter(), 1.0f);
+    float radius = sphere.GetRadius();
+    float dNear = Dot(mDirection, center - mEye) - radius;
+    if (dNear <= mDMin)
+    {
+        return false;
+    }
+
+    // The minimum depth of the sphere is the depth of the point on the view
+    // axis at the distance of the nearest point of the sphere.
+    Vector4<float> nearest = DoTransform(mPVMatrix, mEye + dNear * mDirection);
+    float zNear = nearest[2] / nearest[3];
+
+    // The screen rectangle is that of the sphere's axis-aligned bounding box.
+    float xMin = std::numeric_limits<float>::max(), xMax = -xMin;
+    float yMin = xMin, yMax = xMax;
+    for (int i = 0; i < 8; ++i)
+    {
+        Vector4<float> corner = center;
+        corner[0] += ((i & 1) ? radius : -radius);
+        corner[1] += ((i & 2) ? radius : -radius);
+        corner[2] += ((i & 4) ? radius : -radius);
+        Vector4<float> clip = DoTransform(mPVMatrix, corner);
+        if (clip[3] <= 0.0f)
+        {
+            return false;
+        }
+
+        float x = (clip[0] / clip[3] + 1.0f) * 0.5f * mWidth;
+        float y = (1.0f - clip[1] / clip[3]) * 0.5f * mHeight;
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y);
+        yMax = std::max(yMax, y);
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(xMin)), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(xMax)), mWidth);
+    int y0 = std::max(static_cast<int>(std::floor(yMin)), 0);
+    int y1 = std::min(static_cast<int>(std::ceil(yMax)), mHeight);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return false;
+    }
+
+    // Compare to the tile depths first.  Only the tiles whose maximum depth
+    // is not in front of the sphere require the per-pixel comparisons.
+    for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ++ty)
+    {
+        for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; ++tx)
+        {
+            if (zNear > mTileDepth[tx + mNumXTiles * ty])
+            {
+                continue;
+            }
+
+            int pxMin = std::max(x0, tx * TILE_SIZE);
+            int pxMax = std::min(x1, (tx + 1) * TILE_SIZE);
+            int pyMin = std::max(y0, ty * TILE_SIZE);
+            int pyMax = std::min(y1, (ty + 1) * TILE_SIZE);
+            for (int py = pyMin; py < pyMax; ++py)
+            {
+                float const* row = &mDepth[static_cast<size_t>(mWidth) * py];
+                int visible = 0;
+                for (int px = pxMin; px < pxMax; ++px)
+                {
+                    visible |= (row[px] >= zNear ? 1 : 0);
+                }
+                if (visible)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionCuller::RasterizeOccluder(Visual* occluder)
+{
+    VertexBuffer* vbuffer = occluder->GetVertexBuffer().get();
+    IndexBuffer* ibuffer = occluder->GetIndexBuffer().get();
+    if (!vbuffer || !ibuffer || !(ibuffer->GetPrimitiveType() & IP_HAS_TRIANGLES))
+    {
+        return;
+    }
+
+    std::set<DFType> required;
+    required.insert(DF_R32G32B32_FLOAT);
+    required.insert(DF_R32G32B32A32_FLOAT);
+    char const* positions = vbuffer->GetChannel(VA_POSITION, 0, required);
+    if (!positions)
+    {
+        return;
+    }
+
+    // Transform the vertices to clip space.  The view distance is stored in
+    // the last component of 'views' to test against the near plane.
+    Matrix4x4<float> const& wMatrix = occluder->worldTransform;
+    Matrix4x4<float> pvwMatrix = DoTransform(mPVMatrix, wMatrix);
+    unsigned int const vstride = vbuffer->GetElementSize();
+    unsigned int const numVertices = vbuffer->GetNumElements();
+    std::vector<Vector4<float>> clips(numVertices);
+    std::vector<float> distances(numVertices);
+    for (unsigned int v = 0; v < numVertices; ++v)
+    {
+        Vector3<float> const& position = *reinterpret_cast<Vector3<float> const*>(positions + v * vstride);
+        Vector4<float> hposition = HLift(position, 1.0f);
+        clips[v] = DoTransform(pvwMatrix, hposition);
+        distances[v] = Dot(mDirection, DoTransform(wMatrix, hposition) - mEye);
+    }
+
+    bool const isIndexed = ibuffer->IsIndexed();
+    IPType const primitiveType = ibuffer->GetPrimitiveType();
+    unsigned int const firstTriangle = ibuffer->GetFirstPrimitive();
+    unsigned int const numTriangles = ibuffer->GetNumActivePrimitives();
+    for (unsigned int i = firstTriangle; i < firstTriangle + numTriangles; ++i)
+    {
+        unsigned int v0, v1, v2;
+        if (isIndexed)
+        {
+            ibuffer->GetTriangle(i, v0, v1, v2);
+        }
+        else if (primitiveType == IP_TRIMESH)
+        {
+            v0 = 3 * i;
+            v1 = v0 + 1;
+            v2 = v0 + 2;
+        }
+        else  // primitiveType == IP_TRISTRIP
+        {
+            int offset = (i & 1);
+            v0 = i + offset;
+            v1 = i + 1 + offset;
+            v2 = i + 2 - offset;
+        }
+
+        if (distances[v0] > mDMin && distances[v1] > mDMin && distances[v2] > mDMin)
+        {
+            Vector4<float> clip[3] = { clips[v0], clips[v1], clips[v2] };
+            RasterizeTriangle(clip);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTriangle(Vector4<float> const* clip)
+{
+    // Compute the screen coordinates and depths.
+    float x[3], y[3], z[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        float invW = 1.0f / clip[j][3];
+        x[j] = (clip[j][0] * invW + 1.0f) * 0.5f * mWidth;
+        y[j] = (1.0f - clip[j][1] * invW) * 0.5f * mHeight;
+        z[j] = clip[j][2] * invW;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(area) > 0.0f) || !std::isfinite(area))
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(std::min({ x[0], x[1], x[2] }))), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(std::max({ x[0], x[1], x[2] }))), mWidth);
+    int y0 = std::max(static_cast<int>(std::floor(std::min({ y[0], y[1], y[2] }))), 0);
+    int y1 = std::min(static_cast<int>(std::ceil(std::max({ y[0], y[1], y[2] }))), mHeight);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    // The edge functions E(x,y) = A*x + B*y + C are positive inside the
+    // triangle.  A pixel is entirely inside an edge when E at the pixel
+    // center is at least the offset 0.5*(|A|+|B|).
+    float A[3], B[3], C[3], offset[3];
+    for (int j0 = 0; j0 < 3; ++j0)
+    {
+        int j1 = (j0 + 1) % 3;
+        A[j0] = y[j0] - y[j1];
+        B[j0] = x[j1] - x[j0];
+        C[j0] = -(A[j0] * x[j0] + B[j0] * y[j0]);
+        offset[j0] = 0.5f * (std::fabs(A[j0]) + std::fabs(B[j0]));
+    }
+
+    // The depth is an affine function of the screen coordinates.  The
+    // maximum over a pixel is its value at the center plus
+    // 0.5*(|dz/dx|+|dz/dy|), which is bounded by the maximum vertex depth.
+    float invArea = 1.0f / area;
+    float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (z[2] - z[0])) * invArea;
+    float dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+    float zOffset = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+    float zMax = std::max({ z[0], z[1], z[2] });
+
+    for (int py = y0; py < y1; ++py)
+    {
+        float cx = x0 + 0.5f, cy = py + 0.5f;
+        float e0 = A[0] * cx + B[0] * cy + C[0] - offset[0];
+        float e1 = A[1] * cx + B[1] * cy + C[1] - offset[1];
+        float e2 = A[2] * cx + B[2] * cy + C[2] - offset[2];
+        float zRow = z[0] + dzdx * (cx - x[0]) + dzdy * (cy - y[0]) + zOffset;
+        float* row = &mDepth[static_cast<size_t>(mWidth) * py];
+        for (int px = x0; px < x1; ++px)
+        {
+            float t = static_cast<float>(px - x0);
+            bool covered = (e0 + A[0] * t >= 0.0f) & (e1 + A[1] * t >= 0.0f) & (e2 + A[2] * t >= 0.0f);
+            float depth = std::min(zRow + dzdx * t, zMax);
+            row[px] = (covered ? std::min(row[px], depth) : row[px]);
+        }
+    }
+}
+
+void OcclusionCuller::ComputeTileDepths()
+{
+    for (int ty = 0; ty < mNumYTiles; ++ty)
+    {
+        int pyMax = std::min((ty + 1) * TILE_SIZE, mHeight);
+        for (int tx = 0; tx < mNumXTiles; ++tx)
+        {
+            int pxMax = std::min((tx + 1) * TILE_SIZE, mWidth);
+            float tileDepth = -std::numeric_limits<float>::max();
+            for (int py = ty * TILE_SIZE; py < pyMax; ++py)
+            {
+                float const* row = &mDepth[static_cast<size_t>(mWidth) * py];
+                for (int px = tx * TILE_SIZE; px < pxMax; ++px)
+                {
+                    tileDepth = std::max(tileDepth, row[px]);
+                }
+            }
+            mTileDepth[tx + mNumXTiles * ty] = tileDepth;
+        }
+    }
+}
@@ -164,61 +164,163 @@ PickRecord const& Picker::GetClosestNonpositive() const
     }
 }
 
-void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
+void Picker::BuildIndex(std::shared_ptr<Spatial> const& scene)
 {
-    auto visual = std::dynamic_pointer_cast<Visual>(object);
-    if (visual)
+    mIndexedVisuals.clear();
+    if (scene)
     {
-        if (visual->worldBound.TestIntersection(HProject(mOrigin), HProject(mDirection), mTMin, mTMax))
+        CollectVisuals(scene);
+    }
+
+    // Build the triangle hierarchies of new Visual objects and of those
+    // whose buffers were replaced.  The hierarchies of the Visual objects
+    // no longer in the scene are discarded.
+    std::map<Visual const*, TriangleIndex> triangleIndices;
+    std::vector<AlignedBox3<float>> boxes;
+    for (auto const& visual : mIndexedVisuals)
+    {
+        Visual* object = visual.get();
+        auto iter = mTriangleIndices.find(object);
+        if (iter != mTriangleIndices.end() && iter->second.IsIndexOf(object))
         {
-            // Convert the linear component to model-space coordinates.
-            Matrix4x4<float> const& invWorldMatrix = visual->worldTransform.GetHInverse();
-            Line3<float> line;
-            Vector4<float> temp;
-#if defined (GTE_USE_MAT_VEC)
-            temp = invWorldMatrix * mOrigin;
-            line.origin = { temp[0], temp[1], temp[2] };
-            temp = invWorldMatrix * mDirection;
-            line.direction = { temp[0], temp[1], temp[2] };
-#else
-            temp = mOrigin * invWorldMatrix;
-            line.origin = { temp[0], temp[1], temp[2] };
-            temp = mDirection * invWorldMatrix;
-            line.direction = { temp[0], temp[1], temp[2] };
-#endif
-            // The world transformation might have non-unit scales, in which case the
-            // model-space line direction is not unit length.
-            Normalize(line.direction);
-
-            // Get the position data.
-            VertexBuffer* vbuffer = visual->GetVertexBuffer().get();
-            std::set<DFType> required;
-            required.insert(DF_R32G32B32_FLOAT);
-            required.insert(DF_R32G32B32A32_FLOAT);
-            char const* positions = vbuffer->GetChannel(VA_POSITION, 0, required);
-            if (!positions)
-            {
-                LogInformation("Expecting 3D positions.");
-                return;
-            }
+            triangleIndices.insert(*iter);
+        }
+        else if (ComputeTriangleBoxes(object, boxes))
+        {
+            TriangleIndex& index = triangleIndices[object];
+            index.vbuffer = object->GetVertexBuffer();
+            index.ibuffer = object->GetIndexBuffer();
+            index.firstTriangle = object->GetIndexBuffer()->GetFirstPrimitive();
+            index.numTriangles = object->GetIndexBuffer()->GetNumActivePrimitives();
+            index.tree.Build(boxes);
+        }
+    }
+    mTriangleIndices = std::move(triangleIndices);
 
-            // The picking algorithm depends on the primitive type.
-            unsigned int vstride = vbuffer->GetElementSize();
-            IndexBuffer* ibuffer = visual->GetIndexBuffer().get();
-            IPType primitiveType = ibuffer->GetPrimitiveType();
-            if (primitiveType & IP_HAS_TRIANGLES)
-            {
-                PickTriangles(visual, positions, vstride, ibuffer, line);
-            }
-            else if (primitiveType & IP_HAS_SEGMENTS)
-            {
-                PickSegments(visual, positions, vstride, ibuffer, line);
-            }
-            else if (primitiveType & IP_HAS_POINTS)
-            {
-                PickPoints(visual, positions, vstride, ibuffer, line);
-            }
+    ComputeSceneBoxes(boxes);
+    mSceneTree.Build(boxes);
+    ComputeInverseWorldMatrices();
+}
+
+void Picker::RefitIndex()
+{
+    std::vector<AlignedBox3<float>> boxes;
+    ComputeSceneBoxes(boxes);
+    mSceneTree.Refit(boxes);
+    ComputeInverseWorldMatrices();
+}
+
+void Picker::RefitVisual(std::shared_ptr<Visual> const& visual)
+{
+    auto iter = mTriangleIndices.find(visual.get());
+    if (iter == mTriangleIndices.end())
+    {
+        LogError("The visual does not have a triangle index.");
+        return;
+    }
+
+    std::vector<AlignedBox3<float>> boxes;
+    TriangleIndex& index = iter->second;
+    if (ComputeTriangleBoxes(visual.get(), boxes))
+    {
+        if (index.IsIndexOf(visual.get())
+            && static_cast<int>(boxes.size()) == index.tree.GetNumPrimitives())
+        {
+            index.tree.Refit(boxes);
+        }
+        else
+        {
+            index.vbuffer = visual->GetVertexBuffer();
+            index.ibuffer = visual->GetIndexBuffer();
+            index.firstTriangle = visual->GetIndexBuffer()->GetFirstPrimitive();
+            index.numTriangles = visual->GetIndexBuffer()->GetNumActivePrimitives();
+            index.tree.Build(boxes);
         }
+    }
+    else
+    {
+        mTriangleIndices.erase(iter);
+    }
+}
+
+void Picker::ClearIndex()
+{
+    mIndexedVisuals.clear();
+    mInverseWorldMatrices.clear();
+    mSceneTree.Build(std::vector<AlignedBox3<float>>());
+    mTriangleIndices.clear();
+}
+
+void Picker::operator()(Vector4<float> const& origin, Vector4<float> const& direction,
+    float tmin, float tmax)
+{
+    mOrigin = origin;
+    mDirection = direction;
+    mTMin = tmin;
+    mTMax = tmax;
+
+    records.clear();
+    mSceneTree.VisitLine(HProject(origin), HProject(direction), tmin, tmax,
+        [this, &origin, &direction, tmin, tmax](int i)
+        {
+            PickVisual(mIndexedVisuals[i], mInverseWorldMatrices[i], origin, direction,
+                tmin, tmax, true, records);
+        });
+}
+
+void Picker::operator()(std::vector<Vector4<float>> const& origins,
+    std::vector<Vector4<float>> const& directions, float tmin, float tmax,
+    std::vector<std::vector<PickRecord>>& output) const
+{
+    size_t const numQueries = std::min(origins.size(), directions.size());
+    output.resize(numQueries);
+
+    auto pick = [this, &origins, &directions, tmin, tmax, &output](size_t q0, size_t q1)
+    {
+        for (size_t q = q0; q < q1; ++q)
+        {
+            Vector4<float> const& origin = origins[q];
+            Vector4<float> const& direction = directions[q];
+            std::vector<PickRecord>& queryOutput = output[q];
+            queryOutput.clear();
+            mSceneTree.VisitLine(HProject(origin), HProject(direction), tmin, tmax,
+                [this, &origin, &direction, tmin, tmax, &queryOutput](int i)
+                {
+                    PickVisual(mIndexedVisuals[i], mInverseWorldMatrices[i], origin, direction,
+                        tmin, tmax, true, queryOutput);
+                });
+        }
+    };
+
+    auto const numThreads = static_cast<size_t>(std::min(static_cast<size_t>(mNumThreads), numQueries));
+    if (numThreads > 1)
+    {
+        std::vector<std::thread> process(numThreads);
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            size_t q0 = (t * numQueries) / numThreads;
+            size_t q1 = ((t + 1) * numQueries) / numThreads;
+            process[t] = std::thread([&pick, q0, q1]() { pick(q0, q1); });
+        }
+
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            process[t].join();
+        }
+    }
+    else
+    {
+        pick(0, numQueries);
+    }
+}
+
+void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
+{
+    auto visual = std::dynamic_pointer_cast<Visual>(object);
+    if (visual)
+    {
+        PickVisual(visual, visual->worldTransform.GetHInverse(), mOrigin, mDirection,
+            mTMin, mTMax, false, records);
         return;
     }
 
@@ -246,8 +348,81 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
     LogWarning("Invalid object type.");
 }
 
+void Picker::PickVisual(std::shared_ptr<Visual> const& visual,
+    Matrix4x4<float> const& invWorldMatrix, Vector4<float> const& origin, Vector4<float> const& direction,
+    float tmin, float tmax, bool useIndex, std::vector<PickRecord>& output) const
+{
+    if (!visual->worldBound.TestIntersection(HProject(origin), HProject(direction), tmin, tmax))
+    {
+        return;
+    }
+
+    // Convert the linear component to model-space coordinates.
+    Line3<float> line;
+    Vector4<float> temp;
+#if defined (GTE_USE_MAT_VEC)
+    temp = invWorldMatrix * origin;
+    line.origin = { temp[0], temp[1], temp[2] };
+    temp = invWorldMatrix * direction;
+    line.direction = { temp[0], temp[1], temp[2] };
+#else
+    temp = origin * invWorldMatrix;
+    line.origin = { temp[0], temp[1], temp[2] };
+    temp = direction * invWorldMatrix;
+    line.direction = { temp[0], temp[1], temp[2] };
+#endif
+    // The world transformation might have non-unit scales, in which case the
+    // model-space line direction is not unit length.
+    Normalize(line.direction);
+
+    // Get the position data.
+    char const* positions = GetPositions(visual.get());
+    if (!positions)
+    {
+        LogInformation("Expecting 3D positions.");
+        return;
+    }
+
+    // The picking algorithm depends on the primitive type.
+    VertexBuffer* vbuffer = visual->GetVertexBuffer().get();
+    unsigned int vstride = vbuffer->GetElementSize();
+    IndexBuffer* ibuffer = visual->GetIndexBuffer().get();
+    IPType primitiveType = ibuffer->GetPrimitiveType();
+    if (primitiveType & IP_HAS_TRIANGLES)
+    {
+        if (useIndex)
+        {
+            auto iter = mTriangleIndices.find(visual.get());
+            if (iter != mTriangleIndices.end())
+            {
+                // The primitive k of the tree is the active triangle
+                // firstTriangle + k.
+                unsigned int const firstTriangle = ibuffer->GetFirstPrimitive();
+                iter->second.tree.VisitLine(line.origin, line.direction, tmin, tmax,
+                    [&](int k)
+                    {
+                        PickTriangle(visual, positions, vstride, ibuffer, line,
+                            firstTriangle + k, origin, tmin, tmax, output);
+                    });
+                return;
+            }
+        }
+        PickTriangles(visual, positions, vstride, ibuffer, line, origin, tmin, tmax, output);
+    }
+    else if (primitiveType & IP_HAS_SEGMENTS)
+    {
+        PickSegments(visual, positions, vstride, ibuffer, line, origin, tmin, tmax, output);
+    }
+    else if (primitiveType & IP_HAS_POINTS)
+    {
+        PickPoints(visual, positions, vstride, ibuffer, line, origin, tmin, tmax, output);
+    }
+}
+
 void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, char const* positions,
-    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line)
+    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+    Vector4<float> const& origin, float tmin, float tmax,
+    std::vector<PickRecord>& output) const
 {
     // Partition the items for multiple threads.
     auto const firstTriangle = ibuffer->GetFirstPrimitive();
@@ -273,10 +448,13 @@ void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, char const* po
             auto const i0 = imin[t];
             auto const i1 = imax[t];
             process[t] = std::thread(
-                [this, t, visual, positions, vstride, ibuffer, line, i0, i1, &threadOutputs]()
+                [this, t, visual, positions, vstride, ibuffer, line, i0, i1, origin, tmin, tmax, &threadOutputs]()
                 {
-                    PickTriangles(visual, positions, vstride, ibuffer, line,
-                        i0, i1, threadOutputs[t]);
+                    for (unsigned int i = i0; i <= static_cast<unsigned int>(i1); ++i)
+                    {
+                        PickTriangle(visual, positions, vstride, ibuffer, line,
+                            i, origin, tmin, tmax, threadOutputs[t]);
+                    }
                 });
         }
 
@@ -284,94 +462,78 @@ void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, char const* po
         for (unsigned int t = 0; t < numThreads; ++t)
         {
             process[t].join();
-            std::copy(threadOutputs[t].begin(), threadOutputs[t].end(), std::back_inserter(records));
+            std::copy(threadOutputs[t].begin(), threadOutputs[t].end(), std::back_inserter(output));
         }
     }
     else
     {
-        PickTriangles(visual, positions, vstride, ibuffer, line,
-            firstTriangle, firstTriangle + numTriangles - 1, records);
+        for (unsigned int i = firstTriangle; i < firstTriangle + numTriangles; ++i)
+        {
+            PickTriangle(visual, positions, vstride, ibuffer, line,
+                i, origin, tmin, tmax, output);
+        }
     }
 }
 
-void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, char const* positions,
+void Picker::PickTriangle(std::shared_ptr<Visual> const& visual, char const* positions,
     unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
-    unsigned int i0, unsigned int i1, std::vector<PickRecord>& output) const
+    unsigned int i, Vector4<float> const& origin, float tmin, float tmax,
+    std::vector<PickRecord>& output) const
 {
-    // Compute intersections with the model-space triangles.
-    bool isIndexed = ibuffer->IsIndexed();
-    IPType primitiveType = ibuffer->GetPrimitiveType();
-    for (unsigned int i = i0; i <= i1; ++i)
+    // Get the vertex indices for the triangle.
+    unsigned int v0, v1, v2;
+    GetTriangle(ibuffer, i, v0, v1, v2);
+
+    // Get the vertex positions.
+    Vector3<float> const& p0 = *(Vector3<float> const*)(positions + v0 * vstride);
+    Vector3<float> const& p1 = *(Vector3<float> const*)(positions + v1 * vstride);
+    Vector3<float> const& p2 = *(Vector3<float> const*)(positions + v2 * vstride);
+
+    // Create the query triangle in model space.
+    Triangle3<float> triangle(p0, p1, p2);
+
+    // Compute line-triangle intersection.
+    FIQuery<float, Line3<float>, Triangle3<float>> query;
+    auto result = query(line, triangle);
+    if (result.intersect
+        && tmin <= result.parameter
+        && result.parameter <= tmax)
     {
-        // Get the vertex indices for the triangle.
-        unsigned int v0, v1, v2;
-        if (isIndexed)
-        {
-            ibuffer->GetTriangle(i, v0, v1, v2);
-        }
-        else if (primitiveType == IP_TRIMESH)
-        {
-            v0 = 3 * i;
-            v1 = v0 + 1;
-            v2 = v0 + 2;
-        }
-        else  // primitiveType == IP_TRISTRIP
-        {
-            int offset = (i & 1);
-            v0 = i + offset;
-            v1 = i + 1 + offset;
-            v2 = i + 2 - offset;
-        }
-
-        // Get the vertex positions.
-        Vector3<float> const& p0 = *(Vector3<float> const*)(positions + v0 * vstride);
-        Vector3<float> const& p1 = *(Vector3<float> const*)(positions + v1 * vstride);
-        Vector3<float> const& p2 = *(Vector3<float> const*)(positions + v2 * vstride);
-
-        // Create the query triangle in model space.
-        Triangle3<float> triangle(p0, p1, p2);
-
-        // Compute line-triangle intersection.
-        FIQuery<float, Line3<float>, Triangle3<float>> query;
-        auto result = query(line, triangle);
-        if (result.intersect
-            && mTMin <= result.parameter
-            && result.parameter <= mTMax)
-        {
-            PickRecord record;
-            record.visual = visual;
-            record.primitiveType = primitiveType;
-            record.primitiveIndex = i;
-            record.vertexIndex[0] = static_cast<int>(v0);
-            record.vertexIndex[1] = static_cast<int>(v1);
-            record.vertexIndex[2] = static_cast<int>(v2);
-            record.t = result.parameter;
-            record.bary[0] = result.triangleBary[0];
-            record.bary[1] = result.triangleBary[1];
-            record.bary[2] = result.triangleBary[2];
-            record.linePoint = HLift(result.point, 1.0f);
+        PickRecord record;
+        record.visual = visual;
+        record.primitiveType = ibuffer->GetPrimitiveType();
+        record.primitiveIndex = i;
+        record.vertexIndex[0] = static_cast<int>(v0);
+        record.vertexIndex[1] = static_cast<int>(v1);
+        record.vertexIndex[2] = static_cast<int>(v2);
+        record.t = result.parameter;
+        record.bary[0] = result.triangleBary[0];
+        record.bary[1] = result.triangleBary[1];
+        record.bary[2] = result.triangleBary[2];
+        record.linePoint = HLift(result.point, 1.0f);
 
 #if defined (GTE_USE_MAT_VEC)
-            record.linePoint = visual->worldTransform * record.linePoint;
+        record.linePoint = visual->worldTransform * record.linePoint;
 #else
-            record.linePoint = record.linePoint * visual->worldTransform;
+        record.linePoint = record.linePoint * visual->worldTransform;
 #endif
-            record.primitivePoint = record.linePoint;
+        record.primitivePoint = record.linePoint;
 
-            record.distanceToLinePoint =
-                Length(record.linePoint - mOrigin);
-            record.distanceToPrimitivePoint =
-                Length(record.primitivePoint - mOrigin);
-            record.distanceBetweenLinePrimitive =
-                Length(record.linePoint - record.primitivePoint);
+        record.distanceToLinePoint =
+            Length(record.linePoint - origin);
+        record.distanceToPrimitivePoint =
+            Length(record.primitivePoint - origin);
+        record.distanceBetweenLinePrimitive =
+            Length(record.linePoint - record.primitivePoint);
 
-            output.push_back(record);
-        }
+        output.push_back(record);
     }
 }
 
 void Picker::PickSegments(std::shared_ptr<Visual> const& visual, char const* positions,
-    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line)
+    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+    Vector4<float> const& origin, float tmin, float tmax,
+    std::vector<PickRecord>& output) const
 {
     // Compute distances from the model-space segments to the line.
     unsigned int const firstSegment = ibuffer->GetFirstPrimitive();
@@ -407,7 +569,7 @@ void Picker::PickSegments(std::shared_ptr<Visual> const& visual, char const* pos
         // Compute segment-line distance.
         DCPQuery<float, Line3<float>, Segment3<float>> query;
         auto result = query(line, segment);
-        if (result.distance <= mMaxDistance && mTMin <= result.parameter[0] && result.parameter[0] <= mTMax)
+        if (result.distance <= mMaxDistance && tmin <= result.parameter[0] && result.parameter[0] <= tmax)
         {
             PickRecord record;
             record.visual = visual;
@@ -431,19 +593,21 @@ void Picker::PickSegments(std::shared_ptr<Visual> const& visual, char const* pos
             record.primitivePoint = record.primitivePoint * visual->worldTransform;
 #endif
             record.distanceToLinePoint =
-                Length(record.linePoint - mOrigin);
+                Length(record.linePoint - origin);
             record.distanceToPrimitivePoint =
-                Length(record.primitivePoint - mOrigin);
+                Length(record.primitivePoint - origin);
             record.distanceBetweenLinePrimitive =
                 Length(record.linePoint - record.primitivePoint);
 
-            records.push_back(record);
+            output.push_back(record);
         }
     }
 }
 
 void Picker::PickPoints(std::shared_ptr<Visual> const& visual, char const* positions,
-    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line)
+    unsigned int vstride, IndexBuffer* ibuffer, Line3<float> const& line,
+    Vector4<float> const& origin, float tmin, float tmax,
+    std::vector<PickRecord>& output) const
 {
     // Compute distances from the model-space points to the line.
     unsigned int const firstPoint = ibuffer->GetFirstPrimitive();
@@ -468,7 +632,7 @@ void Picker::PickPoints(std::shared_ptr<Visual> const& visual, char const* posit
         // Compute point-line distance.
         DCPQuery<float, Vector3<float>, Line3<float>> query;
         auto result = query(p, line);
-        if (result.distance <= mMaxDistance && mTMin <= result.lineParameter && result.lineParameter <= mTMax)
+        if (result.distance <= mMaxDistance && tmin <= result.lineParameter && result.lineParameter <= tmax)
         {
             PickRecord record;
             record.visual = visual;
@@ -492,14 +656,134 @@ void Picker::PickPoints(std::shared_ptr<Visual> const& visual, char const* posit
             record.primitivePoint = record.primitivePoint * visual->worldTransform;
 #endif
             record.distanceToLinePoint =
-                Length(record.linePoint - mOrigin);
+                Length(record.linePoint - origin);
             record.distanceToPrimitivePoint =
-                Length(record.primitivePoint - mOrigin);
+                Length(record.primitivePoint - origin);
             record.distanceBetweenLinePrimitive =
                 Length(record.linePoint - record.primitivePoint);
 
-            records.push_back(record);
+            output.push_back(record);
         }
     }
 }
 
+
+void Picker::CollectVisuals(std::shared_ptr<Spatial> const& object)
+{
+    auto visual = std::dynamic_pointer_cast<Visual>(object);
+    if (visual)
+    {
+        mIndexedVisuals.push_back(visual);
+        return;
+    }
+
+    auto node = std::dynamic_pointer_cast<Node>(object);
+    if (node)
+    {
+        int const numChildren = node->GetNumChildren();
+        for (int i = 0; i < numChildren; ++i)
+        {
+            std::shared_ptr<Spatial> child = node->GetChild(i);
+            if (child)
+            {
+                CollectVisuals(child);
+            }
+        }
+    }
+}
+
+void Picker::ComputeSceneBoxes(std::vector<AlignedBox3<float>>& boxes) const
+{
+    // The boxes contain the world bounding spheres.  The spheres themselves
+    // are tested when the leaves of the tree are visited.
+    boxes.resize(mIndexedVisuals.size());
+    for (size_t i = 0; i < mIndexedVisuals.size(); ++i)
+    {
+        BoundingSphere<float> const& sphere = mIndexedVisuals[i]->worldBound;
+        Vector3<float> center = sphere.GetCenter();
+        float radius = sphere.GetRadius();
+        for (int j = 0; j < 3; ++j)
+        {
+            boxes[i].min[j] = center[j] - radius;
+            boxes[i].max[j] = center[j] + radius;
+        }
+    }
+}
+
+void Picker::ComputeInverseWorldMatrices()
+{
+    mInverseWorldMatrices.resize(mIndexedVisuals.size());
+    for (size_t i = 0; i < mIndexedVisuals.size(); ++i)
+    {
+        mInverseWorldMatrices[i] = mIndexedVisuals[i]->worldTransform.GetHInverse();
+    }
+}
+
+char const* Picker::GetPositions(Visual* visual)
+{
+    VertexBuffer* vbuffer = visual->GetVertexBuffer().get();
+    if (!vbuffer || !visual->GetIndexBuffer())
+    {
+        return nullptr;
+    }
+
+    std::set<DFType> required;
+    required.insert(DF_R32G32B32_FLOAT);
+    required.insert(DF_R32G32B32A32_FLOAT);
+    return vbuffer->GetChannel(VA_POSITION, 0, required);
+}
+
+void Picker::GetTriangle(IndexBuffer* ibuffer, unsigned int i,
+    unsigned int& v0, unsigned int& v1, unsigned int& v2)
+{
+    if (ibuffer->IsIndexed())
+    {
+        ibuffer->GetTriangle(i, v0, v1, v2);
+    }
+    else if (ibuffer->GetPrimitiveType() == IP_TRIMESH)
+    {
+        v0 = 3 * i;
+        v1 = v0 + 1;
+        v2 = v0 + 2;
+    }
+    else  // primitiveType == IP_TRISTRIP
+    {
+        int offset = (i & 1);
+        v0 = i + offset;
+        v1 = i + 1 + offset;
+        v2 = i + 2 - offset;
+    }
+}
+
+bool Picker::ComputeTriangleBoxes(Visual* visual, std::vector<AlignedBox3<float>>& boxes)
+{
+    char const* positions = GetPositions(visual);
+    IndexBuffer* ibuffer = visual->GetIndexBuffer().get();
+    if (!positions || !(ibuffer->GetPrimitiveType() & IP_HAS_TRIANGLES))
+    {
+        return false;
+    }
+
+    unsigned int const vstride = visual->GetVertexBuffer()->GetElementSize();
+    unsigned int const firstTriangle = ibuffer->GetFirstPrimitive();
+    unsigned int const numTriangles = ibuffer->GetNumActivePrimitives();
+    boxes.resize(numTriangles);
+    for (unsigned int k = 0; k < numTriangles; ++k)
+    {
+        unsigned int v[3];
+        GetTriangle(ibuffer, firstTriangle + k, v[0], v[1], v[2]);
+        Vector3<float> const& p0 = *(Vector3<float> const*)(positions + v[0] * vstride);
+        boxes[k].min = p0;
+        boxes[k].max = p0;
+        for (int j = 1; j < 3; ++j)
+        {
+            Vector3<float> const& p = *(Vector3<float> const*)(positions + v[j] * vstride);
+            for (int d = 0; d < 3; ++d)
+            {
+                boxes[k].min[d] = std::min(boxes[k].min[d], p[d]);
+                boxes[k].max[d] = std::max(boxes[k].max[d], p[d]);
+            }
+        }
+    }
+    return true;
+}
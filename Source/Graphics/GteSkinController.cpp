@@ -9,6 +9,10 @@
 #include <Graphics/GteSkinController.h>
 #include <Graphics/GteNode.h>
 #include <Graphics/GteVisual.h>
+#include <LowLevel/GteLogger.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 using namespace gte;
 
 SkinController::~SkinController()
@@ -17,6 +21,7 @@ SkinController::~SkinController()
 
 SkinController::SkinController(int numVertices, int numBones, Updater const& postUpdate)
     :
+    numThreads(1),
     mNumVertices(numVertices),
     mNumBones(numBones),
     mBones(numBones),
@@ -26,7 +31,9 @@ SkinController::SkinController(int numVertices, int numBones, Updater const& pos
     mPosition(nullptr),
     mStride(0),
     mFirstUpdate(true),
-    mCanUpdate(false)
+    mCanUpdate(false),
+    mMaxInfluences(0),
+    mDualQuaternion(false)
 {
 }
 
@@ -51,57 +58,67 @@ bool SkinController::Update(double applicationTime)
         visual->worldTransform = Transform::IDENTITY;
         visual->worldTransformIsCurrent = true;
 
-        // Package the bone transformations into a std::vector to avoid the
-        // expensive lock() calls in the inner loop of the position updates.
-        std::vector<Matrix4x4<float>> worldTransforms(mNumBones);
-        for (int bone = 0; bone < mNumBones; ++bone)
-        {
-            worldTransforms[bone] = mBones[bone].lock()->worldTransform;
-        }
-
-        // Compute the skin vertex locations.  The typecasting to raw 'float'
-        // pointers increases the frame rate dramatically, both in Debug and
-        // Release builds.  Without this in Debug builds, the lack of inlining
-        // of Vector4, Matrix4, std::array and std::vector operator[]
-        // functions leads to a low frame rate.  Without this in Release
-        // builds, the lack of a highly efficient implementation of operator[]
-        // in std::array and std::vector leads to a low frame rate.  Running
-        // on an Intel(R) Core(TM) i7-6700 CPU @ 3.40GHz, the Debug frame rate
-        // before the typecasting is 16 fps and after the typecasting is
-        // 223 fps.  The Release frame rate before the typecasting is 2390 fps
-        // and after the typecasting is 4170 fps (sync to vertical retrace is
-        // turned off for these experiments).
-        char* current = mPosition;
-        float const* weights = mWeights.data();
-        Vector4<float> const* offsets = mOffsets.data();
-        for (int vertex = 0; vertex < mNumVertices; ++vertex)
-        {
-            Matrix4x4<float> const* worldTransform = worldTransforms.data();
-            float position[3] = { 0.0f, 0.0f, 0.0f };
-            for (int bone = 0; bone < mNumBones; ++bone, ++weights, ++offsets, ++worldTransform)
+        if (mMaxInfluences > 0)
+        {
+            ComputeBoneData();
+            SkinVertices();
+        }
+        else
+        {
+            // Package the bone transformations into a std::vector to avoid
+            // the expensive lock() calls in the inner loop of the position
+            // updates.
+            std::vector<Matrix4x4<float>> worldTransforms(mNumBones);
+            for (int bone = 0; bone < mNumBones; ++bone)
+            {
+                worldTransforms[bone] = mBones[bone].lock()->worldTransform;
+            }
+
+            // Compute the skin vertex locations.  The typecasting to raw
+            // 'float' pointers increases the frame rate dramatically, both in
+            // Debug and Release builds.  Without this in Debug builds, the
+            // lack of inlining of Vector4, Matrix4, std::array and
+            // std::vector operator[] functions leads to a low frame rate.
+            // Without this in Release builds, the lack of a highly efficient
+            // implementation of operator[] in std::array and std::vector
+            // leads to a low frame rate.  Running on an Intel(R) Core(TM)
+            // i7-6700 CPU @ 3.40GHz, the Debug frame rate before the
+            // typecasting is 16 fps and after the typecasting is 223 fps.
+            // The Release frame rate before the typecasting is 2390 fps and
+            // after the typecasting is 4170 fps (sync to vertical retrace is
+            // turned off for these experiments).
+            char* current = mPosition;
+            float const* weights = mWeights.data();
+            Vector4<float> const* offsets = mOffsets.data();
+            for (int vertex = 0; vertex < mNumVertices; ++vertex)
             {
-                float weight = *weights;
-                if (weight != 0.0f)
+                Matrix4x4<float> const* worldTransform = worldTransforms.data();
+                float position[3] = { 0.0f, 0.0f, 0.0f };
+                for (int bone = 0; bone < mNumBones; ++bone, ++weights, ++offsets, ++worldTransform)
                 {
-                    float const* M = reinterpret_cast<float const*>(worldTransform);
-                    float const* P = reinterpret_cast<float const*>(offsets);
+                    float weight = *weights;
+                    if (weight != 0.0f)
+                    {
+                        float const* M = reinterpret_cast<float const*>(worldTransform);
+                        float const* P = reinterpret_cast<float const*>(offsets);
 #if defined (GTE_USE_MAT_VEC)
-                    position[0] += weight * (M[0] * P[0] + M[1] * P[1] + M[2] * P[2] + M[3]);
-                    position[1] += weight * (M[4] * P[0] + M[5] * P[1] + M[6] * P[2] + M[7]);
-                    position[2] += weight * (M[8] * P[0] + M[9] * P[1] + M[10] * P[2] + M[11]);
+                        position[0] += weight * (M[0] * P[0] + M[1] * P[1] + M[2] * P[2] + M[3]);
+                        position[1] += weight * (M[4] * P[0] + M[5] * P[1] + M[6] * P[2] + M[7]);
+                        position[2] += weight * (M[8] * P[0] + M[9] * P[1] + M[10] * P[2] + M[11]);
 #else
-                    position[0] += weight * (M[0] * P[0] + M[4] * P[1] + M[8] * P[2] + M[12]);
-                    position[1] += weight * (M[1] * P[0] + M[5] * P[1] + M[9] * P[2] + M[13]);
-                    position[2] += weight * (M[2] * P[0] + M[6] * P[1] + M[10] * P[2] + M[14]);
+                        position[0] += weight * (M[0] * P[0] + M[4] * P[1] + M[8] * P[2] + M[12]);
+                        position[1] += weight * (M[1] * P[0] + M[5] * P[1] + M[9] * P[2] + M[13]);
+                        position[2] += weight * (M[2] * P[0] + M[6] * P[1] + M[10] * P[2] + M[14]);
 #endif
+                    }
                 }
-            }
 
-            float* target = reinterpret_cast<float*>(current);
-            target[0] = position[0];
-            target[1] = position[1];
-            target[2] = position[2];
-            current += mStride;
+                float* target = reinterpret_cast<float*>(current);
+                target[0] = position[0];
+                target[1] = position[1];
+                target[2] = position[2];
+                current += mStride;
+            }
         }
 
         visual->UpdateModelBound();
@@ -144,3 +161,395 @@ void SkinController::OnFirstUpdate()
 
     mCanUpdate = (mPosition != nullptr);
 }
+
+bool SkinController::Compress(int maxInfluences)
+{
+    if (maxInfluences < 1 || maxInfluences > MAX_INFLUENCES)
+    {
+        LogError("The number of influences must be in [1,MAX_INFLUENCES].");
+        return false;
+    }
+
+    SetDualQuaternionSkinning(false);
+    mMaxInfluences = maxInfluences;
+    size_t const numInfluences = static_cast<size_t>(maxInfluences) * mNumVertices;
+    mInfluenceBones.assign(numInfluences, 0);
+    mInfluenceWeights.assign(numInfluences, 0.0f);
+    mInfluenceOffsets.assign(3 * numInfluences, 0.0f);
+
+    std::vector<std::pair<float, int>> influences(mNumBones);
+    int const nv = mNumVertices;
+    for (int v = 0; v < nv; ++v)
+    {
+        // Sort the bones by decreasing weight; the ties are broken by the
+        // bone index, so the compression is deterministic.
+        float const* weights = &mWeights[static_cast<size_t>(mNumBones) * v];
+        float sumWeights = 0.0f;
+        for (int b = 0; b < mNumBones; ++b)
+        {
+            influences[b] = std::make_pair(-weights[b], b);
+            sumWeights += weights[b];
+        }
+        int const numKept = std::min(maxInfluences, mNumBones);
+        std::partial_sort(influences.begin(), influences.begin() + numKept,
+            influences.end());
+
+        float sumKept = 0.0f;
+        for (int k = 0; k < numKept; ++k)
+        {
+            sumKept += -influences[k].first;
+        }
+        float const scale = (sumKept != 0.0f ? sumWeights / sumKept : 0.0f);
+
+        // The unused influences have weight zero.  They refer to the first
+        // bone of the vertex, whose matrix is already in cache.
+        for (int k = 0; k < maxInfluences; ++k)
+        {
+            size_t const i = v + static_cast<size_t>(nv) * k;
+            int const b = influences[std::min(k, numKept - 1)].second;
+            mInfluenceBones[i] = b;
+            if (k < numKept && weights[b] != 0.0f)
+            {
+                Vector4<float> const& offset = mOffsets[b + static_cast<size_t>(mNumBones) * v];
+                mInfluenceWeights[i] = scale * weights[b];
+                for (int c = 0; c < 3; ++c)
+                {
+                    mInfluenceOffsets[v + static_cast<size_t>(nv) * (3 * k + c)] = offset[c];
+                }
+            }
+            else
+            {
+                mInfluenceBones[i] = influences[0].second;
+            }
+        }
+    }
+    return true;
+}
+
+void SkinController::Decompress()
+{
+    SetDualQuaternionSkinning(false);
+    mMaxInfluences = 0;
+    mInfluenceBones.clear();
+    mInfluenceWeights.clear();
+    mInfluenceOffsets.clear();
+    mBoneData.clear();
+}
+
+bool SkinController::SetDualQuaternionSkinning(bool enable)
+{
+    if (!enable)
+    {
+        mDualQuaternion = false;
+        mInverseBind.clear();
+        mBindPositions.clear();
+        return true;
+    }
+
+    if (mMaxInfluences == 0)
+    {
+        LogError("Dual-quaternion skinning requires a compressed controller.");
+        return false;
+    }
+
+    std::vector<float> bind(12 * static_cast<size_t>(mNumBones));
+    mInverseBind.resize(bind.size());
+    for (int b = 0; b < mNumBones; ++b)
+    {
+        auto bone = mBones[b].lock();
+        if (!bone)
+        {
+            LogError("The bones must exist.");
+            mInverseBind.clear();
+            return false;
+        }
+        PackAffine(bone->worldTransform.GetHMatrix(), &bind[12 * b]);
+        PackAffine(bone->worldTransform.GetHInverse(), &mInverseBind[12 * b]);
+    }
+
+    // The bind positions are the linear-blend positions in the bind pose.
+    int const nv = mNumVertices;
+    mBindPositions.assign(3 * static_cast<size_t>(nv), 0.0f);
+    for (int k = 0; k < mMaxInfluences; ++k)
+    {
+        size_t const ki = static_cast<size_t>(nv) * k;
+        for (int v = 0; v < nv; ++v)
+        {
+            float const* M = &bind[12 * mInfluenceBones[v + ki]];
+            float const weight = mInfluenceWeights[v + ki];
+            float const x = mInfluenceOffsets[v + 3 * ki];
+            float const y = mInfluenceOffsets[v + 3 * ki + nv];
+            float const z = mInfluenceOffsets[v + 3 * ki + 2 * static_cast<size_t>(nv)];
+            for (int r = 0; r < 3; ++r)
+            {
+                mBindPositions[v + static_cast<size_t>(nv) * r] += weight *
+                    (M[4 * r] * x + M[4 * r + 1] * y + M[4 * r + 2] * z + M[4 * r + 3]);
+            }
+        }
+    }
+
+    mDualQuaternion = true;
+    return true;
+}
+
+void SkinController::ComputeBoneData()
+{
+    // The bone transformations are packed once per frame, so the vertex
+    // kernels neither lock the weak pointers nor depend on the matrix
+    // storage convention.
+    int const numComponents = (mDualQuaternion ? 8 : 12);
+    mBoneData.resize(numComponents * static_cast<size_t>(mNumBones));
+    for (int b = 0; b < mNumBones; ++b)
+    {
+        float affine[12];
+        Matrix4x4<float> const& worldMatrix = mBones[b].lock()->worldTransform;
+        PackAffine(worldMatrix, affine);
+        float* data = &mBoneData[numComponents * static_cast<size_t>(b)];
+        if (mDualQuaternion)
+        {
+            float skin[12];
+            ComposeAffine(affine, &mInverseBind[12 * b], skin);
+            ToDualQuaternion(skin, data);
+        }
+        else
+        {
+            std::copy(affine, affine + 12, data);
+        }
+    }
+}
+
+void SkinController::SkinVertices()
+{
+    unsigned int const maxThreads = static_cast<unsigned int>(mNumVertices) / MIN_VERTICES_PER_THREAD;
+    unsigned int const numUsed = std::min(numThreads, maxThreads);
+    if (numUsed <= 1)
+    {
+        if (mDualQuaternion)
+        {
+            SkinDualQuaternion(0, mNumVertices);
+        }
+        else
+        {
+            SkinLinearBlend(0, mNumVertices);
+        }
+        return;
+    }
+
+    std::vector<std::thread> process(numUsed);
+    for (unsigned int t = 0; t < numUsed; ++t)
+    {
+        int vbegin = static_cast<int>((static_cast<size_t>(t) * mNumVertices) / numUsed);
+        int vend = static_cast<int>((static_cast<size_t>(t + 1) * mNumVertices) / numUsed);
+        process[t] = std::thread([this, vbegin, vend]()
+        {
+            if (mDualQuaternion)
+            {
+                SkinDualQuaternion(vbegin, vend);
+            }
+            else
+            {
+                SkinLinearBlend(vbegin, vend);
+            }
+        });
+    }
+
+    for (unsigned int t = 0; t < numUsed; ++t)
+    {
+        process[t].join();
+    }
+}
+
+void SkinController::SkinLinearBlend(int vbegin, int vend)
+{
+    // The vertices are processed in blocks.  The loops over the vertices of
+    // a block have no branches, so they are vectorized.
+    int const BLOCK_SIZE = 64;
+    size_t const nv = static_cast<size_t>(mNumVertices);
+    float const* boneData = mBoneData.data();
+    float px[BLOCK_SIZE], py[BLOCK_SIZE], pz[BLOCK_SIZE];
+    for (int v0 = vbegin; v0 < vend; v0 += BLOCK_SIZE)
+    {
+        int const n = std::min(BLOCK_SIZE, vend - v0);
+        std::fill(px, px + n, 0.0f);
+        std::fill(py, py + n, 0.0f);
+        std::fill(pz, pz + n, 0.0f);
+        for (int k = 0; k < mMaxInfluences; ++k)
+        {
+            int const* bones = &mInfluenceBones[v0 + nv * k];
+            float const* weights = &mInfluenceWeights[v0 + nv * k];
+            float const* ox = &mInfluenceOffsets[v0 + nv * (3 * k)];
+            float const* oy = ox + nv;
+            float const* oz = oy + nv;
+            for (int i = 0; i < n; ++i)
+            {
+                float const* M = boneData + 12 * bones[i];
+                float const w = weights[i], x = ox[i], y = oy[i], z = oz[i];
+                px[i] += w * (M[0] * x + M[1] * y + M[2] * z + M[3]);
+                py[i] += w * (M[4] * x + M[5] * y + M[6] * z + M[7]);
+                pz[i] += w * (M[8] * x + M[9] * y + M[10] * z + M[11]);
+            }
+        }
+
+        char* current = mPosition + static_cast<size_t>(v0) * mStride;
+        for (int i = 0; i < n; ++i, current += mStride)
+        {
+            float* target = reinterpret_cast<float*>(current);
+            target[0] = px[i];
+            target[1] = py[i];
+            target[2] = pz[i];
+        }
+    }
+}
+
+void SkinController::SkinDualQuaternion(int vbegin, int vend)
+{
+    // The dual quaternions are blended with the signs that place their real
+    // parts in the hemisphere of the first influence, normalized and applied
+    // to the bind positions.
+    int const BLOCK_SIZE = 64;
+    size_t const nv = static_cast<size_t>(mNumVertices);
+    float const* boneData = mBoneData.data();
+    float dq[8][BLOCK_SIZE];
+    for (int v0 = vbegin; v0 < vend; v0 += BLOCK_SIZE)
+    {
+        int const n = std::min(BLOCK_SIZE, vend - v0);
+        for (int j = 0; j < 8; ++j)
+        {
+            std::fill(dq[j], dq[j] + n, 0.0f);
+        }
+
+        int const* first = &mInfluenceBones[v0];
+        for (int k = 0; k < mMaxInfluences; ++k)
+        {
+            int const* bones = &mInfluenceBones[v0 + nv * k];
+            float const* weights = &mInfluenceWeights[v0 + nv * k];
+            for (int i = 0; i < n; ++i)
+            {
+                float const* Q0 = boneData + 8 * first[i];
+                float const* Q = boneData + 8 * bones[i];
+                float const dot = Q0[0] * Q[0] + Q0[1] * Q[1] + Q0[2] * Q[2] + Q0[3] * Q[3];
+                float const w = (dot < 0.0f ? -weights[i] : weights[i]);
+                for (int j = 0; j < 8; ++j)
+                {
+                    dq[j][i] += w * Q[j];
+                }
+            }
+        }
+
+        float const* bx = &mBindPositions[v0];
+        float const* by = bx + nv;
+        float const* bz = by + nv;
+        char* current = mPosition + static_cast<size_t>(v0) * mStride;
+        for (int i = 0; i < n; ++i, current += mStride)
+        {
+            float const length = std::sqrt(dq[0][i] * dq[0][i] + dq[1][i] * dq[1][i]
+                + dq[2][i] * dq[2][i] + dq[3][i] * dq[3][i]);
+            // A vertex without influences has a zero blend.  Its dual
+            // quaternion is set to zero, which maps the bind position to
+            // itself.
+            float const invLength = (length > 0.0f ? 1.0f / length : 0.0f);
+            float const qx = dq[0][i] * invLength, qy = dq[1][i] * invLength;
+            float const qz = dq[2][i] * invLength, qw = dq[3][i] * invLength;
+            float const dx = dq[4][i] * invLength, dy = dq[5][i] * invLength;
+            float const dz = dq[6][i] * invLength, dw = dq[7][i] * invLength;
+
+            // Rotate the bind position by the real part:  P + w*T + q x T,
+            // where T = 2*(q x P).
+            float const x = bx[i], y = by[i], z = bz[i];
+            float const tx = 2.0f * (qy * z - qz * y);
+            float const ty = 2.0f * (qz * x - qx * z);
+            float const tz = 2.0f * (qx * y - qy * x);
+            float const rx = x + qw * tx + (qy * tz - qz * ty);
+            float const ry = y + qw * ty + (qz * tx - qx * tz);
+            float const rz = z + qw * tz + (qx * ty - qy * tx);
+
+            // The translation is 2*(w*d - dw*q + q x d).
+            float* target = reinterpret_cast<float*>(current);
+            target[0] = rx + 2.0f * (qw * dx - dw * qx + (qy * dz - qz * dy));
+            target[1] = ry + 2.0f * (qw * dy - dw * qy + (qz * dx - qx * dz));
+            target[2] = rz + 2.0f * (qw * dz - dw * qz + (qx * dy - qy * dx));
+        }
+    }
+}
+
+void SkinController::PackAffine(Matrix4x4<float> const& M, float* affine)
+{
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+#if defined(GTE_USE_MAT_VEC)
+            affine[4 * r + c] = M(r, c);
+#else
+            affine[4 * r + c] = M(c, r);
+#endif
+        }
+    }
+}
+
+void SkinController::ComposeAffine(float const* A, float const* B, float* AB)
+{
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            AB[4 * r + c] = A[4 * r] * B[c] + A[4 * r + 1] * B[4 + c] + A[4 * r + 2] * B[8 + c];
+        }
+        AB[4 * r + 3] += A[4 * r + 3];
+    }
+}
+
+void SkinController::ToDualQuaternion(float const* affine, float* dq)
+{
+    // Convert the rotation matrix to a quaternion, choosing the largest
+    // component for numerical robustness.
+    float const r00 = affine[0], r01 = affine[1], r02 = affine[2];
+    float const r10 = affine[4], r11 = affine[5], r12 = affine[6];
+    float const r20 = affine[8], r21 = affine[9], r22 = affine[10];
+    float const trace = r00 + r11 + r22;
+    float qx, qy, qz, qw;
+    if (trace > 0.0f)
+    {
+        float const s = 2.0f * std::sqrt(trace + 1.0f);
+        qw = 0.25f * s;
+        qx = (r21 - r12) / s;
+        qy = (r02 - r20) / s;
+        qz = (r10 - r01) / s;
+    }
+    else if (r00 > r11 && r00 > r22)
+    {
+        float const s = 2.0f * std::sqrt(1.0f + r00 - r11 - r22);
+        qw = (r21 - r12) / s;
+        qx = 0.25f * s;
+        qy = (r01 + r10) / s;
+        qz = (r02 + r20) / s;
+    }
+    else if (r11 > r22)
+    {
+        float const s = 2.0f * std::sqrt(1.0f + r11 - r00 - r22);
+        qw = (r02 - r20) / s;
+        qx = (r01 + r10) / s;
+        qy = 0.25f * s;
+        qz = (r12 + r21) / s;
+    }
+    else
+    {
+        float const s = 2.0f * std::sqrt(1.0f + r22 - r00 - r11);
+        qw = (r10 - r01) / s;
+        qx = (r02 + r20) / s;
+        qy = (r12 + r21) / s;
+        qz = 0.25f * s;
+    }
+
+    // The dual part is (1/2)*T*q for the translation T as a pure
+    // quaternion.
+    float const tx = affine[3], ty = affine[7], tz = affine[11];
+    dq[0] = qx;
+    dq[1] = qy;
+    dq[2] = qz;
+    dq[3] = qw;
+    dq[4] = 0.5f * (qw * tx + (ty * qz - tz * qy));
+    dq[5] = 0.5f * (qw * ty + (tz * qx - tx * qz));
+    dq[6] = 0.5f * (qw * tz + (tx * qy - ty * qx));
+    dq[7] = -0.5f * (tx * qx + ty * qy + tz * qz);
+}
@@ -0,0 +1,326 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/12/28)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <Graphics/GteSpatialHierarchy.h>
+#include <algorithm>
+#include <thread>
+#include <typeinfo>
+using namespace gte;
+
+
+SpatialHierarchy::~SpatialHierarchy()
+{
+}
+
+SpatialHierarchy::SpatialHierarchy()
+    :
+    minObjectsPerThread(256)
+{
+}
+
+void SpatialHierarchy::Build(std::shared_ptr<Spatial> const& root)
+{
+    mRoot = root;
+    mObjects.clear();
+    mParents.clear();
+    mKinds.clear();
+    mChildBegin.clear();
+    mLevelBegin.clear();
+    mSerial.clear();
+    mLocalTransforms.clear();
+    mWorldTransforms.clear();
+    mWorldMatrices.clear();
+    mWorldBounds.clear();
+    mDirty.clear();
+    mBoundDirty.clear();
+    mIndices.clear();
+
+    if (!mRoot)
+    {
+        LogError("The root must be nonnull.");
+        return;
+    }
+
+    // The breadth-first traversal uses mObjects as its queue.  The children
+    // of object i are appended when i is visited, so they are contiguous
+    // and the levels are contiguous.
+    mObjects.push_back(mRoot.get());
+    mParents.push_back(-1);
+    mLevelBegin.push_back(0);
+    int levelEnd = 1;
+    for (int i = 0; i < static_cast<int>(mObjects.size()); ++i)
+    {
+        if (i == levelEnd)
+        {
+            mLevelBegin.push_back(i);
+            levelEnd = static_cast<int>(mObjects.size());
+        }
+
+        Spatial* object = mObjects[i];
+        mChildBegin.push_back(static_cast<int>(mObjects.size()));
+        Node* node = dynamic_cast<Node*>(object);
+        if (node)
+        {
+            if (typeid(*node) == typeid(Node))
+            {
+                mKinds.push_back(KIND_NODE);
+                int const numChildren = node->GetNumChildren();
+                for (int c = 0; c < numChildren; ++c)
+                {
+                    auto child = node->GetChild(c);
+                    if (child)
+                    {
+                        mObjects.push_back(child.get());
+                        mParents.push_back(i);
+                    }
+                }
+            }
+            else
+            {
+                mKinds.push_back(KIND_SUBTREE);
+                mSerial.push_back(i);
+                continue;
+            }
+        }
+        else
+        {
+            mKinds.push_back(KIND_LEAF);
+        }
+
+        if (object->GetControllers().size() > 0)
+        {
+            mSerial.push_back(i);
+        }
+    }
+
+    int const numObjects = static_cast<int>(mObjects.size());
+    mChildBegin.push_back(numObjects);
+    mLevelBegin.push_back(numObjects);
+
+    mLocalTransforms.resize(numObjects);
+    mWorldTransforms.resize(numObjects);
+    mWorldMatrices.resize(numObjects);
+    mWorldBounds.resize(numObjects);
+    mDirty.resize(numObjects);
+    mBoundDirty.resize(numObjects);
+    MarkAllDirty();
+
+    mIndices.reserve(numObjects);
+    for (int i = 0; i < numObjects; ++i)
+    {
+        mIndices.insert(std::make_pair(mObjects[i], i));
+    }
+}
+
+void SpatialHierarchy::Update(double applicationTime, unsigned int numThreads,
+    bool updateControllers)
+{
+    Update(applicationTime, numThreads,
+        updateControllers ? UPDATE_ALL : UPDATE_NO_CONTROLLERS);
+}
+
+void SpatialHierarchy::UpdateDirty(double applicationTime, unsigned int numThreads)
+{
+    Update(applicationTime, numThreads, UPDATE_DIRTY);
+}
+
+void SpatialHierarchy::Update(double applicationTime, unsigned int numThreads,
+    UpdateMode mode)
+{
+    if (!mRoot)
+    {
+        return;
+    }
+
+    // The downward pass computes the world transforms.  The objects in
+    // mSerial are sorted by index, so they are visited level by level.
+    int const numLevels = GetNumLevels();
+    auto serial = mSerial.begin();
+    for (int level = 0; level < numLevels; ++level)
+    {
+        int const begin = mLevelBegin[level], end = mLevelBegin[level + 1];
+        for (; serial != mSerial.end() && *serial < end; ++serial)
+        {
+            int i = *serial;
+            Spatial* object = mObjects[i];
+            if (mKinds[i] == KIND_SUBTREE)
+            {
+                // The parent's world transform is current, so the subtree
+                // can be updated by the depth-first recursion.  The dirty
+                // flag of the parent is final, because the parent is at the
+                // previous level.
+                int const parent = mParents[i];
+                if (mode != UPDATE_DIRTY || mDirty[i]
+                    || (parent >= 0 && mDirty[parent]))
+                {
+                    object->Update(applicationTime, false);
+                    mDirty[i] = 1;
+                }
+            }
+            else if (mode != UPDATE_DIRTY)
+            {
+                if (mode == UPDATE_ALL)
+                {
+                    object->UpdateControllers(applicationTime);
+                }
+                mDirty[i] = 1;
+            }
+        }
+
+        ForEach(begin, end, numThreads, [this](int i)
+        {
+            ComputeWorldTransform(i);
+        });
+    }
+
+    // The upward pass computes the world bounds.
+    for (int level = numLevels - 1; level >= 0; --level)
+    {
+        int const begin = mLevelBegin[level], end = mLevelBegin[level + 1];
+        ForEach(begin, end, numThreads, [this](int i)
+        {
+            ComputeWorldBound(i);
+        });
+    }
+
+    std::fill(mDirty.begin(), mDirty.end(), static_cast<uint8_t>(0));
+    std::fill(mBoundDirty.begin(), mBoundDirty.end(), static_cast<uint8_t>(0));
+}
+
+int SpatialHierarchy::GetIndex(Spatial const* object) const
+{
+    auto iter = mIndices.find(object);
+    return (iter != mIndices.end() ? iter->second : -1);
+}
+
+void SpatialHierarchy::MarkDirty(int i)
+{
+    mDirty[i] = 1;
+}
+
+bool SpatialHierarchy::MarkDirty(Spatial const* object)
+{
+    int i = GetIndex(object);
+    if (i >= 0)
+    {
+        mDirty[i] = 1;
+        return true;
+    }
+    return false;
+}
+
+void SpatialHierarchy::MarkAllDirty()
+{
+    std::fill(mDirty.begin(), mDirty.end(), static_cast<uint8_t>(1));
+}
+
+template <typename Function>
+void SpatialHierarchy::ForEach(int begin, int end, unsigned int numThreads,
+    Function const& function)
+{
+    int const numElements = end - begin;
+    unsigned int const minElements = std::max(minObjectsPerThread, 1u);
+    numThreads = std::min(numThreads, static_cast<unsigned int>(numElements) / minElements);
+    if (numThreads <= 1)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            function(i);
+        }
+        return;
+    }
+
+    std::vector<std::thread> process(numThreads);
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        int tBegin = begin + static_cast<int>((static_cast<size_t>(t) * numElements) / numThreads);
+        int tEnd = begin + static_cast<int>((static_cast<size_t>(t + 1) * numElements) / numThreads);
+        process[t] = std::thread([&function, tBegin, tEnd]()
+        {
+            for (int i = tBegin; i < tEnd; ++i)
+            {
+                function(i);
+            }
+        });
+    }
+
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        process[t].join();
+    }
+}
+
+void SpatialHierarchy::ComputeWorldTransform(int i)
+{
+    // The dirty flag of the parent is final, because the parent is at the
+    // previous level.
+    int const parent = mParents[i];
+    if (parent >= 0 && mDirty[parent])
+    {
+        mDirty[i] = 1;
+    }
+
+    if (!mDirty[i])
+    {
+        return;
+    }
+
+    // A subtree object was updated by the serial pass and an object whose
+    // world transform is current was set by the application.
+    Spatial* object = mObjects[i];
+    Transform& world = mWorldTransforms[i];
+    if (mKinds[i] != KIND_SUBTREE && !object->worldTransformIsCurrent)
+    {
+        // The parent slot was written at the previous level.  The root
+        // might have a parent outside the hierarchy.
+        Transform const& local = (mLocalTransforms[i] = object->localTransform);
+        Transform const* parentWorld = (parent >= 0 ? &mWorldTransforms[parent] :
+            (object->GetParent() ? &object->GetParent()->worldTransform : nullptr));
+        if (parentWorld)
+        {
+#if defined(GTE_USE_MAT_VEC)
+            world = *parentWorld * local;
+#else
+            world = local * *parentWorld;
+#endif
+        }
+        else
+        {
+            world = local;
+        }
+        object->worldTransform = world;
+    }
+    else
+    {
+        world = object->worldTransform;
+    }
+    mWorldMatrices[i] = world.GetHMatrix();
+}
+
+void SpatialHierarchy::ComputeWorldBound(int i)
+{
+    bool dirty = (mDirty[i] != 0);
+    for (int c = mChildBegin[i]; !dirty && c < mChildBegin[i + 1]; ++c)
+    {
+        dirty = (mBoundDirty[c] != 0);
+    }
+
+    if (dirty)
+    {
+        // A subtree object was updated by the serial pass.
+        Spatial* object = mObjects[i];
+        if (mKinds[i] != KIND_SUBTREE)
+        {
+            object->UpdateWorldBound();
+        }
+        mWorldBounds[i] = HLift(object->worldBound.GetCenter(),
+            object->worldBound.GetRadius());
+        mBoundDirty[i] = 1;
+    }
+}
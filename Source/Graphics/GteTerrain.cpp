@@ -7,6 +7,9 @@
 
 #include <GTEnginePCH.h>
 #include <Graphics/GteTerrain.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 using namespace gte;
 
 Terrain::Terrain(size_t numRows, size_t numCols, size_t size, float minElevation,
@@ -22,7 +25,13 @@ Terrain::Terrain(size_t numRows, size_t numCols, size_t size, float minElevation
     mLength(mSpacing * (static_cast<float>(size) - 1.0f)),
     mCameraRow(std::numeric_limits<size_t>::max()),
     mCameraCol(std::numeric_limits<size_t>::max()),
-    mCamera(camera)
+    mCamera(camera),
+    mChunkSize(0),
+    mPixelTolerance(1.0f),
+    mViewportHeight(0.0f),
+    mNumTileRows(0),
+    mNumTileCols(0),
+    mStopLoader(false)
 {
     // Validation of inputs.  TODO: The port to GTL must replace these
     // with exception handling.
@@ -58,6 +67,7 @@ Terrain::Terrain(size_t numRows, size_t numCols, size_t size, float minElevation
 
 Terrain::~Terrain()
 {
+    DisablePaging();
 }
 
 std::shared_ptr<Visual> Terrain::GetPage(size_t row, size_t col) const
@@ -186,6 +196,18 @@ void Terrain::OnCameraMotion()
                 };
                 page->localTransform.SetTranslation(pageTrn);
 
+                if (mNumTileRows > 0)
+                {
+                    // The page is hidden until its new tile is applied.
+                    size_t key = GetTileKey(rO, cO);
+                    if (page->tileKey != key)
+                    {
+                        page->tileKey = key;
+                        page->waiting = true;
+                        page->culling = CULL_ALWAYS;
+                    }
+                }
+
                 ++cO;
                 if (++cP == static_cast<int>(mNumCols))
                 {
@@ -199,19 +221,445 @@ void Terrain::OnCameraMotion()
                 rP = 0;
             }
         }
+
+        if (mNumTileRows > 0)
+        {
+            RequestTiles(rminO, cminO);
+            ApplyTiles();
+        }
         Update();
     }
+    else if (mNumTileRows > 0 && ApplyTiles())
+    {
+        Update();
+    }
+
+    if (mChunkSize > 0)
+    {
+        UpdateLOD(modelEye);
+    }
+}
+
+void Terrain::EnableLOD(size_t chunkSize, float pixelTolerance, float viewportHeight)
+{
+    if (chunkSize < 2 || chunkSize >= mSize || (chunkSize & (chunkSize - 1)) != 0
+        || pixelTolerance <= 0.0f || viewportHeight <= 0.0f)
+    {
+        LogError("Invalid input to EnableLOD.");
+        return;
+    }
+
+    mChunkSize = chunkSize;
+    mPixelTolerance = pixelTolerance;
+    mViewportHeight = viewportHeight;
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        page->EnableLOD(mChunkSize);
+    }
+}
+
+void Terrain::DisableLOD()
+{
+    if (mChunkSize > 0)
+    {
+        mChunkSize = 0;
+        mSplit.clear();
+        for (auto const& child : mChild)
+        {
+            auto page = std::dynamic_pointer_cast<Page>(child);
+            page->DisableLOD();
+            if (mUpdater)
+            {
+                mUpdater(page->GetVertexBuffer());
+            }
+        }
+    }
+}
+
+size_t Terrain::GetNumActiveChunks() const
+{
+    size_t numChunks = 0;
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (!page->waiting)
+        {
+            numChunks += page->GetNumActiveChunks();
+        }
+    }
+    return numChunks;
+}
+
+void Terrain::EnablePaging(size_t numTileRows, size_t numTileCols, Loader const& loader)
+{
+    DisablePaging();
+    if (numTileRows == 0 || numTileCols == 0 || !loader)
+    {
+        LogError("Invalid input to EnablePaging.");
+        return;
+    }
+
+    mNumTileRows = numTileRows;
+    mNumTileCols = numTileCols;
+    mLoader = loader;
+    mStopLoader = false;
+
+    // Force the pages to be assigned tiles by the next OnCameraMotion.
+    mCameraRow = std::numeric_limits<size_t>::max();
+    mCameraCol = std::numeric_limits<size_t>::max();
+    mLoaderThread = std::thread([this]() { LoadTiles(); });
+}
+
+void Terrain::DisablePaging()
+{
+    if (mLoaderThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopLoader = true;
+        }
+        mRequested.notify_all();
+        mLoaderThread.join();
+    }
+
+    mNumTileRows = 0;
+    mNumTileCols = 0;
+    mLoader = nullptr;
+    mCache.clear();
+    mPending.clear();
+    mRequests.clear();
+    mCompleted.clear();
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (page->waiting)
+        {
+            page->waiting = false;
+            page->culling = CULL_DYNAMIC;
+        }
+        page->tileKey = std::numeric_limits<size_t>::max();
+    }
+}
+
+Terrain::Loader Terrain::CreateFileLoader(std::string const& prefix, std::string const& suffix) const
+{
+    size_t numHeights = mSize * mSize;
+    return [prefix, suffix, numHeights](size_t row, size_t col, std::vector<unsigned short>& heights)
+    {
+        std::string name = prefix + std::to_string(row) + "." + std::to_string(col) + suffix;
+        std::ifstream input(name, std::ios::binary);
+        if (!input)
+        {
+            return false;
+        }
+
+        std::streamsize numBytes = static_cast<std::streamsize>(numHeights * sizeof(unsigned short));
+        heights.resize(numHeights);
+        input.read(reinterpret_cast<char*>(heights.data()), numBytes);
+        return input.gcount() == numBytes;
+    };
+}
+
+void Terrain::WaitForPages()
+{
+    if (mNumTileRows == 0)
+    {
+        return;
+    }
+
+    bool applied = ApplyTiles();
+    while (GetNumWaitingPages() > 0)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mLoaded.wait(lock, [this]() { return mCompleted.size() > 0; });
+        }
+        if (ApplyTiles())
+        {
+            applied = true;
+        }
+    }
+
+    if (applied)
+    {
+        Update();
+    }
+}
+
+size_t Terrain::GetNumWaitingPages() const
+{
+    size_t numWaiting = 0;
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (page->waiting)
+        {
+            ++numWaiting;
+        }
+    }
+    return numWaiting;
+}
+
+void Terrain::UpdateLOD(Vector4<float> const& modelEye)
+{
+    // The maximum errors and heights of the levels of the pages.
+    size_t numLevels = 0;
+    std::vector<float> levelError, levelHeight;
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (!page->waiting)
+        {
+            numLevels = page->GetNumLevels();
+            levelError.resize(numLevels, 0.0f);
+            levelHeight.resize(numLevels, 0.0f);
+            for (size_t level = 0; level < numLevels; ++level)
+            {
+                levelError[level] = std::max(levelError[level], page->GetLevelError(level));
+                levelHeight[level] = std::max(levelHeight[level], page->GetLevelHeight(level));
+            }
+        }
+    }
+    if (numLevels == 0)
+    {
+        return;
+    }
+
+    // A node of level l > 0 is subdivided when its distance is smaller than
+    // split[l].  The error of level l projects to at most pixelTolerance
+    // pixels at distance error[l] * pixelsPerUnit / pixelTolerance, where
+    // pixelsPerUnit is the number of pixels of a unit length at distance 1.
+    // The split distance also exceeds that of level l-1 by the diagonal of
+    // the bounding box of a chunk of level l-1.  That guarantees that
+    // adjacent chunks differ by at most one level and that the vertices on
+    // the boundary of a chunk and a coarser chunk are fully morphed.
+    float const* frustum = mCamera->GetFrustum();
+    float pixelsPerUnit = 0.5f * mViewportHeight * frustum[ViewVolume::VF_DMIN] /
+        frustum[ViewVolume::VF_UMAX];
+    mSplit.resize(numLevels);
+    mSplit[0] = 0.0f;
+    for (size_t level = 1; level < numLevels; ++level)
+    {
+        float width = mSpacing * static_cast<float>(mChunkSize << (level - 1));
+        float height = levelHeight[level - 1];
+        float diagonal = std::sqrt(2.0f * width * width + height * height);
+        mSplit[level] = std::max(levelError[level] * pixelsPerUnit / mPixelTolerance,
+            mSplit[level - 1] + diagonal);
+    }
+
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (!page->waiting)
+        {
+            Vector3<float> trn = page->localTransform.GetTranslation();
+            Vector3<float> pageEye{ modelEye[0] - trn[0], modelEye[1] - trn[1], modelEye[2] - trn[2] };
+            bool vbufferChanged, ibufferChanged;
+            page->UpdateLOD(pageEye, mSplit, vbufferChanged, ibufferChanged);
+            if (mUpdater)
+            {
+                if (vbufferChanged)
+                {
+                    // Copy only the modified rows of vertices.
+                    auto const& vbuffer = page->GetVertexBuffer();
+                    unsigned int saveOffset = vbuffer->GetOffset();
+                    unsigned int saveNumActiveElements = vbuffer->GetNumActiveElements();
+                    for (auto const& range : page->GetDirtyRanges())
+                    {
+                        vbuffer->SetOffset(range[0]);
+                        vbuffer->SetNumActiveElements(range[1]);
+                        mUpdater(vbuffer);
+                    }
+                    vbuffer->SetOffset(saveOffset);
+                    vbuffer->SetNumActiveElements(saveNumActiveElements);
+                }
+                if (ibufferChanged)
+                {
+                    mUpdater(page->GetIndexBuffer());
+                }
+            }
+        }
+    }
+}
+
+void Terrain::RequestTiles(int rminO, int cminO)
+{
+    // The tiles of the pages and of the ring of pages around them, with
+    // their distances in pages from the page of the camera.
+    int rCamera = rminO + static_cast<int>(mNumRows / 2);
+    int cCamera = cminO + static_cast<int>(mNumCols / 2);
+    int rmaxO = rminO + static_cast<int>(mNumRows);
+    int cmaxO = cminO + static_cast<int>(mNumCols);
+    std::map<size_t, int> wanted;
+    for (int rO = rminO - 1; rO <= rmaxO; ++rO)
+    {
+        for (int cO = cminO - 1; cO <= cmaxO; ++cO)
+        {
+            int distance = std::max(std::abs(rO - rCamera), std::abs(cO - cCamera));
+            auto result = wanted.insert(std::make_pair(GetTileKey(rO, cO), distance));
+            result.first->second = std::min(result.first->second, distance);
+        }
+    }
+
+    // Discard the cached tiles that are no longer needed.
+    for (auto iter = mCache.begin(); iter != mCache.end(); )
+    {
+        if (wanted.find(iter->first) == wanted.end())
+        {
+            iter = mCache.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Cancel the queued requests for tiles that are no longer needed.  The
+    // tile being loaded remains pending.
+    std::vector<std::pair<int, std::shared_ptr<Tile>>> requests;
+    for (auto const& tile : mRequests)
+    {
+        size_t key = tile->col + mNumTileCols * tile->row;
+        auto iter = wanted.find(key);
+        if (iter != wanted.end())
+        {
+            requests.push_back(std::make_pair(iter->second, tile));
+        }
+        else
+        {
+            mPending.erase(key);
+        }
+    }
+
+    // Request the new tiles and sort the queue by distance.
+    for (auto const& element : wanted)
+    {
+        size_t key = element.first;
+        if (mCache.find(key) == mCache.end() && mPending.find(key) == mPending.end())
+        {
+            auto tile = std::make_shared<Tile>();
+            tile->row = key / mNumTileCols;
+            tile->col = key % mNumTileCols;
+            tile->chunkSize = mChunkSize;
+            tile->loaded = false;
+            tile->heights.resize(mSize * mSize);
+            mPending.insert(std::make_pair(key, tile));
+            requests.push_back(std::make_pair(element.second, tile));
+        }
+    }
+    std::stable_sort(requests.begin(), requests.end(),
+        [](std::pair<int, std::shared_ptr<Tile>> const& r0,
+            std::pair<int, std::shared_ptr<Tile>> const& r1)
+        {
+            return r0.first < r1.first;
+        });
+
+    mRequests.clear();
+    for (auto const& request : requests)
+    {
+        mRequests.push_back(request.second);
+    }
+    mRequested.notify_one();
+}
+
+bool Terrain::ApplyTiles()
+{
+    // Move the completed tiles to the cache.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto const& tile : mCompleted)
+        {
+            size_t key = tile->col + mNumTileCols * tile->row;
+            mPending.erase(key);
+            mCache[key] = tile;
+            if (!tile->loaded)
+            {
+                LogError("Failed to load tile " + std::to_string(tile->row) + "."
+                    + std::to_string(tile->col) + ".");
+            }
+        }
+        mCompleted.clear();
+    }
+
+    bool applied = false;
+    for (auto const& child : mChild)
+    {
+        auto page = std::dynamic_pointer_cast<Page>(child);
+        if (page->waiting)
+        {
+            auto iter = mCache.find(page->tileKey);
+            if (iter != mCache.end())
+            {
+                Tile const& tile = *iter->second;
+                if (tile.chunkSize == mChunkSize)
+                {
+                    page->SetHeights(tile.heights, tile.chunks);
+                }
+                else
+                {
+                    page->SetHeights(tile.heights);
+                }
+                page->waiting = false;
+                page->culling = CULL_DYNAMIC;
+                if (mUpdater)
+                {
+                    mUpdater(page->GetVertexBuffer());
+                }
+                applied = true;
+            }
+        }
+    }
+    return applied;
+}
+
+void Terrain::LoadTiles()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mRequested.wait(lock, [this]() { return mStopLoader || mRequests.size() > 0; });
+        if (mStopLoader)
+        {
+            return;
+        }
+
+        auto tile = mRequests.front();
+        mRequests.pop_front();
+        lock.unlock();
+
+        tile->loaded = mLoader(tile->row, tile->col, tile->heights);
+        if (!tile->loaded || tile->heights.size() != mSize * mSize)
+        {
+            tile->loaded = false;
+            tile->heights.assign(mSize * mSize, 0);
+        }
+        if (tile->chunkSize > 0)
+        {
+            Page::ComputeChunks(mSize, tile->chunkSize, mMinElevation,
+                mMaxElevation, tile->heights, tile->chunks);
+        }
+
+        lock.lock();
+        mCompleted.push_back(tile);
+        mLoaded.notify_all();
+    }
 }
 
 Terrain::Page::Page(size_t size, float minElevation, float maxElevation,
     float spacing, float length, Vector2<float> const& origin, VertexFormat const& vformat)
     :
+    tileKey(std::numeric_limits<size_t>::max()),
+    waiting(false),
     mSize(size),
     mMinElevation(minElevation),
     mMaxElevation(maxElevation),
     mSpacing(spacing),
     mOrigin(origin),
-    mHeights(mSize * mSize, 0)
+    mHeights(mSize * mSize, 0),
+    mChunkSize(0)
 {
     // Create a mesh for the page.  The vertices are initialized using
     // the SetHeights(...) function.
@@ -221,6 +669,7 @@ Terrain::Page::Page(size_t size, float minElevation, float maxElevation,
     auto rectangle = mf.CreateRectangle(numSamples, numSamples, length, length);
     mVBuffer = rectangle->GetVertexBuffer();
     mIBuffer = rectangle->GetIndexBuffer();
+    mFullIBuffer = mIBuffer;
 }
 
 Terrain::Page::~Page()
@@ -228,6 +677,11 @@ Terrain::Page::~Page()
 }
 
 void Terrain::Page::SetHeights(std::vector<unsigned short> const& heights)
+{
+    SetHeights(heights, ChunkTree());
+}
+
+void Terrain::Page::SetHeights(std::vector<unsigned short> const& heights, ChunkTree const& chunks)
 {
     char* vertices = mVBuffer->GetData();
     size_t vertexSize = static_cast<size_t>(mVBuffer->GetFormat().GetVertexSize());
@@ -245,8 +699,436 @@ void Terrain::Page::SetHeights(std::vector<unsigned short> const& heights)
         }
     }
 
+    // The normals are those of the full-resolution mesh.
     UpdateModelBound();
+    mIBuffer = mFullIBuffer;
     UpdateModelNormals();
+
+    if (mChunkSize > 0)
+    {
+        mIBuffer = mLODIBuffer;
+        size_t numLeaves = (mSize - 1) / mChunkSize;
+        if (chunks.size() > 0 && chunks[0].size() == numLeaves * numLeaves)
+        {
+            SetChunks(chunks);
+        }
+        else
+        {
+            ChunkTree computed;
+            ComputeChunks(mSize, mChunkSize, mMinElevation, mMaxElevation, mHeights, computed);
+            SetChunks(computed);
+        }
+    }
+}
+
+void Terrain::Page::EnableLOD(size_t chunkSize)
+{
+    mChunkSize = chunkSize;
+    ChunkTree chunks;
+    ComputeChunks(mSize, mChunkSize, mMinElevation, mMaxElevation, mHeights, chunks);
+    SetChunks(chunks);
+
+    if (!mLODIBuffer)
+    {
+        uint32_t numTriangles = static_cast<uint32_t>(2 * (mSize - 1) * (mSize - 1));
+        mLODIBuffer = std::make_shared<IndexBuffer>(IP_TRIMESH, numTriangles,
+            mFullIBuffer->GetElementSize());
+        mLODIBuffer->SetUsage(Resource::DYNAMIC_UPDATE);
+    }
+    mLODIBuffer->SetNumActivePrimitives(0);
+    mSelection.clear();
+    mIBuffer = mLODIBuffer;
+    mVBuffer->SetUsage(Resource::DYNAMIC_UPDATE);
+}
+
+void Terrain::Page::DisableLOD()
+{
+    if (mChunkSize == 0)
+    {
+        return;
+    }
+
+    mChunkSize = 0;
+    mChunks.clear();
+    mLevelError.clear();
+    mLevelHeight.clear();
+    mSelection.clear();
+    mIBuffer = mFullIBuffer;
+
+    // Restore the heights, bound and normals of the full-resolution mesh.
+    char* vertices = mVBuffer->GetData();
+    size_t vertexSize = static_cast<size_t>(mVBuffer->GetFormat().GetVertexSize());
+    for (size_t i = 0; i < mHeights.size(); ++i)
+    {
+        reinterpret_cast<Vector3<float>*>(vertices + i * vertexSize)->operator[](2) = GetHeight(i);
+    }
+    UpdateModelBound();
+    UpdateNormals(0, mSize - 1);
+    mDirtyRows.clear();
+    mDirtyRanges.clear();
+}
+
+void Terrain::Page::UpdateLOD(Vector3<float> const& eye, std::vector<float> const& split,
+    bool& vbufferChanged, bool& ibufferChanged)
+{
+    vbufferChanged = false;
+    ibufferChanged = false;
+    mDirtyRanges.clear();
+    if (mChunkSize == 0)
+    {
+        return;
+    }
+
+    // Select the chunks by a depth-first traversal of the quadtree.  The
+    // stack stores level + 256 * node.
+    unsigned int const rootLevel = static_cast<unsigned int>(mChunks.size() - 1);
+    unsigned int minLevel = rootLevel;
+    mNextSelection.clear();
+    mStack.clear();
+    mStack.push_back(rootLevel);
+    while (mStack.size() > 0)
+    {
+        unsigned int code = mStack.back();
+        mStack.pop_back();
+        unsigned int level = (code & 255u);
+        unsigned int node = (code >> 8);
+        if (level > 0)
+        {
+            size_t cells = mChunkSize << level;
+            size_t n = (mSize - 1) / cells;
+            size_t row = node / n, col = node % n;
+            Chunk const& chunk = mChunks[level][node];
+            float length = mSpacing * static_cast<float>(cells);
+            float xmin = mOrigin[0] + length * static_cast<float>(col);
+            float ymin = mOrigin[1] + length * static_cast<float>(row);
+            float dx = std::max(std::max(xmin - eye[0], eye[0] - xmin - length), 0.0f);
+            float dy = std::max(std::max(ymin - eye[1], eye[1] - ymin - length), 0.0f);
+            float dz = std::max(std::max(chunk.minHeight - eye[2], eye[2] - chunk.maxHeight), 0.0f);
+            if (dx * dx + dy * dy + dz * dz < split[level] * split[level])
+            {
+                size_t childN = 2 * n;
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    size_t child = (2 * col + (i & 1)) + childN * (2 * row + (i >> 1));
+                    mStack.push_back((level - 1) + 256u * static_cast<unsigned int>(child));
+                }
+                continue;
+            }
+        }
+        mNextSelection.push_back(code);
+        minLevel = std::min(minLevel, level);
+    }
+
+    // Generate the triangles of the chunks when the selection changes.  The
+    // diagonal of each cell is from (row,col) to (row+s,col+s), which is
+    // consistent with the morph targets.
+    if (mNextSelection != mSelection)
+    {
+        uint32_t t = 0;
+        for (auto code : mNextSelection)
+        {
+            unsigned int level = (code & 255u);
+            unsigned int node = (code >> 8);
+            size_t s = static_cast<size_t>(1) << level;
+            size_t cells = mChunkSize << level;
+            size_t n = (mSize - 1) / cells;
+            size_t r0 = cells * (node / n), c0 = cells * (node % n);
+            for (size_t r = r0; r < r0 + cells; r += s)
+            {
+                for (size_t c = c0; c < c0 + cells; c += s)
+                {
+                    uint32_t v00 = static_cast<uint32_t>(c + mSize * r);
+                    uint32_t v10 = static_cast<uint32_t>(v00 + s);
+                    uint32_t v01 = static_cast<uint32_t>(v00 + mSize * s);
+                    uint32_t v11 = static_cast<uint32_t>(v01 + s);
+                    mLODIBuffer->SetTriangle(t++, v00, v10, v11);
+                    mLODIBuffer->SetTriangle(t++, v00, v11, v01);
+                }
+            }
+        }
+        mLODIBuffer->SetNumActivePrimitives(t);
+        std::swap(mSelection, mNextSelection);
+        ibufferChanged = true;
+    }
+
+    // Morph the vertices of the levels in use, from coarse to fine.  A
+    // vertex of level l is on the grid with spacing 2^l but not on the grid
+    // with spacing 2^(l+1).  Its target is the midpoint of the neighbors on
+    // the edge or diagonal of the coarser cell that contains it, using the
+    // morphed heights of the neighbors, so a fully morphed vertex is on the
+    // coarser mesh.  The vertex is fully morphed at distance split[l+1],
+    // where a chunk of level l+1 is not subdivided, and not morphed at
+    // distances smaller than (split[l] + split[l+1]) / 2.  The rows that
+    // contain modified vertices are recorded so that only those rows are
+    // copied to graphics memory.
+    if (minLevel < rootLevel)
+    {
+        mDirtyRows.assign(mSize, false);
+        char* vertices = mVBuffer->GetData();
+        size_t vertexSize = static_cast<size_t>(mVBuffer->GetFormat().GetVertexSize());
+        auto Z = [vertices, vertexSize](size_t i) -> float&
+        {
+            return reinterpret_cast<Vector3<float>*>(vertices + i * vertexSize)->operator[](2);
+        };
+
+        for (unsigned int level = rootLevel; level-- > minLevel; )
+        {
+            size_t s = static_cast<size_t>(1) << level;
+            float end = split[level + 1];
+            float start = 0.5f * (split[level] + end);
+            float invRange = (end > start ? 1.0f / (end - start) : 0.0f);
+            for (size_t r = 0; r < mSize; r += s)
+            {
+                bool rowOdd = (((r / s) & 1) != 0);
+                float y = mOrigin[1] + mSpacing * static_cast<float>(r) - eye[1];
+                for (size_t c = (rowOdd ? 0 : s); c < mSize; c += (rowOdd ? s : 2 * s))
+                {
+                    size_t i = c + mSize * r, i0, i1;
+                    if (!rowOdd)
+                    {
+                        i0 = i - s;
+                        i1 = i + s;
+                    }
+                    else if (((c / s) & 1) == 0)
+                    {
+                        i0 = i - mSize * s;
+                        i1 = i + mSize * s;
+                    }
+                    else
+                    {
+                        i0 = i - s - mSize * s;
+                        i1 = i + s + mSize * s;
+                    }
+
+                    float target = 0.5f * (Z(i0) + Z(i1));
+                    float height = GetHeight(i);
+                    float x = mOrigin[0] + mSpacing * static_cast<float>(c) - eye[0];
+                    float z = height - eye[2];
+                    float distance = std::sqrt(x * x + y * y + z * z);
+                    float weight;
+                    if (invRange > 0.0f)
+                    {
+                        weight = std::min(std::max((end - distance) * invRange, 0.0f), 1.0f);
+                    }
+                    else
+                    {
+                        weight = (distance < end ? 1.0f : 0.0f);
+                    }
+                    float morphed = target + weight * (height - target);
+                    if (Z(i) != morphed)
+                    {
+                        Z(i) = morphed;
+                        mDirtyRows[r] = true;
+                    }
+                }
+            }
+        }
+
+        // The normals of a vertex depend on the heights of the adjacent
+        // rows, so those rows are also modified when there are normals.
+        bool const hasNormals = (mVBuffer->GetFormat().GetIndex(VA_NORMAL, 0) >= 0);
+        size_t const margin = (hasNormals ? 1 : 0);
+        for (size_t r = 0; r < mSize; ++r)
+        {
+            if (mDirtyRows[r])
+            {
+                size_t rmin = (r > margin ? r - margin : 0);
+                size_t rmax = std::min(r + margin, mSize - 1);
+                unsigned int first = static_cast<unsigned int>(mSize * rmin);
+                unsigned int last = static_cast<unsigned int>(mSize * (rmax + 1));
+                if (mDirtyRanges.size() > 0
+                    && first <= mDirtyRanges.back()[0] + mDirtyRanges.back()[1])
+                {
+                    // Extend the previous range, which overlaps or is
+                    // adjacent to the rows.
+                    mDirtyRanges.back()[1] = last - mDirtyRanges.back()[0];
+                }
+                else
+                {
+                    mDirtyRanges.push_back({ first, last - first });
+                }
+            }
+        }
+
+        if (mDirtyRanges.size() > 0)
+        {
+            for (auto const& range : mDirtyRanges)
+            {
+                size_t rmin = range[0] / mSize;
+                UpdateNormals(rmin, rmin + range[1] / mSize - 1);
+            }
+            UpdateModelBound();
+            vbufferChanged = true;
+        }
+    }
+}
+
+void Terrain::Page::UpdateNormals(size_t rmin, size_t rmax)
+{
+    std::set<DFType> required;
+    required.insert(DF_R32G32B32_FLOAT);
+    required.insert(DF_R32G32B32A32_FLOAT);
+    char const* positions = mVBuffer->GetChannel(VA_POSITION, 0, required);
+    char* normals = mVBuffer->GetChannel(VA_NORMAL, 0, required);
+    if (!positions || !normals)
+    {
+        return;
+    }
+
+    size_t const stride = static_cast<size_t>(mVBuffer->GetElementSize());
+    auto Position = [positions, stride](unsigned int i) -> Vector3<float> const&
+    {
+        return *reinterpret_cast<Vector3<float> const*>(positions + i * stride);
+    };
+    auto Normal = [normals, stride](unsigned int i) -> Vector3<float>&
+    {
+        return *reinterpret_cast<Vector3<float>*>(normals + i * stride);
+    };
+
+    unsigned int const imin = static_cast<unsigned int>(mSize * rmin);
+    unsigned int const imax = static_cast<unsigned int>(mSize * (rmax + 1));
+    for (unsigned int i = imin; i < imax; ++i)
+    {
+        Normal(i) = { 0.0f, 0.0f, 0.0f };
+    }
+
+    // The full-resolution mesh has two triangles per cell, stored in the
+    // order of the cells, and the cells of rows r-1 and r share the
+    // vertices of row r.  The triangle normals are weighted by area as in
+    // Visual::UpdateModelNormals.
+    size_t const numCellCols = mSize - 1;
+    size_t const cmin = (rmin > 0 ? rmin - 1 : 0);
+    size_t const cmax = std::min(rmax, mSize - 2);
+    for (size_t cellRow = cmin; cellRow <= cmax; ++cellRow)
+    {
+        unsigned int t = static_cast<unsigned int>(2 * numCellCols * cellRow);
+        for (size_t k = 0; k < 2 * numCellCols; ++k, ++t)
+        {
+            unsigned int v[3];
+            mFullIBuffer->GetTriangle(t, v[0], v[1], v[2]);
+            Vector3<float> const& p0 = Position(v[0]);
+            Vector3<float> normal = Cross(Position(v[1]) - p0, Position(v[2]) - p0);
+            for (int j = 0; j < 3; ++j)
+            {
+                if (imin <= v[j] && v[j] < imax)
+                {
+                    Normal(v[j]) += normal;
+                }
+            }
+        }
+    }
+
+    for (unsigned int i = imin; i < imax; ++i)
+    {
+        Vector3<float>& normal = Normal(i);
+        if (normal != Vector3<float>::Zero())
+        {
+            Normalize(normal);
+        }
+    }
+}
+
+void Terrain::Page::ComputeChunks(size_t size, size_t chunkSize, float minElevation,
+    float maxElevation, std::vector<unsigned short> const& heights, ChunkTree& chunks)
+{
+    std::vector<float> h(size * size);
+    for (size_t i = 0; i < h.size(); ++i)
+    {
+        float t = static_cast<float>(heights[i]) / 65535.0f;
+        h[i] = (1.0f - t) * minElevation + t * maxElevation;
+    }
+
+    size_t numLevels = 1;
+    for (size_t n = (size - 1) / chunkSize; n > 1; n /= 2)
+    {
+        ++numLevels;
+    }
+
+    chunks.resize(numLevels);
+    for (size_t level = 0; level < numLevels; ++level)
+    {
+        size_t s = static_cast<size_t>(1) << level;
+        size_t cells = chunkSize << level;
+        size_t n = (size - 1) / cells;
+        chunks[level].resize(n * n);
+        for (size_t row = 0; row < n; ++row)
+        {
+            for (size_t col = 0; col < n; ++col)
+            {
+                Chunk& chunk = chunks[level][col + n * row];
+                size_t r0 = cells * row, c0 = cells * col;
+                if (level == 0)
+                {
+                    chunk.minHeight = std::numeric_limits<float>::max();
+                    chunk.maxHeight = -std::numeric_limits<float>::max();
+                    for (size_t r = r0; r <= r0 + cells; ++r)
+                    {
+                        for (size_t c = c0; c <= c0 + cells; ++c)
+                        {
+                            chunk.minHeight = std::min(chunk.minHeight, h[c + size * r]);
+                            chunk.maxHeight = std::max(chunk.maxHeight, h[c + size * r]);
+                        }
+                    }
+                    chunk.error = 0.0f;
+                    continue;
+                }
+
+                // The bounds and errors of the children.  The error of a
+                // node is at least that of its children.
+                chunk = chunks[level - 1][2 * col + 2 * n * 2 * row];
+                for (size_t i = 1; i < 4; ++i)
+                {
+                    size_t child = (2 * col + (i & 1)) + 2 * n * (2 * row + (i >> 1));
+                    Chunk const& childChunk = chunks[level - 1][child];
+                    chunk.minHeight = std::min(chunk.minHeight, childChunk.minHeight);
+                    chunk.maxHeight = std::max(chunk.maxHeight, childChunk.maxHeight);
+                    chunk.error = std::max(chunk.error, childChunk.error);
+                }
+
+                // The vertical distances between the heights and the
+                // triangles of the cells of the node.
+                float invS = 1.0f / static_cast<float>(s);
+                for (size_t r = r0; r < r0 + cells; r += s)
+                {
+                    for (size_t c = c0; c < c0 + cells; c += s)
+                    {
+                        float h00 = h[c + size * r];
+                        float h10 = h[c + s + size * r];
+                        float h01 = h[c + size * (r + s)];
+                        float h11 = h[c + s + size * (r + s)];
+                        for (size_t dr = 0; dr <= s; ++dr)
+                        {
+                            float w = invS * static_cast<float>(dr);
+                            for (size_t dc = 0; dc <= s; ++dc)
+                            {
+                                float u = invS * static_cast<float>(dc);
+                                float interpolated = (u >= w ?
+                                    (1.0f - u) * h00 + (u - w) * h10 + w * h11 :
+                                    (1.0f - w) * h00 + (w - u) * h01 + u * h11);
+                                float error = std::fabs(h[c + dc + size * (r + dr)] - interpolated);
+                                chunk.error = std::max(chunk.error, error);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Terrain::Page::SetChunks(ChunkTree const& chunks)
+{
+    mChunks = chunks;
+    mLevelError.assign(mChunks.size(), 0.0f);
+    mLevelHeight.assign(mChunks.size(), 0.0f);
+    for (size_t level = 0; level < mChunks.size(); ++level)
+    {
+        for (auto const& chunk : mChunks[level])
+        {
+            mLevelError[level] = std::max(mLevelError[level], chunk.error);
+            mLevelHeight[level] = std::max(mLevelHeight[level], chunk.maxHeight - chunk.minHeight);
+        }
+    }
 }
 
 float Terrain::Page::GetHeight(float x, float y) const
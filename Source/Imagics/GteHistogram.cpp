@@ -9,6 +9,7 @@
 #include <Imagics/GteHistogram.h>
 #include <Imagics/GteImage2.h>
 #include <algorithm>
+#include <thread>
 using namespace gte;
 
 Histogram::Histogram(int numBuckets, int numSamples, int const* samples, bool noRescaling)
@@ -296,3 +297,250 @@ void Histogram::GetTails(double tailAmount, int& lower, int& upper)
         }
     }
 }
+
+void Histogram::Insert(size_t numSamples, uint8_t const* samples, unsigned int numThreads)
+{
+    InsertDirect(numSamples, samples, numThreads);
+}
+
+void Histogram::Insert(size_t numSamples, uint16_t const* samples, unsigned int numThreads)
+{
+    InsertDirect(numSamples, samples, numThreads);
+}
+
+void Histogram::Insert(size_t numSamples, int const* samples, unsigned int numThreads)
+{
+    InsertDirect(numSamples, samples, numThreads);
+}
+
+void Histogram::Insert(size_t numSamples, float const* samples, float minValue,
+    float maxValue, unsigned int numThreads)
+{
+    InsertRescaled(numSamples, samples, minValue, maxValue, numThreads);
+}
+
+void Histogram::Insert(size_t numSamples, double const* samples, double minValue,
+    double maxValue, unsigned int numThreads)
+{
+    InsertRescaled(numSamples, samples, minValue, maxValue, numThreads);
+}
+
+void Histogram::GetCumulative(std::vector<int>& cdf) const
+{
+    cdf.resize(mBuckets.size());
+    int sum = 0;
+    for (size_t i = 0; i < mBuckets.size(); ++i)
+    {
+        sum += mBuckets[i];
+        cdf[i] = sum;
+    }
+}
+
+void Histogram::GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+    uint8_t const* samples0, uint8_t const* samples1, unsigned int numThreads,
+    std::vector<int>& joint)
+{
+    ComputeJoint(numBuckets0, numBuckets1, numSamples, samples0, samples1,
+        numThreads, joint);
+}
+
+void Histogram::GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+    uint16_t const* samples0, uint16_t const* samples1, unsigned int numThreads,
+    std::vector<int>& joint)
+{
+    ComputeJoint(numBuckets0, numBuckets1, numSamples, samples0, samples1,
+        numThreads, joint);
+}
+
+void Histogram::GetJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+    int const* samples0, int const* samples1, unsigned int numThreads,
+    std::vector<int>& joint)
+{
+    ComputeJoint(numBuckets0, numBuckets1, numSamples, samples0, samples1,
+        numThreads, joint);
+}
+
+template <typename Binner>
+void Histogram::Count(size_t numSamples, size_t numCounts, unsigned int numThreads,
+    Binner const& binner, int* counts)
+{
+    // The samples are processed in blocks.  The counter indices of a block
+    // are computed first, a loop the compiler can vectorize, and then the
+    // counters are incremented.  When the counters fit in the cache, each
+    // thread uses 4 copies of them and consecutive samples increment
+    // different copies, which avoids the store-to-load dependency when
+    // consecutive samples are in the same bucket.
+    size_t const minSamplesPerThread = 4096;
+    size_t const numCopies = (numCounts <= 4096 ? 4 : 1);
+
+    size_t maxThreads = (numSamples + minSamplesPerThread - 1) / minSamplesPerThread;
+    numThreads = static_cast<unsigned int>(std::max(std::min(
+        static_cast<size_t>(numThreads), maxThreads), (size_t)1));
+
+    std::vector<std::vector<int>> local(numThreads);
+    auto countRange = [numCounts, numCopies, &binner, &local](
+        unsigned int t, size_t i0, size_t i1)
+    {
+        size_t const blockSize = 256;
+        local[t].assign(numCopies * numCounts, 0);
+        int* c0 = local[t].data();
+        int* c1 = c0 + (numCopies > 1 ? numCounts : 0);
+        int* c2 = c1 + (numCopies > 1 ? numCounts : 0);
+        int* c3 = c2 + (numCopies > 1 ? numCounts : 0);
+        size_t index[blockSize];
+        for (size_t i = i0; i < i1; i += blockSize)
+        {
+            size_t const n = std::min(blockSize, i1 - i);
+            for (size_t j = 0; j < n; ++j)
+            {
+                index[j] = static_cast<size_t>(binner(i + j));
+            }
+
+            size_t j = 0;
+            for (/**/; j + 4 <= n; j += 4)
+            {
+                ++c0[index[j]];
+                ++c1[index[j + 1]];
+                ++c2[index[j + 2]];
+                ++c3[index[j + 3]];
+            }
+            for (/**/; j < n; ++j)
+            {
+                ++c0[index[j]];
+            }
+        }
+    };
+
+    if (numThreads > 1)
+    {
+        std::vector<std::thread> process(numThreads);
+        for (unsigned int t = 0; t < numThreads; ++t)
+        {
+            size_t i0 = (numSamples * t) / numThreads;
+            size_t i1 = (numSamples * (t + 1)) / numThreads;
+            process[t] = std::thread(countRange, t, i0, i1);
+        }
+        for (unsigned int t = 0; t < numThreads; ++t)
+        {
+            process[t].join();
+        }
+    }
+    else
+    {
+        countRange(0, 0, numSamples);
+    }
+
+    // Merge the sub-histograms.
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        int const* c = local[t].data();
+        for (size_t copy = 0; copy < numCopies; ++copy, c += numCounts)
+        {
+            for (size_t k = 0; k < numCounts; ++k)
+            {
+                counts[k] += c[k];
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void Histogram::InsertDirect(size_t numSamples, SampleType const* samples,
+    unsigned int numThreads)
+{
+    if (numSamples > 0 && !samples)
+    {
+        LogError("Invalid inputs.");
+        return;
+    }
+
+    int const numBuckets = static_cast<int>(mBuckets.size());
+    std::vector<int> counts(mBuckets.size() + 2, 0);
+    Count(numSamples, mBuckets.size() + 2, numThreads,
+        [numBuckets, samples](size_t i)
+        {
+            int value = static_cast<int>(samples[i]);
+            return (value < 0 ? 0 : (value < numBuckets ? value + 1 : numBuckets + 1));
+        },
+        counts.data());
+
+    mExcessLess += counts[0];
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        mBuckets[i] += counts[i + 1];
+    }
+    mExcessGreater += counts[numBuckets + 1];
+}
+
+template <typename SampleType>
+void Histogram::InsertRescaled(size_t numSamples, SampleType const* samples,
+    SampleType minValue, SampleType maxValue, unsigned int numThreads)
+{
+    if ((numSamples > 0 && !samples) || !(minValue < maxValue))
+    {
+        LogError("Invalid inputs.");
+        return;
+    }
+
+    // The mapping is the same as for the constructors with real-valued
+    // samples.
+    int const numBuckets = static_cast<int>(mBuckets.size());
+    double numer = static_cast<double>(numBuckets - 1);
+    double denom = static_cast<double>(maxValue - minValue);
+    double mult = numer / denom;
+    std::vector<int> counts(mBuckets.size() + 2, 0);
+    Count(numSamples, mBuckets.size() + 2, numThreads,
+        [numBuckets, samples, minValue, maxValue, mult](size_t i)
+        {
+            SampleType value = samples[i];
+            if (!(value >= minValue))
+            {
+                // The value is smaller than minValue or is a NaN.
+                return 0;
+            }
+            if (value > maxValue)
+            {
+                return numBuckets + 1;
+            }
+            return 1 + static_cast<int>(mult * static_cast<double>(value - minValue));
+        },
+        counts.data());
+
+    mExcessLess += counts[0];
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        mBuckets[i] += counts[i + 1];
+    }
+    mExcessGreater += counts[numBuckets + 1];
+}
+
+template <typename SampleType>
+void Histogram::ComputeJoint(int numBuckets0, int numBuckets1, size_t numSamples,
+    SampleType const* samples0, SampleType const* samples1, unsigned int numThreads,
+    std::vector<int>& joint)
+{
+    if (numBuckets0 <= 0 || numBuckets1 <= 0 || (numSamples > 0 && (!samples0 || !samples1)))
+    {
+        LogError("Invalid inputs.");
+        joint.clear();
+        return;
+    }
+
+    // Counter 0 is used for the pairs with a value out of range.  The
+    // number of buckets can exceed the range of int, so the counter indices
+    // are computed in size_t.
+    size_t const numBuckets = static_cast<size_t>(numBuckets0) * static_cast<size_t>(numBuckets1);
+    std::vector<int> counts(numBuckets + 1, 0);
+    Count(numSamples, numBuckets + 1, numThreads,
+        [numBuckets0, numBuckets1, samples0, samples1](size_t i)
+        {
+            int v0 = static_cast<int>(samples0[i]);
+            int v1 = static_cast<int>(samples1[i]);
+            bool inRange = (0 <= v0 && v0 < numBuckets0 && 0 <= v1 && v1 < numBuckets1);
+            return (inRange ? 1 + static_cast<size_t>(v0) +
+                static_cast<size_t>(numBuckets0) * static_cast<size_t>(v1) : static_cast<size_t>(0));
+        },
+        counts.data());
+
+    joint.assign(counts.begin() + 1, counts.end());
+}
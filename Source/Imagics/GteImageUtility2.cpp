@@ -7,9 +7,13 @@
 
 #include <GTEnginePCH.h>
 #include <Imagics/GteImageUtility2.h>
+#include <Imagics/GteImageUtilityDetail.h>
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
 #include <cmath>
 #include <limits>
 using namespace gte;
+using namespace gte::ImageUtilityDetail;
 
 void ImageUtility2::GetComponents4(Image2<int>& image,
     std::vector<std::vector<size_t>>& components)
@@ -27,6 +31,26 @@ void ImageUtility2::GetComponents8(Image2<int>& image,
     GetComponents(8, &neighbors[0], image, components);
 }
 
+void ImageUtility2::GetComponents4(Image2<int>& image,
+    unsigned int numThreads, std::vector<std::vector<size_t>>& components)
+{
+    int const dim0 = image.GetDimension(0);
+    std::array<int, 1> rowDelta = { -1 };
+    std::array<int, 1> prevDelta = { -dim0 };
+    GetComponents(1, &rowDelta[0], 1, &prevDelta[0], numThreads, image,
+        components);
+}
+
+void ImageUtility2::GetComponents8(Image2<int>& image,
+    unsigned int numThreads, std::vector<std::vector<size_t>>& components)
+{
+    int const dim0 = image.GetDimension(0);
+    std::array<int, 1> rowDelta = { -1 };
+    std::array<int, 3> prevDelta = { -dim0 - 1, -dim0, -dim0 + 1 };
+    GetComponents(1, &rowDelta[0], 3, &prevDelta[0], numThreads, image,
+        components);
+}
+
 void ImageUtility2::Dilate4(Image2<int> const& input, Image2<int>& output)
 {
     std::array<std::array<int, 2>, 4> neighbors;
@@ -185,6 +209,40 @@ void ImageUtility2::Close(Image2<int> const& input, bool zeroExterior,
     Erode(temp, zeroExterior, numNeighbors, neighbors, output);
 }
 
+void ImageUtility2::DilateRectangle(Image2<int> const& input, int xRadius,
+    int yRadius, unsigned int numThreads, Image2<int>& output)
+{
+    MinMaxFilter2(input, xRadius, yRadius, true,
+        std::numeric_limits<int>::min(), numThreads, output);
+}
+
+void ImageUtility2::ErodeRectangle(Image2<int> const& input,
+    bool zeroExterior, int xRadius, int yRadius, unsigned int numThreads,
+    Image2<int>& output)
+{
+    MinMaxFilter2(input, xRadius, yRadius, false,
+        (zeroExterior ? 0 : std::numeric_limits<int>::max()), numThreads,
+        output);
+}
+
+void ImageUtility2::OpenRectangle(Image2<int> const& input,
+    bool zeroExterior, int xRadius, int yRadius, unsigned int numThreads,
+    Image2<int>& output)
+{
+    Image2<int> temp(input.GetDimension(0), input.GetDimension(1));
+    ErodeRectangle(input, zeroExterior, xRadius, yRadius, numThreads, temp);
+    DilateRectangle(temp, xRadius, yRadius, numThreads, output);
+}
+
+void ImageUtility2::CloseRectangle(Image2<int> const& input,
+    bool zeroExterior, int xRadius, int yRadius, unsigned int numThreads,
+    Image2<int>& output)
+{
+    Image2<int> temp(input.GetDimension(0), input.GetDimension(1));
+    DilateRectangle(input, xRadius, yRadius, numThreads, temp);
+    ErodeRectangle(temp, zeroExterior, xRadius, yRadius, numThreads, output);
+}
+
 bool ImageUtility2::ExtractBoundary(int x, int y, Image2<int>& image,
     std::vector<size_t>& boundary)
 {
@@ -556,6 +614,51 @@ void ImageUtility2::GetL2Distance(Image2<int> const& image,
     }
 }
 
+void ImageUtility2::GetExactL2Distance(Image2<int> const& image,
+    unsigned int numThreads, float& maxDistance, int& xMax, int& yMax,
+    Image2<float>& transform)
+{
+    Image2<int> sqrDistance;
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, nullptr);
+
+    int const dim0 = image.GetDimension(0);
+    int const dim1 = image.GetDimension(1);
+    transform.Reconstruct(dim0, dim1);
+    xMax = 0;
+    yMax = 0;
+    maxDistance = 0.0f;
+    for (int y = 0; y < dim1; ++y)
+    {
+        for (int x = 0; x < dim0; ++x)
+        {
+            int sqrDist = sqrDistance(x, y);
+            float distance = (sqrDist < std::numeric_limits<int>::max() ?
+                std::sqrt(static_cast<float>(sqrDist)) :
+                std::numeric_limits<float>::max());
+            if (distance > maxDistance)
+            {
+                maxDistance = distance;
+                xMax = x;
+                yMax = y;
+            }
+            transform(x, y) = distance;
+        }
+    }
+}
+
+void ImageUtility2::GetExactSqrL2Distance(Image2<int> const& image,
+    unsigned int numThreads, Image2<int>& sqrDistance)
+{
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, nullptr);
+}
+
+void ImageUtility2::GetExactSqrL2Distance(Image2<int> const& image,
+    unsigned int numThreads, Image2<int>& sqrDistance,
+    Image2<size_t>& nearest)
+{
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, &nearest);
+}
+
 void ImageUtility2::GetSkeleton(Image2<int>& image)
 {
     int const dim0 = image.GetDimension(0);
@@ -990,6 +1093,263 @@ void ImageUtility2::GetComponents(int numNeighbors, int const* delta,
     }
 }
 
+void ImageUtility2::GetComponents(int numRowNeighbors, int const* rowDelta,
+    int numPrevNeighbors, int const* prevDelta, unsigned int numThreads,
+    Image2<int>& image, std::vector<std::vector<size_t>>& components)
+{
+    // The union-find parent of a foreground pixel is stored as the pixel
+    // value, which is the index of a foreground pixel that precedes it in
+    // raster order (or the index of the pixel itself when it is a root).
+    // The image boundary is zero, so the indices of foreground pixels are
+    // larger than 1 and a value of 1 means "not yet visited".  The roots
+    // are always the minimum indices of their sets.
+    size_t const numPixels = image.GetNumPixels();
+    LogAssert(numPixels < static_cast<size_t>(std::numeric_limits<int>::max()),
+        "The image has too many pixels for in-place labeling.");
+
+    int const dim0 = image.GetDimension(0);
+    int const dim1 = image.GetDimension(1);
+
+    // Label the strips concurrently.  The neighbors in the row preceding
+    // the first row of a strip are ignored, so each thread accesses only
+    // the pixels of its own strip.
+    std::vector<char> isStripStart(dim1, 0);
+    ParallelFor(static_cast<size_t>(dim1), 0, numThreads,
+        [&image, &isStripStart, dim0, numRowNeighbors, rowDelta,
+        numPrevNeighbors, prevDelta](unsigned int, size_t begin, size_t end)
+        {
+            int const y0 = static_cast<int>(begin), y1 = static_cast<int>(end);
+            isStripStart[y0] = 1;
+            for (int y = y0; y < y1; ++y)
+            {
+                int const numPrev = (y > y0 ? numPrevNeighbors : 0);
+                int i = dim0 * y;
+                for (int x = 0; x < dim0; ++x, ++i)
+                {
+                    if (image[i] != 0)
+                    {
+                        image[i] = i;
+                        for (int j = 0; j < numRowNeighbors; ++j)
+                        {
+                            int adj = i + rowDelta[j];
+                            if (image[adj] != 0)
+                            {
+                                Union(image, i, adj);
+                            }
+                        }
+                        for (int j = 0; j < numPrev; ++j)
+                        {
+                            int adj = i + prevDelta[j];
+                            if (image[adj] != 0)
+                            {
+                                Union(image, i, adj);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+    // Merge the equivalences across the strip boundaries.
+    for (int y = 1; y < dim1; ++y)
+    {
+        if (isStripStart[y])
+        {
+            int i = dim0 * y;
+            for (int x = 0; x < dim0; ++x, ++i)
+            {
+                if (image[i] != 0)
+                {
+                    for (int j = 0; j < numPrevNeighbors; ++j)
+                    {
+                        int adj = i + prevDelta[j];
+                        if (image[adj] != 0)
+                        {
+                            Union(image, i, adj);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Resolve the labels.  The parent of a pixel precedes it in raster
+    // order, so the parent has already been assigned its final label.  The
+    // final labels are stored as negative numbers to distinguish them from
+    // the parent indices.
+    int numComponents = 0;
+    for (int i = 0; i < static_cast<int>(numPixels); ++i)
+    {
+        int parent = image[i];
+        if (parent > 0)
+        {
+            image[i] = (parent == i ? -(++numComponents) : image[parent]);
+        }
+    }
+
+    if (numComponents > 0)
+    {
+        std::vector<size_t> numElements(numComponents + 1, 0);
+        for (size_t i = 0; i < numPixels; ++i)
+        {
+            int value = -image[i];
+            image[i] = value;
+            ++numElements[value];
+        }
+
+        components.resize(numComponents + 1);
+        for (int k = 1; k <= numComponents; ++k)
+        {
+            components[k].resize(numElements[k]);
+            numElements[k] = 0;
+        }
+
+        for (size_t i = 0; i < numPixels; ++i)
+        {
+            int value = image[i];
+            if (value != 0)
+            {
+                components[value][numElements[value]] = i;
+                ++numElements[value];
+            }
+        }
+    }
+}
+
+void ImageUtility2::MinMaxFilter2(Image2<int> const& input, int xRadius,
+    int yRadius, bool useMax, int padValue, unsigned int numThreads,
+    Image2<int>& output)
+{
+    // If the assertion is triggered, the function will run but the output
+    // will not be correct.
+    LogAssert(&output != &input, "Input and output must be different.");
+    LogAssert(xRadius >= 0 && yRadius >= 0, "Invalid radius.");
+
+    output = input;
+    int const dim0 = input.GetDimension(0);
+    int const dim1 = input.GetDimension(1);
+
+    // Filter the rows.
+    if (xRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim1), 0, numThreads,
+            [&output, dim0, xRadius, useMax, padValue](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const y0 = static_cast<int>(begin), y1 = static_cast<int>(end);
+                std::vector<int> g, h;
+                for (int y = y0; y < y1; ++y)
+                {
+                    MinMaxFilter1(dim0, xRadius, useMax, padValue, 1, 1,
+                        &output(0, y), g, h);
+                }
+            });
+    }
+
+    // Filter the columns.  The columns are processed in groups of adjacent
+    // columns so that the memory accesses are contiguous.
+    if (yRadius > 0)
+    {
+        int const maxLanes = 256;
+        ParallelFor(static_cast<size_t>(dim0), 0, numThreads,
+            [&output, dim0, yRadius, useMax, padValue, maxLanes](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const x0 = static_cast<int>(begin), x1 = static_cast<int>(end);
+                std::vector<int> g, h;
+                for (int x = x0; x < x1; x += maxLanes)
+                {
+                    int numLanes = std::min(maxLanes, x1 - x);
+                    MinMaxFilter1(output.GetDimension(1), yRadius, useMax,
+                        padValue, numLanes, static_cast<size_t>(dim0),
+                        &output(x, 0), g, h);
+                }
+            });
+    }
+}
+
+void ImageUtility2::GetExactSqrL2Distance(Image2<int> const& image,
+    unsigned int numThreads, Image2<int>& sqrDistance,
+    Image2<size_t>* nearest)
+{
+    int const dim0 = image.GetDimension(0);
+    int const dim1 = image.GetDimension(1);
+    int const infinity = std::numeric_limits<int>::max();
+    size_t const invalid = std::numeric_limits<size_t>::max();
+    sqrDistance.Reconstruct(dim0, dim1);
+    if (nearest)
+    {
+        nearest->Reconstruct(dim0, dim1);
+    }
+
+    // Transform the rows.  The 0-valued pixels are the sites.
+    ParallelFor(static_cast<size_t>(dim1), 0, numThreads,
+        [&image, &sqrDistance, nearest, dim0, infinity, invalid](unsigned int,
+            size_t begin, size_t end)
+        {
+            int const y0 = static_cast<int>(begin), y1 = static_cast<int>(end);
+            std::vector<int> f(dim0), q(dim0), v(dim0);
+            std::vector<double> z(dim0 + 1);
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = 0; x < dim0; ++x)
+                {
+                    f[x] = (image(x, y) == 0 ? 0 : infinity);
+                }
+
+                DistanceTransform1(dim0, f.data(), &sqrDistance(0, y),
+                    q.data(), v, z);
+
+                if (nearest)
+                {
+                    for (int x = 0; x < dim0; ++x)
+                    {
+                        (*nearest)(x, y) = (q[x] >= 0 ?
+                            nearest->GetIndex(q[x], y) : invalid);
+                    }
+                }
+            }
+        });
+
+    // Transform the columns.  The row distances are the heights of the
+    // parabolas and the nearest site of the minimizing parabola is
+    // inherited.
+    ParallelFor(static_cast<size_t>(dim0), 0, numThreads,
+        [&sqrDistance, nearest, dim1, invalid](unsigned int, size_t begin, size_t end)
+        {
+            int const x0 = static_cast<int>(begin), x1 = static_cast<int>(end);
+            std::vector<int> f(dim1), d(dim1), q(dim1), v(dim1);
+            std::vector<double> z(dim1 + 1);
+            std::vector<size_t> site(dim1);
+            for (int x = x0; x < x1; ++x)
+            {
+                for (int y = 0; y < dim1; ++y)
+                {
+                    f[y] = sqrDistance(x, y);
+                }
+
+                DistanceTransform1(dim1, f.data(), d.data(), q.data(), v, z);
+
+                for (int y = 0; y < dim1; ++y)
+                {
+                    sqrDistance(x, y) = d[y];
+                }
+
+                if (nearest)
+                {
+                    for (int y = 0; y < dim1; ++y)
+                    {
+                        site[y] = (*nearest)(x, y);
+                    }
+                    for (int y = 0; y < dim1; ++y)
+                    {
+                        (*nearest)(x, y) = (q[y] >= 0 ? site[q[y]] : invalid);
+                    }
+                }
+            }
+        });
+}
+
 void ImageUtility2::L2Check(int x, int y, int dx, int dy, Image2<int>& xNear,
     Image2<int>& yNear, Image2<int>& dist)
 {
@@ -7,7 +7,13 @@
 
 #include <GTEnginePCH.h>
 #include <Imagics/GteImageUtility3.h>
+#include <Imagics/GteImageUtilityDetail.h>
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 using namespace gte;
+using namespace gte::ImageUtilityDetail;
 
 void ImageUtility3::GetComponents6(Image3<int>& image,
     std::vector<std::vector<size_t>>& components)
@@ -33,6 +39,49 @@ void ImageUtility3::GetComponents26(Image3<int>& image,
     GetComponents(26, &neighbors[0], image, components);
 }
 
+void ImageUtility3::GetComponents6(Image3<int>& image,
+    unsigned int numThreads, std::vector<std::vector<size_t>>& components)
+{
+    int const dim0 = image.GetDimension(0);
+    int const dim01 = dim0 * image.GetDimension(1);
+    std::array<int, 2> sliceDelta = { -1, -dim0 };
+    std::array<int, 1> prevDelta = { -dim01 };
+    GetComponents(2, &sliceDelta[0], 1, &prevDelta[0], numThreads, image,
+        components);
+}
+
+void ImageUtility3::GetComponents18(Image3<int>& image,
+    unsigned int numThreads, std::vector<std::vector<size_t>>& components)
+{
+    int const dim0 = image.GetDimension(0);
+    int const dim01 = dim0 * image.GetDimension(1);
+    std::array<int, 4> sliceDelta = { -1, -dim0 - 1, -dim0, -dim0 + 1 };
+    std::array<int, 5> prevDelta =
+    {
+        -dim01 - dim0, -dim01 - 1, -dim01, -dim01 + 1, -dim01 + dim0
+    };
+    GetComponents(4, &sliceDelta[0], 5, &prevDelta[0], numThreads, image,
+        components);
+}
+
+void ImageUtility3::GetComponents26(Image3<int>& image,
+    unsigned int numThreads, std::vector<std::vector<size_t>>& components)
+{
+    int const dim0 = image.GetDimension(0);
+    int const dim01 = dim0 * image.GetDimension(1);
+    std::array<int, 4> sliceDelta = { -1, -dim0 - 1, -dim0, -dim0 + 1 };
+    std::array<int, 9> prevDelta;
+    for (int dy = -1, j = 0; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx, ++j)
+        {
+            prevDelta[j] = -dim01 + dim0 * dy + dx;
+        }
+    }
+    GetComponents(4, &sliceDelta[0], 9, &prevDelta[0], numThreads, image,
+        components);
+}
+
 void ImageUtility3::Dilate6(Image3<int> const& inImage, Image3<int>& outImage)
 {
     std::array<std::array<int, 3>, 6> neighbors;
@@ -56,6 +105,130 @@ void ImageUtility3::Dilate26(Image3<int> const& inImage,
     Dilate(26, &neighbors[0], inImage, outImage);
 }
 
+void ImageUtility3::DilateBox(Image3<int> const& inImage, int xRadius,
+    int yRadius, int zRadius, unsigned int numThreads, Image3<int>& outImage)
+{
+    MinMaxFilter3(inImage, xRadius, yRadius, zRadius, true,
+        std::numeric_limits<int>::min(), numThreads, outImage);
+}
+
+void ImageUtility3::ErodeBox(Image3<int> const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    Image3<int>& outImage)
+{
+    MinMaxFilter3(inImage, xRadius, yRadius, zRadius, false,
+        (zeroExterior ? 0 : std::numeric_limits<int>::max()), numThreads,
+        outImage);
+}
+
+void ImageUtility3::OpenBox(Image3<int> const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    Image3<int>& outImage)
+{
+    Image3<int> temp(inImage.GetDimension(0), inImage.GetDimension(1),
+        inImage.GetDimension(2));
+    ErodeBox(inImage, zeroExterior, xRadius, yRadius, zRadius, numThreads,
+        temp);
+    DilateBox(temp, xRadius, yRadius, zRadius, numThreads, outImage);
+}
+
+void ImageUtility3::CloseBox(Image3<int> const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    Image3<int>& outImage)
+{
+    Image3<int> temp(inImage.GetDimension(0), inImage.GetDimension(1),
+        inImage.GetDimension(2));
+    DilateBox(inImage, xRadius, yRadius, zRadius, numThreads, temp);
+    ErodeBox(temp, zeroExterior, xRadius, yRadius, zRadius, numThreads,
+        outImage);
+}
+
+void ImageUtility3::DilateBox(BinaryImage const& inImage, int xRadius,
+    int yRadius, int zRadius, unsigned int numThreads, BinaryImage& outImage)
+{
+    MinMaxFilter3(inImage, xRadius, yRadius, zRadius, true, false,
+        numThreads, outImage);
+}
+
+void ImageUtility3::ErodeBox(BinaryImage const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    BinaryImage& outImage)
+{
+    MinMaxFilter3(inImage, xRadius, yRadius, zRadius, false, !zeroExterior,
+        numThreads, outImage);
+}
+
+void ImageUtility3::OpenBox(BinaryImage const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    BinaryImage& outImage)
+{
+    BinaryImage temp;
+    ErodeBox(inImage, zeroExterior, xRadius, yRadius, zRadius, numThreads,
+        temp);
+    DilateBox(temp, xRadius, yRadius, zRadius, numThreads, outImage);
+}
+
+void ImageUtility3::CloseBox(BinaryImage const& inImage, bool zeroExterior,
+    int xRadius, int yRadius, int zRadius, unsigned int numThreads,
+    BinaryImage& outImage)
+{
+    BinaryImage temp;
+    DilateBox(inImage, xRadius, yRadius, zRadius, numThreads, temp);
+    ErodeBox(temp, zeroExterior, xRadius, yRadius, zRadius, numThreads,
+        outImage);
+}
+
+void ImageUtility3::GetExactL2Distance(Image3<int> const& image,
+    unsigned int numThreads, float& maxDistance, int& xMax, int& yMax,
+    int& zMax, Image3<float>& transform)
+{
+    Image3<int> sqrDistance;
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, nullptr);
+
+    int const dim0 = image.GetDimension(0);
+    int const dim1 = image.GetDimension(1);
+    int const dim2 = image.GetDimension(2);
+    transform.Reconstruct(dim0, dim1, dim2);
+    xMax = 0;
+    yMax = 0;
+    zMax = 0;
+    maxDistance = 0.0f;
+    for (int z = 0; z < dim2; ++z)
+    {
+        for (int y = 0; y < dim1; ++y)
+        {
+            for (int x = 0; x < dim0; ++x)
+            {
+                int sqrDist = sqrDistance(x, y, z);
+                float distance = (sqrDist < std::numeric_limits<int>::max() ?
+                    std::sqrt(static_cast<float>(sqrDist)) :
+                    std::numeric_limits<float>::max());
+                if (distance > maxDistance)
+                {
+                    maxDistance = distance;
+                    xMax = x;
+                    yMax = y;
+                    zMax = z;
+                }
+                transform(x, y, z) = distance;
+            }
+        }
+    }
+}
+
+void ImageUtility3::GetExactSqrL2Distance(Image3<int> const& image,
+    unsigned int numThreads, Image3<int>& sqrDistance)
+{
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, nullptr);
+}
+
+void ImageUtility3::GetExactSqrL2Distance(Image3<int> const& image,
+    unsigned int numThreads, Image3<int>& sqrDistance,
+    Image3<size_t>& nearest)
+{
+    GetExactSqrL2Distance(image, numThreads, sqrDistance, &nearest);
+}
+
 void ImageUtility3::ComputeCDConvex(Image3<int>& image)
 {
     int const dim0 = image.GetDimension(0);
@@ -397,3 +570,528 @@ void ImageUtility3::GetComponents(int numNeighbors, int const* delta,
         }
     }
 }
+
+void ImageUtility3::GetComponents(int numSliceNeighbors,
+    int const* sliceDelta, int numPrevNeighbors, int const* prevDelta,
+    unsigned int numThreads, Image3<int>& image,
+    std::vector<std::vector<size_t>>& components)
+{
+    // The union-find parent of a foreground voxel is stored as the voxel
+    // value, which is the index of a foreground voxel that precedes it in
+    // raster order (or the index of the voxel itself when it is a root).
+    // The image boundary is zero, so the indices of foreground voxels are
+    // larger than 1 and a value of 1 means "not yet visited".  The roots
+    // are always the minimum indices of their sets.
+    size_t const numVoxels = image.GetNumPixels();
+    LogAssert(numVoxels < static_cast<size_t>(std::numeric_limits<int>::max()),
+        "The image has too many voxels for in-place labeling.");
+
+    int const dim01 = image.GetDimension(0) * image.GetDimension(1);
+    int const dim2 = image.GetDimension(2);
+
+    // Label the slabs concurrently.  The neighbors in the slice preceding
+    // the first slice of a slab are ignored, so each thread accesses only
+    // the voxels of its own slab.
+    std::vector<char> isSlabStart(dim2, 0);
+    ParallelFor(static_cast<size_t>(dim2), 0, numThreads,
+        [&image, &isSlabStart, dim01, numSliceNeighbors, sliceDelta,
+        numPrevNeighbors, prevDelta](unsigned int, size_t begin, size_t end)
+        {
+            int const z0 = static_cast<int>(begin), z1 = static_cast<int>(end);
+            isSlabStart[z0] = 1;
+            for (int z = z0; z < z1; ++z)
+            {
+                int const numPrev = (z > z0 ? numPrevNeighbors : 0);
+                int i = dim01 * z;
+                for (int k = 0; k < dim01; ++k, ++i)
+                {
+                    if (image[i] != 0)
+                    {
+                        image[i] = i;
+                        for (int j = 0; j < numSliceNeighbors; ++j)
+                        {
+                            int adj = i + sliceDelta[j];
+                            if (image[adj] != 0)
+                            {
+                                Union(image, i, adj);
+                            }
+                        }
+                        for (int j = 0; j < numPrev; ++j)
+                        {
+                            int adj = i + prevDelta[j];
+                            if (image[adj] != 0)
+                            {
+                                Union(image, i, adj);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+    // Merge the equivalences across the slab boundaries.
+    for (int z = 1; z < dim2; ++z)
+    {
+        if (isSlabStart[z])
+        {
+            int i = dim01 * z;
+            for (int k = 0; k < dim01; ++k, ++i)
+            {
+                if (image[i] != 0)
+                {
+                    for (int j = 0; j < numPrevNeighbors; ++j)
+                    {
+                        int adj = i + prevDelta[j];
+                        if (image[adj] != 0)
+                        {
+                            Union(image, i, adj);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Resolve the labels.  The parent of a voxel precedes it in raster
+    // order, so the parent has already been assigned its final label.  The
+    // final labels are stored as negative numbers to distinguish them from
+    // the parent indices.
+    int numComponents = 0;
+    for (int i = 0; i < static_cast<int>(numVoxels); ++i)
+    {
+        int parent = image[i];
+        if (parent > 0)
+        {
+            image[i] = (parent == i ? -(++numComponents) : image[parent]);
+        }
+    }
+
+    if (numComponents > 0)
+    {
+        std::vector<size_t> numElements(numComponents + 1, 0);
+        for (size_t i = 0; i < numVoxels; ++i)
+        {
+            int value = -image[i];
+            image[i] = value;
+            ++numElements[value];
+        }
+
+        components.resize(numComponents + 1);
+        for (int k = 1; k <= numComponents; ++k)
+        {
+            components[k].resize(numElements[k]);
+            numElements[k] = 0;
+        }
+
+        for (size_t i = 0; i < numVoxels; ++i)
+        {
+            int value = image[i];
+            if (value != 0)
+            {
+                components[value][numElements[value]] = i;
+                ++numElements[value];
+            }
+        }
+    }
+}
+
+void ImageUtility3::MinMaxFilter3(Image3<int> const& inImage, int xRadius,
+    int yRadius, int zRadius, bool useMax, int padValue,
+    unsigned int numThreads, Image3<int>& outImage)
+{
+    // If the assertion is triggered, the function will run but the output
+    // will not be correct.
+    LogAssert(&outImage != &inImage, "Input and output must be different.");
+    LogAssert(xRadius >= 0 && yRadius >= 0 && zRadius >= 0,
+        "Invalid radius.");
+
+    outImage = inImage;
+    int const dim0 = inImage.GetDimension(0);
+    int const dim1 = inImage.GetDimension(1);
+    int const dim2 = inImage.GetDimension(2);
+    size_t const dim01 = static_cast<size_t>(dim0) * static_cast<size_t>(dim1);
+
+    // Filter in the x-direction, one line at a time.
+    if (xRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim2), 0, numThreads,
+            [&outImage, dim0, dim1, xRadius, useMax, padValue](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const z0 = static_cast<int>(begin), z1 = static_cast<int>(end);
+                std::vector<int> g, h;
+                for (int z = z0; z < z1; ++z)
+                {
+                    for (int y = 0; y < dim1; ++y)
+                    {
+                        MinMaxFilter1(dim0, xRadius, useMax, padValue, 1, 1,
+                            &outImage(0, y, z), g, h);
+                    }
+                }
+            });
+    }
+
+    // Filter in the y-direction.  The rows of a slice are the lanes.
+    if (yRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim2), 0, numThreads,
+            [&outImage, dim0, dim1, yRadius, useMax, padValue](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const z0 = static_cast<int>(begin), z1 = static_cast<int>(end);
+                std::vector<int> g, h;
+                for (int z = z0; z < z1; ++z)
+                {
+                    MinMaxFilter1(dim1, yRadius, useMax, padValue, dim0,
+                        static_cast<size_t>(dim0), &outImage(0, 0, z), g, h);
+                }
+            });
+    }
+
+    // Filter in the z-direction.  The rows with the same y-value are the
+    // lanes.
+    if (zRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim1), 0, numThreads,
+            [&outImage, dim0, dim2, dim01, zRadius, useMax, padValue](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const y0 = static_cast<int>(begin), y1 = static_cast<int>(end);
+                std::vector<int> g, h;
+                for (int y = y0; y < y1; ++y)
+                {
+                    MinMaxFilter1(dim2, zRadius, useMax, padValue, dim0,
+                        dim01, &outImage(0, y, 0), g, h);
+                }
+            });
+    }
+}
+
+void ImageUtility3::MinMaxFilterBits(int numElements, int radius,
+    bool useOr, uint64_t padWord, int numLanes, size_t stride,
+    uint64_t* data, std::vector<uint64_t>& g, std::vector<uint64_t>& h)
+{
+    // This is the van Herk/Gil-Werman algorithm of MinMaxFilter1 applied
+    // to words of 64 pixels.
+    int const width = 2 * radius + 1;
+    int const numPadded = numElements + 2 * radius;
+    int const numTotal = width * ((numPadded + width - 1) / width);
+    size_t const lanes = static_cast<size_t>(numLanes);
+    g.resize(numTotal * lanes);
+    h.resize(numTotal * lanes);
+    std::vector<uint64_t> padLine(lanes, padWord);
+
+    auto line = [numElements, radius, stride, data, &padLine](int k)
+    {
+        int i = k - radius;
+        return (0 <= i && i < numElements ? data + i * stride : padLine.data());
+    };
+
+    for (int k = 0; k < numTotal; ++k)
+    {
+        uint64_t* gk = &g[k * lanes];
+        if (k % width == 0)
+        {
+            std::copy(line(k), line(k) + lanes, gk);
+        }
+        else
+        {
+            SelectBits(useOr, numLanes, gk - lanes, line(k), gk);
+        }
+    }
+
+    for (int k = numTotal - 1; k >= 0; --k)
+    {
+        uint64_t* hk = &h[k * lanes];
+        if (k % width == width - 1)
+        {
+            std::copy(line(k), line(k) + lanes, hk);
+        }
+        else
+        {
+            SelectBits(useOr, numLanes, hk + lanes, line(k), hk);
+        }
+    }
+
+    for (int i = 0; i < numElements; ++i)
+    {
+        SelectBits(useOr, numLanes, &h[i * lanes],
+            &g[(i + 2 * radius) * lanes], data + i * stride);
+    }
+}
+
+void ImageUtility3::SelectBits(bool useOr, int numLanes, uint64_t const* v0,
+    uint64_t const* v1, uint64_t* result)
+{
+    if (useOr)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            result[j] = v0[j] | v1[j];
+        }
+    }
+    else
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            result[j] = v0[j] & v1[j];
+        }
+    }
+}
+
+void ImageUtility3::FilterRowBits(int numBits, int radius, bool useOr,
+    uint64_t padWord, uint64_t* row, std::vector<uint64_t>& buffer)
+{
+    // Copy the row to a buffer of L = numBits + 2*radius bits so that
+    // buffer bit j is row bit j-radius.  The bits of the buffer that do not
+    // correspond to row bits are padding.
+    int const length = numBits + 2 * radius;
+    int const numWords = (length + 63) / 64;
+    buffer.resize(numWords);
+    for (int k = 0; k < numWords; ++k)
+    {
+        buffer[k] = GetBits(row, numBits, 64 * k - radius, padWord);
+    }
+
+    // Let A_n(j) be the maximum (minimum) of the buffer bits j through
+    // j+n-1, so A_{2n}(j) = A_n(j) op A_n(j+n).  The window size is
+    // w = 2*radius+1 and, for the largest power of two p <= w,
+    // A_w(j) = A_p(j) op A_p(j+w-p).  The updates read only bits at or
+    // after the word being written, so they can be done in-place.
+    int const width = 2 * radius + 1;
+    int n = 1;
+    for (; 2 * n <= width; n *= 2)
+    {
+        for (int k = 0; k < numWords; ++k)
+        {
+            uint64_t shifted = GetBits(buffer.data(), length, 64 * k + n,
+                padWord);
+            buffer[k] = (useOr ? buffer[k] | shifted : buffer[k] & shifted);
+        }
+    }
+    if (n < width)
+    {
+        for (int k = 0; k < numWords; ++k)
+        {
+            uint64_t shifted = GetBits(buffer.data(), length,
+                64 * k + width - n, padWord);
+            buffer[k] = (useOr ? buffer[k] | shifted : buffer[k] & shifted);
+        }
+    }
+
+    // The output bit x is A_w(x), the operation applied to the row bits
+    // x-radius through x+radius.
+    int const numRowWords = (numBits + 63) / 64;
+    std::copy(buffer.begin(), buffer.begin() + numRowWords, row);
+    int const numLastBits = numBits - 64 * (numRowWords - 1);
+    if (numLastBits < 64)
+    {
+        row[numRowWords - 1] &= ((uint64_t)1 << numLastBits) - 1;
+    }
+}
+
+uint64_t ImageUtility3::GetBits(uint64_t const* words, int numBits, int bit,
+    uint64_t padWord)
+{
+    int const numWords = (numBits + 63) / 64;
+    int const numLastBits = numBits - 64 * (numWords - 1);
+    auto word = [words, numWords, numLastBits, padWord](int k)
+    {
+        if (0 <= k && k < numWords)
+        {
+            if (k < numWords - 1 || numLastBits == 64)
+            {
+                return words[k];
+            }
+            uint64_t mask = ((uint64_t)1 << numLastBits) - 1;
+            return (words[k] & mask) | (padWord & ~mask);
+        }
+        return padWord;
+    };
+
+    // Use floor division so that negative bit indices are handled.
+    int k = (bit >= 0 ? bit / 64 : -((63 - bit) / 64));
+    int shift = bit - 64 * k;
+    if (shift == 0)
+    {
+        return word(k);
+    }
+    return (word(k) >> shift) | (word(k + 1) << (64 - shift));
+}
+
+void ImageUtility3::MinMaxFilter3(BinaryImage const& inImage, int xRadius,
+    int yRadius, int zRadius, bool useOr, bool padBit,
+    unsigned int numThreads, BinaryImage& outImage)
+{
+    // If the assertion is triggered, the function will run but the output
+    // will not be correct.
+    LogAssert(&outImage != &inImage, "Input and output must be different.");
+    LogAssert(xRadius >= 0 && yRadius >= 0 && zRadius >= 0,
+        "Invalid radius.");
+
+    outImage = inImage;
+    int const dim0 = inImage.GetDimension(0);
+    int const dim1 = inImage.GetDimension(1);
+    int const dim2 = inImage.GetDimension(2);
+    int const numWordsPerRow = inImage.GetNumWordsPerRow();
+    uint64_t const padWord = (padBit ? ~(uint64_t)0 : (uint64_t)0);
+
+    // Filter in the x-direction, one row at a time.
+    if (xRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim1 * dim2), 0, numThreads,
+            [&outImage, dim0, dim1, xRadius, useOr, padWord](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const r0 = static_cast<int>(begin), r1 = static_cast<int>(end);
+                std::vector<uint64_t> buffer;
+                for (int r = r0; r < r1; ++r)
+                {
+                    FilterRowBits(dim0, xRadius, useOr, padWord,
+                        outImage.GetRow(r % dim1, r / dim1), buffer);
+                }
+            });
+    }
+
+    // Filter in the y-direction.  The words of a row are the lanes.
+    if (yRadius > 0)
+    {
+        ParallelFor(static_cast<size_t>(dim2), 0, numThreads,
+            [&outImage, dim1, numWordsPerRow, yRadius, useOr, padWord](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const z0 = static_cast<int>(begin), z1 = static_cast<int>(end);
+                std::vector<uint64_t> g, h;
+                for (int z = z0; z < z1; ++z)
+                {
+                    MinMaxFilterBits(dim1, yRadius, useOr, padWord,
+                        numWordsPerRow, static_cast<size_t>(numWordsPerRow),
+                        outImage.GetRow(0, z), g, h);
+                }
+            });
+    }
+
+    // Filter in the z-direction.  The words of a row are the lanes.
+    if (zRadius > 0)
+    {
+        size_t const sliceStride = static_cast<size_t>(numWordsPerRow) *
+            static_cast<size_t>(dim1);
+        ParallelFor(static_cast<size_t>(dim1), 0, numThreads,
+            [&outImage, dim2, numWordsPerRow, sliceStride, zRadius, useOr, padWord](unsigned int,
+                size_t begin, size_t end)
+            {
+                int const y0 = static_cast<int>(begin), y1 = static_cast<int>(end);
+                std::vector<uint64_t> g, h;
+                for (int y = y0; y < y1; ++y)
+                {
+                    MinMaxFilterBits(dim2, zRadius, useOr, padWord,
+                        numWordsPerRow, sliceStride, outImage.GetRow(y, 0),
+                        g, h);
+                }
+            });
+    }
+}
+
+void ImageUtility3::GetExactSqrL2Distance(Image3<int> const& image,
+    unsigned int numThreads, Image3<int>& sqrDistance,
+    Image3<size_t>* nearest)
+{
+    int const dim0 = image.GetDimension(0);
+    int const dim1 = image.GetDimension(1);
+    int const dim2 = image.GetDimension(2);
+    size_t const dim01 = static_cast<size_t>(dim0) * static_cast<size_t>(dim1);
+    size_t const numVoxels = image.GetNumPixels();
+
+    // The 0-valued voxels are the sites.  Each voxel is initially its own
+    // nearest site, which is correct for the sites and irrelevant for the
+    // other voxels.
+    sqrDistance.Reconstruct(dim0, dim1, dim2);
+    for (size_t i = 0; i < numVoxels; ++i)
+    {
+        sqrDistance[i] = (image[i] == 0 ? 0 : std::numeric_limits<int>::max());
+    }
+    if (nearest)
+    {
+        nearest->Reconstruct(dim0, dim1, dim2);
+        for (size_t i = 0; i < numVoxels; ++i)
+        {
+            (*nearest)[i] = i;
+        }
+    }
+
+    // Transform the lines in the x-direction.
+    std::vector<size_t> first(static_cast<size_t>(dim1) * static_cast<size_t>(dim2));
+    for (size_t j = 0; j < first.size(); ++j)
+    {
+        first[j] = j * static_cast<size_t>(dim0);
+    }
+    TransformLines(dim0, 1, first, numThreads, sqrDistance, nearest);
+
+    // Transform the lines in the y-direction.  The parabola heights are
+    // the distances computed by the previous pass and the nearest site of
+    // the minimizing parabola is inherited.
+    first.resize(static_cast<size_t>(dim0) * static_cast<size_t>(dim2));
+    for (int z = 0, j = 0; z < dim2; ++z)
+    {
+        for (int x = 0; x < dim0; ++x, ++j)
+        {
+            first[j] = static_cast<size_t>(x) + dim01 * static_cast<size_t>(z);
+        }
+    }
+    TransformLines(dim1, static_cast<size_t>(dim0), first, numThreads,
+        sqrDistance, nearest);
+
+    // Transform the lines in the z-direction.
+    first.resize(dim01);
+    for (size_t j = 0; j < dim01; ++j)
+    {
+        first[j] = j;
+    }
+    TransformLines(dim2, dim01, first, numThreads, sqrDistance, nearest);
+}
+
+void ImageUtility3::TransformLines(int numElements, size_t stride,
+    std::vector<size_t> const& first, unsigned int numThreads,
+    Image3<int>& sqrDistance, Image3<size_t>* nearest)
+{
+    size_t const invalid = std::numeric_limits<size_t>::max();
+    ParallelFor(first.size(), 0, numThreads,
+        [numElements, stride, &first, &sqrDistance, nearest, invalid](unsigned int,
+            size_t begin, size_t end)
+        {
+            int const j0 = static_cast<int>(begin), j1 = static_cast<int>(end);
+            std::vector<int> f(numElements), d(numElements), q(numElements);
+            std::vector<int> v(numElements);
+            std::vector<double> z(numElements + 1);
+            std::vector<size_t> site(numElements);
+            for (int j = j0; j < j1; ++j)
+            {
+                size_t const i0 = first[j];
+                for (int i = 0; i < numElements; ++i)
+                {
+                    f[i] = sqrDistance[i0 + i * stride];
+                }
+
+                DistanceTransform1(numElements, f.data(), d.data(), q.data(),
+                    v, z);
+
+                for (int i = 0; i < numElements; ++i)
+                {
+                    sqrDistance[i0 + i * stride] = d[i];
+                }
+
+                if (nearest)
+                {
+                    for (int i = 0; i < numElements; ++i)
+                    {
+                        site[i] = (*nearest)[i0 + i * stride];
+                    }
+                    for (int i = 0; i < numElements; ++i)
+                    {
+                        (*nearest)[i0 + i * stride] =
+                            (q[i] >= 0 ? site[q[i]] : invalid);
+                    }
+                }
+            }
+        });
+}